@@ -124,6 +124,7 @@ main (int argc, char **argv)
   p4est_connectivity_t *conn;
   p4est_quadrant_t   *points;
   p4est_t            *p4est;
+  sc_array_t         *parray;
   sc_MPI_Comm         mpicomm;
   const char         *usage;
 
@@ -152,6 +153,7 @@ main (int argc, char **argv)
     "   Maxpoints is the maximum number of points per quadrant\n"
     "      which applies to all quadrants above maxlevel\n"
     "      A value of 0 refines recursively to maxlevel\n"
+    "         and builds the forest bottom-up\n"
     "      A value of -1 does no refinement at all\n"
     "   Prefix is for loading a point data file\n";
   wrongusage = 0;
@@ -218,8 +220,18 @@ main (int argc, char **argv)
   points = read_points (buffer, conn->num_trees, &num_points);
   SC_LDEBUGF ("Read %lld points\n", (long long) num_points);
 
-  p4est = p4est_new_points (mpicomm, conn, maxlevel, points,
-                            num_points, max_points, 5, NULL, NULL);
+  if (max_points == 0) {
+    parray = sc_array_new_count (sizeof (p4est_quadrant_t),
+                                 (size_t) num_points);
+    memcpy (parray->array, points, parray->elem_count * parray->elem_size);
+    p4est = p4est_new_points_bottomup (mpicomm, conn, maxlevel, parray,
+                                       5, NULL, NULL);
+    sc_array_destroy (parray);
+  }
+  else {
+    p4est = p4est_new_points (mpicomm, conn, maxlevel, points,
+                              num_points, max_points, 5, NULL, NULL);
+  }
   P4EST_FREE (points);
   p4est_vtk_write_file (p4est, NULL, P4EST_STRING "_points_created");
 
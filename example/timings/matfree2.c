@@ -0,0 +1,682 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+/*
+ * Usage: p4est_matfree [-c <configuration>] [-l <level>] [-d <min degree>]
+ *                      [-D <max degree>] [-r <repetitions>]
+ *        possible configurations:
+ *        o brick     Refinement on a 2 by 2 brick.
+ *        o cubed     Refinement on a 6-tree cubed square.
+ *        o disk      Refinement on a 5-tree disk.
+ *
+ * Usage: p8est_matfree [-c <configuration>] [-l <level>] [-d <min degree>]
+ *                      [-D <max degree>] [-r <repetitions>]
+ *        possible configurations:
+ *        o brick     Refinement on a 2 by 2 by 2 brick.
+ *        o shell     Refinement on a 24-tree spherical shell.
+ *        o sphere    Refinement on a 13-tree solid sphere.
+ *
+ * For each polynomial degree, the program numbers the nodes with
+ * p4est_lnodes and applies a matrix-free Laplacian repeatedly.
+ * The operator gathers element values including the hanging node
+ * interpolation, applies the tensor product element matrices by
+ * sum factorization, scatters the results back and sums over processes.
+ * The time of each phase is reported together with the number of
+ * degrees of freedom processed per second.  The geometry of the trees
+ * is not used: every element is treated as an axis-aligned cube.
+ */
+
+#ifndef P4_TO_P8
+#include <p4est_bits.h>
+#include <p4est_extended.h>
+#include <p4est_ghost.h>
+#include <p4est_iterate.h>
+#include <p4est_lnodes.h>
+#else
+#include <p8est_bits.h>
+#include <p8est_extended.h>
+#include <p8est_ghost.h>
+#include <p8est_iterate.h>
+#include <p8est_lnodes.h>
+#endif
+#include <sc_flops.h>
+#include <sc_statistics.h>
+#include <sc_options.h>
+
+/** The maximum polynomial degree supported by this program. */
+#define MATFREE_MAX_DEGREE 8
+
+enum
+{
+  MATFREE_LNODES,
+  MATFREE_HANGING,
+  MATFREE_GHOST_EXCHANGE,
+  MATFREE_ITERATE,
+  MATFREE_GATHER,
+  MATFREE_KERNEL,
+  MATFREE_SCATTER,
+  MATFREE_SHARE,
+  MATFREE_APPLY,
+  MATFREE_DOFS_PER_SECOND,
+  MATFREE_NUM_STATS
+};
+
+/** Element matrices and work space of the tensor product operator. */
+typedef struct matfree_kernel
+{
+  int                 degree;   /**< Polynomial degree. */
+  int                 n;        /**< Nodes per direction: degree + 1. */
+  int                 vnodes;   /**< Nodes per element. */
+  double              M1[(MATFREE_MAX_DEGREE + 1) *
+                         (MATFREE_MAX_DEGREE + 1)];     /**< 1D mass. */
+  double              K1[(MATFREE_MAX_DEGREE + 1) *
+                         (MATFREE_MAX_DEGREE + 1)];     /**< 1D stiffness. */
+  double             *work[2];  /**< Two vectors of vnodes entries. */
+}
+matfree_kernel_t;
+
+/** Context for the p4est_iterate callbacks. */
+typedef struct matfree_iter
+{
+  double              volume_sum;       /**< Sum of the quadrant data. */
+  p4est_locidx_t      num_faces;        /**< Number of faces visited. */
+  p4est_locidx_t      num_hanging;      /**< Number of hanging faces. */
+}
+matfree_iter_t;
+
+static int          refine_level;
+static int          level_shift;
+
+static void
+init_data (p4est_t * p4est, p4est_topidx_t which_tree, p4est_quadrant_t * q)
+{
+  *(double *) q->p.user_data = (double) q->level;
+}
+
+static int
+refine_fractal (p4est_t * p4est, p4est_topidx_t which_tree,
+                p4est_quadrant_t * q)
+{
+  int                 qid;
+
+  if ((int) q->level >= refine_level) {
+    return 0;
+  }
+  if ((int) q->level < refine_level - level_shift) {
+    return 1;
+  }
+
+  qid = ((int) q->level == 0 ?
+         (which_tree % P4EST_CHILDREN) : p4est_quadrant_child_id (q));
+
+  return (qid == 0 || qid == 3
+#ifdef P4_TO_P8
+          || qid == 5 || qid == 6
+#endif
+    );
+}
+
+static void
+iter_volume (p4est_iter_volume_info_t * info, void *user_data)
+{
+  matfree_iter_t     *it = (matfree_iter_t *) user_data;
+
+  it->volume_sum += *(double *) info->quad->p.user_data;
+}
+
+static void
+iter_face (p4est_iter_face_info_t * info, void *user_data)
+{
+  size_t              zz;
+  matfree_iter_t     *it = (matfree_iter_t *) user_data;
+  p4est_iter_face_side_t *side;
+
+  ++it->num_faces;
+  for (zz = 0; zz < info->sides.elem_count; ++zz) {
+    side = (p4est_iter_face_side_t *) sc_array_index (&info->sides, zz);
+    if (side->is_hanging) {
+      ++it->num_hanging;
+    }
+  }
+}
+
+/** Compute the Gauss-Legendre points and weights on [-1, 1].
+ * \param [in] n        Number of points.
+ * \param [out] x       The n points in ascending order.
+ * \param [out] w       The n weights.
+ */
+static void
+gauss_legendre (int n, double *x, double *w)
+{
+  int                 i, j, k;
+  double              z, dz, p0, p1, p2, dp;
+
+  for (i = 0; i < n; ++i) {
+    z = -cos (M_PI * (i + .75) / (n + .5));
+    for (k = 0; k < 100; ++k) {
+      p0 = 1.;
+      p1 = z;
+      for (j = 1; j < n; ++j) {
+        p2 = ((2 * j + 1) * z * p1 - j * p0) / (j + 1);
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (z * p1 - p0) / (z * z - 1.);
+      dz = p1 / dp;
+      z -= dz;
+      if (fabs (dz) < 1e-15) {
+        break;
+      }
+    }
+    p0 = 1.;
+    p1 = z;
+    for (j = 1; j < n; ++j) {
+      p2 = ((2 * j + 1) * z * p1 - j * p0) / (j + 1);
+      p0 = p1;
+      p1 = p2;
+    }
+    dp = n * (z * p1 - p0) / (z * z - 1.);
+    x[i] = z;
+    w[i] = 2. / ((1. - z * z) * dp * dp);
+  }
+}
+
+/** Compute the 1D mass and stiffness matrices of the Lagrange basis
+ * on equidistant nodes of [-1, 1], consistent with p4est_lnodes.
+ */
+static void
+kernel_init (matfree_kernel_t * kernel, int degree)
+{
+  const int           n = degree + 1;
+  int                 i, j, l, m, q;
+  double              xq[MATFREE_MAX_DEGREE + 1];
+  double              wq[MATFREE_MAX_DEGREE + 1];
+  double              xn[MATFREE_MAX_DEGREE + 1];
+  double              phi[MATFREE_MAX_DEGREE + 1];
+  double              dphi[MATFREE_MAX_DEGREE + 1];
+  double              prod;
+
+  P4EST_ASSERT (1 <= degree && degree <= MATFREE_MAX_DEGREE);
+  kernel->degree = degree;
+  kernel->n = n;
+  kernel->vnodes = 1;
+  for (i = 0; i < P4EST_DIM; ++i) {
+    kernel->vnodes *= n;
+  }
+  kernel->work[0] = P4EST_ALLOC (double, 2 * kernel->vnodes);
+  kernel->work[1] = kernel->work[0] + kernel->vnodes;
+  memset (kernel->M1, 0, sizeof (kernel->M1));
+  memset (kernel->K1, 0, sizeof (kernel->K1));
+
+  for (i = 0; i < n; ++i) {
+    xn[i] = -1. + 2. * i / degree;
+  }
+  gauss_legendre (n, xq, wq);
+  for (q = 0; q < n; ++q) {
+    for (i = 0; i < n; ++i) {
+      phi[i] = 1.;
+      dphi[i] = 0.;
+      for (m = 0; m < n; ++m) {
+        if (m == i) {
+          continue;
+        }
+        phi[i] *= (xq[q] - xn[m]) / (xn[i] - xn[m]);
+        prod = 1. / (xn[i] - xn[m]);
+        for (l = 0; l < n; ++l) {
+          if (l != i && l != m) {
+            prod *= (xq[q] - xn[l]) / (xn[i] - xn[l]);
+          }
+        }
+        dphi[i] += prod;
+      }
+    }
+    for (i = 0; i < n; ++i) {
+      for (j = 0; j < n; ++j) {
+        kernel->M1[i * n + j] += wq[q] * phi[i] * phi[j];
+        kernel->K1[i * n + j] += wq[q] * dphi[i] * dphi[j];
+      }
+    }
+  }
+}
+
+static void
+kernel_reset (matfree_kernel_t * kernel)
+{
+  P4EST_FREE (kernel->work[0]);
+}
+
+/** Apply a 1D matrix in one coordinate direction of an element vector. */
+static void
+kernel_apply_1d (const matfree_kernel_t * kernel, const double *A, int dir,
+                 const double *in, double *out)
+{
+  const int           n = kernel->n;
+  int                 idx, i, j, stride, base;
+  double              sum;
+
+  for (stride = 1, i = 0; i < dir; ++i) {
+    stride *= n;
+  }
+  for (idx = 0; idx < kernel->vnodes; ++idx) {
+    i = (idx / stride) % n;
+    base = idx - i * stride;
+    sum = 0.;
+    for (j = 0; j < n; ++j) {
+      sum += A[i * n + j] * in[base + j * stride];
+    }
+    out[idx] = sum;
+  }
+}
+
+/** Apply the element Laplacian to a range of elements.
+ * The stiffness in direction d is K1 in d and M1 in all other directions.
+ */
+static void
+kernel_apply (matfree_kernel_t * kernel,
+              const p4est_quadrant_t ** quads, p4est_locidx_t count,
+              const double *ue, double *ve)
+{
+  const int           vnodes = kernel->vnodes;
+  int                 d, e, k, cur;
+  double              scale;
+  const double       *in;
+  p4est_locidx_t      el;
+
+  for (el = 0; el < count; ++el) {
+    /* (2 / h)^2 from the derivatives, (h / 2)^dim from the volume */
+#ifndef P4_TO_P8
+    scale = 1.;
+#else
+    scale = .5 * P4EST_QUADRANT_LEN (quads[el]->level) / P4EST_ROOT_LEN;
+#endif
+    memset (ve, 0, vnodes * sizeof (double));
+    for (d = 0; d < P4EST_DIM; ++d) {
+      in = ue;
+      cur = 0;
+      for (e = 0; e < P4EST_DIM; ++e) {
+        kernel_apply_1d (kernel, e == d ? kernel->K1 : kernel->M1, e,
+                         in, kernel->work[cur]);
+        in = kernel->work[cur];
+        cur ^= 1;
+      }
+      for (k = 0; k < vnodes; ++k) {
+        ve[k] += scale * in[k];
+      }
+    }
+    ue += vnodes;
+    ve += vnodes;
+  }
+}
+
+/** Sum the values of shared nodes over all processes. */
+static void
+share_sum (p4est_t * p4est, p4est_lnodes_t * lnodes, double *v)
+{
+  const int           npeers = (int) lnodes->sharers->elem_count;
+  int                 iq, jn, nshared;
+  const double       *w;
+  sc_array_t          node_data;
+  sc_array_t         *recv_data;
+  p4est_locidx_t      gl;
+  p4est_lnodes_rank_t *lrank;
+  p4est_lnodes_buffer_t *buffer;
+
+  sc_array_init_data (&node_data, v, sizeof (double),
+                      lnodes->num_local_nodes);
+  buffer = p4est_lnodes_share_all (&node_data, lnodes);
+  for (iq = 0; iq < npeers; ++iq) {
+    lrank = (p4est_lnodes_rank_t *) sc_array_index_int (lnodes->sharers, iq);
+    if (lrank->rank == p4est->mpirank) {
+      continue;
+    }
+    recv_data = (sc_array_t *) sc_array_index_int (buffer->recv_buffers, iq);
+    nshared = (int) lrank->shared_nodes.elem_count;
+    P4EST_ASSERT ((int) recv_data->elem_count == nshared);
+    w = (const double *) recv_data->array;
+    for (jn = 0; jn < nshared; ++jn) {
+      gl = *(p4est_locidx_t *) sc_array_index_int (&lrank->shared_nodes, jn);
+      v[gl] += w[jn];
+    }
+  }
+  p4est_lnodes_buffer_destroy (buffer);
+  sc_array_reset (&node_data);
+}
+
+/** Apply the operator out = A in, processing the elements in blocks.
+ * \param [in,out] timers   If not NULL, the wall clock times of gather,
+ *                          kernel, scatter and share are added to it.
+ */
+static void
+matfree_apply (p4est_t * p4est, p4est_lnodes_t * lnodes,
+               p4est_lnodes_hanging_t * hanging, matfree_kernel_t * kernel,
+               const p4est_quadrant_t ** quads, p4est_locidx_t block,
+               double *ue, double *ve, const double *in, double *out,
+               double timers[4])
+{
+  p4est_locidx_t      first, count;
+  double              t0 = 0., t1;
+
+  memset (out, 0, lnodes->num_local_nodes * sizeof (double));
+  for (first = 0; first < lnodes->num_local_elements; first += count) {
+    count = SC_MIN (block, lnodes->num_local_elements - first);
+    if (timers != NULL) {
+      t0 = sc_MPI_Wtime ();
+    }
+    p4est_lnodes_gather (hanging, in, first, count, ue);
+    if (timers != NULL) {
+      t1 = sc_MPI_Wtime ();
+      timers[0] += t1 - t0;
+      t0 = t1;
+    }
+    kernel_apply (kernel, quads + first, count, ue, ve);
+    if (timers != NULL) {
+      t1 = sc_MPI_Wtime ();
+      timers[1] += t1 - t0;
+      t0 = t1;
+    }
+    p4est_lnodes_scatter_add (hanging, ve, first, count, out);
+    if (timers != NULL) {
+      t1 = sc_MPI_Wtime ();
+      timers[2] += t1 - t0;
+    }
+  }
+  if (timers != NULL) {
+    t0 = sc_MPI_Wtime ();
+  }
+  share_sum (p4est, lnodes, out);
+  if (timers != NULL) {
+    timers[3] += sc_MPI_Wtime () - t0;
+  }
+}
+
+static void
+run_degree (p4est_t * p4est, p4est_ghost_t * ghost, double *ghost_data,
+            int degree, int reps, int block)
+{
+  int                 mpiret;
+  int                 r;
+  size_t              zz;
+  double              timers[4];
+  double              apply_time, max_time, residual;
+  double             *ue, *ve, *u, *v;
+  const p4est_quadrant_t **quads;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      el, lni;
+  p4est_gloidx_t      global_nodes;
+  p4est_tree_t       *tree;
+  p4est_lnodes_t     *lnodes;
+  p4est_lnodes_hanging_t *hanging;
+  matfree_kernel_t    kernel;
+  matfree_iter_t      it;
+  sc_statinfo_t       stats[MATFREE_NUM_STATS];
+  sc_flopinfo_t       fi, snapshot;
+
+  sc_flops_start (&fi);
+
+  /* time the node numbering */
+  sc_flops_snap (&fi, &snapshot);
+  lnodes = p4est_lnodes_new (p4est, ghost, degree);
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[MATFREE_LNODES], snapshot.iwtime, "Lnodes");
+
+  /* time the hanging node tables */
+  sc_flops_snap (&fi, &snapshot);
+  hanging = p4est_lnodes_hanging_new (lnodes, NULL);
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[MATFREE_HANGING], snapshot.iwtime, "Hanging");
+
+  /* time the exchange of one value per quadrant */
+  sc_flops_snap (&fi, &snapshot);
+  for (r = 0; r < reps; ++r) {
+    p4est_ghost_exchange_data (p4est, ghost, ghost_data);
+  }
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[MATFREE_GHOST_EXCHANGE], snapshot.iwtime / reps,
+                 "Ghost exchange");
+
+  /* time a traversal of volumes and faces */
+  memset (&it, 0, sizeof (it));
+  sc_flops_snap (&fi, &snapshot);
+  for (r = 0; r < reps; ++r) {
+    p4est_iterate (p4est, ghost, &it, iter_volume, iter_face,
+#ifdef P4_TO_P8
+                   NULL,
+#endif
+                   NULL);
+  }
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[MATFREE_ITERATE], snapshot.iwtime / reps,
+                 "Iterate");
+  P4EST_VERBOSEF ("Iterated faces %lld hanging %lld\n",
+                  (long long) it.num_faces / reps,
+                  (long long) it.num_hanging / reps);
+
+  /* collect the quadrants in the order of the lnodes elements */
+  quads = P4EST_ALLOC (const p4est_quadrant_t *, lnodes->num_local_elements);
+  for (el = 0, jt = p4est->first_local_tree; jt <= p4est->last_local_tree;
+       ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      quads[el++] = p4est_quadrant_array_index (&tree->quadrants, zz);
+    }
+  }
+  P4EST_ASSERT (el == lnodes->num_local_elements);
+
+  kernel_init (&kernel, degree);
+  ue = P4EST_ALLOC (double, (size_t) block * kernel.vnodes);
+  ve = P4EST_ALLOC (double, (size_t) block * kernel.vnodes);
+  u = P4EST_ALLOC (double, lnodes->num_local_nodes);
+  v = P4EST_ALLOC (double, lnodes->num_local_nodes);
+
+  /* the Laplacian of a constant vanishes even across hanging faces */
+  for (lni = 0; lni < lnodes->num_local_nodes; ++lni) {
+    u[lni] = 1.;
+  }
+  matfree_apply (p4est, lnodes, hanging, &kernel, quads, block,
+                 ue, ve, u, v, NULL);
+  residual = 0.;
+  for (lni = 0; lni < lnodes->num_local_nodes; ++lni) {
+    residual = SC_MAX (residual, fabs (v[lni]));
+  }
+  mpiret = sc_MPI_Allreduce (sc_MPI_IN_PLACE, &residual, 1, sc_MPI_DOUBLE,
+                             sc_MPI_MAX, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  for (lni = 0; lni < lnodes->num_local_nodes; ++lni) {
+    u[lni] = sin ((double) (lnodes->global_offset + lni));
+  }
+
+  /* time the phases of the operator separately */
+  memset (timers, 0, sizeof (timers));
+  for (r = 0; r < reps; ++r) {
+    matfree_apply (p4est, lnodes, hanging, &kernel, quads, block,
+                   ue, ve, u, v, timers);
+  }
+  sc_stats_set1 (&stats[MATFREE_GATHER], timers[0] / reps, "Gather");
+  sc_stats_set1 (&stats[MATFREE_KERNEL], timers[1] / reps, "Kernel");
+  sc_stats_set1 (&stats[MATFREE_SCATTER], timers[2] / reps, "Scatter");
+  sc_stats_set1 (&stats[MATFREE_SHARE], timers[3] / reps, "Share");
+
+  /* time the operator without intermediate timers */
+  mpiret = sc_MPI_Barrier (p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  sc_flops_snap (&fi, &snapshot);
+  for (r = 0; r < reps; ++r) {
+    matfree_apply (p4est, lnodes, hanging, &kernel, quads, block,
+                   ue, ve, u, v, NULL);
+  }
+  sc_flops_shot (&fi, &snapshot);
+  apply_time = snapshot.iwtime;
+  sc_stats_set1 (&stats[MATFREE_APPLY], apply_time / reps, "Apply");
+  sc_stats_set1 (&stats[MATFREE_DOFS_PER_SECOND],
+                 apply_time > 0. ? lnodes->owned_count * reps / apply_time :
+                 0., "DOFs per second");
+
+  /* report the global throughput */
+  global_nodes = lnodes->global_offset + lnodes->owned_count;
+  mpiret = sc_MPI_Bcast (&global_nodes, 1, P4EST_MPI_GLOIDX,
+                         p4est->mpisize - 1, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Allreduce (&apply_time, &max_time, 1, sc_MPI_DOUBLE,
+                             sc_MPI_MAX, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_GLOBAL_STATISTICSF
+    ("Degree %d nodes %lld residual %g global DOFs per second %g\n",
+     degree, (long long) global_nodes, residual,
+     max_time > 0. ? (double) global_nodes * reps / max_time : 0.);
+
+  sc_stats_compute (p4est->mpicomm, MATFREE_NUM_STATS, stats);
+  sc_stats_print (p4est_package_id, SC_LP_STATISTICS,
+                  MATFREE_NUM_STATS, stats, 1, 1);
+
+  P4EST_FREE (v);
+  P4EST_FREE (u);
+  P4EST_FREE (ve);
+  P4EST_FREE (ue);
+  kernel_reset (&kernel);
+  P4EST_FREE (quads);
+  p4est_lnodes_hanging_destroy (hanging);
+  p4est_lnodes_destroy (lnodes);
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  int                 first_argc;
+  int                 degree, min_degree, max_degree;
+  int                 reps, block;
+  const char         *config_name;
+  double             *ghost_data;
+  sc_MPI_Comm         mpicomm;
+  sc_options_t       *opt;
+  p4est_connectivity_t *conn;
+  p4est_t            *p4est;
+  p4est_ghost_t      *ghost;
+
+  /* initialize MPI and p4est internals */
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+#ifndef P4EST_ENABLE_DEBUG
+  sc_set_log_defaults (NULL, NULL, SC_LP_STATISTICS);
+#endif
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+  /* process command line arguments */
+  opt = sc_options_new (argv[0]);
+  sc_options_add_int (opt, 'l', "level", &refine_level, 4,
+                      "maximum refine level");
+#ifndef P4_TO_P8
+  sc_options_add_string (opt, 'c', "configuration", &config_name, "brick",
+                         "configuration: brick|cubed|disk");
+#else
+  sc_options_add_string (opt, 'c', "configuration", &config_name, "brick",
+                         "configuration: brick|shell|sphere");
+#endif
+  sc_options_add_int (opt, 'd', "min-degree", &min_degree, 1,
+                      "minimum polynomial degree");
+  sc_options_add_int (opt, 'D', "max-degree", &max_degree,
+                      MATFREE_MAX_DEGREE, "maximum polynomial degree");
+  sc_options_add_int (opt, 'r', "repetitions", &reps, 10,
+                      "operator applications per degree");
+  sc_options_add_int (opt, 'b', "block", &block, 64,
+                      "elements per gather and scatter call");
+
+  first_argc = sc_options_parse (p4est_package_id, SC_LP_DEFAULT,
+                                 opt, argc, argv);
+  if (first_argc < 0 || first_argc != argc || refine_level < 0 ||
+      min_degree < 1 || max_degree > MATFREE_MAX_DEGREE ||
+      min_degree > max_degree || reps < 1 || block < 1) {
+    sc_options_print_usage (p4est_package_id, SC_LP_ERROR, opt, NULL);
+    return 1;
+  }
+  sc_options_print_summary (p4est_package_id, SC_LP_PRODUCTION, opt);
+
+  /* create connectivity */
+  conn = NULL;
+  if (!strcmp (config_name, "brick")) {
+#ifndef P4_TO_P8
+    conn = p4est_connectivity_new_brick (2, 2, 0, 0);
+#else
+    conn = p8est_connectivity_new_brick (2, 2, 2, 0, 0, 0);
+#endif
+  }
+#ifndef P4_TO_P8
+  else if (!strcmp (config_name, "cubed")) {
+    conn = p4est_connectivity_new_cubed ();
+  }
+  else if (!strcmp (config_name, "disk")) {
+    conn = p4est_connectivity_new_disk (0, 0);
+  }
+#else
+  else if (!strcmp (config_name, "shell")) {
+    conn = p8est_connectivity_new_shell ();
+  }
+  else if (!strcmp (config_name, "sphere")) {
+    conn = p8est_connectivity_new_sphere ();
+  }
+#endif
+  else {
+    P4EST_GLOBAL_LERRORF ("Wrong configuration name given: %s\n",
+                          config_name);
+    sc_options_print_usage (p4est_package_id, SC_LP_ERROR, opt, NULL);
+    sc_abort_collective ("Usage error");
+  }
+
+  /* create a 2:1 balanced forest with hanging faces */
+  level_shift = SC_MIN (refine_level, 2);
+  p4est = p4est_new_ext (mpicomm, conn, 0, refine_level - level_shift, 1,
+                         sizeof (double), init_data, NULL);
+  P4EST_GLOBAL_STATISTICSF
+    ("Processors %d configuration %s level %d shift %d\n",
+     p4est->mpisize, config_name, refine_level, level_shift);
+  p4est_refine (p4est, 1, refine_fractal, init_data);
+  p4est_partition (p4est, 0, NULL);
+  p4est_balance (p4est, P4EST_CONNECT_FULL, init_data);
+  p4est_partition (p4est, 0, NULL);
+  ghost = p4est_ghost_new (p4est, P4EST_CONNECT_FULL);
+  ghost_data = P4EST_ALLOC (double, ghost->ghosts.elem_count);
+  P4EST_GLOBAL_STATISTICSF ("Quadrants %lld\n",
+                            (long long) p4est->global_num_quadrants);
+
+  for (degree = min_degree; degree <= max_degree; ++degree) {
+    run_degree (p4est, ghost, ghost_data, degree, reps, block);
+  }
+
+  /* clean up and exit */
+  P4EST_FREE (ghost_data);
+  p4est_ghost_destroy (ghost);
+  p4est_destroy (p4est);
+  p4est_connectivity_destroy (conn);
+  sc_options_destroy (opt);
+
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}
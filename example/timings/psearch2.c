@@ -0,0 +1,368 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+/*
+ * Usage:
+ * p4est_psearch [-l <LEVEL>] [-s <LEVEL-SHIFT>] [-N <NUM-POINTS>] [-V]
+ *
+ * NUM-POINTS determines how many points are positioned randomly on each
+ * process and located in the local forest on the unit square/cube.
+ * The search is timed with the per-point callback of p4est_search_local
+ * and with the batched callback of p4est_search_local_batch.
+ */
+
+#ifndef P4_TO_P8
+#include <p4est_bits.h>
+#include <p4est_extended.h>
+#include <p4est_search.h>
+#include <p4est_vtk.h>
+#else
+#include <p8est_bits.h>
+#include <p8est_extended.h>
+#include <p8est_search.h>
+#include <p8est_vtk.h>
+#endif
+#include <sc_flops.h>
+#include <sc_options.h>
+#include <sc_statistics.h>
+
+static int          refine_level, level_shift;
+
+typedef enum psearch_stats
+{
+  PSEARCH_NEW,
+  PSEARCH_REFINE,
+  PSEARCH_PARTITION,
+  PSEARCH_SEARCH_POINT,
+  PSEARCH_SEARCH_BATCH,
+  PSEARCH_NUM_STATS
+}
+psearch_stats_t;
+
+typedef struct psearch_point
+{
+  double              xy[P4EST_DIM];
+  p4est_locidx_t      lid;
+}
+psearch_point_t;
+
+typedef struct
+{
+  size_t              matches;
+  double              lower[P4EST_DIM];
+  double              upper[P4EST_DIM];
+}
+psearch_global_t;
+
+static int
+refine_fractal_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                   p4est_quadrant_t * q)
+{
+  int                 qid;
+
+  if ((int) q->level >= refine_level) {
+    return 0;
+  }
+  if ((int) q->level < refine_level - level_shift) {
+    return 1;
+  }
+
+  qid = p4est_quadrant_child_id (q);
+  return (qid == 0 || qid == 3
+#ifdef P4_TO_P8
+          || qid == 5 || qid == 6
+#endif
+    );
+}
+
+/** Store the half-open bounding box of a quadrant in the global data. */
+static int
+psearch_quadrant_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                     p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
+                     void *point)
+{
+  psearch_global_t   *psg = (psearch_global_t *) p4est->user_pointer;
+  const double        irootlen = 1. / (double) P4EST_ROOT_LEN;
+  const double        width =
+    (double) P4EST_QUADRANT_LEN (quadrant->level) * irootlen;
+
+  P4EST_ASSERT (point == NULL);
+
+  psg->lower[0] = quadrant->x * irootlen;
+  psg->lower[1] = quadrant->y * irootlen;
+#ifdef P4_TO_P8
+  psg->lower[2] = quadrant->z * irootlen;
+#endif
+  psg->upper[0] = psg->lower[0] + width;
+  psg->upper[1] = psg->lower[1] + width;
+#ifdef P4_TO_P8
+  psg->upper[2] = psg->lower[2] + width;
+#endif
+
+  return 1;
+}
+
+static int
+psearch_point_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                  p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
+                  void *point)
+{
+  psearch_global_t   *psg = (psearch_global_t *) p4est->user_pointer;
+  psearch_point_t    *p = (psearch_point_t *) point;
+  int                 j;
+
+  for (j = 0; j < P4EST_DIM; ++j) {
+    if (p->xy[j] < psg->lower[j] || p->xy[j] >= psg->upper[j]) {
+      return 0;
+    }
+  }
+  if (local_num >= 0) {
+    P4EST_ASSERT (p->lid == -1);
+    p->lid = local_num;
+    ++psg->matches;
+  }
+  return 1;
+}
+
+static void
+psearch_batch_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                  p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
+                  sc_array_t * points, const size_t * indices,
+                  size_t num_indices, uint8_t * matches)
+{
+  psearch_global_t   *psg = (psearch_global_t *) p4est->user_pointer;
+  const psearch_point_t *base = (const psearch_point_t *) points->array;
+  const psearch_point_t *p;
+  const double        lx = psg->lower[0], ux = psg->upper[0];
+  const double        ly = psg->lower[1], uy = psg->upper[1];
+#ifdef P4_TO_P8
+  const double        lz = psg->lower[2], uz = psg->upper[2];
+#endif
+  size_t              zz;
+
+  /* branch-free bounding box test amenable to vectorization */
+  for (zz = 0; zz < num_indices; ++zz) {
+    p = base + indices[zz];
+    matches[zz] = (uint8_t) ((p->xy[0] >= lx) & (p->xy[0] < ux) &
+                             (p->xy[1] >= ly) & (p->xy[1] < uy)
+#ifdef P4_TO_P8
+                             & (p->xy[2] >= lz) & (p->xy[2] < uz)
+#endif
+      );
+  }
+
+  /* record the matches on a leaf */
+  if (local_num >= 0) {
+    for (zz = 0; zz < num_indices; ++zz) {
+      if (matches[zz]) {
+        P4EST_ASSERT (base[indices[zz]].lid == -1);
+        ((psearch_point_t *) points->array)[indices[zz]].lid = local_num;
+        ++psg->matches;
+      }
+    }
+  }
+}
+
+static void
+time_search (psearch_global_t * psg, p4est_t * p4est,
+             sc_MPI_Comm mpicomm, size_t znum_points,
+             sc_flopinfo_t * fi, sc_statinfo_t * stats)
+{
+  int                 j;
+  int                 mpiret;
+  long long           ll[2], gg[2];
+  size_t              zz;
+  p4est_locidx_t     *lids;
+  psearch_point_t    *p;
+  sc_array_t         *points;
+  sc_flopinfo_t       snapshot;
+
+  /* generate random points, which differ between processes */
+  points = sc_array_new_count (sizeof (psearch_point_t), znum_points);
+  for (zz = 0; zz < znum_points; ++zz) {
+    p = (psearch_point_t *) sc_array_index (points, zz);
+    for (j = 0; j < P4EST_DIM; ++j) {
+      p->xy[j] = rand () / (RAND_MAX + 1.);
+    }
+    p->lid = -1;
+  }
+
+  /* search with one callback per point and quadrant */
+  psg->matches = 0;
+  sc_flops_snap (fi, &snapshot);
+  p4est_search_local (p4est, 0, psearch_quadrant_fn, psearch_point_fn,
+                      points);
+  sc_flops_shot (fi, &snapshot);
+  sc_stats_set1 (&stats[PSEARCH_SEARCH_POINT], snapshot.iwtime,
+                 "Search per point");
+  ll[0] = (long long) psg->matches;
+
+  /* remember the results and reset the points */
+  lids = P4EST_ALLOC (p4est_locidx_t, znum_points);
+  for (zz = 0; zz < znum_points; ++zz) {
+    p = (psearch_point_t *) sc_array_index (points, zz);
+    lids[zz] = p->lid;
+    p->lid = -1;
+  }
+
+  /* search with one callback per quadrant */
+  psg->matches = 0;
+  sc_flops_snap (fi, &snapshot);
+  p4est_search_local_batch (p4est, 0, psearch_quadrant_fn, psearch_batch_fn,
+                            points);
+  sc_flops_shot (fi, &snapshot);
+  sc_stats_set1 (&stats[PSEARCH_SEARCH_BATCH], snapshot.iwtime,
+                 "Search batched");
+  ll[1] = (long long) psg->matches;
+
+  /* both searches must find the same quadrants */
+  for (zz = 0; zz < znum_points; ++zz) {
+    p = (psearch_point_t *) sc_array_index (points, zz);
+    SC_CHECK_ABORT (p->lid == lids[zz], "Batched search mismatch");
+  }
+  P4EST_FREE (lids);
+  sc_array_destroy (points);
+
+  mpiret = sc_MPI_Allreduce (ll, gg, 2, sc_MPI_LONG_LONG_INT, sc_MPI_SUM,
+                             mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_GLOBAL_STATISTICSF ("Matches per point %lld batched %lld\n",
+                            gg[0], gg[1]);
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  int                 mpisize, mpirank;
+  int                 first_argc;
+  int                 write_vtk;
+  size_t              znum_points;
+  sc_MPI_Comm         mpicomm;
+  p4est_connectivity_t *connectivity;
+  p4est_t            *p4est;
+  sc_statinfo_t       stats[PSEARCH_NUM_STATS];
+  sc_flopinfo_t       fi, snapshot;
+  sc_options_t       *opt;
+  psearch_global_t    psgt, *psg = &psgt;
+
+  /* initialize MPI */
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+  mpiret = sc_MPI_Comm_size (mpicomm, &mpisize);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Comm_rank (mpicomm, &mpirank);
+  SC_CHECK_MPI (mpiret);
+
+  /* initialize p4est internals */
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+#ifndef P4EST_ENABLE_DEBUG
+  sc_set_log_defaults (NULL, NULL, SC_LP_STATISTICS);
+#endif
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+  /* initialize global data */
+  srand (mpirank + 1);
+  memset (psg, 0, sizeof (*psg));
+
+  /* process command line arguments */
+  opt = sc_options_new (argv[0]);
+  sc_options_add_int (opt, 'l', "level", &refine_level, 0,
+                      "Refinement level");
+  sc_options_add_int (opt, 's', "level-shift", &level_shift, 4,
+                      "Refinement shift");
+  sc_options_add_bool (opt, 'V', "write-vtk", &write_vtk, 0,
+                       "Write VTK files");
+  sc_options_add_size_t (opt, 'N', "num-points", &znum_points, 0,
+                         "Number of points per process");
+  first_argc = sc_options_parse (p4est_package_id, SC_LP_ERROR,
+                                 opt, argc, argv);
+  if (first_argc < 0 || first_argc != argc) {
+    sc_options_print_usage (p4est_package_id, SC_LP_ERROR, opt, NULL);
+    return 1;
+  }
+  sc_options_print_summary (p4est_package_id, SC_LP_PRODUCTION, opt);
+
+  /* start overall timing */
+  mpiret = sc_MPI_Barrier (mpicomm);
+  SC_CHECK_MPI (mpiret);
+  sc_flops_start (&fi);
+
+  /* create connectivity and forest */
+  sc_flops_snap (&fi, &snapshot);
+#ifndef P4_TO_P8
+  connectivity = p4est_connectivity_new_unitsquare ();
+#else
+  connectivity = p8est_connectivity_new_unitcube ();
+#endif
+  p4est = p4est_new_ext (mpicomm, connectivity,
+                         0, SC_MAX (refine_level - level_shift, 0), 1, 0,
+                         NULL, psg);
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[PSEARCH_NEW], snapshot.iwtime, "New");
+
+  /* time refine */
+  sc_flops_snap (&fi, &snapshot);
+  p4est_refine (p4est, 1, refine_fractal_fn, NULL);
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[PSEARCH_REFINE], snapshot.iwtime, "Refine");
+
+  /* time a uniform partition */
+  sc_flops_snap (&fi, &snapshot);
+  p4est_partition (p4est, 0, NULL);
+  sc_flops_shot (&fi, &snapshot);
+  sc_stats_set1 (&stats[PSEARCH_PARTITION], snapshot.iwtime, "Partition");
+  if (write_vtk) {
+    p4est_vtk_write_file (p4est, NULL, P4EST_STRING "_psearch");
+  }
+
+  /* run search timings */
+  time_search (psg, p4est, mpicomm, znum_points, &fi, stats);
+
+  /* print status */
+  P4EST_GLOBAL_STATISTICSF
+    ("Processors %d level %d shift %d points %llu quadrants %lld\n",
+     mpisize, refine_level, level_shift, (unsigned long long) znum_points,
+     (long long) p4est->global_num_quadrants);
+
+  /* calculate and print timings */
+  sc_stats_compute (mpicomm, PSEARCH_NUM_STATS, stats);
+  sc_stats_print (p4est_package_id, SC_LP_ESSENTIAL,
+                  PSEARCH_NUM_STATS, stats, 1, 1);
+
+  /* destroy the p4est and its connectivity structure */
+  p4est_destroy (p4est);
+  p4est_connectivity_destroy (connectivity);
+
+  /* clean up and exit */
+  sc_options_destroy (opt);
+
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}
@@ -98,6 +98,7 @@ enum
   TIMINGS_BALANCE_RANGES,
   TIMINGS_BALANCE_NOTIFY,
   TIMINGS_BALANCE_NOTIFY_ALLGATHER,
+  TIMINGS_BALANCE_NOTIFY_NBX,
   TIMINGS_BALANCE_A_ZERO_SENDS,
   TIMINGS_BALANCE_A_ZERO_RECEIVES,
   TIMINGS_BALANCE_B_ZERO_SENDS,
@@ -120,6 +121,7 @@ enum
   TIMINGS_LNODES,
   TIMINGS_LNODES3,
   TIMINGS_LNODES7,
+  TIMINGS_NODES_HASH,
   TIMINGS_NUM_STATS
 };
 
@@ -243,7 +245,7 @@ main (int argc, char **argv)
   p4est_gloidx_t      global_shipped;
   p4est_connectivity_t *connectivity;
   p4est_t            *p4est;
-  p4est_nodes_t      *nodes = NULL;
+  p4est_nodes_t      *nodes = NULL, *hnodes;
   p4est_ghost_t      *ghost;
   p4est_lnodes_t     *lnodes;
   const timings_regression_t *r, *regression;
@@ -257,10 +259,12 @@ main (int argc, char **argv)
   int                 borders;
   int                 max_ranges;
   int                 use_ranges, use_ranges_notify, use_balance_verify;
+  int                 use_notify_nbx;
   int                 oldschool, generate;
   int                 first_argc;
   int                 test_multiple_orders;
   int                 skip_nodes, skip_lnodes;
+  int                 nodes_hash;
   int                 repartition_lnodes;
 
   /* initialize MPI and p4est internals */
@@ -298,6 +302,8 @@ main (int argc, char **argv)
                          "use both ranges and notify");
   sc_options_add_switch (opt, 'y', "balance-verify", &use_balance_verify,
                          "use verifications in balance");
+  sc_options_add_switch (opt, 0, "notify-nbx", &use_notify_nbx,
+                         "use nonblocking consensus in balance and nodes");
   sc_options_add_int (opt, 'l', "level", &refine_level, 0,
                       "initial refine level");
 #ifndef P4_TO_P8
@@ -318,6 +324,8 @@ main (int argc, char **argv)
                          "Also time lnodes for orders 2, 4, and 8");
   sc_options_add_switch (opt, 0, "skip-nodes", &skip_nodes, "Skip nodes");
   sc_options_add_switch (opt, 0, "skip-lnodes", &skip_lnodes, "Skip lnodes");
+  sc_options_add_switch (opt, 0, "nodes-hash", &nodes_hash,
+                         "Also time nodes with the original hash arrays");
   sc_options_add_switch (opt, 0, "repartition-lnodes",
                          &repartition_lnodes,
                          "Repartition to load-balance lnodes");
@@ -504,6 +512,7 @@ main (int argc, char **argv)
   p4est->inspect->use_balance_ranges = use_ranges;
   p4est->inspect->use_balance_ranges_notify = use_ranges_notify;
   p4est->inspect->use_balance_verify = use_balance_verify;
+  p4est->inspect->use_notify_nbx = use_notify_nbx;
   p4est->inspect->balance_max_ranges = max_ranges;
   P4EST_GLOBAL_STATISTICSF
     ("Balance: new overlap %d new subtree %d borders %d\n", overlap,
@@ -556,6 +565,9 @@ main (int argc, char **argv)
   sc_stats_set1 (&stats[TIMINGS_BALANCE_NOTIFY_ALLGATHER],
                  p4est->inspect->balance_notify_allgather,
                  "Balance time for notify_allgather");
+  sc_stats_set1 (&stats[TIMINGS_BALANCE_NOTIFY_NBX],
+                 p4est->inspect->balance_notify_nbx,
+                 "Balance time for notify_nbx");
   sc_stats_set1 (&stats[TIMINGS_BALANCE_A_ZERO_RECEIVES],
                  p4est->inspect->balance_zero_receives[0],
                  "Balance A zero receives");
@@ -637,6 +649,28 @@ main (int argc, char **argv)
   /* set this anyway so the output format is dimension independent */
   sc_stats_set1 (&stats[TIMINGS_TRILINEAR_OBSOLETE], 0., "Unused");
 
+  /* compare with the node numbering based on hash arrays */
+  if (!skip_nodes && nodes_hash) {
+    p4est->inspect->use_nodes_hash = 1;
+    sc_flops_snap (&fi, &snapshot);
+    hnodes = p4est_nodes_new (p4est, ghost);
+    sc_flops_shot (&fi, &snapshot);
+    sc_stats_set1 (&stats[TIMINGS_NODES_HASH], snapshot.iwtime,
+                   "Nodes hash");
+    p4est->inspect->use_nodes_hash = 0;
+    SC_CHECK_ABORT (hnodes->indep_nodes.elem_count ==
+                    nodes->indep_nodes.elem_count &&
+                    hnodes->face_hangings.elem_count ==
+                    nodes->face_hangings.elem_count &&
+                    !memcmp (hnodes->local_nodes, nodes->local_nodes,
+                             P4EST_CHILDREN * nodes->num_local_quadrants *
+                             sizeof (p4est_locidx_t)), "Nodes hash mismatch");
+    p4est_nodes_destroy (hnodes);
+  }
+  else {
+    sc_stats_set1 (&stats[TIMINGS_NODES_HASH], 0., "Nodes hash");
+  }
+
   if (!skip_nodes) {
     p4est_nodes_destroy (nodes);
   }
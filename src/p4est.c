@@ -925,6 +925,690 @@ p4est_refine_ext (p4est_t * p4est, int refine_recursive, int allowed_level,
                             (long long) p4est->global_num_quadrants);
 }
 
+void
+p4est_refine_flags (p4est_t * p4est, const int8_t * flags,
+                    int allowed_level, p4est_init_t init_fn,
+                    p4est_replace_t replace_fn, p4est_locidx_t * old_to_new)
+{
+  int                 i, maxlevel;
+  p4est_topidx_t      nt;
+  p4est_locidx_t      old_offset, new_count;
+  p4est_gloidx_t      old_gnq;
+  size_t              zz, incount, current;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, *c;
+  sc_array_t         *tquadrants, refined;
+  p4est_quadrant_t   *family[P4EST_CHILDREN];
+  p4est_quadrant_t    parent, *pp = &parent;
+
+  if (allowed_level < 0) {
+    allowed_level = P4EST_QMAXLEVEL;
+  }
+  P4EST_GLOBAL_PRODUCTIONF ("Into " P4EST_STRING
+                            "_refine_flags with %lld total quadrants,"
+                            " allowed level %d\n",
+                            (long long) p4est->global_num_quadrants,
+                            allowed_level);
+  p4est_log_indent_push ();
+  P4EST_ASSERT (p4est_is_valid (p4est));
+  P4EST_ASSERT (0 <= allowed_level && allowed_level <= P4EST_QMAXLEVEL);
+  P4EST_ASSERT (flags != NULL || p4est->local_num_quadrants == 0);
+
+  /* remember input quadrant count; it will not decrease */
+  old_gnq = p4est->global_num_quadrants;
+
+  /* loop over all local trees */
+  old_offset = 0;
+  new_count = 0;
+  for (nt = p4est->first_local_tree; nt <= p4est->last_local_tree; ++nt) {
+    tree = p4est_tree_array_index (p4est->trees, nt);
+    tree->quadrants_offset = new_count;
+    tquadrants = &tree->quadrants;
+    incount = tquadrants->elem_count;
+
+    /* count the output quadrants of this tree */
+    current = incount;
+    for (zz = 0; zz < incount; ++zz) {
+      q = p4est_quadrant_array_index (tquadrants, zz);
+      if (flags[old_offset + (p4est_locidx_t) zz] &&
+          (int) q->level < allowed_level) {
+        current += P4EST_CHILDREN - 1;
+      }
+    }
+    if (current == incount) {
+      /* no refinement occurs in this tree */
+      if (old_to_new != NULL) {
+        for (zz = 0; zz < incount; ++zz) {
+          old_to_new[old_offset + (p4est_locidx_t) zz] =
+            new_count + (p4est_locidx_t) zz;
+        }
+      }
+      old_offset += (p4est_locidx_t) incount;
+      new_count += (p4est_locidx_t) incount;
+      continue;
+    }
+
+    /* stream the quadrants and their children into a new array */
+    maxlevel = 0;
+    for (i = 0; i <= P4EST_QMAXLEVEL; ++i) {
+      tree->quadrants_per_level[i] = 0;
+    }
+    sc_array_init_size (&refined, sizeof (p4est_quadrant_t), current);
+    current = 0;
+    for (zz = 0; zz < incount; ++zz) {
+      q = p4est_quadrant_array_index (tquadrants, zz);
+      if (old_to_new != NULL) {
+        old_to_new[old_offset + (p4est_locidx_t) zz] =
+          new_count + (p4est_locidx_t) current;
+      }
+      c = p4est_quadrant_array_index (&refined, current);
+      if (!(flags[old_offset + (p4est_locidx_t) zz] &&
+            (int) q->level < allowed_level)) {
+        /* the quadrant is kept including its user data */
+        *c = *q;
+        maxlevel = SC_MAX (maxlevel, (int) q->level);
+        ++tree->quadrants_per_level[q->level];
+        ++current;
+        continue;
+      }
+
+      /* replace the quadrant by its children */
+      parent = *q;
+      p4est_quadrant_childrenv (&parent, c);
+      for (i = 0; i < P4EST_CHILDREN; ++i) {
+        p4est_quadrant_init_data (p4est, nt, c + i, init_fn);
+        family[i] = c + i;
+      }
+      if (replace_fn != NULL) {
+        replace_fn (p4est, nt, 1, &pp, P4EST_CHILDREN, family);
+      }
+      p4est_quadrant_free_data (p4est, &parent);
+      maxlevel = SC_MAX (maxlevel, (int) c->level);
+      tree->quadrants_per_level[c->level] += P4EST_CHILDREN;
+      current += P4EST_CHILDREN;
+    }
+    P4EST_ASSERT (current == refined.elem_count);
+    sc_array_reset (tquadrants);
+    *tquadrants = refined;
+    tree->maxlevel = (int8_t) maxlevel;
+    P4EST_ASSERT (p4est_tree_is_sorted (tree));
+    P4EST_ASSERT (p4est_tree_is_complete (tree));
+
+    old_offset += (p4est_locidx_t) incount;
+    new_count += (p4est_locidx_t) current;
+  }
+  P4EST_ASSERT (old_offset == p4est->local_num_quadrants);
+  if (old_to_new != NULL) {
+    old_to_new[old_offset] = new_count;
+  }
+  p4est->local_num_quadrants = new_count;
+  if (p4est->last_local_tree >= 0) {
+    for (; nt < p4est->connectivity->num_trees; ++nt) {
+      tree = p4est_tree_array_index (p4est->trees, nt);
+      tree->quadrants_offset = p4est->local_num_quadrants;
+    }
+  }
+
+  /* compute global number of quadrants */
+  p4est_comm_count_quadrants (p4est);
+  P4EST_ASSERT (p4est->global_num_quadrants >= old_gnq);
+  if (old_gnq != p4est->global_num_quadrants) {
+    ++p4est->revision;
+  }
+
+  P4EST_ASSERT (p4est_is_valid (p4est));
+  p4est_log_indent_pop ();
+  P4EST_GLOBAL_PRODUCTIONF ("Done " P4EST_STRING
+                            "_refine_flags with %lld total quadrants\n",
+                            (long long) p4est->global_num_quadrants);
+}
+
+/** Compute the overlap relation between the old and new local quadrants.
+ * Both are complete and sorted in every tree, thus one merge suffices.
+ * \param [in] p4est        The forest after adaptation.
+ * \param [in] old_quadrants The local quadrants before adaptation.
+ * \param [in] old_offsets  For each local tree and one beyond, the offset
+ *                          of its quadrants in \b old_quadrants.
+ * \param [out] map_offsets CSR offsets by old quadrant.
+ * \param [out] map_indices CSR indices of the new quadrants.
+ */
+static void
+p4est_adapt_map (p4est_t * p4est, const p4est_quadrant_t * old_quadrants,
+                 const p4est_locidx_t * old_offsets,
+                 sc_array_t * map_offsets, sc_array_t * map_indices)
+{
+  const p4est_topidx_t num_local_trees =
+    p4est->last_local_tree - p4est->first_local_tree + 1;
+  p4est_topidx_t      nt;
+  p4est_locidx_t      il, iend, jl, jend;
+  p4est_locidx_t     *offsets;
+  p4est_tree_t       *tree;
+  const p4est_quadrant_t *o, *n;
+
+  sc_array_resize (map_offsets, (size_t) old_offsets[num_local_trees] + 1);
+  sc_array_resize (map_indices, 0);
+  offsets = (p4est_locidx_t *) map_offsets->array;
+  offsets[0] = 0;
+  for (nt = p4est->first_local_tree; nt <= p4est->last_local_tree; ++nt) {
+    tree = p4est_tree_array_index (p4est->trees, nt);
+    il = old_offsets[nt - p4est->first_local_tree];
+    iend = old_offsets[nt - p4est->first_local_tree + 1];
+    jl = 0;
+    jend = (p4est_locidx_t) tree->quadrants.elem_count;
+    while (il < iend) {
+      P4EST_ASSERT (jl < jend);
+      o = old_quadrants + il;
+      n = p4est_quadrant_array_index (&tree->quadrants, (size_t) jl);
+      if (p4est_quadrant_is_ancestor (n, o)) {
+        /* several old quadrants have been replaced by one new quadrant */
+        do {
+          *(p4est_locidx_t *) sc_array_push (map_indices) =
+            tree->quadrants_offset + jl;
+          offsets[++il] = (p4est_locidx_t) map_indices->elem_count;
+        }
+        while (il < iend &&
+               p4est_quadrant_is_ancestor (n, old_quadrants + il));
+        ++jl;
+      }
+      else {
+        /* one old quadrant is kept or replaced by several new ones */
+        P4EST_ASSERT (p4est_quadrant_is_equal (n, o) ||
+                      p4est_quadrant_is_ancestor (o, n));
+        do {
+          *(p4est_locidx_t *) sc_array_push (map_indices) =
+            tree->quadrants_offset + jl;
+          ++jl;
+        }
+        while (jl < jend && p4est_quadrant_is_ancestor
+               (o, p4est_quadrant_array_index (&tree->quadrants,
+                                               (size_t) jl)));
+        offsets[++il] = (p4est_locidx_t) map_indices->elem_count;
+      }
+    }
+    P4EST_ASSERT (jl == jend);
+  }
+}
+
+void
+p4est_adapt (p4est_t * p4est, const int8_t * marks,
+             p4est_connect_type_t btype, p4est_init_t init_fn,
+             sc_array_t * map_offsets, sc_array_t * map_indices)
+{
+  const int           do_map = map_offsets != NULL;
+  int                 i, k;
+  int                 mpiret;
+  int                 changed, gchanged;
+  int                 maxlevel;
+  p4est_topidx_t      nt;
+  p4est_locidx_t      old_offset, new_count;
+  p4est_locidx_t     *old_offsets;
+  size_t              zz, incount, current;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, *c;
+  p4est_quadrant_t   *old_quadrants;
+  sc_array_t         *tquadrants, adapted;
+
+  P4EST_GLOBAL_PRODUCTIONF ("Into " P4EST_STRING
+                            "_adapt with %lld total quadrants\n",
+                            (long long) p4est->global_num_quadrants);
+  p4est_log_indent_push ();
+  P4EST_ASSERT (p4est_is_valid (p4est));
+  P4EST_ASSERT (marks != NULL || p4est->local_num_quadrants == 0);
+  P4EST_ASSERT ((map_offsets == NULL) == (map_indices == NULL));
+  P4EST_ASSERT (map_offsets == NULL ||
+                map_offsets->elem_size == sizeof (p4est_locidx_t));
+  P4EST_ASSERT (map_indices == NULL ||
+                map_indices->elem_size == sizeof (p4est_locidx_t));
+
+  /* remember the old quadrants to compute the index map at the end */
+  old_quadrants = NULL;
+  old_offsets = NULL;
+  if (do_map) {
+    old_quadrants = P4EST_ALLOC (p4est_quadrant_t,
+                                 p4est->local_num_quadrants);
+    old_offsets = P4EST_ALLOC (p4est_locidx_t, p4est->last_local_tree -
+                               p4est->first_local_tree + 2);
+    old_offsets[0] = 0;
+  }
+
+  /* refine and coarsen in one pass over each tree */
+  changed = 0;
+  old_offset = 0;
+  new_count = 0;
+  for (nt = p4est->first_local_tree; nt <= p4est->last_local_tree; ++nt) {
+    tree = p4est_tree_array_index (p4est->trees, nt);
+    tree->quadrants_offset = new_count;
+    tquadrants = &tree->quadrants;
+    incount = tquadrants->elem_count;
+    if (do_map) {
+      memcpy (old_quadrants + old_offset, tquadrants->array,
+              incount * sizeof (p4est_quadrant_t));
+      old_offsets[nt - p4est->first_local_tree + 1] =
+        old_offset + (p4est_locidx_t) incount;
+    }
+
+    /* the output array is allocated for the case of no coarsening */
+    current = incount;
+    for (zz = 0; zz < incount; ++zz) {
+      if (marks[old_offset + (p4est_locidx_t) zz] > 0) {
+        current += P4EST_CHILDREN - 1;
+      }
+    }
+    sc_array_init_size (&adapted, sizeof (p4est_quadrant_t), current);
+    maxlevel = 0;
+    for (i = 0; i <= P4EST_QMAXLEVEL; ++i) {
+      tree->quadrants_per_level[i] = 0;
+    }
+    current = 0;
+    for (zz = 0; zz < incount;) {
+      q = p4est_quadrant_array_index (tquadrants, zz);
+      c = p4est_quadrant_array_index (&adapted, current);
+
+      /* a local family with all members marked for coarsening */
+      if (marks[old_offset + (p4est_locidx_t) zz] < 0 &&
+          zz + P4EST_CHILDREN <= incount && q->level > 0 &&
+          p4est_quadrant_is_familyv (q)) {
+        for (k = 1; k < P4EST_CHILDREN; ++k) {
+          if (marks[old_offset + (p4est_locidx_t) zz + k] >= 0) {
+            break;
+          }
+        }
+        if (k == P4EST_CHILDREN) {
+          p4est_quadrant_parent (q, c);
+          for (k = 0; k < P4EST_CHILDREN; ++k) {
+            p4est_quadrant_free_data (p4est, q + k);
+          }
+          p4est_quadrant_init_data (p4est, nt, c, init_fn);
+          maxlevel = SC_MAX (maxlevel, (int) c->level);
+          ++tree->quadrants_per_level[c->level];
+          ++current;
+          zz += P4EST_CHILDREN;
+          changed = 1;
+          continue;
+        }
+      }
+
+      if (marks[old_offset + (p4est_locidx_t) zz] > 0 &&
+          (int) q->level < P4EST_QMAXLEVEL) {
+        /* replace the quadrant by its children */
+        p4est_quadrant_childrenv (q, c);
+        p4est_quadrant_free_data (p4est, q);
+        for (k = 0; k < P4EST_CHILDREN; ++k) {
+          p4est_quadrant_init_data (p4est, nt, c + k, init_fn);
+        }
+        maxlevel = SC_MAX (maxlevel, (int) c->level);
+        tree->quadrants_per_level[c->level] += P4EST_CHILDREN;
+        current += P4EST_CHILDREN;
+        changed = 1;
+      }
+      else {
+        /* the quadrant is kept including its user data */
+        *c = *q;
+        maxlevel = SC_MAX (maxlevel, (int) q->level);
+        ++tree->quadrants_per_level[q->level];
+        ++current;
+      }
+      ++zz;
+    }
+    sc_array_resize (&adapted, current);
+    sc_array_reset (tquadrants);
+    *tquadrants = adapted;
+    tree->maxlevel = (int8_t) maxlevel;
+    P4EST_ASSERT (p4est_tree_is_sorted (tree));
+    P4EST_ASSERT (p4est_tree_is_complete (tree));
+
+    old_offset += (p4est_locidx_t) incount;
+    new_count += (p4est_locidx_t) current;
+  }
+  P4EST_ASSERT (old_offset == p4est->local_num_quadrants);
+  p4est->local_num_quadrants = new_count;
+  if (p4est->last_local_tree >= 0) {
+    for (; nt < p4est->connectivity->num_trees; ++nt) {
+      tree = p4est_tree_array_index (p4est->trees, nt);
+      tree->quadrants_offset = p4est->local_num_quadrants;
+    }
+  }
+
+  /* the forest may change locally while the global count stays the same */
+  p4est_comm_count_quadrants (p4est);
+  mpiret = sc_MPI_Allreduce (&changed, &gchanged, 1, sc_MPI_INT,
+                             sc_MPI_MAX, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  if (gchanged) {
+    ++p4est->revision;
+
+    /* balance only refines, which the index map will reflect */
+    p4est_balance_ext (p4est, btype, init_fn, NULL);
+  }
+
+  /* relate the old and new quadrants */
+  if (do_map) {
+    p4est_adapt_map (p4est, old_quadrants, old_offsets,
+                     map_offsets, map_indices);
+    P4EST_FREE (old_quadrants);
+    P4EST_FREE (old_offsets);
+  }
+
+  P4EST_ASSERT (p4est_is_valid (p4est));
+  p4est_log_indent_pop ();
+  P4EST_GLOBAL_PRODUCTIONF ("Done " P4EST_STRING
+                            "_adapt with %lld total quadrants\n",
+                            (long long) p4est->global_num_quadrants);
+}
+
+struct p4est_project
+{
+  p4est_locidx_t      num_old, num_new;
+  int8_t             *levels;           /**< Levels of the new quadrants. */
+  sc_array_t          kept;             /**< Runs of old, new, count. */
+  sc_array_t          refine_coarse, refine_fine;
+  sc_array_t          coarsen_coarse, coarsen_fine;
+  sc_array_t          cascade;          /**< Old, first new, old level. */
+};
+
+p4est_project_t    *
+p4est_project_new (p4est_t * p4est,
+                   sc_array_t * map_offsets, sc_array_t * map_indices)
+{
+  p4est_topidx_t      jt;
+  p4est_locidx_t      k, kk, l, n, j, lq;
+  p4est_locidx_t     *run;
+  const p4est_locidx_t *offsets, *indices;
+  uint64_t            volume;
+  int                 maxlevel, level;
+  size_t              zz;
+  p4est_tree_t       *tree;
+  p4est_project_t    *project;
+
+  P4EST_ASSERT (map_offsets->elem_size == sizeof (p4est_locidx_t));
+  P4EST_ASSERT (map_indices->elem_size == sizeof (p4est_locidx_t));
+  P4EST_ASSERT (map_offsets->elem_count > 0);
+
+  project = P4EST_ALLOC (p4est_project_t, 1);
+  project->num_old = (p4est_locidx_t) map_offsets->elem_count - 1;
+  project->num_new = p4est->local_num_quadrants;
+  project->levels = P4EST_ALLOC (int8_t, project->num_new);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      project->levels[lq] =
+        p4est_quadrant_array_index (&tree->quadrants, zz)->level;
+    }
+  }
+  sc_array_init (&project->kept, 3 * sizeof (p4est_locidx_t));
+  sc_array_init (&project->refine_coarse, sizeof (p4est_locidx_t));
+  sc_array_init (&project->refine_fine, sizeof (p4est_locidx_t));
+  sc_array_init (&project->coarsen_coarse, sizeof (p4est_locidx_t));
+  sc_array_init (&project->coarsen_fine, sizeof (p4est_locidx_t));
+  sc_array_init (&project->cascade, 3 * sizeof (p4est_locidx_t));
+
+  /* classify the relations of the index map */
+  offsets = (const p4est_locidx_t *) map_offsets->array;
+  indices = (const p4est_locidx_t *) map_indices->array;
+  P4EST_ASSERT (offsets[project->num_old] ==
+                (p4est_locidx_t) map_indices->elem_count);
+  for (k = 0; k < project->num_old;) {
+    n = offsets[k + 1] - offsets[k];
+    j = indices[offsets[k]];
+    P4EST_ASSERT (n >= 1 && 0 <= j && j + n <= project->num_new);
+    if (n == P4EST_CHILDREN) {
+      /* a complete subdivision into this many quadrants is one level */
+      *(p4est_locidx_t *) sc_array_push (&project->refine_coarse) = k;
+      *(p4est_locidx_t *) sc_array_push (&project->refine_fine) = j;
+      ++k;
+      continue;
+    }
+    if (n > 1) {
+      /* deduce the old level from the volume of the new quadrants */
+      maxlevel = 0;
+      for (l = j; l < j + n; ++l) {
+        maxlevel = SC_MAX (maxlevel, (int) project->levels[l]);
+      }
+      volume = 0;
+      for (l = j; l < j + n; ++l) {
+        P4EST_ASSERT (P4EST_DIM * (maxlevel - project->levels[l]) < 64);
+        volume += (uint64_t) 1 << (P4EST_DIM *
+                                   (maxlevel - project->levels[l]));
+      }
+      for (level = maxlevel; volume > 1; --level) {
+        P4EST_ASSERT (volume % P4EST_CHILDREN == 0);
+        volume /= P4EST_CHILDREN;
+      }
+      run = (p4est_locidx_t *) sc_array_push (&project->cascade);
+      run[0] = k;
+      run[1] = j;
+      run[2] = (p4est_locidx_t) level;
+      ++k;
+      continue;
+    }
+
+    /* count the old quadrants mapped to the same new one */
+    for (kk = k + 1; kk < project->num_old &&
+         offsets[kk + 1] - offsets[kk] == 1 && indices[offsets[kk]] == j;
+         ++kk) {
+    }
+    if (kk > k + 1) {
+      P4EST_ASSERT (kk - k == P4EST_CHILDREN);
+      *(p4est_locidx_t *) sc_array_push (&project->coarsen_coarse) = j;
+      *(p4est_locidx_t *) sc_array_push (&project->coarsen_fine) = k;
+      k = kk;
+      continue;
+    }
+
+    /* extend the current run of kept quadrants if possible */
+    run = project->kept.elem_count == 0 ? NULL :
+      (p4est_locidx_t *) sc_array_index (&project->kept,
+                                         project->kept.elem_count - 1);
+    if (run != NULL && run[0] + run[2] == k && run[1] + run[2] == j) {
+      ++run[2];
+    }
+    else {
+      run = (p4est_locidx_t *) sc_array_push (&project->kept);
+      run[0] = k;
+      run[1] = j;
+      run[2] = 1;
+    }
+    ++k;
+  }
+
+  return project;
+}
+
+void
+p4est_project_destroy (p4est_project_t * project)
+{
+  P4EST_FREE (project->levels);
+  sc_array_reset (&project->kept);
+  sc_array_reset (&project->refine_coarse);
+  sc_array_reset (&project->refine_fine);
+  sc_array_reset (&project->coarsen_coarse);
+  sc_array_reset (&project->coarsen_fine);
+  sc_array_reset (&project->cascade);
+  P4EST_FREE (project);
+}
+
+/** Default refinement kernel that copies the parent data to all children. */
+static void
+p4est_project_inject (const p4est_project_block_t * block, void *user)
+{
+  int                 f, c;
+  p4est_locidx_t      r;
+  const size_t        bytes = block->field_size * sizeof (double);
+
+  for (f = 0; f < block->num_fields; ++f) {
+    for (r = 0; r < block->num_relations; ++r) {
+      for (c = 0; c < block->num_fine; ++c) {
+        memcpy (block->dst_fields[f] +
+                (size_t) (block->fine[r] + c) * block->field_size,
+                block->src_fields[f] +
+                (size_t) block->coarse[r] * block->field_size, bytes);
+      }
+    }
+  }
+}
+
+/** Default coarsening kernel that averages the data of the children. */
+static void
+p4est_project_average (const p4est_project_block_t * block, void *user)
+{
+  int                 f, c;
+  size_t              zz;
+  p4est_locidx_t      r;
+  double             *dst;
+  const double       *src;
+
+  for (f = 0; f < block->num_fields; ++f) {
+    for (r = 0; r < block->num_relations; ++r) {
+      dst = block->dst_fields[f] +
+        (size_t) block->coarse[r] * block->field_size;
+      src = block->src_fields[f] +
+        (size_t) block->fine[r] * block->field_size;
+      for (zz = 0; zz < block->field_size; ++zz) {
+        dst[zz] = 0.;
+        for (c = 0; c < block->num_fine; ++c) {
+          dst[zz] += src[c * block->field_size + zz];
+        }
+        dst[zz] /= block->num_fine;
+      }
+    }
+  }
+}
+
+/** Refine the data of one quadrant recursively into new quadrants.
+ * \param [in] parent       For each field, the data of the quadrant.
+ * \param [in] level        The level of the quadrant.
+ * \param [in,out] pos      The next new quadrant, incremented on output.
+ */
+static void
+p4est_project_cascade (p4est_project_t * project, int num_fields,
+                       size_t field_size, const double **parent, int level,
+                       double **new_fields, p4est_project_kernel_t refine_fn,
+                       void *user, p4est_locidx_t * pos)
+{
+  const p4est_locidx_t zero = 0;
+  int                 f, c;
+  double            **children;
+  const double      **child;
+  p4est_project_block_t block;
+
+  /* interpolate to temporary children */
+  children = P4EST_ALLOC (double *, num_fields);
+  child = P4EST_ALLOC (const double *, num_fields);
+  for (f = 0; f < num_fields; ++f) {
+    children[f] = P4EST_ALLOC (double, P4EST_CHILDREN * field_size);
+  }
+  block.num_fields = num_fields;
+  block.field_size = field_size;
+  block.src_fields = parent;
+  block.dst_fields = children;
+  block.num_relations = 1;
+  block.num_fine = P4EST_CHILDREN;
+  block.coarse = &zero;
+  block.fine = &zero;
+  refine_fn (&block, user);
+
+  /* store the children that are new quadrants and descend into the rest */
+  for (c = 0; c < P4EST_CHILDREN; ++c) {
+    P4EST_ASSERT (*pos < project->num_new);
+    if ((int) project->levels[*pos] == level + 1) {
+      for (f = 0; f < num_fields; ++f) {
+        memcpy (new_fields[f] + (size_t) pos[0] * field_size,
+                children[f] + c * field_size, field_size * sizeof (double));
+      }
+      ++*pos;
+    }
+    else {
+      P4EST_ASSERT ((int) project->levels[*pos] > level + 1);
+      for (f = 0; f < num_fields; ++f) {
+        child[f] = children[f] + c * field_size;
+      }
+      p4est_project_cascade (project, num_fields, field_size, child,
+                             level + 1, new_fields, refine_fn, user, pos);
+    }
+  }
+
+  for (f = 0; f < num_fields; ++f) {
+    P4EST_FREE (children[f]);
+  }
+  P4EST_FREE (children);
+  P4EST_FREE (child);
+}
+
+void
+p4est_project_apply (p4est_project_t * project,
+                     int num_fields, size_t field_size,
+                     const double **old_fields, double **new_fields,
+                     p4est_project_kernel_t refine_fn,
+                     p4est_project_kernel_t coarsen_fn, void *user)
+{
+  int                 f;
+  size_t              zz;
+  p4est_locidx_t      pos;
+  const p4est_locidx_t *run;
+  const double      **parent;
+  p4est_project_block_t block;
+
+  P4EST_ASSERT (num_fields >= 0);
+  if (num_fields == 0 || field_size == 0) {
+    return;
+  }
+  if (refine_fn == NULL) {
+    refine_fn = p4est_project_inject;
+  }
+  if (coarsen_fn == NULL) {
+    coarsen_fn = p4est_project_average;
+  }
+
+  /* copy the runs of kept quadrants */
+  for (zz = 0; zz < project->kept.elem_count; ++zz) {
+    run = (const p4est_locidx_t *) sc_array_index (&project->kept, zz);
+    for (f = 0; f < num_fields; ++f) {
+      memcpy (new_fields[f] + (size_t) run[1] * field_size,
+              old_fields[f] + (size_t) run[0] * field_size,
+              (size_t) run[2] * field_size * sizeof (double));
+    }
+  }
+
+  /* one batch for all refinement and one for all coarsening */
+  block.num_fields = num_fields;
+  block.field_size = field_size;
+  block.num_fine = P4EST_CHILDREN;
+  if (project->refine_coarse.elem_count > 0) {
+    block.src_fields = old_fields;
+    block.dst_fields = new_fields;
+    block.num_relations =
+      (p4est_locidx_t) project->refine_coarse.elem_count;
+    block.coarse = (const p4est_locidx_t *) project->refine_coarse.array;
+    block.fine = (const p4est_locidx_t *) project->refine_fine.array;
+    refine_fn (&block, user);
+  }
+  if (project->coarsen_coarse.elem_count > 0) {
+    block.src_fields = old_fields;
+    block.dst_fields = new_fields;
+    block.num_relations =
+      (p4est_locidx_t) project->coarsen_coarse.elem_count;
+    block.coarse = (const p4est_locidx_t *) project->coarsen_coarse.array;
+    block.fine = (const p4est_locidx_t *) project->coarsen_fine.array;
+    coarsen_fn (&block, user);
+  }
+
+  /* quadrants refined by several levels are rare */
+  if (project->cascade.elem_count > 0) {
+    parent = P4EST_ALLOC (const double *, num_fields);
+    for (zz = 0; zz < project->cascade.elem_count; ++zz) {
+      run = (const p4est_locidx_t *) sc_array_index (&project->cascade, zz);
+      for (f = 0; f < num_fields; ++f) {
+        parent[f] = old_fields[f] + (size_t) run[0] * field_size;
+      }
+      pos = run[1];
+      p4est_project_cascade (project, num_fields, field_size, parent,
+                             (int) run[2], new_fields, refine_fn, user, &pos);
+    }
+    P4EST_FREE (parent);
+  }
+}
+
 void
 p4est_coarsen (p4est_t * p4est, int coarsen_recursive,
                p4est_coarsen_t coarsen_fn, p4est_init_t init_fn)
@@ -1313,6 +1997,7 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
   int                *receiver_ranks_notify, *sender_ranks_notify;
   int                 num_receivers_notify, num_senders_notify;
   int                 is_ranges_primary, is_balance_verify;
+  int                 is_notify_nbx;
   int                 is_ranges_active, is_notify_active;
   int                 max_ranges;
   MPI_Request        *requests_first, *requests_second;
@@ -1658,6 +2343,7 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
   is_ranges_primary = 0;
   is_ranges_active = 0;
   is_notify_active = 1;
+  is_notify_nbx = 0;
   is_balance_verify = 0;
 #endif
   if (p4est->inspect != NULL) {
@@ -1672,6 +2358,7 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
     p4est->inspect->balance_ranges = 0.;
     p4est->inspect->balance_notify = 0.;
     p4est->inspect->balance_notify_allgather = 0.;
+    p4est->inspect->balance_notify_nbx = 0.;
 #ifdef P4EST_ENABLE_MPI
     is_ranges_primary = p4est->inspect->use_balance_ranges;
     is_ranges_active = is_ranges_primary;
@@ -1679,6 +2366,7 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
     if (p4est->inspect->use_balance_ranges_notify) {
       is_ranges_active = is_notify_active = 1;
     }
+    is_notify_nbx = p4est->inspect->use_notify_nbx;
     is_balance_verify = p4est->inspect->use_balance_verify;
 #endif
   }
@@ -1809,7 +2497,8 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
                     nwin, maxwin, max_ranges, first_peer, last_peer);
   }
 
-  /* determine asymmetric communication pattern by sc_notify function */
+  /* determine asymmetric communication pattern by sc_notify function
+   * or alternatively by the nonblocking consensus algorithm */
   if (is_notify_active) {
     receiver_ranks_notify = P4EST_ALLOC (int, num_procs);
     sender_ranks_notify = P4EST_ALLOC (int, num_procs);
@@ -1820,18 +2509,30 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
         receiver_ranks_notify[num_receivers_notify++] = j;
       }
     }
-    if (p4est->inspect != NULL) {
-      p4est->inspect->balance_notify = -MPI_Wtime ();
+    if (!is_notify_nbx) {
+      if (p4est->inspect != NULL) {
+        p4est->inspect->balance_notify = -MPI_Wtime ();
+      }
+      mpiret = sc_notify (receiver_ranks_notify, num_receivers_notify,
+                          sender_ranks_notify, &num_senders_notify,
+                          p4est->mpicomm);
+      SC_CHECK_MPI (mpiret);
+      if (p4est->inspect != NULL) {
+        p4est->inspect->balance_notify += MPI_Wtime ();
+      }
     }
-    mpiret = sc_notify (receiver_ranks_notify, num_receivers_notify,
-                        sender_ranks_notify, &num_senders_notify,
-                        p4est->mpicomm);
-    SC_CHECK_MPI (mpiret);
-    if (p4est->inspect != NULL) {
-      p4est->inspect->balance_notify += MPI_Wtime ();
+    else {
+      P4EST_ASSERT (p4est->inspect != NULL);
+      p4est->inspect->balance_notify_nbx = -MPI_Wtime ();
+      mpiret = p4est_comm_notify_nbx (receiver_ranks_notify,
+                                      num_receivers_notify,
+                                      sender_ranks_notify,
+                                      &num_senders_notify, p4est->mpicomm);
+      SC_CHECK_MPI (mpiret);
+      p4est->inspect->balance_notify_nbx += MPI_Wtime ();
     }
 
-    /* double-check sc_notify results by sc_notify_allgather */
+    /* double-check the notify results by the other notify variants */
     if (is_balance_verify) {
       int                *sender_ranks2, num_senders2;
 
@@ -1855,6 +2556,32 @@ p4est_balance_ext (p4est_t * p4est, p4est_connect_type_t btype,
         SC_CHECK_ABORT (sender_ranks2[j] == sender_ranks_notify[j],
                         "Failed notify_allgather sender rank");
       }
+
+      /* time and verify the variant that was not used above */
+      if (p4est->inspect != NULL) {
+        if (is_notify_nbx) {
+          p4est->inspect->balance_notify = -MPI_Wtime ();
+          mpiret = sc_notify (receiver_ranks_notify, num_receivers_notify,
+                              sender_ranks2, &num_senders2, p4est->mpicomm);
+          SC_CHECK_MPI (mpiret);
+          p4est->inspect->balance_notify += MPI_Wtime ();
+        }
+        else {
+          p4est->inspect->balance_notify_nbx = -MPI_Wtime ();
+          mpiret = p4est_comm_notify_nbx (receiver_ranks_notify,
+                                          num_receivers_notify,
+                                          sender_ranks2, &num_senders2,
+                                          p4est->mpicomm);
+          SC_CHECK_MPI (mpiret);
+          p4est->inspect->balance_notify_nbx += MPI_Wtime ();
+        }
+        SC_CHECK_ABORT (num_senders2 == num_senders_notify,
+                        "Failed notify_nbx sender count");
+        for (j = 0; j < num_senders_notify; ++j) {
+          SC_CHECK_ABORT (sender_ranks2[j] == sender_ranks_notify[j],
+                          "Failed notify_nbx sender rank");
+        }
+      }
       P4EST_FREE (sender_ranks2);
     }
   }
@@ -2435,9 +3162,32 @@ p4est_gloidx_t
 p4est_partition_ext (p4est_t * p4est, int partition_for_coarsening,
                      p4est_weight_t weight_fn)
 {
-  p4est_gloidx_t      global_shipped = 0;
-  const p4est_gloidx_t global_num_quadrants = p4est->global_num_quadrants;
+  return p4est_partition_end
+    (p4est_partition_begin (p4est, partition_for_coarsening, weight_fn));
+}
+
+/** Create the context of a partition that ships no quadrants. */
+static p4est_partition_context_t *
+p4est_partition_inactive (p4est_t * p4est)
+{
+  p4est_partition_context_t *pc;
+
+  pc = P4EST_ALLOC_ZERO (p4est_partition_context_t, 1);
+  pc->p4est = p4est;
+  pc->active = 0;
+  pc->local_keep_first = 0;
+  pc->local_keep_count = p4est->local_num_quadrants;
+
+  return pc;
+}
+
+p4est_partition_context_t *
+p4est_partition_begin (p4est_t * p4est, int partition_for_coarsening,
+                       p4est_weight_t weight_fn)
+{
+  p4est_partition_context_t *pc;
 #ifdef P4EST_ENABLE_MPI
+  const p4est_gloidx_t global_num_quadrants = p4est->global_num_quadrants;
   int                 mpiret;
   int                 low_source, high_source;
   const int           num_procs = p4est->mpisize;
@@ -2478,8 +3228,7 @@ p4est_partition_ext (p4est_t * p4est, int partition_for_coarsening,
     P4EST_GLOBAL_PRODUCTION ("Done " P4EST_STRING "_partition no shipping\n");
 
     /* in particular, there is no need to bumb the revision counter */
-    P4EST_ASSERT (global_shipped == 0);
-    return global_shipped;
+    return p4est_partition_inactive (p4est);
   }
 
   p4est_log_indent_push ();
@@ -2562,8 +3311,7 @@ p4est_partition_ext (p4est_t * p4est, int partition_for_coarsening,
                                "_partition no shipping\n");
 
       /* in particular, there is no need to bumb the revision counter */
-      P4EST_ASSERT (global_shipped == 0);
-      return global_shipped;
+      return p4est_partition_inactive (p4est);
     }
 
     /* determine processor ids to send to */
@@ -2763,17 +3511,44 @@ p4est_partition_ext (p4est_t * p4est, int partition_for_coarsening,
        (long long) num_corrected);
   }
 
-  /* run the partition algorithm with proper quadrant counts */
-  global_shipped = p4est_partition_given (p4est, num_quadrants_in_proc);
+  /* post the messages of the partition algorithm with proper counts */
+  pc = p4est_partition_given_begin (p4est, num_quadrants_in_proc);
+  P4EST_FREE (num_quadrants_in_proc);
+
+  /* the caller's logging during the overlap is not indented */
+  p4est_log_indent_pop ();
+#else
+  /* a forest without MPI has one process and returns above */
+  SC_ABORT_NOT_REACHED ();
+  pc = NULL;
+#endif /* P4EST_ENABLE_MPI */
+
+  return pc;
+}
+
+p4est_gloidx_t
+p4est_partition_end (p4est_partition_context_t * pc)
+{
+  p4est_t            *p4est = pc->p4est;
+  const p4est_gloidx_t global_num_quadrants = p4est->global_num_quadrants;
+  p4est_gloidx_t      global_shipped = 0;
+
+  if (!pc->active) {
+    /* the forest is unchanged and the revision counter stays the same */
+    P4EST_FREE (pc);
+    return global_shipped;
+  }
+
+  /* receive the quadrants and assemble the new local forest */
+  p4est_log_indent_push ();
+  global_shipped = p4est_partition_given_end (pc);
   if (global_shipped) {
     /* the partition of the forest has changed somewhere */
     ++p4est->revision;
   }
-  P4EST_FREE (num_quadrants_in_proc);
 
   /* check validity of the p4est */
   P4EST_ASSERT (p4est_is_valid (p4est));
-#endif /* P4EST_ENABLE_MPI */
 
   p4est_log_indent_pop ();
   P4EST_GLOBAL_PRODUCTIONF
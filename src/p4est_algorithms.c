@@ -2756,9 +2756,10 @@ p4est_next_nonempty_process (int rank, int num_procs,
   return rank;
 }
 
-p4est_gloidx_t
-p4est_partition_given (p4est_t * p4est,
-                       const p4est_locidx_t * new_num_quadrants_in_proc)
+p4est_partition_context_t *
+p4est_partition_given_begin (p4est_t * p4est,
+                             const p4est_locidx_t *
+                             new_num_quadrants_in_proc)
 {
   const int           num_procs = p4est->mpisize;
   const int           rank = p4est->mpirank;
@@ -2779,25 +2780,15 @@ p4est_partition_given (p4est_t * p4est,
   int                 from_proc, to_proc;
   int                 num_proc_recv_from, num_proc_send_to;
   char               *user_data_send_buf;
-  char               *user_data_recv_buf;
   char              **recv_buf, **send_buf;
-  size_t              recv_size, send_size, zz, zoffset;
-  p4est_topidx_t      it;
+  size_t              recv_size, send_size;
   p4est_topidx_t      which_tree;
-  p4est_topidx_t      first_tree, last_tree;
   p4est_topidx_t      num_recv_trees;
-  p4est_topidx_t      new_first_local_tree, new_last_local_tree;
-  p4est_topidx_t      first_from_tree, last_from_tree, from_tree;
   p4est_locidx_t      il;
   p4est_locidx_t      num_copy;
-  p4est_locidx_t      num_quadrants;
-  p4est_locidx_t      new_local_num_quadrants;
   p4est_locidx_t     *num_recv_from, *num_send_to;
-  p4est_locidx_t     *new_local_tree_elem_count;
-  p4est_locidx_t     *new_local_tree_elem_count_before;
   p4est_locidx_t     *num_per_tree_local;
   p4est_locidx_t     *num_per_tree_send_buf;
-  p4est_locidx_t     *num_per_tree_recv_buf;
   p4est_gloidx_t     *begin_send_to;
   p4est_gloidx_t      tree_from_begin, tree_from_end, num_copy_global;
   p4est_gloidx_t      from_begin, from_end;
@@ -2807,11 +2798,9 @@ p4est_partition_given (p4est_t * p4est,
   p4est_gloidx_t     *new_global_last_quad_index;
   p4est_gloidx_t     *local_tree_last_quad_index;
   p4est_gloidx_t      diff64, total_quadrants_shipped;
-  sc_array_t         *quadrants;
   p4est_quadrant_t   *quad_send_buf;
-  p4est_quadrant_t   *quad_recv_buf;
-  p4est_quadrant_t   *quad;
   p4est_tree_t       *tree;
+  p4est_partition_context_t *pc;
 #ifdef P4EST_ENABLE_MPI
   int                 mpiret;
   MPI_Comm            comm = p4est->mpicomm;
@@ -3145,7 +3134,108 @@ p4est_partition_given (p4est_t * p4est,
   for (; sk < num_proc_send_to; ++sk) {
     send_request[sk] = MPI_REQUEST_NULL;
   }
+#endif
+
+  /* Save the state required to assemble the new forest */
+  pc = P4EST_ALLOC_ZERO (p4est_partition_context_t, 1);
+  pc->p4est = p4est;
+  pc->active = 1;
+  pc->num_proc_recv_from = num_proc_recv_from;
+  pc->num_proc_send_to = num_proc_send_to;
+  pc->recv_buf = recv_buf;
+  pc->send_buf = send_buf;
+#ifdef P4EST_ENABLE_MPI
+  pc->recv_request = recv_request;
+  pc->send_request = send_request;
+#endif
+  pc->num_recv_from = num_recv_from;
+  pc->num_send_to = num_send_to;
+  pc->num_per_tree_local = num_per_tree_local;
+  pc->begin_send_to = begin_send_to;
+  pc->global_last_quad_index = global_last_quad_index;
+  pc->new_global_last_quad_index = new_global_last_quad_index;
+  pc->local_tree_last_quad_index = local_tree_last_quad_index;
+  pc->total_quadrants_shipped = total_quadrants_shipped;
+
+  /* the local quadrants that stay on this process */
+  my_base = (rank == 0) ? 0 : (global_last_quad_index[rank - 1] + 1);
+  pc->local_keep_first = (num_send_to[rank] == 0) ? 0 :
+    (p4est_locidx_t) (begin_send_to[rank] - my_base);
+  pc->local_keep_count = num_send_to[rank];
+#ifdef P4EST_ENABLE_DEBUG
+  pc->crc = crc;
+#endif
+
+  return pc;
+}
+
+p4est_gloidx_t
+p4est_partition_given_end (p4est_partition_context_t * pc)
+{
+  p4est_t            *p4est = pc->p4est;
+  const int           num_procs = p4est->mpisize;
+  const int           rank = p4est->mpirank;
+  const p4est_topidx_t first_local_tree = p4est->first_local_tree;
+  const p4est_topidx_t last_local_tree = p4est->last_local_tree;
+  const size_t        data_size = p4est->data_size;
+  sc_array_t         *trees = p4est->trees;
+  const p4est_gloidx_t total_quadrants_shipped = pc->total_quadrants_shipped;
+
+  int                 i;
+  int                 from_proc;
+  int                 num_proc_recv_from, num_proc_send_to;
+  char               *user_data_recv_buf;
+  char              **recv_buf, **send_buf;
+  size_t              zz, zoffset;
+  p4est_topidx_t      it;
+  p4est_topidx_t      which_tree;
+  p4est_topidx_t      first_tree, last_tree;
+  p4est_topidx_t      num_recv_trees;
+  p4est_topidx_t      new_first_local_tree, new_last_local_tree;
+  p4est_topidx_t      first_from_tree, last_from_tree, from_tree;
+  p4est_locidx_t      num_copy;
+  p4est_locidx_t      num_quadrants;
+  p4est_locidx_t      new_local_num_quadrants;
+  p4est_locidx_t     *num_recv_from, *num_send_to;
+  p4est_locidx_t     *new_local_tree_elem_count;
+  p4est_locidx_t     *new_local_tree_elem_count_before;
+  p4est_locidx_t     *num_per_tree_local;
+  p4est_locidx_t     *num_per_tree_recv_buf;
+  p4est_gloidx_t     *begin_send_to;
+  p4est_gloidx_t      tree_from_begin, tree_from_end;
+  p4est_gloidx_t      from_begin, from_end;
+  p4est_gloidx_t      my_base, my_begin, my_end;
+  p4est_gloidx_t     *global_last_quad_index;
+  p4est_gloidx_t     *new_global_last_quad_index;
+  p4est_gloidx_t     *local_tree_last_quad_index;
+  sc_array_t         *quadrants;
+  p4est_quadrant_t   *quad_recv_buf;
+  p4est_quadrant_t   *quad;
+  p4est_tree_t       *tree;
+#ifdef P4EST_ENABLE_MPI
+  int                 mpiret;
+  MPI_Request        *recv_request, *send_request;
+#endif
 
+  /* Restore the state saved by p4est_partition_given_begin */
+  P4EST_ASSERT (pc->active);
+  num_proc_recv_from = pc->num_proc_recv_from;
+  num_proc_send_to = pc->num_proc_send_to;
+  recv_buf = pc->recv_buf;
+  send_buf = pc->send_buf;
+#ifdef P4EST_ENABLE_MPI
+  recv_request = pc->recv_request;
+  send_request = pc->send_request;
+#endif
+  num_recv_from = pc->num_recv_from;
+  num_send_to = pc->num_send_to;
+  num_per_tree_local = pc->num_per_tree_local;
+  begin_send_to = pc->begin_send_to;
+  global_last_quad_index = pc->global_last_quad_index;
+  new_global_last_quad_index = pc->new_global_last_quad_index;
+  local_tree_last_quad_index = pc->local_tree_last_quad_index;
+
+#ifdef P4EST_ENABLE_MPI
   /* Fill in forest */
   mpiret =
     MPI_Waitall (num_proc_recv_from, recv_request, MPI_STATUSES_IGNORE);
@@ -3496,7 +3586,8 @@ p4est_partition_given (p4est_t * p4est,
   p4est_comm_global_partition (p4est, NULL);
 
   /* Assert that we have a valid partition */
-  P4EST_ASSERT (crc == p4est_checksum (p4est));
+  P4EST_ASSERT (pc->crc == p4est_checksum (p4est));
+  P4EST_FREE (pc);
   P4EST_GLOBAL_INFOF
     ("Done " P4EST_STRING
      "_partition_given shipped %lld quadrants %.3g%%\n",
@@ -3505,3 +3596,11 @@ p4est_partition_given (p4est_t * p4est,
 
   return total_quadrants_shipped;
 }
+
+p4est_gloidx_t
+p4est_partition_given (p4est_t * p4est,
+                       const p4est_locidx_t * new_num_quadrants_in_proc)
+{
+  return p4est_partition_given_end
+    (p4est_partition_given_begin (p4est, new_num_quadrants_in_proc));
+}
@@ -311,6 +311,30 @@ int                 p4est_next_nonempty_process (int rank,
                                                  p4est_locidx_t *
                                                  num_quadrants_in_proc);
 
+/** Begin to partition \a p4est given the number of quadrants per proc.
+ * The messages are posted, but the forest is not changed until
+ * \ref p4est_partition_given_end is called.
+ *
+ * \param [in] p4est     the forest that is partitioned.
+ * \param [in] num_quadrants_in_proc  an integer array of the number of
+ *                        quadrants desired per processor.  It may be
+ *                        freed after this function returns.
+ * \return               Context to be passed to
+ *                        \ref p4est_partition_given_end.
+ */
+p4est_partition_context_t *p4est_partition_given_begin (p4est_t * p4est,
+                                                        const p4est_locidx_t
+                                                        *
+                                                        num_quadrants_in_proc);
+
+/** Complete a partition started by \ref p4est_partition_given_begin.
+ *
+ * \param [in] pc        The context is deallocated before returning.
+ * \return               Returns the global count of shipped quadrants.
+ */
+p4est_gloidx_t      p4est_partition_given_end (p4est_partition_context_t *
+                                               pc);
+
 /** Partition \a p4est given the number of quadrants per proc.
  *
  * Given the desired number of quadrants per proc \a num_quadrants_in_proc
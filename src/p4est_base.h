@@ -146,6 +146,10 @@ typedef enum p4est_comm_tag
   P4EST_COMM_LNODES_PASS,
   P4EST_COMM_LNODES_OWNED,
   P4EST_COMM_LNODES_ALL,
+  P4EST_COMM_NOTIFY_NBX,
+  P4EST_COMM_NOTIFY_NBX_ODD,
+  P4EST_COMM_SEARCH_MIGRATE,
+  P4EST_COMM_HIERARCHY_TRANSFER,
   P4EST_COMM_TAG_LAST
 }
 p4est_comm_tag_t;
@@ -31,11 +31,19 @@
 #include <p4est_communication.h>
 #include <p4est_bits.h>
 #endif /* !P4_TO_P8 */
+#include <sc_notify.h>
 #include <sc_search.h>
 #ifdef P4EST_HAVE_ZLIB
 #include <zlib.h>
 #endif
 
+/* the nonblocking consensus needs MPI_Ibarrier from MPI-3 */
+#if defined (P4EST_ENABLE_MPI) && defined (MPI_VERSION)
+#if MPI_VERSION >= 3
+#define P4EST_COMM_NBX
+#endif
+#endif
+
 void
 p4est_comm_parallel_env_assign (p4est_t * p4est, sc_MPI_Comm mpicomm)
 {
@@ -302,6 +310,145 @@ p4est_comm_parallel_env_reduce_ext (p4est_t ** p4est_supercomm,
   return 1;
 }
 
+void
+p4est_comm_hierarchy_split (sc_MPI_Comm mpicomm, int num_levels,
+                            const int *levels, sc_MPI_Comm * hiercomm)
+{
+  int                 mpiret;
+  int                 rank, node, l;
+  sc_MPI_Comm         sortcomm, nextcomm;
+#if defined (P4EST_ENABLE_MPI) && defined (SC_ENABLE_MPICOMMSHARED)
+  sc_MPI_Comm         nodecomm;
+#endif
+
+  P4EST_ASSERT (num_levels >= 0);
+  P4EST_ASSERT (num_levels == 0 || levels != NULL);
+  P4EST_ASSERT (hiercomm != NULL);
+
+  mpiret = sc_MPI_Comm_rank (mpicomm, &rank);
+  SC_CHECK_MPI (mpiret);
+
+  /* identify the shared memory node by its smallest rank */
+  node = rank;
+#if defined (P4EST_ENABLE_MPI) && defined (SC_ENABLE_MPICOMMSHARED)
+  mpiret = MPI_Comm_split_type (mpicomm, MPI_COMM_TYPE_SHARED, rank,
+                                MPI_INFO_NULL, &nodecomm);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Allreduce (&rank, &node, 1, sc_MPI_INT, sc_MPI_MIN,
+                             nodecomm);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Comm_free (&nodecomm);
+  SC_CHECK_MPI (mpiret);
+#endif
+
+  /* sc_MPI_Comm_split breaks ties in the key by the current rank order,
+   * so splitting by node and then by each level from fine to coarse
+   * sorts the processes lexicographically by (levels, node, rank) */
+  mpiret = sc_MPI_Comm_split (mpicomm, 0, node, &sortcomm);
+  SC_CHECK_MPI (mpiret);
+  for (l = num_levels - 1; l >= 0; --l) {
+    mpiret = sc_MPI_Comm_split (sortcomm, 0, levels[l], &nextcomm);
+    SC_CHECK_MPI (mpiret);
+    mpiret = sc_MPI_Comm_free (&sortcomm);
+    SC_CHECK_MPI (mpiret);
+    sortcomm = nextcomm;
+  }
+  *hiercomm = sortcomm;
+}
+
+#ifdef P4EST_COMM_NBX
+
+/* the attribute of a communicator that is not NULL after an odd number of
+ * NBX calls; it points to the key itself and owns no memory */
+static int          p4est_comm_nbx_keyval = MPI_KEYVAL_INVALID;
+
+#endif
+
+int
+p4est_comm_notify_nbx (int *receivers, int num_receivers,
+                       int *senders, int *num_senders, sc_MPI_Comm mpicomm)
+{
+#ifdef P4EST_COMM_NBX
+  int                 mpiret;
+  int                 i, flag, tag;
+  int                 barrier_active, done;
+  char                dummy = 0;
+  void               *parity;
+  MPI_Request        *send_requests, barrier_request;
+  MPI_Status          status;
+
+  P4EST_ASSERT (num_receivers >= 0);
+  P4EST_ASSERT (num_senders != NULL);
+
+  /* a process leaving the barrier may already send for the next call while
+   * others still probe; it cannot get further ahead, since every process
+   * enters the barrier of a call before anyone completes it, so alternating
+   * between two tags keeps consecutive calls apart */
+  if (p4est_comm_nbx_keyval == MPI_KEYVAL_INVALID) {
+    mpiret = MPI_Comm_create_keyval (MPI_COMM_NULL_COPY_FN,
+                                     MPI_COMM_NULL_DELETE_FN,
+                                     &p4est_comm_nbx_keyval, NULL);
+    SC_CHECK_MPI (mpiret);
+  }
+  mpiret = MPI_Comm_get_attr (mpicomm, p4est_comm_nbx_keyval, &parity,
+                              &flag);
+  SC_CHECK_MPI (mpiret);
+  if (!flag) {
+    parity = NULL;
+  }
+  tag = parity == NULL ? P4EST_COMM_NOTIFY_NBX : P4EST_COMM_NOTIFY_NBX_ODD;
+  mpiret = MPI_Comm_set_attr (mpicomm, p4est_comm_nbx_keyval,
+                              parity == NULL ? &p4est_comm_nbx_keyval : NULL);
+  SC_CHECK_MPI (mpiret);
+
+  /* a synchronous send completes only once it has been matched */
+  send_requests = P4EST_ALLOC (MPI_Request, num_receivers);
+  for (i = 0; i < num_receivers; ++i) {
+    P4EST_ASSERT (i == 0 || receivers[i - 1] < receivers[i]);
+    mpiret = MPI_Issend (&dummy, 0, MPI_BYTE, receivers[i],
+                         tag, mpicomm, send_requests + i);
+    SC_CHECK_MPI (mpiret);
+  }
+
+  /* receive notifications until everybody has had all sends matched */
+  *num_senders = 0;
+  barrier_request = MPI_REQUEST_NULL;
+  barrier_active = done = 0;
+  while (!done) {
+    mpiret = MPI_Iprobe (MPI_ANY_SOURCE, tag, mpicomm, &flag, &status);
+    SC_CHECK_MPI (mpiret);
+    if (flag) {
+      mpiret = MPI_Recv (&dummy, 0, MPI_BYTE, status.MPI_SOURCE,
+                         tag, mpicomm, MPI_STATUS_IGNORE);
+      SC_CHECK_MPI (mpiret);
+      senders[(*num_senders)++] = status.MPI_SOURCE;
+    }
+    if (!barrier_active) {
+      mpiret = MPI_Testall (num_receivers, send_requests, &flag,
+                            MPI_STATUSES_IGNORE);
+      SC_CHECK_MPI (mpiret);
+      if (flag) {
+        mpiret = MPI_Ibarrier (mpicomm, &barrier_request);
+        SC_CHECK_MPI (mpiret);
+        barrier_active = 1;
+      }
+    }
+    else {
+      mpiret = MPI_Test (&barrier_request, &done, MPI_STATUS_IGNORE);
+      SC_CHECK_MPI (mpiret);
+    }
+  }
+  P4EST_FREE (send_requests);
+
+  /* match the output convention of sc_notify */
+  qsort (senders, (size_t) * num_senders, sizeof (int), sc_int_compare);
+
+  return sc_MPI_SUCCESS;
+#else
+  return sc_notify (receivers, num_receivers, senders, num_senders, mpicomm);
+#endif
+}
+
 void
 p4est_comm_count_quadrants (p4est_t * p4est)
 {
@@ -749,6 +896,182 @@ p4est_comm_find_owner (p4est_t * p4est, p4est_locidx_t which_tree,
   return guess;
 }
 
+/** Compute the lookup key of a quadrant or clamped node.
+ * It is the Morton index of its first descendant at P4EST_QMAXLEVEL.
+ */
+static inline uint64_t
+p4est_comm_owner_key (const p4est_quadrant_t * q)
+{
+  const p4est_qcoord_t mask = ~(P4EST_QUADRANT_LEN (P4EST_QMAXLEVEL) - 1);
+  p4est_quadrant_t    a;
+
+  P4EST_ASSERT (p4est_quadrant_is_node (q, 1) || p4est_quadrant_is_valid (q));
+
+  /* a node is mapped to the smallest quadrant that contains it */
+  a.x = q->x & mask;
+  a.y = q->y & mask;
+#ifdef P4_TO_P8
+  a.z = q->z & mask;
+#endif
+  a.level = P4EST_QMAXLEVEL;
+
+  return p4est_quadrant_linear_id (&a, P4EST_QMAXLEVEL);
+}
+
+/** Check whether the partition boundary p is less or equal a position.
+ * \param [in] p        Process number in [0, mpisize].
+ * \return              True if boundary p is at or before (\a t, \a key).
+ */
+static inline int
+p4est_comm_owner_is_before (const p4est_comm_owner_lookup_t * lookup,
+                            int p, p4est_topidx_t t, uint64_t key)
+{
+  P4EST_ASSERT (0 <= p && p <= lookup->mpisize);
+
+  return lookup->tree[p] < t || (lookup->tree[p] == t && lookup->key[p] <= key);
+}
+
+p4est_comm_owner_lookup_t *
+p4est_comm_owner_lookup_new (p4est_t * p4est, int radix_bits)
+{
+  const int           num_procs = p4est->mpisize;
+  const p4est_topidx_t num_trees = p4est->connectivity->num_trees;
+  const p4est_quadrant_t *gfp = p4est->global_first_position;
+  int                 p;
+  size_t              zz, num_buckets;
+  p4est_topidx_t      t;
+  uint64_t            start;
+  p4est_comm_owner_lookup_t *lookup;
+
+  P4EST_ASSERT (gfp != NULL);
+  P4EST_ASSERT (0 <= radix_bits && radix_bits <= 16);
+
+  lookup = P4EST_ALLOC (p4est_comm_owner_lookup_t, 1);
+  lookup->mpisize = num_procs;
+  lookup->num_trees = num_trees;
+  lookup->revision = p4est->revision;
+  lookup->radix_bits = radix_bits;
+  lookup->radix_shift = P4EST_DIM * P4EST_QMAXLEVEL - radix_bits;
+
+  /* convert the partition markers into integer keys */
+  lookup->tree = P4EST_ALLOC (p4est_topidx_t, num_procs + 1);
+  lookup->key = P4EST_ALLOC (uint64_t, num_procs + 1);
+  for (p = 0; p <= num_procs; ++p) {
+    P4EST_ASSERT (gfp[p].level == P4EST_QMAXLEVEL);
+    lookup->tree[p] = gfp[p].p.which_tree;
+    lookup->key[p] = p4est_quadrant_linear_id (&gfp[p], P4EST_QMAXLEVEL);
+    P4EST_ASSERT (p == 0 ||
+                  p4est_comm_owner_is_before (lookup, p - 1, lookup->tree[p],
+                                              lookup->key[p]));
+  }
+  P4EST_ASSERT (lookup->tree[0] == 0 && lookup->key[0] == 0);
+  P4EST_ASSERT (lookup->tree[num_procs] == num_trees);
+
+  /* merge the bucket starts with the partition boundaries */
+  num_buckets = (size_t) num_trees << radix_bits;
+  lookup->table = P4EST_ALLOC (int, num_buckets + 1);
+  p = 0;
+  for (zz = 0; zz < num_buckets; ++zz) {
+    t = (p4est_topidx_t) (zz >> radix_bits);
+    start = (uint64_t) (zz & (((size_t) 1 << radix_bits) - 1))
+      << lookup->radix_shift;
+    while (p <= num_procs && (lookup->tree[p] < t ||
+                              (lookup->tree[p] == t &&
+                               lookup->key[p] < start))) {
+      ++p;
+    }
+    lookup->table[zz] = p;
+  }
+  lookup->table[num_buckets] = num_procs;
+  P4EST_ASSERT (p <= num_procs);
+
+  return lookup;
+}
+
+void
+p4est_comm_owner_lookup_destroy (p4est_comm_owner_lookup_t * lookup)
+{
+  P4EST_FREE (lookup->tree);
+  P4EST_FREE (lookup->key);
+  P4EST_FREE (lookup->table);
+  P4EST_FREE (lookup);
+}
+
+int
+p4est_comm_owner_lookup_find (const p4est_comm_owner_lookup_t * lookup,
+                              p4est_topidx_t which_tree,
+                              const p4est_quadrant_t * q)
+{
+  int                 low, high, guess;
+  size_t              bucket;
+  uint64_t            key;
+
+  P4EST_ASSERT (lookup != NULL);
+  P4EST_ASSERT (0 <= which_tree && which_tree < lookup->num_trees);
+
+  key = p4est_comm_owner_key (q);
+  bucket = ((size_t) which_tree << lookup->radix_bits) +
+    (size_t) (key >> lookup->radix_shift);
+
+  /* the number of boundaries at or before q lies within [low, high] */
+  low = lookup->table[bucket];
+  high = lookup->table[bucket + 1];
+  P4EST_ASSERT (0 <= low && low <= high && high <= lookup->mpisize);
+
+  /* find the first boundary strictly after q */
+  while (low < high) {
+    guess = low + (high - low) / 2;
+    if (p4est_comm_owner_is_before (lookup, guess, which_tree, key)) {
+      low = guess + 1;
+    }
+    else {
+      high = guess;
+    }
+  }
+
+  /* the owner is the last process that begins at or before q */
+  P4EST_ASSERT (0 < low && low <= lookup->mpisize);
+  P4EST_ASSERT (lookup->tree[low - 1] != lookup->tree[low] ||
+                lookup->key[low - 1] != lookup->key[low]);
+  return low - 1;
+}
+
+void
+p4est_comm_owner_lookup_batch (const p4est_comm_owner_lookup_t * lookup,
+                               p4est_topidx_t which_tree,
+                               sc_array_t * quadrants, sc_array_t * owners)
+{
+  int                 p;
+  int                *op;
+  size_t              zz, count;
+  uint64_t            key;
+
+  P4EST_ASSERT (lookup != NULL);
+  P4EST_ASSERT (quadrants != NULL &&
+                quadrants->elem_size == sizeof (p4est_quadrant_t));
+  P4EST_ASSERT (sc_array_is_sorted (quadrants, p4est_quadrant_compare));
+  P4EST_ASSERT (owners != NULL && owners->elem_size == sizeof (int));
+
+  count = quadrants->elem_count;
+  sc_array_resize (owners, count);
+  if (count == 0) {
+    return;
+  }
+
+  /* locate the first quadrant by search and the others by merging */
+  op = (int *) owners->array;
+  op[0] = p = p4est_comm_owner_lookup_find
+    (lookup, which_tree, p4est_quadrant_array_index (quadrants, 0));
+  for (zz = 1; zz < count; ++zz) {
+    key = p4est_comm_owner_key (p4est_quadrant_array_index (quadrants, zz));
+    while (p4est_comm_owner_is_before (lookup, p + 1, which_tree, key)) {
+      ++p;
+      P4EST_ASSERT (p < lookup->mpisize);
+    }
+    op[zz] = p;
+  }
+}
+
 void
 p4est_comm_tree_info (p4est_t * p4est, p4est_locidx_t which_tree,
                       int full_tree[], int tree_contact[],
@@ -102,6 +102,58 @@ int                 p4est_comm_parallel_env_reduce_ext (p4est_t **
                                                         int add_to_beginning,
                                                         int **ranks_subcomm);
 
+/** Create a communicator whose rank order follows the machine hierarchy.
+ * Partitioning assigns consecutive segments of the space filling curve to
+ * consecutive ranks.  A forest created on the returned communicator thus
+ * cuts the curve first into one segment per group of the hierarchy and then
+ * into one segment per process, such that the processes that share the most
+ * ghost layer data also share a node.
+ * Processes are ordered by \a levels, then by shared memory node, then by
+ * their rank in \a mpicomm.  Shared memory nodes are only detected if MPI-3
+ * shared communicators are available; otherwise each process counts as a
+ * node of its own.
+ * This function is collective over \a mpicomm.
+ *
+ * \param [in] mpicomm     Communicator to reorder.
+ * \param [in] num_levels  Number of user-defined hierarchy levels >= 0.
+ *                         Must be the same on all processes.
+ * \param [in] levels      For this process, its group number on each level,
+ *                         coarsest first (such as switch, then rack).
+ *                         May be NULL if \a num_levels is 0.
+ * \param [out] hiercomm   New communicator of the same size as \a mpicomm.
+ *                         Must be freed with sc_MPI_Comm_free.
+ */
+void                p4est_comm_hierarchy_split (sc_MPI_Comm mpicomm,
+                                                int num_levels,
+                                                const int *levels,
+                                                sc_MPI_Comm * hiercomm);
+
+/** Determine the processes that send to this one, given the receivers.
+ * This is a drop-in replacement for sc_notify that uses the nonblocking
+ * consensus algorithm (NBX): each process posts a synchronous send to its
+ * receivers and enters a nonblocking barrier once all of them are matched.
+ * Its cost is proportional to the number of peers plus a logarithmic
+ * barrier, which pays off for sparse patterns on large communicators.
+ * If MPI-3 is not available, this function calls sc_notify.
+ * This function is collective over \a mpicomm.  Since a process may leave
+ * the barrier while others still receive, consecutive calls on the same
+ * communicator alternate between two tags, whose parity is kept in an
+ * attribute of \a mpicomm.  Hence all processes of \a mpicomm must make
+ * the same sequence of calls on it, and no other messages may use the tags
+ * P4EST_COMM_NOTIFY_NBX and P4EST_COMM_NOTIFY_NBX_ODD on it.
+ *
+ * \param [in] receivers     Sorted array of ranks this process sends to.
+ * \param [in] num_receivers Length of \a receivers.
+ * \param [out] senders      Array of at least mpisize entries.  On output
+ *                           contains the sorted ranks sending to this one.
+ * \param [out] num_senders  Number of valid entries in \a senders.
+ * \param [in] mpicomm       Communicator to use.
+ * \return                   sc_MPI_SUCCESS or an MPI error code.
+ */
+int                 p4est_comm_notify_nbx (int *receivers, int num_receivers,
+                                          int *senders, int *num_senders,
+                                          sc_MPI_Comm mpicomm);
+
 /** Caculate the number and partition of quadrents.
  * \param [in,out] p4est  Adds all \c p4est->local_num_quadrant counters and
  *                        puts cumulative sums in p4est->global_first_quadrant.
@@ -170,6 +222,84 @@ int                 p4est_comm_find_owner (p4est_t * p4est,
                                            const p4est_quadrant_t * q,
                                            int guess);
 
+/** Precomputed structure to look up the owner of a quadrant quickly.
+ * The partition boundaries of p4est->global_first_position are stored as
+ * pairs of tree number and Morton index at P4EST_QMAXLEVEL, such that a
+ * search compares integers instead of calling \ref p4est_quadrant_compare.
+ * An optional radix table indexed by tree number and the leading bits of the
+ * Morton index narrows down the binary search to a small range of processes.
+ * The structure is only valid as long as the partition of the forest does
+ * not change, which can be checked against the stored \a revision.
+ */
+typedef struct p4est_comm_owner_lookup
+{
+  int                 mpisize;          /**< Number of processes. */
+  p4est_topidx_t      num_trees;        /**< Number of trees. */
+  long                revision;         /**< Forest revision at creation. */
+  int                 radix_bits;       /**< Key bits resolved by table. */
+  int                 radix_shift;      /**< Shift to obtain table bucket. */
+  p4est_topidx_t     *tree;             /**< Tree number of each partition
+                                             boundary, mpisize + 1 entries. */
+  uint64_t           *key;              /**< Morton index of each partition
+                                             boundary, mpisize + 1 entries. */
+  int                *table;            /**< For each tree and bucket the
+                                             number of boundaries before it,
+                                             (num_trees << radix_bits) + 1
+                                             entries. */
+}
+p4est_comm_owner_lookup_t;
+
+/** Create a structure for repeated owner searches of quadrants.
+ * Not collective; all information is taken from the partition markers.
+ * \param [in] p4est        Its global_first_position array must be valid.
+ * \param [in] radix_bits   Number of leading Morton index bits that are
+ *                          resolved by table lookup before the binary search.
+ *                          The table has (num_trees << radix_bits) + 1 entries.
+ *                          Must be in [0, 16].
+ *                          If 0, the table is indexed by tree number only.
+ * \return                  Lookup structure to be freed with
+ *                          \ref p4est_comm_owner_lookup_destroy.
+ */
+p4est_comm_owner_lookup_t *p4est_comm_owner_lookup_new (p4est_t * p4est,
+                                                        int radix_bits);
+
+/** Free all memory of an owner lookup structure.
+ * \param [in] lookup       Structure created by
+ *                          \ref p4est_comm_owner_lookup_new.
+ */
+void                p4est_comm_owner_lookup_destroy (p4est_comm_owner_lookup_t
+                                                     * lookup);
+
+/** Find the owner of a quadrant with the help of a lookup structure.
+ * This function returns the same result as \ref p4est_comm_find_owner.
+ * \param [in] lookup       Valid lookup structure for the current partition.
+ * \param [in] which_tree   Tree number of the quadrant.
+ * \param [in] q            Valid quadrant or node clamped inside the tree.
+ * \return                  The process owning the first descendant of \a q.
+ */
+int                 p4est_comm_owner_lookup_find (const
+                                                  p4est_comm_owner_lookup_t *
+                                                  lookup,
+                                                  p4est_topidx_t which_tree,
+                                                  const p4est_quadrant_t * q);
+
+/** Find the owners of a sorted array of quadrants in one merge pass.
+ * The cost is one search for the first quadrant plus a linear sweep over the
+ * quadrants and the partition boundaries they span.
+ * \param [in] lookup       Valid lookup structure for the current partition.
+ * \param [in] which_tree   Tree number of all quadrants.
+ * \param [in] quadrants    Array of quadrants sorted in Morton order.
+ *                          Overlaps and duplicates are permitted.
+ * \param [in,out] owners   Array of int is resized to the quadrant count and
+ *                          filled with the owner of each quadrant.
+ */
+void                p4est_comm_owner_lookup_batch (const
+                                                   p4est_comm_owner_lookup_t *
+                                                   lookup,
+                                                   p4est_topidx_t which_tree,
+                                                   sc_array_t * quadrants,
+                                                   sc_array_t * owners);
+
 /** Computes information about a tree being fully owned.
  * This is determined separately for the beginning and end of the tree.
  * \param [in] p4est            The p4est to work on.
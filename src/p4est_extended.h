@@ -63,10 +63,16 @@ struct p4est_inspect
   /** If true, call both sc_ranges and sc_notify and verify consistency.
    * Which is actually used is still determined by \a use_balance_ranges. */
   int                 use_balance_ranges_notify;
+  /** Use the nonblocking consensus p4est_comm_notify_nbx in place of
+   * sc_notify in balance and in place of sc_ranges in p4est_nodes_new. */
+  int                 use_notify_nbx;
   /** Verify sc_ranges and/or sc_notify as applicable. */
   int                 use_balance_verify;
   /** If positive and smaller than p4est_num ranges, overrides it */
   int                 balance_max_ranges;
+  /** Collect the nodes in p4est_nodes_new with sc_hash_array as they are
+   * found.  If false (the default), they are sorted and made unique. */
+  int                 use_nodes_hash;
   size_t              balance_A_count_in;
   size_t              balance_A_count_out;
   size_t              balance_comm_sent;
@@ -81,6 +87,8 @@ struct p4est_inspect
   double              balance_notify;   /**< time spent in sc_notify */
   /** time spent in sc_notify_allgather */
   double              balance_notify_allgather;
+  /** time spent in p4est_comm_notify_nbx */
+  double              balance_notify_nbx;
   int                 use_B;
 };
 
@@ -110,6 +118,38 @@ typedef void        (*p4est_replace_t) (p4est_t * p4est,
                                         int num_incoming,
                                         p4est_quadrant_t * incoming[]);
 
+/** A batch of refinement or coarsening relations passed to a projection
+ * kernel, see \ref p4est_project_apply.  Every relation connects one
+ * coarse quadrant to the \a num_fine quadrants of its family, which are
+ * numbered consecutively in child order.  For refinement, the coarse
+ * quadrants index the source fields and the fine ones the destination fields;
+ * for coarsening it is the other way around.  Each field stores
+ * \a field_size consecutive doubles per quadrant.
+ */
+typedef struct p4est_project_block
+{
+  int                 num_fields;       /**< Number of fields. */
+  size_t              field_size;       /**< Doubles per quadrant. */
+  const double      **src_fields;       /**< Fields to read from. */
+  double            **dst_fields;       /**< Fields to write to. */
+  p4est_locidx_t      num_relations;    /**< Number of relations. */
+  int                 num_fine;         /**< Always P4EST_CHILDREN. */
+  const p4est_locidx_t *coarse;         /**< Coarse quadrant by relation. */
+  const p4est_locidx_t *fine;           /**< First of the fine quadrants. */
+}
+p4est_project_block_t;
+
+/** Callback function prototype to project a batch of relations.
+ * \param [in] block    The relations and the fields to read and write.
+ * \param [in] user     The user pointer passed to \ref p4est_project_apply.
+ */
+typedef void        (*p4est_project_kernel_t) (const p4est_project_block_t *
+                                               block, void *user);
+
+/** Opaque plan to project data from the old to the new quadrants of an
+ * adapted forest, created by \ref p4est_project_new. */
+typedef struct p4est_project p4est_project_t;
+
 /** Create a new forest.
  * This is a more general form of p4est_new.
  * See the documentation of p4est_new for basic usage.
@@ -148,6 +188,34 @@ p4est_mesh_t       *p4est_mesh_new_ext (p4est_t * p4est,
                                         int compute_level_lists,
                                         p4est_connect_type_t btype);
 
+/** Create a new mesh without calling \ref p4est_iterate.
+ * The face neighbors of each local quadrant are looked up directly in the
+ * sorted local quadrants and ghost layer.  The face neighbors are stored
+ * only in the compressed sparse row arrays face_offset, face_quad and
+ * face_code, which take one entry per actual neighbor.  The dense arrays
+ * quad_to_quad, quad_to_face and quad_to_half are not allocated and NULL.
+ * \ref p4est_mesh_face_neighbor_next works with either kind of mesh.
+ * The corner neighbors are found in the same loop and stored as in
+ * \ref p4est_mesh_new_ext.
+ * \param [in] p4est                A forest that is fully 2:1 balanced.
+ * \param [in] ghost                The ghost layer created from the
+ *                                  provided p4est.
+ * \param [in] compute_tree_index   Boolean to decide whether to allocate and
+ *                                  compute the quad_to_tree list.
+ * \param [in] compute_level_lists  Boolean to decide whether to compute the
+ *                                  level lists in quad_level.
+ * \param [in] btype                Which neighbors to store.  The corner
+ *                                  neighbors are found if this is
+ *                                  P4EST_CONNECT_FULL.  The ghost layer and
+ *                                  the balance must be at least this strong.
+ * \return                          A fully allocated mesh structure.
+ */
+p4est_mesh_t       *p4est_mesh_new_csr (p4est_t * p4est,
+                                        p4est_ghost_t * ghost,
+                                        int compute_tree_index,
+                                        int compute_level_lists,
+                                        p4est_connect_type_t btype);
+
 /** Make a deep copy of a p4est.
  * The connectivity is not duplicated.
  * Copying of quadrant user data is optional.
@@ -192,6 +260,117 @@ void                p4est_refine_ext (p4est_t * p4est,
                                       p4est_init_t init_fn,
                                       p4est_replace_t replace_fn);
 
+/** Refine a forest once by a precomputed flag for each local quadrant.
+ * This function works like \ref p4est_refine_ext without recursion, but
+ * needs no refinement callback.  The new quadrants of each tree are written
+ * into a preallocated array in one pass over the old ones.
+ * This function is collective since it updates the global quadrant count.
+ * \param [in,out] p4est The forest is changed in place.
+ * \param [in] flags      For each local quadrant, nonzero if it shall be
+ *                        refined.  May be NULL if there are no local
+ *                        quadrants.
+ * \param [in] allowed_level Maximum allowed refinement level (inclusive).
+ *                        If this is negative the level is restricted only
+ *                        by the compile-time constant QMAXLEVEL in p4est.h.
+ *                        Flags of quadrants at this level are ignored.
+ * \param [in] init_fn    Callback function to initialize the user_data for
+ *                        newly created quadrants, which is guaranteed to be
+ *                        allocated.  This function pointer may be NULL.
+ * \param [in] replace_fn Callback function that allows the user to change
+ *                        incoming quadrants based on the quadrants they
+ *                        replace; may be NULL.
+ * \param [out] old_to_new If not NULL, an array of length
+ *                        local_num_quadrants + 1 before refinement.
+ *                        On output, the new local quadrants that replace old
+ *                        quadrant k are [old_to_new[k], old_to_new[k + 1]),
+ *                        which is either one or P4EST_CHILDREN quadrants.
+ */
+void                p4est_refine_flags (p4est_t * p4est,
+                                        const int8_t * flags,
+                                        int allowed_level,
+                                        p4est_init_t init_fn,
+                                        p4est_replace_t replace_fn,
+                                        p4est_locidx_t * old_to_new);
+
+/** Refine, coarsen and 2:1 balance a forest by a mark per local quadrant.
+ * Refinement and coarsening are applied together in one pass over each
+ * tree, followed by \ref p4est_balance_ext if the forest has changed.
+ * A family is coarsened if all of its members are local and marked.
+ * Refinement and coarsening are not recursive.
+ * The user data of kept quadrants is preserved, that of removed quadrants freed,
+ * and that of new quadrants initialized by \b init_fn.
+ * Instead of replace callbacks, an index map in compressed sparse row format
+ * relates every old quadrant to the new quadrants overlapping it: either the
+ * same quadrant, its descendants, or its coarsened ancestor.
+ * The partition is not changed.  This function is collective.
+ * \param [in,out] p4est The forest is changed in place.
+ * \param [in] marks      For each local quadrant, positive to refine,
+ *                        negative to coarsen, and zero to keep it.
+ *                        May be NULL if there are no local quadrants.
+ * \param [in] btype      Balance type after refinement and coarsening.
+ * \param [in] init_fn    Callback function to initialize the user_data for
+ *                        newly created quadrants, which is guaranteed to be
+ *                        allocated.  This function pointer may be NULL.
+ * \param [out] map_offsets If not NULL, an array of element size
+ *                        sizeof (p4est_locidx_t).  It is resized to the
+ *                        number of old local quadrants plus one.  The new
+ *                        quadrants overlapping old quadrant k are
+ *                        map_indices[map_offsets[k] .. map_offsets[k + 1]).
+ * \param [out] map_indices Must be NULL if and only if \b map_offsets is.
+ *                        Array of element size sizeof (p4est_locidx_t)
+ *                        resized to hold the local numbers of the new
+ *                        quadrants for all old ones.
+ */
+void                p4est_adapt (p4est_t * p4est, const int8_t * marks,
+                                 p4est_connect_type_t btype,
+                                 p4est_init_t init_fn,
+                                 sc_array_t * map_offsets,
+                                 sc_array_t * map_indices);
+
+/** Create a plan to project data from the old to the new local quadrants
+ * of a forest adapted by \ref p4est_adapt.  The index map is classified
+ * into kept quadrants, refined ones and coarsened families.  Consecutive
+ * kept quadrants are merged into runs, and the relations of refinement by
+ * one level and of coarsening are each gathered into one batch.  A quadrant
+ * refined by several levels during balance is projected level by level.
+ * \param [in] p4est        The forest after adaptation.
+ * \param [in] map_offsets  The index map offsets output by \ref p4est_adapt.
+ * \param [in] map_indices  The index map indices output by \ref p4est_adapt.
+ * \return                  A plan that can be applied any number of times
+ *                          while the forest is unchanged.
+ */
+p4est_project_t    *p4est_project_new (p4est_t * p4est,
+                                       sc_array_t * map_offsets,
+                                       sc_array_t * map_indices);
+
+/** Free the memory of a projection plan.
+ * \param [in] project      Plan created by \ref p4est_project_new.
+ */
+void                p4est_project_destroy (p4est_project_t * project);
+
+/** Project data stored outside of the forest, one array per field,
+ * from the old to the new local quadrants.  The data of kept quadrants is
+ * copied, and the refinement and coarsening batches are passed to the
+ * respective kernel once each.
+ * \param [in] project      Plan created by \ref p4est_project_new.
+ * \param [in] num_fields   Number of fields, may be zero.
+ * \param [in] field_size   Number of doubles per quadrant in every field.
+ * \param [in] old_fields   For each field, the data on the old quadrants.
+ * \param [out] new_fields  For each field, the data on the new quadrants.
+ * \param [in] refine_fn    Kernel to interpolate from a parent to its
+ *                          children.  If NULL, the parent data is copied.
+ * \param [in] coarsen_fn   Kernel to restrict from children to their parent.
+ *                          If NULL, the data of the children is averaged.
+ * \param [in] user         Passed through to the kernels.
+ */
+void                p4est_project_apply (p4est_project_t * project,
+                                         int num_fields, size_t field_size,
+                                         const double **old_fields,
+                                         double **new_fields,
+                                         p4est_project_kernel_t refine_fn,
+                                         p4est_project_kernel_t coarsen_fn,
+                                         void *user);
+
 /** Coarsen a forest.
  * \param [in,out] p4est The forest is changed in place.
  * \param [in] coarsen_recursive Boolean to decide on recursive coarsening.
@@ -241,6 +420,36 @@ void                p4est_balance_subtree_ext (p4est_t * p4est,
                                                p4est_init_t init_fn,
                                                p4est_replace_t replace_fn);
 
+/** A partition whose quadrant messages are in flight.
+ * It is created by \ref p4est_partition_begin or
+ * \ref p4est_partition_given_begin and freed by the matching end call.
+ * Only the members \a local_keep_first and \a local_keep_count may be read
+ * by the caller.  All other members are internal.
+ */
+typedef struct p4est_partition_context
+{
+  p4est_t            *p4est;            /**< The forest being partitioned. */
+  int                 active;           /**< False if nothing is shipped. */
+  int                 num_proc_recv_from, num_proc_send_to;
+  char              **recv_buf, **send_buf;
+  sc_MPI_Request     *recv_request, *send_request;
+  p4est_locidx_t     *num_recv_from, *num_send_to;
+  p4est_locidx_t     *num_per_tree_local;
+  p4est_gloidx_t     *begin_send_to;
+  p4est_gloidx_t     *global_last_quad_index;
+  p4est_gloidx_t     *new_global_last_quad_index;
+  p4est_gloidx_t     *local_tree_last_quad_index;
+  p4est_gloidx_t      total_quadrants_shipped;
+  p4est_locidx_t      local_keep_first; /**< Local index of the first
+                                             quadrant that stays on this
+                                             process. */
+  p4est_locidx_t      local_keep_count; /**< Number of local quadrants that
+                                             stay on this process; they
+                                             are contiguous. */
+  unsigned            crc;
+}
+p4est_partition_context_t;
+
 /** Repartition the forest.
  *
  * The forest is partitioned between processors such that each processor
@@ -257,6 +466,39 @@ p4est_gloidx_t      p4est_partition_ext (p4est_t * p4est,
                                          int partition_for_coarsening,
                                          p4est_weight_t weight_fn);
 
+/** Begin to repartition the forest.
+ * This function computes the new partition like \ref p4est_partition_ext
+ * and posts the messages for the quadrants and their user data.
+ * The forest is not yet changed.  Its quadrants and user data may be read
+ * until \ref p4est_partition_end, which allows to overlap computation on
+ * the local quadrants with the communication.
+ * The quadrants with local indices \a local_keep_first up to excluding
+ * \a local_keep_first + \a local_keep_count of the returned context stay
+ * on this process, all others are sent away.  Computation on the kept
+ * quadrants and their user data carries over to the new partition, while
+ * changes to the user data of the other quadrants are lost.
+ * The forest must not be modified between begin and end: no refinement,
+ * coarsening, balancing, partitioning or any other change to its trees
+ * and quadrants is allowed, and \ref p4est_partition_end must be called
+ * before the forest is used in any other collective function.
+ * \param [in] p4est      The forest that will be partitioned.
+ * \param [in] partition_for_coarsening     As in \ref p4est_partition_ext.
+ * \param [in] weight_fn  A weighting function or NULL
+ *                        for uniform partitioning.
+ * \return                Context to be passed to \ref p4est_partition_end.
+ */
+p4est_partition_context_t *p4est_partition_begin (p4est_t * p4est,
+                                                  int
+                                                  partition_for_coarsening,
+                                                  p4est_weight_t weight_fn);
+
+/** Complete a partition started by \ref p4est_partition_begin.
+ * This function waits for all messages and assembles the new local forest.
+ * \param [in] pc         The context is deallocated before returning.
+ * \return                The global number of shipped quadrants
+ */
+p4est_gloidx_t      p4est_partition_end (p4est_partition_context_t * pc);
+
 /** Correct partition to allow one level of coarsening.
  *
  * \param [in] p4est                     forest whose partition is corrected
@@ -101,3 +101,470 @@ p4est_geometry_new_connectivity (p4est_connectivity_t * conn)
 
   return geom;
 }
+
+/** Step of the finite differences in the geometry cache relative to the
+ * quadrant length, and its lower bound in the unit tree, which is about
+ * the square root of the machine epsilon. */
+static const double geometry_cache_step = 1.e-4;
+static const double geometry_cache_min_step = 1.5e-8;
+
+/** Compute the Gauss-Legendre points and weights on [0, 1].
+ * \param [in] n        Number of points.
+ * \param [out] x       The n points in ascending order.
+ * \param [out] w       The n weights.
+ */
+static void
+geometry_cache_gauss (int n, double *x, double *w)
+{
+  int                 i, j, k;
+  double              z, dz, p0, p1, p2, dp;
+
+  for (i = 0; i < n; ++i) {
+    z = -cos (M_PI * (i + .75) / (n + .5));
+    for (k = 0; k < 100; ++k) {
+      p0 = 1.;
+      p1 = z;
+      for (j = 1; j < n; ++j) {
+        p2 = ((2 * j + 1) * z * p1 - j * p0) / (j + 1);
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (z * p1 - p0) / (z * z - 1.);
+      dz = p1 / dp;
+      z -= dz;
+      if (fabs (dz) < 1e-15) {
+        break;
+      }
+    }
+    p0 = 1.;
+    p1 = z;
+    for (j = 1; j < n; ++j) {
+      p2 = ((2 * j + 1) * z * p1 - j * p0) / (j + 1);
+      p0 = p1;
+      p1 = p2;
+    }
+    dp = n * (z * p1 - p0) / (z * z - 1.);
+    x[i] = .5 * (z + 1.);
+    w[i] = 1. / ((1. - z * z) * dp * dp);
+  }
+}
+
+/** Evaluate the multilinear map of the tree vertices and its exact
+ * derivatives at a point of a quadrant.
+ * \param [in] conn     The connectivity with valid vertices.
+ * \param [in] which_tree   The tree of the quadrant.
+ * \param [in] abc      The tree reference coordinates of the point.
+ * \param [in] qlen     The quadrant length relative to the tree.
+ * \param [out] xyz     The physical coordinates of the point.
+ * \param [out] J       Column k holds the derivatives with respect to
+ *                      the quadrant reference coordinate k.
+ */
+static void
+geometry_cache_vertices (p4est_connectivity_t * conn,
+                         p4est_topidx_t which_tree, const double abc[3],
+                         double qlen, double xyz[3], double J[P4EST_DIM][3])
+{
+  int                 c, j, k, l;
+  double              f, w, dw[P4EST_DIM];
+  const double       *v;
+
+  P4EST_ASSERT (conn->vertices != NULL);
+
+  for (j = 0; j < 3; ++j) {
+    xyz[j] = 0.;
+    for (k = 0; k < P4EST_DIM; ++k) {
+      J[k][j] = 0.;
+    }
+  }
+  for (c = 0; c < P4EST_CHILDREN; ++c) {
+    /* the weight of a corner is a product of one factor per direction */
+    w = 1.;
+    for (k = 0; k < P4EST_DIM; ++k) {
+      dw[k] = qlen;
+    }
+    for (l = 0; l < P4EST_DIM; ++l) {
+      f = (c >> l) & 1 ? abc[l] : 1. - abc[l];
+      w *= f;
+      for (k = 0; k < P4EST_DIM; ++k) {
+        dw[k] *= k != l ? f : (c >> l) & 1 ? 1. : -1.;
+      }
+    }
+    v = conn->vertices +
+      3 * conn->tree_to_vertex[which_tree * P4EST_CHILDREN + c];
+    for (j = 0; j < 3; ++j) {
+      xyz[j] += w * v[j];
+      for (k = 0; k < P4EST_DIM; ++k) {
+        J[k][j] += dw[k] * v[j];
+      }
+    }
+  }
+}
+
+/** Evaluate the geometry and its derivatives at a point of a quadrant.
+ * The derivatives are approximated by second order differences that do
+ * not leave the unit tree, central ones where possible.  The step is
+ * bounded below such that rounding does not dominate on small quadrants.
+ * \param [in] geom     The geometry transformation.  If NULL, the
+ *                      vertices of \b conn are used with exact derivatives.
+ * \param [in] conn     The connectivity of the forest.
+ * \param [in] which_tree   The tree of the quadrant.
+ * \param [in] abc      The tree reference coordinates of the point.
+ * \param [in] qlen     The quadrant length relative to the tree.
+ * \param [out] xyz     The physical coordinates of the point.
+ * \param [out] J       Column k holds the derivatives with respect to
+ *                      the quadrant reference coordinate k.
+ */
+static void
+geometry_cache_eval (p4est_geometry_t * geom, p4est_connectivity_t * conn,
+                     p4est_topidx_t which_tree, const double abc[3],
+                     double qlen, double xyz[3], double J[P4EST_DIM][3])
+{
+  int                 j, k;
+  const double        h =
+    SC_MAX (qlen * geometry_cache_step, geometry_cache_min_step);
+  double              s, p[3], x1[3], x2[3];
+
+  if (geom == NULL) {
+    geometry_cache_vertices (conn, which_tree, abc, qlen, xyz, J);
+    return;
+  }
+  geom->X (geom, which_tree, abc, xyz);
+  for (k = 0; k < P4EST_DIM; ++k) {
+    p[0] = abc[0];
+    p[1] = abc[1];
+    p[2] = abc[2];
+    if (abc[k] - h >= 0. && abc[k] + h <= 1.) {
+      p[k] = abc[k] + h;
+      geom->X (geom, which_tree, p, x1);
+      p[k] = abc[k] - h;
+      geom->X (geom, which_tree, p, x2);
+      for (j = 0; j < 3; ++j) {
+        J[k][j] = (x1[j] - x2[j]) * (qlen / (2. * h));
+      }
+    }
+    else {
+      s = abc[k] - h < 0. ? 1. : -1.;
+      p[k] = abc[k] + s * h;
+      geom->X (geom, which_tree, p, x1);
+      p[k] = abc[k] + 2. * s * h;
+      geom->X (geom, which_tree, p, x2);
+      for (j = 0; j < 3; ++j) {
+        J[k][j] = s * (4. * x1[j] - 3. * xyz[j] - x2[j]) * (qlen / (2. * h));
+      }
+    }
+  }
+}
+
+static void
+geometry_cache_cross (const double a[3], const double b[3], double c[3])
+{
+  c[0] = a[1] * b[2] - a[2] * b[1];
+  c[1] = a[2] * b[0] - a[0] * b[2];
+  c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/** Compute the unit outward normal and the surface element of a face.
+ * \param [in] J        The columns of the Jacobian on the face.
+ * \param [in] face     The face number of the quadrant.
+ * \param [out] n       The unit outward normal.
+ * \return              The surface element.
+ */
+static double
+geometry_cache_normal (double J[P4EST_DIM][3], int face, double n[3])
+{
+  const int           k = face / 2;
+  int                 j;
+  double              area, norm, dot;
+#ifndef P4_TO_P8
+  double              m[3];
+
+  /* the normal lies in the surface and is orthogonal to the face */
+  geometry_cache_cross (J[0], J[1], m);
+  geometry_cache_cross (J[1 - k], m, n);
+  area = sqrt (J[1 - k][0] * J[1 - k][0] + J[1 - k][1] * J[1 - k][1] +
+               J[1 - k][2] * J[1 - k][2]);
+#else
+  geometry_cache_cross (J[(k + 1) % 3], J[(k + 2) % 3], n);
+  area = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+#endif
+
+  /* orient along increasing coordinate k, then outward */
+  dot = n[0] * J[k][0] + n[1] * J[k][1] + n[2] * J[k][2];
+  norm = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  if ((dot < 0.) == (face % 2 == 1)) {
+    norm = -norm;
+  }
+  for (j = 0; j < 3; ++j) {
+    n[j] /= norm;
+  }
+  return area;
+}
+
+/** Compute the cache entries of one quadrant. */
+static void
+geometry_cache_quadrant (p4est_geometry_cache_t * cache,
+                         p4est_topidx_t which_tree,
+                         const p4est_quadrant_t * q, p4est_locidx_t qid)
+{
+  p4est_geometry_t   *geom = cache->geom;
+  p4est_connectivity_t *conn = cache->p4est->connectivity;
+  const int           degree = cache->degree;
+  const int           np = cache->num_points;
+  const int           nfp = cache->num_face_points;
+  const p4est_locidx_t nq =
+    cache->local_num_quadrants + cache->ghost_num_quadrants;
+  const double        qlen =
+    (double) P4EST_QUADRANT_LEN (q->level) / P4EST_ROOT_LEN;
+  int                 i, j, k, l, f;
+  double              corner[3], abc[3], xyz[3], n[3];
+  double              J[P4EST_DIM][3], det, volume;
+  size_t              zf;
+
+  corner[0] = (double) q->x / P4EST_ROOT_LEN;
+  corner[1] = (double) q->y / P4EST_ROOT_LEN;
+#ifndef P4_TO_P8
+  corner[2] = 0.;
+#else
+  corner[2] = (double) q->z / P4EST_ROOT_LEN;
+#endif
+  abc[2] = corner[2];
+
+  /* volume points */
+  volume = 0.;
+  for (i = 0; i < np; ++i) {
+    for (l = i, k = 0; k < P4EST_DIM; ++k, l /= degree) {
+      abc[k] = corner[k] + qlen * cache->points[l % degree];
+    }
+    geometry_cache_eval (geom, conn, which_tree, abc, qlen, xyz, J);
+    for (j = 0; j < 3; ++j) {
+      cache->xyz[((size_t) j * nq + qid) * np + i] = xyz[j];
+      for (k = 0; k < P4EST_DIM; ++k) {
+        cache->jacobian[((size_t) (3 * k + j) * nq + qid) * np + i] =
+          J[k][j];
+      }
+    }
+#ifndef P4_TO_P8
+    geometry_cache_cross (J[0], J[1], n);
+    det = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+#else
+    geometry_cache_cross (J[1], J[2], n);
+    det = J[0][0] * n[0] + J[0][1] * n[1] + J[0][2] * n[2];
+#endif
+    cache->detJ[(size_t) qid * np + i] = det;
+    volume += cache->weights[i] * det;
+  }
+  cache->volume[qid] = volume;
+
+  /* face points */
+  for (f = 0; f < P4EST_FACES; ++f) {
+    for (i = 0; i < nfp; ++i) {
+      for (l = i, k = 0; k < P4EST_DIM; ++k) {
+        if (k == f / 2) {
+          abc[k] = corner[k] + qlen * (f % 2);
+        }
+        else {
+          abc[k] = corner[k] + qlen * cache->points[l % degree];
+          l /= degree;
+        }
+      }
+      geometry_cache_eval (geom, conn, which_tree, abc, qlen, xyz, J);
+      zf = ((size_t) qid * P4EST_FACES + f) * nfp + i;
+      cache->face_detJ[zf] = geometry_cache_normal (J, f, n);
+      for (j = 0; j < 3; ++j) {
+        cache->normal[(size_t) j * nq * P4EST_FACES * nfp + zf] = n[j];
+      }
+    }
+  }
+}
+
+/** Copy a contiguous range between a cache field and a record. */
+static double      *
+geometry_cache_copy (double *field, double *rec, size_t n, int unpack)
+{
+  if (unpack) {
+    memcpy (field, rec, n * sizeof (double));
+  }
+  else {
+    memcpy (rec, field, n * sizeof (double));
+  }
+  return rec + n;
+}
+
+/** Pack the data of one quadrant into a record or unpack it. */
+static void
+geometry_cache_record (p4est_geometry_cache_t * cache, p4est_locidx_t qid,
+                       double *rec, int unpack)
+{
+  const size_t        np = (size_t) cache->num_points;
+  const size_t        nfp = (size_t) cache->num_face_points * P4EST_FACES;
+  const size_t        nq =
+    (size_t) (cache->local_num_quadrants + cache->ghost_num_quadrants);
+  int                 j;
+
+  for (j = 0; j < 3; ++j) {
+    rec = geometry_cache_copy (cache->xyz + (j * nq + qid) * np,
+                               rec, np, unpack);
+  }
+  for (j = 0; j < 3 * P4EST_DIM; ++j) {
+    rec = geometry_cache_copy (cache->jacobian + (j * nq + qid) * np,
+                               rec, np, unpack);
+  }
+  rec = geometry_cache_copy (cache->detJ + qid * np, rec, np, unpack);
+  rec = geometry_cache_copy (cache->volume + qid, rec, 1, unpack);
+  for (j = 0; j < 3; ++j) {
+    rec = geometry_cache_copy (cache->normal + (j * nq + qid) * nfp,
+                               rec, nfp, unpack);
+  }
+  (void) geometry_cache_copy (cache->face_detJ + qid * nfp, rec, nfp, unpack);
+}
+
+static void
+geometry_cache_free (p4est_geometry_cache_t * cache)
+{
+  P4EST_FREE (cache->xyz);
+  P4EST_FREE (cache->jacobian);
+  P4EST_FREE (cache->detJ);
+  P4EST_FREE (cache->volume);
+  P4EST_FREE (cache->normal);
+  P4EST_FREE (cache->face_detJ);
+}
+
+static void
+geometry_cache_compute (p4est_geometry_cache_t * cache, p4est_ghost_t * ghost)
+{
+  p4est_t            *p4est = cache->p4est;
+  const int           np = cache->num_points;
+  const int           nfp = cache->num_face_points;
+  const size_t        rec = (size_t) np * (4 + 3 * P4EST_DIM) + 1 +
+    (size_t) nfp * P4EST_FACES * 4;
+  size_t              nq, zz, nm;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      qid, g;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q;
+  double             *mirror_buffer, *ghost_buffer;
+  void              **mirror_data;
+
+  cache->revision = p4est->revision;
+  cache->local_num_quadrants = p4est->local_num_quadrants;
+  cache->ghost_num_quadrants =
+    ghost == NULL ? 0 : (p4est_locidx_t) ghost->ghosts.elem_count;
+  nq = (size_t) (cache->local_num_quadrants + cache->ghost_num_quadrants);
+
+  cache->xyz = P4EST_ALLOC (double, 3 * nq * np);
+  cache->jacobian = P4EST_ALLOC (double, 3 * P4EST_DIM * nq * np);
+  cache->detJ = P4EST_ALLOC (double, nq * np);
+  cache->volume = P4EST_ALLOC (double, nq);
+  cache->normal = P4EST_ALLOC (double, 3 * nq * P4EST_FACES * nfp);
+  cache->face_detJ = P4EST_ALLOC (double, nq * P4EST_FACES * nfp);
+
+  /* the local quadrants are computed independently on every process */
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    qid = tree->quadrants_offset;
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz, ++qid) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      geometry_cache_quadrant (cache, jt, q, qid);
+    }
+  }
+  if (ghost == NULL) {
+    return;
+  }
+
+  /* the ghost data is received from the owners of the ghosts */
+  nm = ghost->mirrors.elem_count;
+  mirror_buffer = P4EST_ALLOC (double, nm * rec);
+  mirror_data = P4EST_ALLOC (void *, nm);
+  for (zz = 0; zz < nm; ++zz) {
+    q = p4est_quadrant_array_index (&ghost->mirrors, zz);
+    mirror_data[zz] = mirror_buffer + zz * rec;
+    geometry_cache_record (cache, q->p.piggy3.local_num,
+                           mirror_buffer + zz * rec, 0);
+  }
+  ghost_buffer = P4EST_ALLOC (double, cache->ghost_num_quadrants * rec);
+  p4est_ghost_exchange_custom (p4est, ghost, rec * sizeof (double),
+                               mirror_data, ghost_buffer);
+  for (g = 0; g < cache->ghost_num_quadrants; ++g) {
+    geometry_cache_record (cache, cache->local_num_quadrants + g,
+                           ghost_buffer + g * rec, 1);
+  }
+  P4EST_FREE (mirror_buffer);
+  P4EST_FREE (mirror_data);
+  P4EST_FREE (ghost_buffer);
+}
+
+p4est_geometry_cache_t *
+p4est_geometry_cache_new (p4est_t * p4est, p4est_ghost_t * ghost,
+                          p4est_geometry_t * geom, int degree)
+{
+  int                 i, k, l;
+  double             *w;
+  p4est_geometry_cache_t *cache;
+
+  P4EST_ASSERT (degree >= 1);
+  P4EST_ASSERT (ghost == NULL || ghost->mpisize == p4est->mpisize);
+  P4EST_ASSERT (geom != NULL || p4est->connectivity->vertices != NULL);
+
+  cache = P4EST_ALLOC_ZERO (p4est_geometry_cache_t, 1);
+  cache->p4est = p4est;
+  cache->geom = geom;
+  cache->degree = degree;
+  cache->num_face_points = 1;
+  for (k = 1; k < P4EST_DIM; ++k) {
+    cache->num_face_points *= degree;
+  }
+  cache->num_points = cache->num_face_points * degree;
+
+  /* tensor product quadrature rules */
+  cache->points = P4EST_ALLOC (double, degree);
+  w = P4EST_ALLOC (double, degree);
+  geometry_cache_gauss (degree, cache->points, w);
+  cache->weights = P4EST_ALLOC (double, cache->num_points);
+  for (i = 0; i < cache->num_points; ++i) {
+    cache->weights[i] = 1.;
+    for (l = i, k = 0; k < P4EST_DIM; ++k, l /= degree) {
+      cache->weights[i] *= w[l % degree];
+    }
+  }
+  cache->face_weights = P4EST_ALLOC (double, cache->num_face_points);
+  for (i = 0; i < cache->num_face_points; ++i) {
+    cache->face_weights[i] = 1.;
+    for (l = i, k = 1; k < P4EST_DIM; ++k, l /= degree) {
+      cache->face_weights[i] *= w[l % degree];
+    }
+  }
+  P4EST_FREE (w);
+
+  geometry_cache_compute (cache, ghost);
+  return cache;
+}
+
+void
+p4est_geometry_cache_destroy (p4est_geometry_cache_t * cache)
+{
+  geometry_cache_free (cache);
+  P4EST_FREE (cache->points);
+  P4EST_FREE (cache->weights);
+  P4EST_FREE (cache->face_weights);
+  P4EST_FREE (cache);
+}
+
+int
+p4est_geometry_cache_is_current (p4est_geometry_cache_t * cache)
+{
+  return cache->revision == p4est_revision (cache->p4est);
+}
+
+int
+p4est_geometry_cache_update (p4est_geometry_cache_t * cache,
+                             p4est_ghost_t * ghost)
+{
+  P4EST_ASSERT (ghost == NULL || ghost->mpisize == cache->p4est->mpisize);
+
+  if (p4est_geometry_cache_is_current (cache)) {
+    return 0;
+  }
+  geometry_cache_free (cache);
+  geometry_cache_compute (cache, ghost);
+  return 1;
+}
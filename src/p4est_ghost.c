@@ -4069,3 +4069,90 @@ p4est_ghost_is_valid (p4est_t * p4est, p4est_ghost_t * ghost)
   P4EST_FREE (checksums_recv);
   return retval;
 }
+
+void
+p4est_partition_stats (p4est_t * p4est, p4est_ghost_t * ghost,
+                       p4est_weight_t weight_fn, size_t data_size,
+                       double *values, sc_statinfo_t * stats)
+{
+  const int           num_procs = p4est->mpisize;
+  const int           rank = p4est->mpirank;
+  int                 p, f;
+  int                 num_peers;
+  size_t              zz;
+  double              weight;
+  p4est_topidx_t      jt, nt;
+  p4est_locidx_t      num_faces, num_mirrors, num_sends;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, n;
+  sc_statinfo_t       si[P4EST_PARTITION_STATS_LAST];
+
+  P4EST_ASSERT (ghost != NULL);
+  P4EST_ASSERT (ghost->mpisize == num_procs);
+
+  /* sum the partition weights */
+  if (weight_fn == NULL) {
+    weight = (double) p4est->local_num_quadrants;
+  }
+  else {
+    weight = 0.;
+    for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+      tree = p4est_tree_array_index (p4est->trees, jt);
+      for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+        q = p4est_quadrant_array_index (&tree->quadrants, zz);
+        weight += (double) weight_fn (p4est, jt, q);
+      }
+    }
+  }
+
+  /* count the processes we exchange ghosts with in either direction */
+  num_peers = 0;
+  for (p = 0; p < num_procs; ++p) {
+    if (p != rank &&
+        (ghost->proc_offsets[p] < ghost->proc_offsets[p + 1] ||
+         ghost->mirror_proc_offsets[p] < ghost->mirror_proc_offsets[p + 1])) {
+      ++num_peers;
+    }
+  }
+  num_mirrors = (p4est_locidx_t) ghost->mirrors.elem_count;
+  num_sends = ghost->mirror_proc_offsets[num_procs];
+
+  /* only mirror quadrants can have a face on the parallel boundary */
+  num_faces = 0;
+  for (zz = 0; zz < ghost->mirrors.elem_count; ++zz) {
+    q = p4est_quadrant_array_index (&ghost->mirrors, zz);
+    for (f = 0; f < P4EST_FACES; ++f) {
+      nt = p4est_quadrant_face_neighbor_extra (q, q->p.piggy3.which_tree, f,
+                                               &n, NULL, p4est->connectivity);
+      if (nt >= 0 && !p4est_comm_is_contained (p4est, nt, &n, rank)) {
+        ++num_faces;
+      }
+    }
+  }
+
+  /* compute the statistics over all processes */
+  if (stats == NULL) {
+    stats = si;
+  }
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_QUADRANTS,
+                 (double) p4est->local_num_quadrants, "Quadrants");
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_WEIGHT, weight, "Weight");
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_PEERS, (double) num_peers,
+                 "Ghost peers");
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_FACES, (double) num_faces,
+                 "Parallel faces");
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_MIRRORS, (double) num_mirrors,
+                 "Mirrors");
+  sc_stats_set1 (stats + P4EST_PARTITION_STATS_BYTES,
+                 (double) num_sends * (double) data_size, "Ghost bytes");
+  if (values != NULL) {
+    for (f = 0; f < P4EST_PARTITION_STATS_LAST; ++f) {
+      values[f] = stats[f].sum_values;
+    }
+  }
+  sc_stats_compute (p4est->mpicomm, P4EST_PARTITION_STATS_LAST, stats);
+  if (stats == si) {
+    sc_stats_print (p4est_package_id, SC_LP_STATISTICS,
+                    P4EST_PARTITION_STATS_LAST, stats, 1, 0);
+  }
+}
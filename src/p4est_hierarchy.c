@@ -0,0 +1,246 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef P4_TO_P8
+#include <p4est_algorithms.h>
+#include <p4est_bits.h>
+#include <p4est_communication.h>
+#include <p4est_extended.h>
+#include <p4est_hierarchy.h>
+#else
+#include <p8est_algorithms.h>
+#include <p8est_bits.h>
+#include <p8est_communication.h>
+#include <p8est_extended.h>
+#include <p8est_hierarchy.h>
+#endif
+
+static int
+hierarchy_coarsen_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                      p4est_quadrant_t * quadrants[])
+{
+  return 1;
+}
+
+/** Relate the local quadrants of a forest and its coarsened copy.
+ * Both forests must have the same partition boundaries.
+ */
+static void
+hierarchy_level_maps (p4est_t * fine, p4est_t * coarse,
+                      p4est_hierarchy_level_t * level)
+{
+  size_t              zf, zc, nf, nc;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      fo, co;
+  p4est_tree_t       *ftree, *ctree;
+  p4est_quadrant_t   *f, *c;
+
+  level->num_coarse = coarse->local_num_quadrants;
+  level->fine_to_coarse =
+    P4EST_ALLOC (p4est_locidx_t, fine->local_num_quadrants);
+  level->coarse_to_fine =
+    P4EST_ALLOC (p4est_locidx_t, coarse->local_num_quadrants + 1);
+  level->coarse_to_fine[coarse->local_num_quadrants] =
+    fine->local_num_quadrants;
+
+  P4EST_ASSERT (fine->first_local_tree == coarse->first_local_tree);
+  P4EST_ASSERT (fine->last_local_tree == coarse->last_local_tree);
+  for (jt = fine->first_local_tree; jt <= fine->last_local_tree; ++jt) {
+    ftree = p4est_tree_array_index (fine->trees, jt);
+    ctree = p4est_tree_array_index (coarse->trees, jt);
+    fo = ftree->quadrants_offset;
+    co = ctree->quadrants_offset;
+    nf = ftree->quadrants.elem_count;
+    nc = ctree->quadrants.elem_count;
+
+    /* every coarse quadrant covers a nonempty range of fine quadrants */
+    zc = 0;
+    for (zf = 0; zf < nf; ++zf) {
+      f = p4est_quadrant_array_index (&ftree->quadrants, zf);
+      c = p4est_quadrant_array_index (&ctree->quadrants, zc);
+      if (!p4est_quadrant_is_equal (c, f) &&
+          !p4est_quadrant_is_ancestor (c, f)) {
+        ++zc;
+        P4EST_ASSERT (zc < nc);
+        c = p4est_quadrant_array_index (&ctree->quadrants, zc);
+        P4EST_ASSERT (p4est_quadrant_is_equal (c, f) ||
+                      p4est_quadrant_is_ancestor (c, f));
+        level->coarse_to_fine[co + (p4est_locidx_t) zc] =
+          fo + (p4est_locidx_t) zf;
+      }
+      else if (zf == 0) {
+        level->coarse_to_fine[co] = fo;
+      }
+      level->fine_to_coarse[fo + (p4est_locidx_t) zf] =
+        co + (p4est_locidx_t) zc;
+    }
+    P4EST_ASSERT (nf == 0 || zc + 1 == nc);
+  }
+}
+
+/** Partition a coarse forest, packing it onto fewer processes if small. */
+static void
+hierarchy_partition (p4est_t * coarse, p4est_locidx_t min_quadrants)
+{
+  int                 p, num_active;
+  p4est_gloidx_t      gnq = coarse->global_num_quadrants;
+  p4est_locidx_t     *num_per_proc;
+
+  if (min_quadrants <= 0 ||
+      gnq >= (p4est_gloidx_t) min_quadrants * coarse->mpisize) {
+    (void) p4est_partition_ext (coarse, 1, NULL);
+    return;
+  }
+
+  /* give equally many quadrants to the first few processes */
+  num_active = (int) SC_MAX (gnq / min_quadrants, 1);
+  P4EST_ASSERT (num_active <= coarse->mpisize);
+  num_per_proc = P4EST_ALLOC_ZERO (p4est_locidx_t, coarse->mpisize);
+  for (p = 0; p < num_active; ++p) {
+    num_per_proc[p] = (p4est_locidx_t)
+      (gnq * (p + 1) / num_active - gnq * p / num_active);
+  }
+
+  /* move the cuts to family boundaries such that every family stays whole */
+  (void) p4est_partition_for_coarsening (coarse, num_per_proc);
+  (void) p4est_partition_given (coarse, num_per_proc);
+  P4EST_FREE (num_per_proc);
+}
+
+p4est_hierarchy_t  *
+p4est_hierarchy_new (p4est_t * p4est, int max_levels,
+                     p4est_locidx_t min_quadrants, p4est_connect_type_t btype)
+{
+  int                 mpiret;
+  int                 l, num_levels;
+  size_t              gfq_size;
+  p4est_t            *fine, *coarse;
+  p4est_hierarchy_t  *hierarchy;
+  p4est_hierarchy_level_t *level;
+
+  P4EST_GLOBAL_PRODUCTIONF ("Into " P4EST_STRING
+                            "_hierarchy_new with %lld total quadrants\n",
+                            (long long) p4est->global_num_quadrants);
+  p4est_log_indent_push ();
+  P4EST_ASSERT (max_levels >= 1);
+  P4EST_ASSERT (p4est_is_balanced (p4est, btype));
+
+  hierarchy = P4EST_ALLOC (p4est_hierarchy_t, 1);
+  hierarchy->levels = P4EST_ALLOC_ZERO (p4est_hierarchy_level_t, max_levels);
+  hierarchy->levels[0].p4est = p4est;
+
+  /* this loop is left early on processes that drop out of a level */
+  num_levels = 1;
+  for (fine = p4est, l = 1; l < max_levels; ++l) {
+    coarse = p4est_copy_ext (fine, 0, 0);
+    p4est_coarsen_ext (coarse, 0, 0, hierarchy_coarsen_fn, NULL, NULL);
+    p4est_balance_ext (coarse, btype, NULL, NULL);
+    if (coarse->global_num_quadrants == fine->global_num_quadrants) {
+      /* this decision is the same on all processes of the level */
+      p4est_destroy (coarse);
+      break;
+    }
+    num_levels = l + 1;
+
+    /* relate the quadrants and remember the partition before and after */
+    level = hierarchy->levels + l;
+    hierarchy_level_maps (fine, coarse, level);
+    gfq_size = (size_t) (fine->mpisize + 1) * sizeof (p4est_gloidx_t);
+    level->coarse_gfq = P4EST_ALLOC (p4est_gloidx_t, fine->mpisize + 1);
+    memcpy (level->coarse_gfq, coarse->global_first_quadrant, gfq_size);
+    hierarchy_partition (coarse, min_quadrants);
+    level->partition_gfq = P4EST_ALLOC (p4est_gloidx_t, fine->mpisize + 1);
+    memcpy (level->partition_gfq, coarse->global_first_quadrant, gfq_size);
+
+    /* continue with the processes that own coarse quadrants */
+    if (!p4est_comm_parallel_env_reduce (&coarse)) {
+      P4EST_ASSERT (coarse == NULL);
+      break;
+    }
+    level->p4est = fine = coarse;
+    if (fine->mpirank == 0) {
+      P4EST_VERBOSEF ("Hierarchy level %d has %lld quadrants on %d ranks\n",
+                      l, (long long) fine->global_num_quadrants,
+                      fine->mpisize);
+    }
+  }
+
+  /* processes that dropped out learn the number of levels */
+  mpiret = sc_MPI_Allreduce (&num_levels, &hierarchy->num_levels, 1,
+                             sc_MPI_INT, sc_MPI_MAX, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+
+  p4est_log_indent_pop ();
+  P4EST_GLOBAL_PRODUCTIONF ("Done " P4EST_STRING
+                            "_hierarchy_new with %d levels\n",
+                            hierarchy->num_levels);
+  return hierarchy;
+}
+
+void
+p4est_hierarchy_destroy (p4est_hierarchy_t * hierarchy)
+{
+  int                 l;
+  p4est_hierarchy_level_t *level;
+
+  /* coarser forests may share the communicator of finer ones */
+  for (l = hierarchy->num_levels - 1; l > 0; --l) {
+    level = hierarchy->levels + l;
+    if (level->p4est != NULL) {
+      p4est_destroy (level->p4est);
+    }
+    P4EST_FREE (level->fine_to_coarse);
+    P4EST_FREE (level->coarse_to_fine);
+    P4EST_FREE (level->coarse_gfq);
+    P4EST_FREE (level->partition_gfq);
+  }
+  P4EST_FREE (hierarchy->levels);
+  P4EST_FREE (hierarchy);
+}
+
+void
+p4est_hierarchy_transfer_fixed (p4est_hierarchy_t * hierarchy, int level,
+                                int to_level, void *dest_data,
+                                const void *src_data, size_t data_size)
+{
+  p4est_hierarchy_level_t *hl;
+
+  P4EST_ASSERT (0 < level && level < hierarchy->num_levels);
+  P4EST_ASSERT (hierarchy->levels[level - 1].p4est != NULL);
+
+  hl = hierarchy->levels + level;
+  P4EST_ASSERT (hl->coarse_gfq != NULL && hl->partition_gfq != NULL);
+  if (to_level) {
+    p4est_transfer_fixed (hl->partition_gfq, hl->coarse_gfq,
+                          hierarchy->levels[level - 1].p4est->mpicomm,
+                          P4EST_COMM_HIERARCHY_TRANSFER,
+                          dest_data, src_data, data_size);
+  }
+  else {
+    p4est_transfer_fixed (hl->coarse_gfq, hl->partition_gfq,
+                          hierarchy->levels[level - 1].p4est->mpicomm,
+                          P4EST_COMM_HIERARCHY_TRANSFER,
+                          dest_data, src_data, data_size);
+  }
+}
@@ -0,0 +1,128 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+/** \file p4est_hierarchy.h
+ *
+ * Build a hierarchy of successively coarser forests for geometric multigrid.
+ *
+ * \ingroup p4est
+ */
+
+#ifndef P4EST_HIERARCHY_H
+#define P4EST_HIERARCHY_H
+
+#include <p4est.h>
+
+SC_EXTERN_C_BEGIN;
+
+/** One level of a hierarchy of forests.
+ * Level 0 refers to the fine forest that the hierarchy is created from.
+ * Each coarser level l is derived from level l - 1 in three steps:
+ * 1. A copy of the finer forest is coarsened once wherever a family is
+ *    complete on one process, and 2:1 balanced again.  This does not change
+ *    the partition boundaries, thus every coarse quadrant is equal to or an
+ *    ancestor of consecutive fine quadrants on the same process.  The maps
+ *    fine_to_coarse and coarse_to_fine relate these local quadrant numbers.
+ * 2. The coarse forest is partitioned with partition_for_coarsening, so that
+ *    the next level can coarsen every family.  If it has fewer quadrants than
+ *    min_quadrants per process, it is packed onto fewer processes, whose
+ *    cuts are moved to family boundaries in the same way.
+ * 3. The communicator is reduced to the nonempty processes by
+ *    \ref p4est_comm_parallel_env_reduce.  On all other processes the forest
+ *    of this and every coarser level is NULL.
+ * The partitions before and after step 2 are stored as global_first_quadrant
+ * arrays on the communicator of level l - 1.  Quadrant data is moved between
+ * them by \ref p4est_hierarchy_transfer_fixed.
+ */
+typedef struct p4est_hierarchy_level
+{
+  p4est_t            *p4est;            /**< Forest on this level or NULL. */
+
+  /* These members are NULL on level 0 and where level l - 1 is NULL */
+  p4est_locidx_t      num_coarse;       /**< Local quadrants after step 1. */
+  p4est_locidx_t     *fine_to_coarse;   /**< For each local quadrant of
+                                             level l - 1 the number of its
+                                             coarse quadrant after step 1. */
+  p4est_locidx_t     *coarse_to_fine;   /**< num_coarse + 1 offsets into the
+                                             local quadrants of level l - 1. */
+  p4est_gloidx_t     *coarse_gfq;       /**< Partition after step 1. */
+  p4est_gloidx_t     *partition_gfq;    /**< Partition after step 2. */
+}
+p4est_hierarchy_level_t;
+
+/** A hierarchy of successively coarser forests. */
+typedef struct p4est_hierarchy
+{
+  int                 num_levels;       /**< Equal on all processes. */
+  p4est_hierarchy_level_t *levels;      /**< Level 0 is the finest. */
+}
+p4est_hierarchy_t;
+
+/** Create a hierarchy of coarser forests for geometric multigrid.
+ * The coarse forests are created without user data.
+ * Coarsening stops when a level would not reduce the global number of
+ * quadrants, or when \a max_levels is reached.
+ * This function is collective over the communicator of \a p4est.
+ * \param [in] p4est        The fine forest, must be 2:1 balanced by \a btype.
+ *                          It is not changed and becomes level 0.  It must
+ *                          not be destroyed before the hierarchy.
+ * \param [in] max_levels   Maximum number of levels including level 0.
+ * \param [in] min_quadrants If positive, a coarse level with fewer quadrants
+ *                          than this number per process is partitioned
+ *                          onto fewer processes.
+ * \param [in] btype        The balance type of the coarse forests.
+ * \return                  A hierarchy to free with
+ *                          \ref p4est_hierarchy_destroy.
+ */
+p4est_hierarchy_t  *p4est_hierarchy_new (p4est_t * p4est, int max_levels,
+                                         p4est_locidx_t min_quadrants,
+                                         p4est_connect_type_t btype);
+
+/** Destroy a hierarchy and all of its coarse forests.
+ * \param [in] hierarchy    The fine forest of level 0 is not destroyed.
+ */
+void                p4est_hierarchy_destroy (p4est_hierarchy_t * hierarchy);
+
+/** Move fixed-size quadrant data across the partition step of a level.
+ * This function is collective over the communicator of level \a level - 1
+ * and must not be called on processes where that forest is NULL.
+ * \param [in] hierarchy    A hierarchy created by \ref p4est_hierarchy_new.
+ * \param [in] level        A coarse level, 0 < \a level < num_levels.
+ * \param [in] to_level     If true, move data from the quadrants after
+ *                          coarsening to the forest of \a level (restrict).
+ *                          If false, move it backwards (prolongate).
+ * \param [out] dest_data   Receives \a data_size bytes per quadrant.
+ * \param [in] src_data     Holds \a data_size bytes per quadrant.
+ * \param [in] data_size    Data size per quadrant in bytes.
+ */
+void                p4est_hierarchy_transfer_fixed (p4est_hierarchy_t *
+                                                    hierarchy, int level,
+                                                    int to_level,
+                                                    void *dest_data,
+                                                    const void *src_data,
+                                                    size_t data_size);
+
+SC_EXTERN_C_END;
+
+#endif /* !P4EST_HIERARCHY_H */
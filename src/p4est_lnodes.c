@@ -2682,6 +2682,570 @@ p4est_lnodes_destroy (p4est_lnodes_t * lnodes)
   P4EST_FREE (lnodes);
 }
 
+/** Compare pairs of degree and node number lexicographically. */
+static int
+p4est_lnodes_degree_compare (const void *v1, const void *v2)
+{
+  const p4est_locidx_t *a = (const p4est_locidx_t *) v1;
+  const p4est_locidx_t *b = (const p4est_locidx_t *) v2;
+
+  if (a[0] != b[0]) {
+    return a[0] < b[0] ? -1 : 1;
+  }
+  return a[1] == b[1] ? 0 : a[1] < b[1] ? -1 : 1;
+}
+
+/** Return the largest difference between the owned nodes of an element. */
+static              p4est_locidx_t
+p4est_lnodes_bandwidth (p4est_lnodes_t * lnodes)
+{
+  p4est_locidx_t      el, li, n, lo, hi, bandwidth;
+
+  bandwidth = 0;
+  for (el = 0; el < lnodes->num_local_elements; ++el) {
+    lo = lnodes->owned_count;
+    hi = -1;
+    for (li = 0; li < lnodes->vnodes; ++li) {
+      n = lnodes->element_nodes[el * lnodes->vnodes + li];
+      if (n < lnodes->owned_count) {
+        lo = SC_MIN (lo, n);
+        hi = SC_MAX (hi, n);
+      }
+    }
+    bandwidth = SC_MAX (bandwidth, hi - lo);
+  }
+  return bandwidth;
+}
+
+/** Compute the reverse Cuthill-McKee order of the owned nodes.
+ * \param [out] order   The owned nodes in their new order.
+ */
+static void
+p4est_lnodes_order_rcm (p4est_lnodes_t * lnodes, p4est_locidx_t * order)
+{
+  const p4est_locidx_t owned = lnodes->owned_count;
+  const p4est_locidx_t nlen = lnodes->num_local_elements * lnodes->vnodes;
+  const int           vnodes = lnodes->vnodes;
+  p4est_locidx_t      li, lj, n, m, v, w, el, head, tail, start;
+  p4est_locidx_t     *eoffsets, *elements;
+  p4est_locidx_t     *aoffsets, *marker, *pair;
+  size_t              zz, zy;
+  sc_array_t         *adjacency, *candidates, *starts;
+
+  /* the elements of every owned node */
+  eoffsets = P4EST_ALLOC_ZERO (p4est_locidx_t, owned + 1);
+  for (li = 0; li < nlen; ++li) {
+    if ((n = lnodes->element_nodes[li]) < owned) {
+      ++eoffsets[n + 1];
+    }
+  }
+  for (n = 0; n < owned; ++n) {
+    eoffsets[n + 1] += eoffsets[n];
+  }
+  elements = P4EST_ALLOC (p4est_locidx_t, eoffsets[owned]);
+  for (li = 0; li < nlen; ++li) {
+    if ((n = lnodes->element_nodes[li]) < owned) {
+      elements[eoffsets[n]++] = li / vnodes;
+    }
+  }
+  for (n = owned; n > 0; --n) {
+    eoffsets[n] = eoffsets[n - 1];
+  }
+  eoffsets[0] = 0;
+
+  /* the distinct owned neighbors of every owned node */
+  marker = P4EST_ALLOC (p4est_locidx_t, owned);
+  for (n = 0; n < owned; ++n) {
+    marker[n] = -1;
+  }
+  aoffsets = P4EST_ALLOC (p4est_locidx_t, owned + 1);
+  adjacency = sc_array_new (sizeof (p4est_locidx_t));
+  aoffsets[0] = 0;
+  for (v = 0; v < owned; ++v) {
+    marker[v] = v;
+    for (lj = eoffsets[v]; lj < eoffsets[v + 1]; ++lj) {
+      el = elements[lj];
+      for (li = 0; li < vnodes; ++li) {
+        w = lnodes->element_nodes[el * vnodes + li];
+        if (w < owned && marker[w] != v) {
+          marker[w] = v;
+          *(p4est_locidx_t *) sc_array_push (adjacency) = w;
+        }
+      }
+    }
+    aoffsets[v + 1] = (p4est_locidx_t) adjacency->elem_count;
+  }
+  P4EST_FREE (eoffsets);
+  P4EST_FREE (elements);
+
+  /* start every connected component at a node of smallest degree */
+  starts = sc_array_new_count (2 * sizeof (p4est_locidx_t), (size_t) owned);
+  for (v = 0; v < owned; ++v) {
+    pair = (p4est_locidx_t *) sc_array_index (starts, (size_t) v);
+    pair[0] = aoffsets[v + 1] - aoffsets[v];
+    pair[1] = v;
+    marker[v] = 0;
+  }
+  sc_array_sort (starts, p4est_lnodes_degree_compare);
+
+  /* breadth first search visiting neighbors by increasing degree */
+  candidates = sc_array_new (2 * sizeof (p4est_locidx_t));
+  head = tail = 0;
+  for (zz = 0; zz < starts->elem_count; ++zz) {
+    start = ((p4est_locidx_t *) sc_array_index (starts, zz))[1];
+    if (marker[start]) {
+      continue;
+    }
+    marker[start] = 1;
+    order[tail++] = start;
+    while (head < tail) {
+      v = order[head++];
+      sc_array_truncate (candidates);
+      for (m = aoffsets[v]; m < aoffsets[v + 1]; ++m) {
+        w = *(p4est_locidx_t *) sc_array_index (adjacency, (size_t) m);
+        if (!marker[w]) {
+          marker[w] = 1;
+          pair = (p4est_locidx_t *) sc_array_push (candidates);
+          pair[0] = aoffsets[w + 1] - aoffsets[w];
+          pair[1] = w;
+        }
+      }
+      sc_array_sort (candidates, p4est_lnodes_degree_compare);
+      for (zy = 0; zy < candidates->elem_count; ++zy) {
+        order[tail++] = ((p4est_locidx_t *)
+                         sc_array_index (candidates, zy))[1];
+      }
+    }
+  }
+  P4EST_ASSERT (tail == owned);
+
+  /* reverse the order */
+  for (n = 0; n < owned / 2; ++n) {
+    v = order[n];
+    order[n] = order[owned - 1 - n];
+    order[owned - 1 - n] = v;
+  }
+
+  sc_array_destroy (candidates);
+  sc_array_destroy (starts);
+  sc_array_destroy (adjacency);
+  P4EST_FREE (aoffsets);
+  P4EST_FREE (marker);
+}
+
+void
+p4est_lnodes_reorder (p4est_lnodes_t * lnodes, p4est_lnodes_order_t order,
+                      p4est_locidx_t bandwidth[2])
+{
+  int                 mpiret, mpirank;
+  int8_t             *touched;
+  const p4est_locidx_t owned = lnodes->owned_count;
+  const p4est_locidx_t nlen = lnodes->num_local_elements * lnodes->vnodes;
+  p4est_locidx_t      li, n, *sequence, *perm;
+  p4est_locidx_t      local_bw[2], global_bw[2];
+  p4est_gloidx_t     *gp;
+  size_t              zz, zy;
+  sc_array_t         *global_nodes, *sorter, *shared_nodes;
+  p4est_lnodes_rank_t *lrank;
+
+  P4EST_GLOBAL_PRODUCTIONF ("Into " P4EST_STRING "_lnodes_reorder %s\n",
+                            order == P4EST_LNODES_ORDER_RCM ? "RCM" : "SFC");
+  p4est_log_indent_push ();
+  mpiret = sc_MPI_Comm_rank (lnodes->mpicomm, &mpirank);
+  SC_CHECK_MPI (mpiret);
+  local_bw[0] = p4est_lnodes_bandwidth (lnodes);
+
+  /* compute the new order of the owned nodes */
+  sequence = P4EST_ALLOC (p4est_locidx_t, owned);
+  if (order == P4EST_LNODES_ORDER_RCM) {
+    p4est_lnodes_order_rcm (lnodes, sequence);
+  }
+  else {
+    P4EST_ASSERT (order == P4EST_LNODES_ORDER_SFC);
+    touched = P4EST_ALLOC_ZERO (int8_t, owned);
+    n = 0;
+    for (li = 0; li < nlen; ++li) {
+      if (lnodes->element_nodes[li] < owned &&
+          !touched[lnodes->element_nodes[li]]) {
+        touched[lnodes->element_nodes[li]] = 1;
+        sequence[n++] = lnodes->element_nodes[li];
+      }
+    }
+    P4EST_ASSERT (n == owned);
+    P4EST_FREE (touched);
+  }
+  perm = P4EST_ALLOC (p4est_locidx_t, lnodes->num_local_nodes);
+  for (n = 0; n < owned; ++n) {
+    perm[sequence[n]] = n;
+  }
+  P4EST_FREE (sequence);
+
+  /* send the new global numbers of the owned nodes to the sharers */
+  global_nodes = sc_array_new_count (sizeof (p4est_gloidx_t),
+                                     (size_t) lnodes->num_local_nodes);
+  for (n = 0; n < owned; ++n) {
+    *(p4est_gloidx_t *) sc_array_index (global_nodes, (size_t) n) =
+      lnodes->global_offset + perm[n];
+  }
+  p4est_lnodes_share_owned (global_nodes, lnodes);
+
+  /* sort the nodes owned by every other process by their new numbers */
+  sorter = sc_array_new (2 * sizeof (p4est_gloidx_t));
+  for (zz = 0; zz < lnodes->sharers->elem_count; ++zz) {
+    lrank = p4est_lnodes_rank_array_index (lnodes->sharers, zz);
+    if (lrank->rank == mpirank) {
+      continue;
+    }
+    sc_array_resize (sorter, (size_t) lrank->owned_count);
+    for (n = 0; n < lrank->owned_count; ++n) {
+      li = lrank->owned_offset + n;
+      gp = (p4est_gloidx_t *) sc_array_index (sorter, (size_t) n);
+      gp[0] = *(p4est_gloidx_t *) sc_array_index (global_nodes, (size_t) li);
+      gp[1] = li;
+    }
+    sc_array_sort (sorter, p4est_gloidx_compare);
+    for (n = 0; n < lrank->owned_count; ++n) {
+      li = lrank->owned_offset + n;
+      gp = (p4est_gloidx_t *) sc_array_index (sorter, (size_t) n);
+      perm[(p4est_locidx_t) gp[1]] = li;
+      lnodes->nonlocal_nodes[li - owned] = gp[0];
+    }
+  }
+  sc_array_destroy (sorter);
+  sc_array_destroy (global_nodes);
+
+  /* apply the permutation to the elements and the sharers */
+  for (li = 0; li < nlen; ++li) {
+    lnodes->element_nodes[li] = perm[lnodes->element_nodes[li]];
+  }
+  sorter = sc_array_new (2 * sizeof (p4est_gloidx_t));
+  for (zz = 0; zz < lnodes->sharers->elem_count; ++zz) {
+    lrank = p4est_lnodes_rank_array_index (lnodes->sharers, zz);
+    shared_nodes = &lrank->shared_nodes;
+    sc_array_resize (sorter, shared_nodes->elem_count);
+    for (zy = 0; zy < shared_nodes->elem_count; ++zy) {
+      li = perm[*(p4est_locidx_t *) sc_array_index (shared_nodes, zy)];
+      gp = (p4est_gloidx_t *) sc_array_index (sorter, zy);
+      gp[0] = p4est_lnodes_global_index (lnodes, li);
+      gp[1] = li;
+    }
+    sc_array_sort (sorter, p4est_gloidx_compare);
+    for (zy = 0; zy < shared_nodes->elem_count; ++zy) {
+      gp = (p4est_gloidx_t *) sc_array_index (sorter, zy);
+      *(p4est_locidx_t *) sc_array_index (shared_nodes, zy) =
+        (p4est_locidx_t) gp[1];
+    }
+  }
+  sc_array_destroy (sorter);
+  P4EST_FREE (perm);
+
+  /* report the bandwidth */
+  local_bw[1] = p4est_lnodes_bandwidth (lnodes);
+  mpiret = sc_MPI_Allreduce (local_bw, global_bw, 2, P4EST_MPI_LOCIDX,
+                             sc_MPI_MAX, lnodes->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  if (bandwidth != NULL) {
+    bandwidth[0] = local_bw[0];
+    bandwidth[1] = local_bw[1];
+  }
+
+  p4est_log_indent_pop ();
+  P4EST_GLOBAL_PRODUCTIONF ("Done " P4EST_STRING "_lnodes_reorder with"
+                            " bandwidth %lld before and %lld after\n",
+                            (long long) global_bw[0],
+                            (long long) global_bw[1]);
+}
+
+struct p4est_lnodes_hanging
+{
+  p4est_lnodes_t     *lnodes;
+  int                *code_table;       /**< Table by face_code or -1. */
+  int                 max_rows;         /**< Most rows of any table. */
+  sc_array_t          table_rows;       /**< Row offsets by table. */
+  sc_array_t          row_node;         /**< Element node by row. */
+  sc_array_t          row_entries;      /**< Entry offsets by row. */
+  sc_array_t          entry_node;       /**< Source element node by entry. */
+  sc_array_t          entry_weight;     /**< Weight by entry. */
+};
+
+#ifndef P4_TO_P8
+#define P4EST_LNODES_NUM_CODES (1 << (2 * P4EST_DIM))
+#else
+#define P4EST_LNODES_NUM_CODES (1 << (3 * P4EST_DIM))
+#endif
+
+/** Append the interpolation rows of one face_code.
+ * A node on a hanging face is interpolated in the tangential directions,
+ * a node on a hanging edge only along the edge.
+ * \param [in] interp   For each child position, the one-dimensional
+ *                      interpolation from the parent nodes.
+ */
+static void
+p4est_lnodes_hanging_code (p4est_lnodes_hanging_t * hanging,
+                           p4est_lnodes_code_t code, const double *interp)
+{
+  const int           degree = hanging->lnodes->degree;
+  const int           n1 = degree + 1;
+  const int           vnodes = hanging->lnodes->vnodes;
+  const int           c = (int) (code & (P4EST_CHILDREN - 1));
+  const int           faces = (int) ((code >> P4EST_DIM) &
+                                     ((1 << P4EST_DIM) - 1));
+#ifdef P4_TO_P8
+  const int           edges = (int) ((code >> (2 * P4EST_DIM)) &
+                                     ((1 << P4EST_DIM) - 1));
+#endif
+  int                 n, m, d, i, mask, stride;
+  int                 a[P4EST_DIM], j[P4EST_DIM], b[P4EST_DIM];
+  int                 num_rows;
+  size_t              first_entry;
+  double              w;
+
+  for (d = 0; d < P4EST_DIM; ++d) {
+    b[d] = (c >> d) & 1;
+  }
+  num_rows = 0;
+  for (n = 0; n < vnodes; ++n) {
+    for (d = 0, stride = 1; d < P4EST_DIM; ++d, stride *= n1) {
+      a[d] = (n / stride) % n1;
+    }
+
+    /* find the directions of interpolation */
+    mask = 0;
+    for (i = 0; i < P4EST_DIM; ++i) {
+      if ((faces & (1 << i)) && a[i] == b[i] * degree) {
+        mask = ((1 << P4EST_DIM) - 1) & ~(1 << i);
+        break;
+      }
+    }
+#ifdef P4_TO_P8
+    for (i = 0; mask == 0 && i < P4EST_DIM; ++i) {
+      if ((edges & (1 << i)) &&
+          a[(i + 1) % 3] == b[(i + 1) % 3] * degree &&
+          a[(i + 2) % 3] == b[(i + 2) % 3] * degree) {
+        mask = 1 << i;
+      }
+    }
+#endif
+    if (mask == 0) {
+      continue;
+    }
+
+    /* tensor product of the one-dimensional interpolations */
+    first_entry = hanging->entry_node.elem_count;
+    for (m = 0; m < vnodes; ++m) {
+      w = 1.;
+      for (d = 0, stride = 1; d < P4EST_DIM; ++d, stride *= n1) {
+        j[d] = (m / stride) % n1;
+        if (mask & (1 << d)) {
+          w *= interp[(b[d] * n1 + a[d]) * n1 + j[d]];
+        }
+        else if (j[d] != a[d]) {
+          w = 0.;
+        }
+      }
+      if (w != 0.) {
+        *(int *) sc_array_push (&hanging->entry_node) = m;
+        *(double *) sc_array_push (&hanging->entry_weight) = w;
+      }
+    }
+
+    /* the corner shared with the parent is not hanging */
+    if (hanging->entry_node.elem_count == first_entry + 1 &&
+        *(int *) sc_array_index (&hanging->entry_node, first_entry) == n &&
+        *(double *) sc_array_index (&hanging->entry_weight,
+                                    first_entry) == 1.) {
+      sc_array_resize (&hanging->entry_node, first_entry);
+      sc_array_resize (&hanging->entry_weight, first_entry);
+      continue;
+    }
+    *(int *) sc_array_push (&hanging->row_node) = n;
+    *(int *) sc_array_push (&hanging->row_entries) =
+      (int) hanging->entry_node.elem_count;
+    ++num_rows;
+  }
+  *(int *) sc_array_push (&hanging->table_rows) =
+    (int) hanging->row_node.elem_count;
+  hanging->max_rows = SC_MAX (hanging->max_rows, num_rows);
+}
+
+p4est_lnodes_hanging_t *
+p4est_lnodes_hanging_new (p4est_lnodes_t * lnodes, const double *points)
+{
+  const int           degree = lnodes->degree;
+  const int           n1 = degree + 1;
+  int                 i, k, l, b, num_tables;
+  double              x, w, *nodes, *interp;
+  p4est_locidx_t      el;
+  p4est_lnodes_code_t code;
+  p4est_lnodes_hanging_t *hanging;
+
+  P4EST_ASSERT (degree > 0);
+
+  /* interpolate from the parent nodes to the nodes of either child */
+  nodes = P4EST_ALLOC (double, n1);
+  for (i = 0; i < n1; ++i) {
+    nodes[i] = points != NULL ? points[i] : -1. + 2. * i / degree;
+  }
+  interp = P4EST_ALLOC (double, 2 * n1 * n1);
+  for (b = 0; b < 2; ++b) {
+    for (i = 0; i < n1; ++i) {
+      x = .5 * (nodes[i] + 2 * b - 1);
+      for (k = 0; k < n1; ++k) {
+        w = 1.;
+        for (l = 0; l < n1; ++l) {
+          if (l != k) {
+            w *= (x - nodes[l]) / (nodes[k] - nodes[l]);
+          }
+        }
+        interp[(b * n1 + i) * n1 + k] = w;
+      }
+    }
+  }
+  P4EST_FREE (nodes);
+
+  hanging = P4EST_ALLOC (p4est_lnodes_hanging_t, 1);
+  hanging->lnodes = lnodes;
+  hanging->code_table = P4EST_ALLOC (int, P4EST_LNODES_NUM_CODES);
+  for (i = 0; i < P4EST_LNODES_NUM_CODES; ++i) {
+    hanging->code_table[i] = -1;
+  }
+  hanging->max_rows = 0;
+  sc_array_init (&hanging->table_rows, sizeof (int));
+  sc_array_init (&hanging->row_node, sizeof (int));
+  sc_array_init (&hanging->row_entries, sizeof (int));
+  sc_array_init (&hanging->entry_node, sizeof (int));
+  sc_array_init (&hanging->entry_weight, sizeof (double));
+  *(int *) sc_array_push (&hanging->table_rows) = 0;
+  *(int *) sc_array_push (&hanging->row_entries) = 0;
+
+  /* only the face codes present in the mesh get a table */
+  num_tables = 0;
+  for (el = 0; el < lnodes->num_local_elements; ++el) {
+    code = lnodes->face_code[el];
+    P4EST_ASSERT (0 <= code && code < P4EST_LNODES_NUM_CODES);
+    if (code != 0 && hanging->code_table[code] < 0) {
+      hanging->code_table[code] = num_tables++;
+      p4est_lnodes_hanging_code (hanging, code, interp);
+    }
+  }
+  P4EST_FREE (interp);
+
+  return hanging;
+}
+
+void
+p4est_lnodes_hanging_destroy (p4est_lnodes_hanging_t * hanging)
+{
+  P4EST_FREE (hanging->code_table);
+  sc_array_reset (&hanging->table_rows);
+  sc_array_reset (&hanging->row_node);
+  sc_array_reset (&hanging->row_entries);
+  sc_array_reset (&hanging->entry_node);
+  sc_array_reset (&hanging->entry_weight);
+  P4EST_FREE (hanging);
+}
+
+void
+p4est_lnodes_gather (p4est_lnodes_hanging_t * hanging, const double *u,
+                     p4est_locidx_t first, p4est_locidx_t count, double *ue)
+{
+  const p4est_lnodes_t *lnodes = hanging->lnodes;
+  const int           vnodes = lnodes->vnodes;
+  const p4est_locidx_t *en = lnodes->element_nodes + first * vnodes;
+  const p4est_locidx_t total = count * vnodes;
+  const int          *table_rows = (const int *) hanging->table_rows.array;
+  const int          *row_node = (const int *) hanging->row_node.array;
+  const int          *row_entries = (const int *) hanging->row_entries.array;
+  const int          *entry_node = (const int *) hanging->entry_node.array;
+  const double       *entry_weight =
+    (const double *) hanging->entry_weight.array;
+  int                 t, r, k;
+  double              sum, *values, *work;
+  p4est_locidx_t      li, el;
+
+  P4EST_ASSERT (0 <= first && 0 <= count &&
+                first + count <= lnodes->num_local_elements);
+
+  /* the plain gather is a single loop over all elements */
+  for (li = 0; li < total; ++li) {
+    ue[li] = u[en[li]];
+  }
+
+  /* interpolate at hanging nodes from the gathered values */
+  work = P4EST_ALLOC (double, hanging->max_rows);
+  for (el = 0; el < count; ++el) {
+    if (lnodes->face_code[first + el] == 0) {
+      continue;
+    }
+    t = hanging->code_table[lnodes->face_code[first + el]];
+    P4EST_ASSERT (t >= 0);
+    values = ue + el * vnodes;
+    for (r = table_rows[t]; r < table_rows[t + 1]; ++r) {
+      sum = 0.;
+      for (k = row_entries[r]; k < row_entries[r + 1]; ++k) {
+        sum += entry_weight[k] * values[entry_node[k]];
+      }
+      work[r - table_rows[t]] = sum;
+    }
+    for (r = table_rows[t]; r < table_rows[t + 1]; ++r) {
+      values[row_node[r]] = work[r - table_rows[t]];
+    }
+  }
+  P4EST_FREE (work);
+}
+
+void
+p4est_lnodes_scatter_add (p4est_lnodes_hanging_t * hanging,
+                          const double *ue, p4est_locidx_t first,
+                          p4est_locidx_t count, double *u)
+{
+  const p4est_lnodes_t *lnodes = hanging->lnodes;
+  const int           vnodes = lnodes->vnodes;
+  const p4est_locidx_t *en;
+  const int          *table_rows = (const int *) hanging->table_rows.array;
+  const int          *row_node = (const int *) hanging->row_node.array;
+  const int          *row_entries = (const int *) hanging->row_entries.array;
+  const int          *entry_node = (const int *) hanging->entry_node.array;
+  const double       *entry_weight =
+    (const double *) hanging->entry_weight.array;
+  int                 i, t, r, k;
+  double             *work;
+  const double       *values;
+  p4est_locidx_t      el;
+
+  P4EST_ASSERT (0 <= first && 0 <= count &&
+                first + count <= lnodes->num_local_elements);
+
+  work = P4EST_ALLOC (double, vnodes);
+  for (el = 0; el < count; ++el) {
+    en = lnodes->element_nodes + (first + el) * vnodes;
+    values = ue + el * vnodes;
+    if (lnodes->face_code[first + el] == 0) {
+      for (i = 0; i < vnodes; ++i) {
+        u[en[i]] += values[i];
+      }
+      continue;
+    }
+
+    /* apply the transpose interpolation */
+    t = hanging->code_table[lnodes->face_code[first + el]];
+    P4EST_ASSERT (t >= 0);
+    memcpy (work, values, vnodes * sizeof (double));
+    for (r = table_rows[t]; r < table_rows[t + 1]; ++r) {
+      work[row_node[r]] = 0.;
+    }
+    for (r = table_rows[t]; r < table_rows[t + 1]; ++r) {
+      for (k = row_entries[r]; k < row_entries[r + 1]; ++k) {
+        work[entry_node[k]] += entry_weight[k] * values[row_node[r]];
+      }
+    }
+    for (i = 0; i < vnodes; ++i) {
+      u[en[i]] += work[i];
+    }
+  }
+  P4EST_FREE (work);
+}
+
 #ifdef P4EST_ENABLE_MPI
 
 static              size_t
@@ -580,11 +580,16 @@ p4est_mesh_memory_used (p4est_mesh_t * mesh)
     }
   }
 
-  /* basic memory plus face information */
+  /* basic memory */
   all_memory =
-    sizeof (p4est_mesh_t) + qtt_memory + ql_memory +
-    P4EST_FACES * lqz * (sizeof (p4est_locidx_t) + sizeof (int8_t)) +
-    ngz * sizeof (int) + sc_array_memory_used (mesh->quad_to_half, 1);
+    sizeof (p4est_mesh_t) + qtt_memory + ql_memory + ngz * sizeof (int);
+
+  /* add face information */
+  if (mesh->quad_to_quad != NULL) {
+    all_memory +=
+      P4EST_FACES * lqz * (sizeof (p4est_locidx_t) + sizeof (int8_t)) +
+      sc_array_memory_used (mesh->quad_to_half, 1);
+  }
 
   /* add corner information */
   if (mesh->quad_to_corner != NULL) {
@@ -595,6 +600,25 @@ p4est_mesh_memory_used (p4est_mesh_t * mesh)
       sc_array_memory_used (mesh->corner_corner, 1);
   }
 
+#ifdef P4_TO_P8
+  /* add edge information */
+  if (mesh->quad_to_edge != NULL) {
+    all_memory +=
+      P8EST_EDGES * lqz * sizeof (p4est_locidx_t) +
+      sc_array_memory_used (mesh->edge_offset, 1) +
+      sc_array_memory_used (mesh->edge_quad, 1) +
+      sc_array_memory_used (mesh->edge_edge, 1);
+  }
+#endif
+
+  /* add compressed face information */
+  if (mesh->face_offset != NULL) {
+    all_memory +=
+      (P4EST_FACES * lqz + 1) * sizeof (p4est_locidx_t) +
+      mesh->face_offset[P4EST_FACES * lqz] *
+      (sizeof (p4est_locidx_t) + sizeof (int8_t));
+  }
+
   return all_memory;
 }
 
@@ -605,39 +629,37 @@ p4est_mesh_new (p4est_t * p4est, p4est_ghost_t * ghost,
   return p4est_mesh_new_ext (p4est, ghost, 0, 0, btype);
 }
 
-p4est_mesh_t       *
-p4est_mesh_new_ext (p4est_t * p4est, p4est_ghost_t * ghost,
-                    int compute_tree_index, int compute_level_lists,
-                    p4est_connect_type_t btype)
+/** Allocate a mesh and fill its ghost information.
+ * If \a compute_faces is true, the face arrays quad_to_quad, quad_to_face
+ * and quad_to_half are allocated and set to invalid values.
+ */
+static p4est_mesh_t *
+mesh_allocate (p4est_t * p4est, p4est_ghost_t * ghost,
+               int compute_tree_index, int compute_level_lists,
+               int compute_faces)
 {
-  int                 do_corner = 0;
-  int                 do_volume = 0;
   int                 rank;
   p4est_locidx_t      lq, ng;
   p4est_locidx_t      jl;
   p4est_mesh_t       *mesh;
 
-  P4EST_ASSERT (p4est_is_balanced (p4est, btype));
-
   mesh = P4EST_ALLOC_ZERO (p4est_mesh_t, 1);
 
   lq = mesh->local_num_quadrants = p4est->local_num_quadrants;
   ng = mesh->ghost_num_quadrants = (p4est_locidx_t) ghost->ghosts.elem_count;
 
-  if (btype == P4EST_CONNECT_FULL) {
-    do_corner = 1;
-  }
-  do_volume = (compute_tree_index || compute_level_lists ? 1 : 0);
-
   /* Optional map of tree index for each quadrant */
   if (compute_tree_index) {
     mesh->quad_to_tree = P4EST_ALLOC (p4est_topidx_t, lq);
   }
 
   mesh->ghost_to_proc = P4EST_ALLOC (int, ng);
-  mesh->quad_to_quad = P4EST_ALLOC (p4est_locidx_t, P4EST_FACES * lq);
-  mesh->quad_to_face = P4EST_ALLOC (int8_t, P4EST_FACES * lq);
-  mesh->quad_to_half = sc_array_new (P4EST_HALF * sizeof (p4est_locidx_t));
+  if (compute_faces) {
+    mesh->quad_to_quad = P4EST_ALLOC (p4est_locidx_t, P4EST_FACES * lq);
+    mesh->quad_to_face = P4EST_ALLOC (int8_t, P4EST_FACES * lq);
+    mesh->quad_to_half =
+      sc_array_new (P4EST_HALF * sizeof (p4est_locidx_t));
+  }
 
   /* Optional per-level lists of quadrants */
   if (compute_level_lists) {
@@ -659,20 +681,53 @@ p4est_mesh_new_ext (p4est_t * p4est, p4est_ghost_t * ghost,
   }
 
   /* Fill face arrays with default values */
-  memset (mesh->quad_to_quad, -1, P4EST_FACES * lq * sizeof (p4est_locidx_t));
-  memset (mesh->quad_to_face, -25, P4EST_FACES * lq * sizeof (int8_t));
+  if (compute_faces) {
+    memset (mesh->quad_to_quad, -1,
+            P4EST_FACES * lq * sizeof (p4est_locidx_t));
+    memset (mesh->quad_to_face, -25, P4EST_FACES * lq * sizeof (int8_t));
+  }
 
-  if (do_corner) {
-    /* Initialize corner information to a consistent state */
-    mesh->quad_to_corner = P4EST_ALLOC (p4est_locidx_t, P4EST_CHILDREN * lq);
-    memset (mesh->quad_to_corner, -1, P4EST_CHILDREN * lq *
-            sizeof (p4est_locidx_t));
+  return mesh;
+}
+
+/** Initialize the corner information to a consistent state. */
+static void
+mesh_corner_init (p4est_mesh_t * mesh)
+{
+  p4est_locidx_t      lq = mesh->local_num_quadrants;
+
+  mesh->quad_to_corner = P4EST_ALLOC (p4est_locidx_t, P4EST_CHILDREN * lq);
+  memset (mesh->quad_to_corner, -1, P4EST_CHILDREN * lq *
+          sizeof (p4est_locidx_t));
+
+  mesh->corner_offset = sc_array_new (sizeof (p4est_locidx_t));
+  *(p4est_locidx_t *) sc_array_push (mesh->corner_offset) = 0;
+
+  mesh->corner_quad = sc_array_new (sizeof (p4est_locidx_t));
+  mesh->corner_corner = sc_array_new (sizeof (int8_t));
+}
+
+p4est_mesh_t       *
+p4est_mesh_new_ext (p4est_t * p4est, p4est_ghost_t * ghost,
+                    int compute_tree_index, int compute_level_lists,
+                    p4est_connect_type_t btype)
+{
+  int                 do_corner = 0;
+  int                 do_volume = 0;
+  p4est_mesh_t       *mesh;
 
-    mesh->corner_offset = sc_array_new (sizeof (p4est_locidx_t));
-    *(p4est_locidx_t *) sc_array_push (mesh->corner_offset) = 0;
+  P4EST_ASSERT (p4est_is_balanced (p4est, btype));
+
+  mesh = mesh_allocate (p4est, ghost, compute_tree_index,
+                        compute_level_lists, 1);
 
-    mesh->corner_quad = sc_array_new (sizeof (p4est_locidx_t));
-    mesh->corner_corner = sc_array_new (sizeof (int8_t));
+  if (btype == P4EST_CONNECT_FULL) {
+    do_corner = 1;
+  }
+  do_volume = (compute_tree_index || compute_level_lists ? 1 : 0);
+
+  if (do_corner) {
+    mesh_corner_init (mesh);
   }
 
   /* Call the forest iterator to collect face connectivity */
@@ -686,6 +741,378 @@ p4est_mesh_new_ext (p4est_t * p4est, p4est_ghost_t * ghost,
   return mesh;
 }
 
+/** Find a local or ghost quadrant by its exact position.
+ * \return      The quadrant number encoded as in quad_to_quad, or -1.
+ */
+static              p4est_locidx_t
+mesh_find_quadrant (p4est_t * p4est, p4est_ghost_t * ghost,
+                    p4est_topidx_t which_tree, const p4est_quadrant_t * q)
+{
+  ssize_t             found;
+  p4est_tree_t       *tree;
+
+  if (p4est->first_local_tree <= which_tree &&
+      which_tree <= p4est->last_local_tree) {
+    tree = p4est_tree_array_index (p4est->trees, which_tree);
+    found = sc_array_bsearch (&tree->quadrants, q, p4est_quadrant_compare);
+    if (found >= 0) {
+      return tree->quadrants_offset + (p4est_locidx_t) found;
+    }
+  }
+  found = p4est_ghost_bsearch (ghost, -1, which_tree, q);
+  if (found >= 0) {
+    return p4est->local_num_quadrants + (p4est_locidx_t) found;
+  }
+  return -1;
+}
+
+/** Find the leaf that touches a corner of a same-size neighbor position.
+ * The leaf may be the neighbor itself, its parent if the corner is also
+ * a corner of the parent, or the child of the neighbor at this corner.
+ * \param [in] n        Same-size neighbor inside tree \a which_tree.
+ * \param [in] ncorner  The corner of \a n that touches the quadrant.
+ * \return      The leaf number encoded as in quad_to_quad, or -1 if the
+ *              corner is hanging and has no diagonal neighbor.
+ */
+static              p4est_locidx_t
+mesh_find_corner_leaf (p4est_t * p4est, p4est_ghost_t * ghost,
+                       p4est_topidx_t which_tree, const p4est_quadrant_t * n,
+                       int ncorner)
+{
+  p4est_locidx_t      qtq;
+  p4est_quadrant_t    r;
+
+  qtq = mesh_find_quadrant (p4est, ghost, which_tree, n);
+  if (qtq >= 0) {
+    return qtq;
+  }
+  P4EST_QUADRANT_INIT (&r);
+  if (n->level > 0 && p4est_quadrant_child_id (n) == ncorner) {
+    p4est_quadrant_parent (n, &r);
+    qtq = mesh_find_quadrant (p4est, ghost, which_tree, &r);
+    if (qtq >= 0) {
+      return qtq;
+    }
+  }
+  if (n->level < P4EST_QMAXLEVEL) {
+    p4est_quadrant_child (n, &r, ncorner);
+    return mesh_find_quadrant (p4est, ghost, which_tree, &r);
+  }
+  return -1;
+}
+
+/** Find the corner neighbors of one local quadrant's corner. */
+static void
+mesh_csr_corner (p4est_t * p4est, p4est_ghost_t * ghost,
+                 p4est_mesh_t * mesh, p4est_topidx_t which_tree,
+                 const p4est_quadrant_t * q, p4est_locidx_t qid, int corner,
+                 sc_array_t * quads, sc_array_t * treeids,
+                 sc_array_t * ncorners)
+{
+  int                 nc;
+  size_t              zz, count, cstart;
+  p4est_locidx_t      qtq, cornerid;
+  p4est_quadrant_t    n;
+
+  /* on the inside of the tree there is at most one diagonal neighbor */
+  P4EST_QUADRANT_INIT (&n);
+  p4est_quadrant_corner_neighbor (q, corner, &n);
+  if (p4est_quadrant_is_inside_root (&n)) {
+    mesh->quad_to_corner[P4EST_CHILDREN * qid + corner] =
+      mesh_find_corner_leaf (p4est, ghost, which_tree, &n,
+                             corner ^ (P4EST_CHILDREN - 1));
+    return;
+  }
+
+  /* across tree boundaries the neighbors are collected into a group */
+  sc_array_truncate (quads);
+  sc_array_truncate (treeids);
+  sc_array_truncate (ncorners);
+  p4est_quadrant_corner_neighbor_extra (q, which_tree, corner, quads,
+                                        treeids, ncorners,
+                                        p4est->connectivity);
+  count = quads->elem_count;
+  cstart = mesh->corner_quad->elem_count;
+  for (zz = 0; zz < count; ++zz) {
+    nc = *(int *) sc_array_index (ncorners, zz);
+    qtq = mesh_find_corner_leaf
+      (p4est, ghost, *(p4est_topidx_t *) sc_array_index (treeids, zz),
+       p4est_quadrant_array_index (quads, zz), nc);
+    if (qtq >= 0) {
+      *(p4est_locidx_t *) sc_array_push (mesh->corner_quad) = qtq;
+      *(int8_t *) sc_array_push (mesh->corner_corner) = (int8_t) nc;
+    }
+  }
+  if (mesh->corner_quad->elem_count == cstart) {
+    return;
+  }
+
+  /* close the group of neighbors pushed above */
+  cornerid = mesh->local_num_corners++;
+  *(p4est_locidx_t *) sc_array_push (mesh->corner_offset) =
+    (p4est_locidx_t) mesh->corner_quad->elem_count;
+  mesh->quad_to_corner[P4EST_CHILDREN * qid + corner] =
+    mesh->local_num_quadrants + mesh->ghost_num_quadrants + cornerid;
+}
+
+#ifdef P4_TO_P8
+
+/** Find the edge neighbors of one local octant's edge. */
+static void
+mesh_csr_edge (p4est_t * p4est, p4est_ghost_t * ghost,
+               p4est_mesh_t * mesh, p4est_topidx_t which_tree,
+               const p4est_quadrant_t * q, p4est_locidx_t qid, int edge,
+               sc_array_t * quads, sc_array_t * treeids, sc_array_t * nedges)
+{
+  int                 ne, o, h, code;
+  int                 inside, ncid;
+  size_t              zz, count, estart;
+  p4est_topidx_t      nt;
+  p4est_locidx_t      qtq, qtqs[2], edgeid;
+  p4est_quadrant_t   *n, r;
+  sc_array_t         *equad = mesh->edge_quad;
+  sc_array_t         *ecode = mesh->edge_edge;
+
+  sc_array_truncate (quads);
+  sc_array_truncate (treeids);
+  sc_array_truncate (nedges);
+  p8est_quadrant_edge_neighbor_extra (q, which_tree, edge, quads, treeids,
+                                      nedges, p4est->connectivity);
+  count = quads->elem_count;
+  if (count == 0) {
+    return;
+  }
+  P4EST_QUADRANT_INIT (&r);
+  p8est_quadrant_edge_neighbor (q, edge, &r);
+  inside = p4est_quadrant_is_inside_root (&r);
+
+  /* push the neighbors tentatively as a new group */
+  estart = equad->elem_count;
+  for (zz = 0; zz < count; ++zz) {
+    n = p4est_quadrant_array_index (quads, zz);
+    nt = *(p4est_topidx_t *) sc_array_index (treeids, zz);
+    ne = *(int *) sc_array_index (nedges, zz);
+    o = ne / P8EST_EDGES;
+    ne %= P8EST_EDGES;
+
+    /* same-size neighbor */
+    qtq = mesh_find_quadrant (p4est, ghost, nt, n);
+    if (qtq >= 0) {
+      *(p4est_locidx_t *) sc_array_push (equad) = qtq;
+      *(int8_t *) sc_array_push (ecode) = (int8_t) (o * P8EST_EDGES + ne);
+      continue;
+    }
+
+    /* double-size neighbor if the edge is not hanging on one of its faces */
+    ncid = p4est_quadrant_child_id (n);
+    if (n->level > 0 && (p8est_edge_corners[ne][0] == ncid ||
+                         p8est_edge_corners[ne][1] == ncid)) {
+      p4est_quadrant_parent (n, &r);
+      qtq = mesh_find_quadrant (p4est, ghost, nt, &r);
+      if (qtq >= 0) {
+        h = (p8est_edge_corners[edge][1] == p4est_quadrant_child_id (q));
+        P4EST_ASSERT (h || p8est_edge_corners[edge][0] ==
+                      p4est_quadrant_child_id (q));
+        code = 2 * P8EST_EDGES * (h + 1) + o * P8EST_EDGES + ne;
+        *(p4est_locidx_t *) sc_array_push (equad) = qtq;
+        *(int8_t *) sc_array_push (ecode) = (int8_t) code;
+        continue;
+      }
+    }
+
+    /* two half-size neighbors or none at all */
+    if (n->level == P4EST_QMAXLEVEL) {
+      continue;
+    }
+    for (h = 0; h < 2; ++h) {
+      p4est_quadrant_child (n, &r, p8est_edge_corners[ne][h]);
+      qtqs[h] = mesh_find_quadrant (p4est, ghost, nt, &r);
+    }
+    if (qtqs[0] < 0) {
+      SC_CHECK_ABORT (qtqs[1] < 0, "Mesh edge neighbor not found");
+      continue;
+    }
+    SC_CHECK_ABORT (qtqs[1] >= 0, "Mesh edge neighbor not found");
+    code = o * P8EST_EDGES + ne - 2 * P8EST_EDGES;
+    for (h = 0; h < 2; ++h) {
+      *(p4est_locidx_t *) sc_array_push (equad) = qtqs[h];
+      *(int8_t *) sc_array_push (ecode) = (int8_t) code;
+    }
+  }
+
+  if (equad->elem_count == estart) {
+    return;
+  }
+
+  /* a single same-size neighbor inside the tree is stored directly */
+  if (inside && equad->elem_count == estart + 1 &&
+      *(int8_t *) sc_array_index (ecode, estart) == (edge ^ 3)) {
+    mesh->quad_to_edge[P8EST_EDGES * qid + edge] =
+      *(p4est_locidx_t *) sc_array_index (equad, estart);
+    sc_array_resize (equad, estart);
+    sc_array_resize (ecode, estart);
+    return;
+  }
+
+  /* otherwise close the group of neighbors */
+  edgeid = mesh->local_num_edges++;
+  *(p4est_locidx_t *) sc_array_push (mesh->edge_offset) =
+    (p4est_locidx_t) equad->elem_count;
+  mesh->quad_to_edge[P8EST_EDGES * qid + edge] =
+    mesh->local_num_quadrants + mesh->ghost_num_quadrants + edgeid;
+}
+
+#endif /* P4_TO_P8 */
+
+p4est_mesh_t       *
+p4est_mesh_new_csr (p4est_t * p4est, p4est_ghost_t * ghost,
+                    int compute_tree_index, int compute_level_lists,
+                    p4est_connect_type_t btype)
+{
+  int                 face, nface, code, qcid, h;
+  int                 corner, do_corner;
+#ifdef P4_TO_P8
+  int                 edge, do_edge;
+#endif
+  size_t              zz, count;
+  p4est_topidx_t      jt, nt;
+  p4est_locidx_t      lq, jl, il, qtq;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, n, p, c;
+  sc_array_t          fquad, fcode;
+  sc_array_t          nquads, ntrees, nints;
+  p4est_mesh_t       *mesh;
+
+  P4EST_ASSERT (p4est_is_balanced (p4est, btype));
+  P4EST_ASSERT (ghost->btype >= btype);
+
+  mesh = mesh_allocate (p4est, ghost, compute_tree_index,
+                        compute_level_lists, 0);
+  lq = mesh->local_num_quadrants;
+  mesh->face_offset = P4EST_ALLOC (p4est_locidx_t, P4EST_FACES * lq + 1);
+  mesh->face_offset[0] = 0;
+  sc_array_init (&fquad, sizeof (p4est_locidx_t));
+  sc_array_init (&fcode, sizeof (int8_t));
+
+  /* prepare the lists of edge and corner neighbors */
+  do_corner = (btype == P4EST_CONNECT_FULL);
+  if (do_corner) {
+    mesh_corner_init (mesh);
+  }
+#ifdef P4_TO_P8
+  do_edge = (btype >= P8EST_CONNECT_EDGE);
+  if (do_edge) {
+    mesh->quad_to_edge = P4EST_ALLOC (p4est_locidx_t, P8EST_EDGES * lq);
+    memset (mesh->quad_to_edge, -1, P8EST_EDGES * lq *
+            sizeof (p4est_locidx_t));
+    mesh->edge_offset = sc_array_new (sizeof (p4est_locidx_t));
+    *(p4est_locidx_t *) sc_array_push (mesh->edge_offset) = 0;
+    mesh->edge_quad = sc_array_new (sizeof (p4est_locidx_t));
+    mesh->edge_edge = sc_array_new (sizeof (int8_t));
+  }
+#endif
+  sc_array_init (&nquads, sizeof (p4est_quadrant_t));
+  sc_array_init (&ntrees, sizeof (p4est_topidx_t));
+  sc_array_init (&nints, sizeof (int));
+
+  P4EST_QUADRANT_INIT (&n);
+  P4EST_QUADRANT_INIT (&p);
+  P4EST_QUADRANT_INIT (&c);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      jl = tree->quadrants_offset + (p4est_locidx_t) zz;
+      if (mesh->quad_to_tree != NULL) {
+        mesh->quad_to_tree[jl] = jt;
+      }
+      if (mesh->quad_level != NULL) {
+        *(p4est_locidx_t *) sc_array_push (mesh->quad_level + q->level) = jl;
+      }
+      qcid = p4est_quadrant_child_id (q);
+
+      for (face = 0; face < P4EST_FACES; ++face) {
+        il = P4EST_FACES * jl + face;
+        nt = p4est_quadrant_face_neighbor_extra (q, jt, face, &n, &nface,
+                                                 p4est->connectivity);
+        if (nt == -1) {
+          /* this face is on an outside boundary of the forest */
+          mesh->face_offset[il + 1] = (p4est_locidx_t) fquad.elem_count;
+          continue;
+        }
+
+        /* look for a same-size or a double-size neighbor */
+        code = nface;
+        qtq = mesh_find_quadrant (p4est, ghost, nt, &n);
+        if (qtq < 0 && n.level > 0) {
+          p4est_quadrant_parent (&n, &p);
+          qtq = mesh_find_quadrant (p4est, ghost, nt, &p);
+          if (qtq >= 0) {
+            for (h = 0; h < P4EST_HALF; ++h) {
+              if (p4est_face_corners[face][h] == qcid) {
+                break;
+              }
+            }
+            P4EST_ASSERT (h < P4EST_HALF);
+            code += P4EST_FACES * (h + 1) * P4EST_HALF;
+          }
+        }
+        if (qtq >= 0) {
+          *(p4est_locidx_t *) sc_array_push (&fquad) = qtq;
+          *(int8_t *) sc_array_push (&fcode) = (int8_t) code;
+          mesh->face_offset[il + 1] = (p4est_locidx_t) fquad.elem_count;
+          continue;
+        }
+
+        /* the neighbors are half size, listed in their z-order */
+        P4EST_ASSERT (n.level < P4EST_QMAXLEVEL);
+        code = nface - P4EST_FACES * P4EST_HALF;
+        for (h = 0; h < P4EST_HALF; ++h) {
+          p4est_quadrant_child (&n, &c,
+                                p4est_face_corners[nface % P4EST_FACES][h]);
+          qtq = mesh_find_quadrant (p4est, ghost, nt, &c);
+          SC_CHECK_ABORT (qtq >= 0, "Mesh face neighbor not found");
+          *(p4est_locidx_t *) sc_array_push (&fquad) = qtq;
+          *(int8_t *) sc_array_push (&fcode) = (int8_t) code;
+        }
+        mesh->face_offset[il + 1] = (p4est_locidx_t) fquad.elem_count;
+      }
+
+#ifdef P4_TO_P8
+      if (do_edge) {
+        for (edge = 0; edge < P8EST_EDGES; ++edge) {
+          mesh_csr_edge (p4est, ghost, mesh, jt, q, jl, edge,
+                         &nquads, &ntrees, &nints);
+        }
+      }
+#endif
+      if (do_corner) {
+        for (corner = 0; corner < P4EST_CHILDREN; ++corner) {
+          mesh_csr_corner (p4est, ghost, mesh, jt, q, jl, corner,
+                           &nquads, &ntrees, &nints);
+        }
+      }
+    }
+  }
+  sc_array_reset (&nquads);
+  sc_array_reset (&ntrees);
+  sc_array_reset (&nints);
+
+  /* copy the neighbor lists into arrays of exact size */
+  count = fquad.elem_count;
+  P4EST_ASSERT (mesh->face_offset[P4EST_FACES * lq] == (p4est_locidx_t) count);
+  mesh->face_quad = P4EST_ALLOC (p4est_locidx_t, count);
+  mesh->face_code = P4EST_ALLOC (int8_t, count);
+  if (count > 0) {
+    memcpy (mesh->face_quad, fquad.array, count * sizeof (p4est_locidx_t));
+    memcpy (mesh->face_code, fcode.array, count * sizeof (int8_t));
+  }
+  sc_array_reset (&fquad);
+  sc_array_reset (&fcode);
+
+  return mesh;
+}
+
 void
 p4est_mesh_destroy (p4est_mesh_t * mesh)
 {
@@ -703,9 +1130,11 @@ p4est_mesh_destroy (p4est_mesh_t * mesh)
   }
 
   P4EST_FREE (mesh->ghost_to_proc);
-  P4EST_FREE (mesh->quad_to_quad);
-  P4EST_FREE (mesh->quad_to_face);
-  sc_array_destroy (mesh->quad_to_half);
+  if (mesh->quad_to_quad != NULL) {
+    P4EST_FREE (mesh->quad_to_quad);
+    P4EST_FREE (mesh->quad_to_face);
+    sc_array_destroy (mesh->quad_to_half);
+  }
 
   if (mesh->quad_to_corner != NULL) {
     P4EST_FREE (mesh->quad_to_corner);
@@ -714,6 +1143,21 @@ p4est_mesh_destroy (p4est_mesh_t * mesh)
     sc_array_destroy (mesh->corner_corner);
   }
 
+#ifdef P4_TO_P8
+  if (mesh->quad_to_edge != NULL) {
+    P4EST_FREE (mesh->quad_to_edge);
+    sc_array_destroy (mesh->edge_offset);
+    sc_array_destroy (mesh->edge_quad);
+    sc_array_destroy (mesh->edge_edge);
+  }
+#endif
+
+  if (mesh->face_offset != NULL) {
+    P4EST_FREE (mesh->face_offset);
+    P4EST_FREE (mesh->face_quad);
+    P4EST_FREE (mesh->face_code);
+  }
+
   P4EST_FREE (mesh);
 }
 
@@ -832,6 +1276,7 @@ p4est_mesh_face_neighbor_next (p4est_mesh_face_neighbor_t * mfn,
   p4est_topidx_t      which_tree;
   p4est_locidx_t      qtq, quadfacecode;
   p4est_locidx_t      lnq, *halfs;
+  p4est_locidx_t      first, num;
 #ifdef P4EST_ENABLE_DEBUG
   p4est_locidx_t      ngh;
 #endif
@@ -856,27 +1301,47 @@ p4est_mesh_face_neighbor_next (p4est_mesh_face_neighbor_t * mfn,
 
   /* Retrieve face and quadrant codes */
   quadfacecode = mfn->quadrant_code + (p4est_locidx_t) mfn->face;
-  qtq = mfn->mesh->quad_to_quad[quadfacecode];
-  qtf = (int) mfn->mesh->quad_to_face[quadfacecode];
-  if (qtf >= 0) {
-    /* Neighbor is same or double size */
-    ;
-
-    /* Advance to next quadrant */
-    ++mfn->face;
+  if (mfn->mesh->quad_to_quad == NULL) {
+    /* the face neighbors are only stored in compressed rows */
+    first = mfn->mesh->face_offset[quadfacecode];
+    num = mfn->mesh->face_offset[quadfacecode + 1] - first;
+    if (num == 0) {
+      /* a boundary face sees the quadrant itself */
+      qtq = mfn->quadrant_code / P4EST_FACES;
+      qtf = mfn->face++;
+    }
+    else {
+      qtq = mfn->mesh->face_quad[first + mfn->subface];
+      qtf = (int) mfn->mesh->face_code[first + mfn->subface];
+      if (++mfn->subface == num) {
+        mfn->subface = 0;
+        ++mfn->face;
+      }
+    }
   }
   else {
-    /* Neighbors across this face are half size */
-    P4EST_ASSERT (qtq >= 0);
-    halfs = (p4est_locidx_t *) sc_array_index (mfn->mesh->quad_to_half,
-                                               (size_t) qtq);
-    qtq = halfs[mfn->subface];
-
-    /* Advance to next quadrant */
-    if (++mfn->subface == P4EST_HALF) {
-      mfn->subface = 0;
+    qtq = mfn->mesh->quad_to_quad[quadfacecode];
+    qtf = (int) mfn->mesh->quad_to_face[quadfacecode];
+    if (qtf >= 0) {
+      /* Neighbor is same or double size */
+      ;
+
+      /* Advance to next quadrant */
       ++mfn->face;
     }
+    else {
+      /* Neighbors across this face are half size */
+      P4EST_ASSERT (qtq >= 0);
+      halfs = (p4est_locidx_t *) sc_array_index (mfn->mesh->quad_to_half,
+                                                 (size_t) qtq);
+      qtq = halfs[mfn->subface];
+
+      /* Advance to next quadrant */
+      if (++mfn->subface == P4EST_HALF) {
+        mfn->subface = 0;
+        ++mfn->face;
+      }
+    }
   }
 
   mfn->current_qtq = qtq;
@@ -83,6 +83,17 @@ SC_EXTERN_C_BEGIN;
  * in corner_quad, and the corner number from the neighbor as corner_corner.
  *
  * Corners with no diagonal neighbor at all are assigned the value -1.
+ *
+ * A mesh created by p4est_mesh_new_csr stores the face neighbors in the
+ * face_offset, face_quad and face_code arrays in compressed sparse row
+ * format instead, and its quad_to_quad, quad_to_face and quad_to_half
+ * members are NULL.  The neighbors across face f
+ * of local quadrant q are face_quad[i] for face_offset[4 * q + f] <= i <
+ * face_offset[4 * q + f + 1], encoded like the quad_to_quad values.
+ * Each face_code[i] holds the matching quad_to_face value, which is negative
+ * for all entries of a face with half-size neighbors.  A face on the boundary
+ * of the forest has no entries.  These arrays are NULL unless the mesh is
+ * created by p4est_mesh_new_csr.
  */
 typedef struct
 {
@@ -100,12 +111,18 @@ typedef struct
                                              NULL by default */
 
   /* These members are NULL if the connect_t is not P4EST_CONNECT_CORNER */
-  /* CAUTION: tree-boundary corners not yet implemented */
   p4est_locidx_t      local_num_corners;        /* tree-boundary corners */
   p4est_locidx_t     *quad_to_corner;   /* 4 indices for each local quad */
   sc_array_t         *corner_offset;    /* local_num_corners + 1 entries */
   sc_array_t         *corner_quad;      /* corner_offset indexes into this */
   sc_array_t         *corner_corner;    /* and this one too (type int8_t) */
+
+  /* These members are NULL unless the mesh is created by p4est_mesh_new_csr,
+   * which leaves quad_to_quad, quad_to_face and quad_to_half NULL instead */
+  p4est_locidx_t     *face_offset;      /**< 4 * local_num_quadrants + 1
+                                             offsets into face_quad */
+  p4est_locidx_t     *face_quad;        /**< face neighbors of all quadrants */
+  int8_t             *face_code;        /**< one quad_to_face value each */
 }
 p4est_mesh_t;
 
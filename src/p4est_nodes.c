@@ -26,11 +26,13 @@
 #include <p4est_algorithms.h>
 #include <p4est_bits.h>
 #include <p4est_communication.h>
+#include <p4est_extended.h>
 #include <p4est_nodes.h>
 #else
 #include <p8est_algorithms.h>
 #include <p8est_bits.h>
 #include <p8est_communication.h>
+#include <p8est_extended.h>
 #include <p8est_nodes.h>
 #endif
 #include <sc_ranges.h>
@@ -459,6 +461,124 @@ p4est_nodes_foreach (void **item, const void *u)
   return 1;
 }
 
+/** Sort an array of clamped nodes and identify the unique ones.
+ *
+ * \param [in,out] keys     On input, canonicalized nodes with their owning
+ *                          tree in p.piggy3.which_tree and their position in
+ *                          the array in p.piggy3.local_num.  On output,
+ *                          resized to hold one copy of every unique node.
+ *                          The element size must be sizeof (p4est_quadrant_t)
+ *                          or that of an equivalent node structure.
+ * \param [out] numbers     For each input position, the index of its node
+ *                          in the output array \a keys.
+ * \param [out] first       If NULL, the unique nodes are ordered by tree and
+ *                          Morton index.  Otherwise, of size elem_count, each
+ *                          input position receives the smallest position with
+ *                          the same node, the unique nodes are ordered by
+ *                          this first occurrence and keep it in local_num.
+ *                          This is the order of sc_hash_array_insert_unique.
+ * \return                  The number of unique nodes.
+ */
+static p4est_locidx_t
+p4est_nodes_sort_unique (sc_array_t * keys, p4est_locidx_t * numbers,
+                         p4est_locidx_t * first)
+{
+  const size_t        count = keys->elem_count;
+  size_t              zz, zy, zend;
+  p4est_locidx_t      il, rep, num_unique;
+  p4est_quadrant_t   *key, *q;
+
+  P4EST_ASSERT (keys->elem_size >= sizeof (p4est_quadrant_t));
+
+  sc_array_sort (keys, p4est_quadrant_compare_piggy);
+  num_unique = 0;
+  for (zz = 0; zz < count; zz = zend) {
+    /* find the run of equal nodes and the first position among them */
+    key = (p4est_quadrant_t *) sc_array_index (keys, zz);
+    rep = key->p.piggy3.local_num;
+    for (zend = zz + 1; zend < count; ++zend) {
+      q = (p4est_quadrant_t *) sc_array_index (keys, zend);
+      if (p4est_quadrant_compare_piggy (key, q)) {
+        break;
+      }
+      rep = SC_MIN (rep, q->p.piggy3.local_num);
+    }
+    for (zy = zz; zy < zend; ++zy) {
+      q = (p4est_quadrant_t *) sc_array_index (keys, zy);
+      if (first == NULL) {
+        numbers[q->p.piggy3.local_num] = num_unique;
+      }
+      else {
+        first[q->p.piggy3.local_num] = rep;
+      }
+    }
+
+    /* compact the array in place, key is not overwritten before */
+    q = (p4est_quadrant_t *) sc_array_index (keys, (size_t) num_unique);
+    if (q != key) {
+      memcpy (q, key, keys->elem_size);
+    }
+    q->p.piggy3.local_num = rep;
+    ++num_unique;
+  }
+  sc_array_resize (keys, (size_t) num_unique);
+
+  if (first != NULL) {
+    /* number the unique nodes by their first occurrence */
+    for (rep = 0, il = 0; il < (p4est_locidx_t) count; ++il) {
+      if (first[il] == il) {
+        numbers[il] = rep++;
+      }
+      else {
+        P4EST_ASSERT (first[il] < il);
+        numbers[il] = numbers[first[il]];
+      }
+    }
+    P4EST_ASSERT (rep == num_unique);
+    sc_array_sort (keys, p4est_quadrant_compare_local_num);
+  }
+
+  return num_unique;
+}
+
+/** Minimum number of independent node keys sorted at a time.
+ * The corners of the local quadrants are deduplicated in chunks of this
+ * size, such that the peak memory exceeds that of the unique nodes only by
+ * one chunk and the nodes repeated on the boundaries between chunks.
+ * Debug builds use small chunks to exercise the merging in the tests.
+ */
+#ifndef P4EST_ENABLE_DEBUG
+static const size_t p4est_nodes_chunk_keys = (size_t) 1 << 16;
+#else
+static const size_t p4est_nodes_chunk_keys = (size_t) 1 << 8;
+#endif
+
+/** Deduplicate a chunk of independent nodes and append the unique ones.
+ * \param [in,out] chunk    Canonicalized corner nodes of consecutive local
+ *                          quadrants with their position in the chunk in
+ *                          p.piggy3.local_num.  Emptied on output.
+ * \param [out] numbers     For each input position, the position of its
+ *                          node in \a inda.
+ * \param [in,out] inda     The unique nodes of every chunk so far.  Nodes
+ *                          shared between chunks are contained repeatedly.
+ */
+static void
+p4est_nodes_flush_chunk (sc_array_t * chunk, p4est_locidx_t * numbers,
+                         sc_array_t * inda)
+{
+  const p4est_locidx_t count = (p4est_locidx_t) chunk->elem_count;
+  const p4est_locidx_t offset = (p4est_locidx_t) inda->elem_count;
+  p4est_locidx_t      il, num_unique;
+
+  num_unique = p4est_nodes_sort_unique (chunk, numbers, NULL);
+  for (il = 0; il < count; ++il) {
+    numbers[il] += offset;
+  }
+  memcpy (sc_array_push_count (inda, (size_t) num_unique), chunk->array,
+          (size_t) num_unique * chunk->elem_size);
+  sc_array_resize (chunk, 0);
+}
+
 #ifdef P4EST_ENABLE_MPI
 
 static p4est_locidx_t *
@@ -497,6 +617,8 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   int                 nwin, maxpeers, maxwin, twomaxwin;
   int                 my_ranges[2 * p4est_num_ranges];
   int                *procs, *all_ranges;
+  int                *receivers, *senders;
+  int                 num_receivers, num_senders;
   int                *nonlocal_ranks;
   int                *old_sharers, *new_sharers;
   char               *this_base;
@@ -508,6 +630,7 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   p4est_locidx_t     *node_number;
   p4est_node_peer_t  *peers, *peer;
   p4est_indep_t       inkey;
+  ssize_t             found;
   sc_array_t          send_requests;
   sc_recycle_array_t *orarr, *nrarr;
   MPI_Request        *send_request;
@@ -519,6 +642,7 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   int                 k;
   int                 qcid, face;
   int                 clamped = 1;
+  int                 use_hash;
   void               *save_user_data;
   size_t              zz, position;
   int8_t             *local_status, *quad_status;
@@ -531,6 +655,8 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   p4est_locidx_t      num_face_hangings, dup_face_hangings;
   p4est_locidx_t     *local_nodes, *quad_nodes;
   p4est_locidx_t     *new_node_number;
+  p4est_locidx_t      num_face_keys, *face_numbers, *face_first;
+  p4est_locidx_t      chunk_first;
   p4est_tree_t       *tree;
   p4est_nodes_t      *nodes;
   p4est_quadrant_t    c, n, p;
@@ -539,6 +665,8 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   sc_array_t         *quadrants;
   sc_array_t         *inda, *faha;
   sc_array_t         *shared_indeps;
+  sc_array_t          face_keys, *keys;
+  sc_array_t          chunk;
   sc_hash_array_t    *indep_nodes;
   sc_hash_array_t    *face_hangings;
 #ifndef P4_TO_P8
@@ -550,10 +678,12 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
 #endif
   p4est_locidx_t      num_edge_hangings_begin;
   p4est_locidx_t      num_edge_hangings, dup_edge_hangings;
+  p4est_locidx_t      num_edge_keys, *edge_numbers, *edge_first;
   p8est_hang4_t      *fh;
   p8est_hang2_t      *eh;
   sc_array_t          exist_array;
   sc_array_t         *edha;
+  sc_array_t          edge_keys;
   sc_hash_array_t    *edge_hangings;
 #endif
 
@@ -598,20 +728,42 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
     P4EST_ALLOC (p4est_locidx_t, num_local_nodes);
   memset (local_nodes, -1, num_local_nodes * sizeof (*local_nodes));
 
-  indep_nodes = sc_hash_array_new (sizeof (p4est_indep_t),
-                                   p4est_node_hash_piggy_fn,
-                                   p4est_node_equal_piggy_fn, &clamped);
-#ifndef P4_TO_P8
-  face_hangings = sc_hash_array_new (sizeof (p4est_hang2_t),
+  /* The nodes are either collected in hash arrays as they are found,
+   * or appended to arrays that are sorted afterwards.  The independent
+   * nodes are sorted in chunks as they come to bound the memory.
+   * Both ways produce identical results; the latter is the default.
+   */
+  use_hash = (p4est->inspect != NULL && p4est->inspect->use_nodes_hash);
+  if (use_hash) {
+    indep_nodes = sc_hash_array_new (sizeof (p4est_indep_t),
                                      p4est_node_hash_piggy_fn,
                                      p4est_node_equal_piggy_fn, &clamped);
+#ifndef P4_TO_P8
+    face_hangings = sc_hash_array_new (sizeof (p4est_hang2_t),
+                                       p4est_node_hash_piggy_fn,
+                                       p4est_node_equal_piggy_fn, &clamped);
 #else
-  face_hangings = sc_hash_array_new (sizeof (p8est_hang4_t),
-                                     p4est_node_hash_piggy_fn,
-                                     p4est_node_equal_piggy_fn, &clamped);
-  edge_hangings = sc_hash_array_new (sizeof (p8est_hang2_t),
-                                     p4est_node_hash_piggy_fn,
-                                     p4est_node_equal_piggy_fn, &clamped);
+    face_hangings = sc_hash_array_new (sizeof (p8est_hang4_t),
+                                       p4est_node_hash_piggy_fn,
+                                       p4est_node_equal_piggy_fn, &clamped);
+    edge_hangings = sc_hash_array_new (sizeof (p8est_hang2_t),
+                                       p4est_node_hash_piggy_fn,
+                                       p4est_node_equal_piggy_fn, &clamped);
+#endif
+  }
+  else {
+    indep_nodes = face_hangings = NULL;
+    sc_array_init (&nodes->indep_nodes, sizeof (p4est_indep_t));
+    sc_array_init (&chunk, sizeof (p4est_indep_t));
+#ifndef P4_TO_P8
+    sc_array_init (faha, sizeof (p4est_hang2_t));
+#else
+    edge_hangings = NULL;
+    sc_array_init (faha, sizeof (p8est_hang4_t));
+    sc_array_init (edha, sizeof (p8est_hang2_t));
+#endif
+  }
+#ifdef P4_TO_P8
   sc_array_init (&exist_array, sizeof (int));
 #endif
 
@@ -619,6 +771,7 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
    * It will also collect all independent nodes relevant for the elements.
    */
   num_indep_nodes = dup_indep_nodes = all_face_hangings = 0;
+  chunk_first = 0;
   quad_nodes = local_nodes;
   quad_status = local_status;
   for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
@@ -690,6 +843,12 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
       for (k = 0; k < P4EST_CHILDREN; ++k) {
         P4EST_ASSERT (quad_status[k] >= 0 || quad_status[k] <= 2);
         p4est_quadrant_corner_node (qpp[quad_status[k]], k, &n);
+        if (!use_hash) {
+          r = (p4est_quadrant_t *) sc_array_push (&chunk);
+          p4est_node_canonicalize (p4est, jt, &n, r);
+          r->p.piggy3.local_num = (p4est_locidx_t) chunk.elem_count - 1;
+          continue;
+        }
         p4est_node_canonicalize (p4est, jt, &n, &c);
         r =
           (p4est_quadrant_t *) sc_hash_array_insert_unique (indep_nodes, &c,
@@ -705,41 +864,81 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
         P4EST_ASSERT ((p4est_locidx_t) position < num_indep_nodes);
         quad_nodes[k] = (p4est_locidx_t) position;
       }
+      if (!use_hash && chunk.elem_count >= p4est_nodes_chunk_keys) {
+        P4EST_ASSERT (quad_nodes + P4EST_CHILDREN - local_nodes ==
+                      chunk_first + (p4est_locidx_t) chunk.elem_count);
+        p4est_nodes_flush_chunk (&chunk, local_nodes + chunk_first,
+                                 &nodes->indep_nodes);
+        chunk_first = (p4est_locidx_t) (quad_nodes + P4EST_CHILDREN -
+                                        local_nodes);
+      }
     }
   }
-  P4EST_ASSERT (num_indep_nodes + dup_indep_nodes == num_local_nodes);
 #ifdef P4_TO_P8
   sc_array_reset (&exist_array);
 #endif
-  inda = &indep_nodes->a;
-  P4EST_ASSERT (num_indep_nodes == (p4est_locidx_t) inda->elem_count);
 
-  /* Reorder independent nodes by their global treeid and z-order index. */
-  new_node_number = P4EST_ALLOC (p4est_locidx_t, num_indep_nodes);
-  for (il = 0; il < num_indep_nodes; ++il) {
-    in = (p4est_indep_t *) sc_array_index (inda, (size_t) il);
-    in->pad8 = 0;               /* shared by 0 other processors so far */
-    in->pad16 = (int16_t) (-1);
-    in->p.piggy3.local_num = il;
+  if (!use_hash) {
+    /* Sort the independent nodes by their global treeid and z-order index
+     * and remove the duplicates between chunks, renumbering the corners
+     * of all elements. */
+    inda = &nodes->indep_nodes;
+    P4EST_ASSERT (chunk_first + (p4est_locidx_t) chunk.elem_count ==
+                  num_local_nodes);
+    p4est_nodes_flush_chunk (&chunk, local_nodes + chunk_first, inda);
+    sc_array_reset (&chunk);
+    for (zz = 0; zz < inda->elem_count; ++zz) {
+      in = (p4est_indep_t *) sc_array_index (inda, zz);
+      in->p.piggy3.local_num = (p4est_locidx_t) zz;
+    }
+    new_node_number = P4EST_ALLOC (p4est_locidx_t, inda->elem_count);
+    num_indep_nodes = p4est_nodes_sort_unique (inda, new_node_number, NULL);
+    for (il = 0; il < num_local_nodes; ++il) {
+      local_nodes[il] = new_node_number[local_nodes[il]];
+    }
+    P4EST_FREE (new_node_number);
+    dup_indep_nodes = num_local_nodes - num_indep_nodes;
+    for (il = 0; il < num_indep_nodes; ++il) {
+      in = (p4est_indep_t *) sc_array_index (inda, (size_t) il);
+      in->pad8 = 0;             /* shared by 0 other processors so far */
+      in->pad16 = (int16_t) (-1);
+      in->p.piggy3.local_num = il;
+    }
   }
-  sc_array_sort (inda, p4est_quadrant_compare_piggy);
-  for (il = 0; il < num_indep_nodes; ++il) {
-    in = (p4est_indep_t *) sc_array_index (inda, (size_t) il);
-    new_node_number[in->p.piggy3.local_num] = il;
+  else {
+    inda = &indep_nodes->a;
+    P4EST_ASSERT (num_indep_nodes == (p4est_locidx_t) inda->elem_count);
+
+    /* Reorder independent nodes by their global treeid and z-order index. */
+    new_node_number = P4EST_ALLOC (p4est_locidx_t, num_indep_nodes);
+    for (il = 0; il < num_indep_nodes; ++il) {
+      in = (p4est_indep_t *) sc_array_index (inda, (size_t) il);
+      in->pad8 = 0;             /* shared by 0 other processors so far */
+      in->pad16 = (int16_t) (-1);
+      in->p.piggy3.local_num = il;
+    }
+    sc_array_sort (inda, p4est_quadrant_compare_piggy);
+    for (il = 0; il < num_indep_nodes; ++il) {
+      in = (p4est_indep_t *) sc_array_index (inda, (size_t) il);
+      new_node_number[in->p.piggy3.local_num] = il;
 #ifndef P4EST_ENABLE_MPI
-    in->p.piggy3.local_num = il;
+      in->p.piggy3.local_num = il;
 #endif
-  }
+    }
 
-  /* Re-synchronize hash array and local nodes */
-  save_user_data = indep_nodes->internal_data.user_data;
-  indep_nodes->internal_data.user_data = new_node_number;
-  sc_hash_foreach (indep_nodes->h, p4est_nodes_foreach);
-  indep_nodes->internal_data.user_data = save_user_data;
-  for (il = 0; il < num_local_nodes; ++il) {
-    P4EST_ASSERT (local_nodes[il] >= 0 && local_nodes[il] < num_indep_nodes);
-    local_nodes[il] = new_node_number[local_nodes[il]];
+    /* Re-synchronize hash array and local nodes */
+    save_user_data = indep_nodes->internal_data.user_data;
+    indep_nodes->internal_data.user_data = new_node_number;
+    sc_hash_foreach (indep_nodes->h, p4est_nodes_foreach);
+    indep_nodes->internal_data.user_data = save_user_data;
+    for (il = 0; il < num_local_nodes; ++il) {
+      P4EST_ASSERT (local_nodes[il] >= 0 &&
+                    local_nodes[il] < num_indep_nodes);
+      local_nodes[il] = new_node_number[local_nodes[il]];
+    }
+    P4EST_FREE (new_node_number);
   }
+  P4EST_ASSERT (num_indep_nodes + dup_indep_nodes == num_local_nodes);
 #ifndef P4EST_ENABLE_MPI
   num_owned_indeps = num_indep_nodes;
   offset_owned_indeps = 0;
@@ -748,7 +947,6 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   offset_owned_indeps = -1;     /* will be computed below */
 #endif
   num_owned_shared = 0;
-  P4EST_FREE (new_node_number);
 
 #ifdef P4EST_ENABLE_MPI
   /* Fill send buffers and number owned nodes. */
@@ -812,32 +1010,32 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   end_owned_indeps = offset_owned_indeps + num_owned_indeps;
 
   /* Distribute global information about who is sending to who. */
-  maxpeers = first_peer;
-  maxwin = last_peer;
-  nwin = sc_ranges_adaptive (p4est_package_id,
-                             p4est->mpicomm, procs, &maxpeers, &maxwin,
-                             p4est_num_ranges, my_ranges, &all_ranges);
-  twomaxwin = 2 * maxwin;
-#ifdef P4EST_ENABLE_DEBUG
-  P4EST_GLOBAL_STATISTICSF ("Max peers %d ranges %d/%d\n",
-                            maxpeers, maxwin, p4est_num_ranges);
-  sc_ranges_statistics (p4est_package_id, SC_LP_STATISTICS,
-                        p4est->mpicomm, num_procs, procs,
-                        rank, p4est_num_ranges, my_ranges);
-#endif
-  P4EST_VERBOSEF ("Peer ranges %d/%d/%d first %d last %d owned %lld/%lld\n",
-                  nwin, maxwin, p4est_num_ranges, first_peer, last_peer,
-                  (long long) num_owned_indeps, (long long) num_indep_nodes);
-
-  /* Send queries to the owners of the independent nodes that I share. */
-  num_send_queries = num_send_nonzero = local_send_count = 0;
-  for (l = 0; l < nwin; ++l) {
-    for (k = my_ranges[2 * l]; k <= my_ranges[2 * l + 1]; ++k) {
-      peer = peers + k;
-      if (k == rank) {
-        P4EST_ASSERT (peer->send_first.elem_count == 0);
-        continue;
+  all_ranges = NULL;
+  if (p4est->inspect != NULL && p4est->inspect->use_notify_nbx) {
+    /* Only the owners learn about their queries, which suffices since
+     * every query that is sent is nonempty. */
+    receivers = P4EST_ALLOC (int, num_procs);
+    senders = P4EST_ALLOC (int, num_procs);
+    num_receivers = 0;
+    for (k = first_peer; k <= last_peer; ++k) {
+      if (procs[k] > 0) {
+        receivers[num_receivers++] = k;
       }
+    }
+    mpiret = p4est_comm_notify_nbx (receivers, num_receivers,
+                                    senders, &num_senders, p4est->mpicomm);
+    SC_CHECK_MPI (mpiret);
+    P4EST_VERBOSEF ("Peer notify %d/%d first %d last %d owned %lld/%lld\n",
+                    num_receivers, num_senders, first_peer, last_peer,
+                    (long long) num_owned_indeps,
+                    (long long) num_indep_nodes);
+
+    /* Send queries to the owners of the independent nodes that I share. */
+    num_send_queries = num_send_nonzero = local_send_count = 0;
+    for (l = 0; l < num_receivers; ++l) {
+      k = receivers[l];
+      peer = peers + k;
+      P4EST_ASSERT (k != rank && peer->send_first.elem_count > 0);
       send_request = (MPI_Request *) sc_array_push (&send_requests);
       this_size = peer->send_first.elem_count * first_size;
       mpiret = MPI_Isend (peer->send_first.array, (int) this_size,
@@ -846,28 +1044,80 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
       SC_CHECK_MPI (mpiret);
       local_send_count += (int) peer->send_first.elem_count;
       ++num_send_queries;
-      if (this_size > 0) {
-        ++num_send_nonzero;
-        peer->expect_reply = 1;
-      }
+      ++num_send_nonzero;
+      peer->expect_reply = 1;
     }
-  }
 
-  /* Prepare to receive queries */
-  num_recv_queries = local_recv_count = 0;
-  for (k = 0; k < num_procs; ++k) {
-    if (k == rank) {
-      continue;
+    /* Prepare to receive queries */
+    num_recv_queries = local_recv_count = 0;
+    for (l = 0; l < num_senders; ++l) {
+      k = senders[l];
+      P4EST_ASSERT (k != rank);
+      peers[k].expect_query = 1;
+      ++num_recv_queries;
     }
-    for (l = 0; l < maxwin; ++l) {
-      start = all_ranges[k * twomaxwin + 2 * l];
-      if (start == -1 || start > rank) {
-        break;
+    P4EST_FREE (receivers);
+    P4EST_FREE (senders);
+  }
+  else {
+    maxpeers = first_peer;
+    maxwin = last_peer;
+    nwin = sc_ranges_adaptive (p4est_package_id,
+                               p4est->mpicomm, procs, &maxpeers, &maxwin,
+                               p4est_num_ranges, my_ranges, &all_ranges);
+    twomaxwin = 2 * maxwin;
+#ifdef P4EST_ENABLE_DEBUG
+    P4EST_GLOBAL_STATISTICSF ("Max peers %d ranges %d/%d\n",
+                              maxpeers, maxwin, p4est_num_ranges);
+    sc_ranges_statistics (p4est_package_id, SC_LP_STATISTICS,
+                          p4est->mpicomm, num_procs, procs,
+                          rank, p4est_num_ranges, my_ranges);
+#endif
+    P4EST_VERBOSEF ("Peer ranges %d/%d/%d first %d last %d owned %lld/%lld\n",
+                    nwin, maxwin, p4est_num_ranges, first_peer, last_peer,
+                    (long long) num_owned_indeps,
+                    (long long) num_indep_nodes);
+
+    /* Send queries to the owners of the independent nodes that I share. */
+    num_send_queries = num_send_nonzero = local_send_count = 0;
+    for (l = 0; l < nwin; ++l) {
+      for (k = my_ranges[2 * l]; k <= my_ranges[2 * l + 1]; ++k) {
+        peer = peers + k;
+        if (k == rank) {
+          P4EST_ASSERT (peer->send_first.elem_count == 0);
+          continue;
+        }
+        send_request = (MPI_Request *) sc_array_push (&send_requests);
+        this_size = peer->send_first.elem_count * first_size;
+        mpiret = MPI_Isend (peer->send_first.array, (int) this_size,
+                            MPI_BYTE, k, P4EST_COMM_NODES_QUERY,
+                            p4est->mpicomm, send_request);
+        SC_CHECK_MPI (mpiret);
+        local_send_count += (int) peer->send_first.elem_count;
+        ++num_send_queries;
+        if (this_size > 0) {
+          ++num_send_nonzero;
+          peer->expect_reply = 1;
+        }
       }
-      if (rank <= all_ranges[k * twomaxwin + 2 * l + 1]) {
-        peers[k].expect_query = 1;
-        ++num_recv_queries;
-        break;
+    }
+
+    /* Prepare to receive queries */
+    num_recv_queries = local_recv_count = 0;
+    for (k = 0; k < num_procs; ++k) {
+      if (k == rank) {
+        continue;
+      }
+      for (l = 0; l < maxwin; ++l) {
+        start = all_ranges[k * twomaxwin + 2 * l];
+        if (start == -1 || start > rank) {
+          break;
+        }
+        if (rank <= all_ranges[k * twomaxwin + 2 * l + 1]) {
+          peers[k].expect_query = 1;
+          ++num_recv_queries;
+          break;
+        }
       }
     }
   }
@@ -905,8 +1155,15 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
 #endif
       ttt = (p4est_topidx_t *) (&xyz[P4EST_DIM]);
       inkey.p.which_tree = *ttt;
-      P4EST_EXECUTE_ASSERT_TRUE (sc_hash_array_lookup
-                                 (indep_nodes, &inkey, &position));
+      if (use_hash) {
+        P4EST_EXECUTE_ASSERT_TRUE (sc_hash_array_lookup
+                                   (indep_nodes, &inkey, &position));
+      }
+      else {
+        found = sc_array_bsearch (inda, &inkey, p4est_quadrant_compare_piggy);
+        P4EST_ASSERT (found >= 0);
+        position = (size_t) found;
+      }
       P4EST_ASSERT ((p4est_locidx_t) position >= offset_owned_indeps &&
                     (p4est_locidx_t) position < end_owned_indeps);
       node_number = (p4est_locidx_t *) xyz;
@@ -1014,11 +1271,74 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   }
 #endif /* P4EST_ENABLE_MPI */
 
+  /* Without hash arrays the hanging nodes are collected, sorted
+   * and numbered in the order of their first occurrence up front. */
+  face_numbers = face_first = NULL;
+#ifdef P4_TO_P8
+  edge_numbers = edge_first = NULL;
+#endif
+  if (!use_hash) {
+    sc_array_init (&face_keys, sizeof (p4est_quadrant_t));
+#ifdef P4_TO_P8
+    sc_array_init (&edge_keys, sizeof (p4est_quadrant_t));
+#endif
+    quad_status = local_status;
+    for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+      tree = p4est_tree_array_index (p4est->trees, jt);
+      quadrants = &tree->quadrants;
+      for (zz = 0; zz < quadrants->elem_count;
+           quad_status += P4EST_CHILDREN, ++zz) {
+        q = p4est_quadrant_array_index (quadrants, zz);
+        for (k = 0; k < P4EST_CHILDREN; ++k) {
+          if (quad_status[k] == 0) {
+            continue;
+          }
+#ifndef P4_TO_P8
+          P4EST_ASSERT (quad_status[k] == 1);
+          keys = &face_keys;
+#else
+          P4EST_ASSERT (quad_status[k] == 1 || quad_status[k] == 2);
+          keys = quad_status[k] == 1 ? &face_keys : &edge_keys;
+#endif
+          r = (p4est_quadrant_t *) sc_array_push (keys);
+          il = (p4est_locidx_t) keys->elem_count - 1;
+          p4est_quadrant_corner_node (q, k, &n);
+          p4est_node_canonicalize (p4est, jt, &n, r);
+          r->p.piggy3.local_num = il;
+        }
+      }
+    }
+    P4EST_ASSERT ((p4est_locidx_t) face_keys.elem_count == all_face_hangings);
+    face_numbers = P4EST_ALLOC (p4est_locidx_t, 2 * all_face_hangings);
+    face_first = face_numbers + all_face_hangings;
+    p4est_nodes_sort_unique (&face_keys, face_numbers, face_first);
+    sc_array_resize (faha, face_keys.elem_count);
+    for (zz = 0; zz < face_keys.elem_count; ++zz) {
+      *(p4est_quadrant_t *) sc_array_index (faha, zz) =
+        *p4est_quadrant_array_index (&face_keys, zz);
+    }
+    sc_array_reset (&face_keys);
+#ifdef P4_TO_P8
+    il = (p4est_locidx_t) edge_keys.elem_count;
+    edge_numbers = P4EST_ALLOC (p4est_locidx_t, 2 * il);
+    edge_first = edge_numbers + il;
+    p4est_nodes_sort_unique (&edge_keys, edge_numbers, edge_first);
+    sc_array_resize (edha, edge_keys.elem_count);
+    for (zz = 0; zz < edge_keys.elem_count; ++zz) {
+      *(p4est_quadrant_t *) sc_array_index (edha, zz) =
+        *p4est_quadrant_array_index (&edge_keys, zz);
+    }
+    sc_array_reset (&edge_keys);
+#endif
+  }
+
   /* This second loop will collect and assign all hanging nodes. */
   num_face_hangings = dup_face_hangings = 0;    /* still unknown */
+  num_face_keys = 0;
 #ifdef P4_TO_P8
   num_edge_hangings = dup_edge_hangings = 0;    /* still unknown */
   num_edge_hangings_begin = num_indep_nodes + all_face_hangings;
+  num_edge_keys = 0;
 #endif
   quad_nodes = local_nodes;
   quad_status = local_status;
@@ -1038,13 +1358,22 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
         if (quad_status[k] == 1) {
           P4EST_ASSERT (qcid != k && quad_indeps[qcid] != quad_indeps[k]);
           P4EST_ASSERT (p4est_child_corner_faces[qcid][k] >= 0);
-          p4est_quadrant_corner_node (q, k, &n);
-          p4est_node_canonicalize (p4est, jt, &n, &c);
-          r =
-            (p4est_quadrant_t *) sc_hash_array_insert_unique (face_hangings,
-                                                              &c, &position);
+          if (use_hash) {
+            p4est_quadrant_corner_node (q, k, &n);
+            p4est_node_canonicalize (p4est, jt, &n, &c);
+            r = (p4est_quadrant_t *)
+              sc_hash_array_insert_unique (face_hangings, &c, &position);
+            if (r != NULL) {
+              *r = c;
+            }
+          }
+          else {
+            position = (size_t) face_numbers[num_face_keys];
+            r = face_first[num_face_keys] != num_face_keys ? NULL :
+              (p4est_quadrant_t *) sc_array_index (faha, position);
+            ++num_face_keys;
+          }
           if (r != NULL) {
-            *r = c;
             P4EST_ASSERT (num_face_hangings == (p4est_locidx_t) position);
 #ifndef P4_TO_P8
             fh = (p4est_hang2_t *) r;
@@ -1092,13 +1421,22 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
         else if (quad_status[k] == 2) {
           P4EST_ASSERT (qcid != k && quad_indeps[qcid] != quad_indeps[k]);
           P4EST_ASSERT (p8est_child_corner_edges[qcid][k] >= 0);
-          p4est_quadrant_corner_node (q, k, &n);
-          p4est_node_canonicalize (p4est, jt, &n, &c);
-          r =
-            (p4est_quadrant_t *) sc_hash_array_insert_unique (edge_hangings,
-                                                              &c, &position);
+          if (use_hash) {
+            p4est_quadrant_corner_node (q, k, &n);
+            p4est_node_canonicalize (p4est, jt, &n, &c);
+            r = (p4est_quadrant_t *)
+              sc_hash_array_insert_unique (edge_hangings, &c, &position);
+            if (r != NULL) {
+              *r = c;
+            }
+          }
+          else {
+            position = (size_t) edge_numbers[num_edge_keys];
+            r = edge_first[num_edge_keys] != num_edge_keys ? NULL :
+              (p4est_quadrant_t *) sc_array_index (edha, position);
+            ++num_edge_keys;
+          }
           if (r != NULL) {
-            *r = c;
             P4EST_ASSERT (num_edge_hangings == (p4est_locidx_t) position);
             eh = (p8est_hang2_t *) r;
             first = quad_indeps[qcid];
@@ -1125,10 +1463,16 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   }
   P4EST_ASSERT (num_face_hangings + dup_face_hangings == all_face_hangings);
   P4EST_FREE (local_status);
-  sc_hash_array_rip (face_hangings, faha);
+  P4EST_FREE (face_numbers);
+  if (use_hash) {
+    sc_hash_array_rip (face_hangings, faha);
+  }
   P4EST_ASSERT (num_face_hangings == (p4est_locidx_t) faha->elem_count);
 #ifdef P4_TO_P8
-  sc_hash_array_rip (edge_hangings, edha);
+  P4EST_FREE (edge_numbers);
+  if (use_hash) {
+    sc_hash_array_rip (edge_hangings, edha);
+  }
   P4EST_ASSERT (num_edge_hangings == (p4est_locidx_t) edha->elem_count);
 
   /* Correct the offsets of edge hanging nodes */
@@ -1151,7 +1495,9 @@ p4est_nodes_new (p4est_t * p4est, p4est_ghost_t * ghost)
   nodes->num_owned_indeps = num_owned_indeps;
   nodes->num_owned_shared = num_owned_shared;
   nodes->offset_owned_indeps = offset_owned_indeps;
-  sc_hash_array_rip (indep_nodes, inda = &nodes->indep_nodes);
+  if (use_hash) {
+    sc_hash_array_rip (indep_nodes, inda = &nodes->indep_nodes);
+  }
   nodes->nonlocal_ranks =
     P4EST_ALLOC (int, num_indep_nodes - num_owned_indeps);
   nodes->global_owned_indeps = P4EST_ALLOC (p4est_locidx_t, num_procs);
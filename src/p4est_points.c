@@ -393,3 +393,521 @@ p4est_new_points (sc_MPI_Comm mpicomm, p4est_connectivity_t * connectivity,
 
   return p4est;
 }
+
+#ifdef P4EST_ENABLE_MPI
+
+/** Number of regular samples that each process contributes to the choice
+ * of the splitters of \ref p4est_points_sample_sort, if there are more
+ * processes than that.  It bounds the imbalance independently of the
+ * number of processes while keeping the sample small.
+ */
+static const int    p4est_points_num_samples = 32;
+
+/** Merge runs of sorted quadrants into one array without duplicates.
+ * The runs are merged by a binary heap of their current heads.
+ * \param [in] runs         The quadrants, each run sorted and unique.
+ * \param [in] offsets      Run r consists of the quadrants offsets[r] up to
+ *                          excluding offsets[r + 1].
+ * \param [in] num_runs     Number of runs, at least one.
+ * \param [in,out] out      On output the sorted and unique quadrants.
+ */
+static void
+p4est_points_merge (const p4est_quadrant_t * runs, const size_t * offsets,
+                    int num_runs, sc_array_t * out)
+{
+  int                 i, r, child, parent, num_heap;
+  int                *heap;
+  size_t              count, *pos;
+  p4est_quadrant_t   *last;
+
+  P4EST_ASSERT (num_runs > 0);
+  heap = P4EST_ALLOC (int, num_runs);
+  pos = P4EST_ALLOC (size_t, num_runs);
+
+  /* insert the nonempty runs into the heap */
+  num_heap = 0;
+  for (r = 0; r < num_runs; ++r) {
+    pos[r] = offsets[r];
+    if (pos[r] == offsets[r + 1]) {
+      continue;
+    }
+    for (i = num_heap++; i > 0; i = parent) {
+      parent = (i - 1) / 2;
+      if (p4est_quadrant_compare_piggy (runs + pos[heap[parent]],
+                                        runs + pos[r]) <= 0) {
+        break;
+      }
+      heap[i] = heap[parent];
+    }
+    heap[i] = r;
+  }
+
+  /* take the smallest head and advance its run */
+  sc_array_resize (out, offsets[num_runs]);
+  count = 0;
+  last = NULL;
+  while (num_heap > 0) {
+    r = heap[0];
+    if (last == NULL ||
+        p4est_quadrant_compare_piggy (last, runs + pos[r]) != 0) {
+      last = p4est_quadrant_array_index (out, count++);
+      *last = runs[pos[r]];
+    }
+    if (++pos[r] == offsets[r + 1]) {
+      /* the run is exhausted and replaced by the last one in the heap */
+      r = heap[--num_heap];
+    }
+    for (i = 0; (child = 2 * i + 1) < num_heap; i = child) {
+      if (child + 1 < num_heap &&
+          p4est_quadrant_compare_piggy (runs + pos[heap[child + 1]],
+                                        runs + pos[heap[child]]) < 0) {
+        ++child;
+      }
+      if (p4est_quadrant_compare_piggy (runs + pos[r],
+                                        runs + pos[heap[child]]) <= 0) {
+        break;
+      }
+      heap[i] = heap[child];
+    }
+    heap[i] = r;
+  }
+  sc_array_resize (out, count);
+
+  P4EST_FREE (heap);
+  P4EST_FREE (pos);
+}
+
+/** Sort and redistribute quadrants in parallel by regular sampling.
+ * Every process sends a fixed number of regular samples to the root,
+ * which chooses the splitters and broadcasts them.  The quadrants are
+ * sent to their processes and the received sorted runs are merged.
+ * Equal quadrants are always sent to the same process.
+ * \param [in] mpicomm      The communicator to sort over.
+ * \param [in,out] points   Unsorted local quadrants on input; on output
+ *                          the locally sorted and unique quadrants of this
+ *                          process's share of the global order.
+ */
+static void
+p4est_points_sample_sort (sc_MPI_Comm mpicomm, sc_array_t * points)
+{
+  int                 mpiret;
+  int                 num_procs, rank;
+  int                 i, j, num_samples, per_proc;
+  int                *send_counts, *send_offsets;
+  int                *recv_counts, *recv_offsets;
+  const int           qsize = (int) sizeof (p4est_quadrant_t);
+  size_t              zz, lcount, total;
+  size_t             *run_offsets;
+  p4est_quadrant_t   *samples, *splitters, *q;
+  sc_array_t          recv;
+
+  mpiret = sc_MPI_Comm_size (mpicomm, &num_procs);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Comm_rank (mpicomm, &rank);
+  SC_CHECK_MPI (mpiret);
+
+  /* sort locally, which also prepares the sampling */
+  sc_array_sort (points, p4est_quadrant_compare_piggy);
+  sc_array_uniq (points, p4est_quadrant_compare_piggy);
+  if (num_procs == 1) {
+    return;
+  }
+  lcount = points->elem_count;
+
+  /* every process sends a few regular samples to the root;
+   * empty processes mark theirs invalid by a negative tree number */
+  per_proc = SC_MIN (num_procs - 1, p4est_points_num_samples);
+  q = P4EST_ALLOC (p4est_quadrant_t, per_proc);
+  for (i = 0; i < per_proc; ++i) {
+    if (lcount > 0) {
+      q[i] = *p4est_quadrant_array_index
+        (points, (size_t) (i + 1) * lcount / (size_t) (per_proc + 1));
+    }
+    else {
+      P4EST_QUADRANT_INIT (&q[i]);
+      q[i].p.which_tree = -1;
+    }
+  }
+  samples = rank == 0 ?
+    P4EST_ALLOC (p4est_quadrant_t, num_procs * per_proc) : NULL;
+  mpiret = MPI_Gather (q, per_proc * qsize, MPI_BYTE,
+                       samples, per_proc * qsize, MPI_BYTE, 0, mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_FREE (q);
+
+  /* the root selects the splitters and broadcasts them */
+  splitters = P4EST_ALLOC_ZERO (p4est_quadrant_t, num_procs);
+  if (rank == 0) {
+    num_samples = 0;
+    for (i = 0; i < num_procs * per_proc; ++i) {
+      if (samples[i].p.which_tree >= 0) {
+        samples[num_samples++] = samples[i];
+      }
+    }
+    qsort (samples, (size_t) num_samples, sizeof (p4est_quadrant_t),
+           p4est_quadrant_compare_piggy);
+    for (j = 1; j < num_procs; ++j) {
+      if (num_samples > 0) {
+        splitters[j] = samples[(size_t) j * num_samples / num_procs];
+      }
+    }
+    P4EST_FREE (samples);
+  }
+  mpiret = MPI_Bcast (splitters + 1, (num_procs - 1) * qsize, MPI_BYTE,
+                      0, mpicomm);
+  SC_CHECK_MPI (mpiret);
+
+  /* count the quadrants sent to each process */
+  send_counts = P4EST_ALLOC_ZERO (int, 4 * num_procs);
+  send_offsets = send_counts + num_procs;
+  recv_counts = send_offsets + num_procs;
+  recv_offsets = recv_counts + num_procs;
+  j = 0;
+  for (zz = 0; zz < lcount; ++zz) {
+    q = p4est_quadrant_array_index (points, zz);
+    while (j < num_procs - 1 &&
+           p4est_quadrant_compare_piggy (q, &splitters[j + 1]) >= 0) {
+      ++j;
+    }
+    ++send_counts[j];
+  }
+  P4EST_FREE (splitters);
+
+  /* exchange counts and quadrants */
+  mpiret = MPI_Alltoall (send_counts, 1, MPI_INT,
+                         recv_counts, 1, MPI_INT, mpicomm);
+  SC_CHECK_MPI (mpiret);
+  run_offsets = P4EST_ALLOC (size_t, num_procs + 1);
+  total = 0;
+  for (j = 0; j < num_procs; ++j) {
+    SC_CHECK_ABORT ((size_t) send_counts[j] <= (size_t) INT32_MAX / qsize &&
+                    (size_t) recv_counts[j] <= (size_t) INT32_MAX / qsize,
+                    "Point sort message size overflow");
+    send_offsets[j] = (j == 0 ? 0 : send_offsets[j - 1] +
+                       send_counts[j - 1]);
+    recv_offsets[j] = (int) total;
+    run_offsets[j] = total;
+    total += (size_t) recv_counts[j];
+  }
+  run_offsets[num_procs] = total;
+  SC_CHECK_ABORT (total <= (size_t) INT32_MAX / qsize,
+                  "Point sort receive size overflow");
+  for (j = 0; j < num_procs; ++j) {
+    send_counts[j] *= qsize;
+    send_offsets[j] *= qsize;
+    recv_counts[j] *= qsize;
+    recv_offsets[j] *= qsize;
+  }
+  sc_array_init_size (&recv, sizeof (p4est_quadrant_t), total);
+  mpiret = MPI_Alltoallv (points->array, send_counts, send_offsets, MPI_BYTE,
+                          recv.array, recv_counts, recv_offsets, MPI_BYTE,
+                          mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_FREE (send_counts);
+
+  /* the received quadrants are sorted runs, one per sender */
+  p4est_points_merge ((const p4est_quadrant_t *) recv.array, run_offsets,
+                      num_procs, points);
+  P4EST_FREE (run_offsets);
+  sc_array_reset (&recv);
+}
+
+#endif /* P4EST_ENABLE_MPI */
+
+/** Append quadrants to a tree while maintaining its level counters.
+ * The quadrants strictly between \a a and \a b are created by
+ * p4est_complete_region in the empty scratch tree \a gap.
+ */
+static void
+p4est_points_fill (p4est_t * p4est, p4est_topidx_t which_tree,
+                   p4est_tree_t * tree, p4est_tree_t * gap,
+                   const p4est_quadrant_t * a, const p4est_quadrant_t * b,
+                   int include_b, p4est_init_t init_fn)
+{
+  int                 i;
+  size_t              count;
+
+  P4EST_ASSERT (gap->quadrants.elem_count == 0);
+  P4EST_ASSERT (p4est_quadrant_compare (a, b) < 0);
+
+  p4est_complete_region (p4est, a, 0, b, include_b, gap, which_tree,
+                         init_fn);
+  count = gap->quadrants.elem_count;
+  if (count > 0) {
+    memcpy (sc_array_push_count (&tree->quadrants, count),
+            gap->quadrants.array, count * sizeof (p4est_quadrant_t));
+    for (i = 0; i <= P4EST_QMAXLEVEL; ++i) {
+      tree->quadrants_per_level[i] += gap->quadrants_per_level[i];
+      gap->quadrants_per_level[i] = 0;
+    }
+    tree->maxlevel = SC_MAX (tree->maxlevel, gap->maxlevel);
+    sc_array_resize (&gap->quadrants, 0);
+  }
+}
+
+p4est_t            *
+p4est_new_points_bottomup (sc_MPI_Comm mpicomm,
+                           p4est_connectivity_t * connectivity,
+                           int maxlevel, sc_array_t * points,
+                           size_t data_size, p4est_init_t init_fn,
+                           void *user_pointer)
+{
+  int                 mpiret;
+  int                 num_procs, rank;
+  int                 i;
+  size_t              zz, zend, num_points;
+  p4est_topidx_t      jt, num_trees;
+  p4est_topidx_t      first_tree, last_tree, next_tree;
+  p4est_quadrant_t   *first_quad, *next_quad, *quad, *limit;
+  p4est_quadrant_t    a, b, c, f, l, n, prev;
+  p4est_tree_t       *tree, gap;
+  p4est_t            *p4est;
+
+  P4EST_GLOBAL_PRODUCTIONF ("Into " P4EST_STRING
+                            "_new_points_bottomup with max level %d\n",
+                            maxlevel);
+  p4est_log_indent_push ();
+  P4EST_ASSERT (p4est_connectivity_is_valid (connectivity));
+  P4EST_ASSERT (0 <= maxlevel && maxlevel <= P4EST_QMAXLEVEL);
+  P4EST_ASSERT (points != NULL &&
+                points->elem_size == sizeof (p4est_quadrant_t));
+
+  /* retrieve MPI information */
+  mpiret = sc_MPI_Comm_size (mpicomm, &num_procs);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Comm_rank (mpicomm, &rank);
+  SC_CHECK_MPI (mpiret);
+
+  /* This implementation runs in O(N/p) with N the total number of
+   * quadrants, up to the sort of the points:
+   * 1. Every point is replaced by its quadrant of level maxlevel.
+   * 2. These quadrants are sorted in parallel and duplicates removed.
+   * 3. The gaps between successive quadrants are filled with the
+   *    coarsest possible quadrants by complete_region.
+   */
+
+  /* reduce the points to unique quadrants and sort them in parallel */
+  for (zz = 0; zz < points->elem_count; ++zz) {
+    quad = p4est_quadrant_array_index (points, zz);
+    P4EST_ASSERT (p4est_quadrant_is_node (quad, 1));
+    P4EST_ASSERT (0 <= quad->p.which_tree &&
+                  quad->p.which_tree < connectivity->num_trees);
+    p4est_node_to_quadrant (quad, maxlevel, &a);
+    a.p.which_tree = quad->p.which_tree;
+    *quad = a;
+  }
+#ifdef P4EST_ENABLE_MPI
+  p4est_points_sample_sort (mpicomm, points);
+#else
+  sc_array_sort (points, p4est_quadrant_compare_piggy);
+  sc_array_uniq (points, p4est_quadrant_compare_piggy);
+#endif
+  num_points = points->elem_count;
+  P4EST_ASSERT (sc_array_is_sorted (points, p4est_quadrant_compare_piggy));
+
+  /* create the p4est */
+  p4est = P4EST_ALLOC_ZERO (p4est_t, 1);
+  p4est->data_size = data_size;
+  p4est->user_pointer = user_pointer;
+  p4est->connectivity = connectivity;
+  num_trees = connectivity->num_trees;
+
+  /* set parallel environment */
+  p4est_comm_parallel_env_assign (p4est, mpicomm);
+
+  /* allocate memory pools */
+  if (p4est->data_size > 0) {
+    p4est->user_data_pool = sc_mempool_new (p4est->data_size);
+  }
+  else {
+    p4est->user_data_pool = NULL;
+  }
+  p4est->quadrant_pool = sc_mempool_new (sizeof (p4est_quadrant_t));
+
+  P4EST_GLOBAL_PRODUCTIONF ("New " P4EST_STRING
+                            " with %lld trees on %d processors\n",
+                            (long long) num_trees, num_procs);
+
+  /* allocate trees */
+  p4est->trees = sc_array_new (sizeof (p4est_tree_t));
+  sc_array_resize (p4est->trees, num_trees);
+  for (jt = 0; jt < num_trees; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    sc_array_init (&tree->quadrants, sizeof (p4est_quadrant_t));
+    P4EST_QUADRANT_INIT (&tree->first_desc);
+    P4EST_QUADRANT_INIT (&tree->last_desc);
+    tree->quadrants_offset = 0;
+    for (i = 0; i <= P4EST_QMAXLEVEL; ++i) {
+      tree->quadrants_per_level[i] = 0;
+    }
+    for (; i <= P4EST_MAXLEVEL; ++i) {
+      tree->quadrants_per_level[i] = -1;
+    }
+    tree->maxlevel = 0;
+  }
+  p4est->local_num_quadrants = 0;
+  p4est->global_num_quadrants = 0;
+
+  /* create point based partition: each process begins at its first point
+   * except for the first process that always begins at the origin */
+  P4EST_QUADRANT_INIT (&f);
+  p4est->global_first_position =
+    P4EST_ALLOC_ZERO (p4est_quadrant_t, num_procs + 1);
+  if (rank == 0) {
+    first_tree = p4est->first_local_tree = 0;
+    p4est_quadrant_set_morton (&f, maxlevel, 0);
+    first_quad = &f;
+  }
+  else if (num_points == 0) {
+    P4EST_VERBOSE ("Empty processor");
+    first_tree = p4est->first_local_tree = -1;
+    first_quad = NULL;
+  }
+  else {
+    first_quad = p4est_quadrant_array_index (points, 0);
+    first_tree = p4est->first_local_tree = first_quad->p.which_tree;
+  }
+  last_tree = p4est->last_local_tree = -2;
+  p4est_comm_global_partition (p4est, first_quad);
+  first_quad = p4est->global_first_position + rank;
+  next_quad = p4est->global_first_position + (rank + 1);
+  next_tree = next_quad->p.which_tree;
+  if (first_tree >= 0 &&
+      p4est_quadrant_is_equal (first_quad, next_quad) &&
+      first_quad->p.which_tree == next_quad->p.which_tree) {
+    /* the first process is empty if its range is empty */
+    P4EST_ASSERT (rank == 0 && num_points == 0);
+    first_tree = p4est->first_local_tree = -1;
+  }
+  if (first_tree >= 0) {
+    if (next_quad->x == 0 && next_quad->y == 0
+#ifdef P4_TO_P8
+        && next_quad->z == 0
+#endif
+      ) {
+      last_tree = p4est->last_local_tree = next_tree - 1;
+    }
+    else {
+      last_tree = p4est->last_local_tree = next_tree;
+    }
+    P4EST_ASSERT (first_tree <= last_tree);
+  }
+
+  /* fill the local trees */
+  P4EST_QUADRANT_INIT (&a);
+  P4EST_QUADRANT_INIT (&b);
+  P4EST_QUADRANT_INIT (&c);
+  P4EST_QUADRANT_INIT (&l);
+  n = *next_quad;
+  n.level = (int8_t) maxlevel;
+  sc_array_init (&gap.quadrants, sizeof (p4est_quadrant_t));
+  for (i = 0; i <= P4EST_QMAXLEVEL; ++i) {
+    gap.quadrants_per_level[i] = 0;
+  }
+  gap.maxlevel = 0;
+  zz = 0;
+  for (jt = first_tree; jt <= last_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+
+    /* find the points in this tree */
+    for (zend = zz; zend < num_points; ++zend) {
+      quad = p4est_quadrant_array_index (points, zend);
+      if (quad->p.which_tree != jt) {
+        break;
+      }
+    }
+    limit = (zz < zend) ? p4est_quadrant_array_index (points, zz) :
+      (jt == next_tree) ? &n : NULL;
+
+    /* determine the first local quadrant of this tree */
+    if (jt == first_tree) {
+      a = *first_quad;
+      a.level = (int8_t) maxlevel;
+    }
+    else {
+      p4est_quadrant_set_morton (&a, maxlevel, 0);
+    }
+    P4EST_ASSERT (limit == NULL || p4est_quadrant_compare (&a, limit) <= 0);
+    if (limit != NULL && zz < zend && p4est_quadrant_is_equal (&a, limit)) {
+      ++zz;
+    }
+    else {
+      /* enlarge it as long as it does not reach the first point */
+      while (p4est_quadrant_child_id (&a) == 0 && a.level > 0) {
+        p4est_quadrant_parent (&a, &c);
+        if (limit != NULL) {
+          p4est_quadrant_last_descendant (&c, &l, maxlevel);
+          if (p4est_quadrant_compare (&l, limit) >= 0) {
+            break;
+          }
+        }
+        a = c;
+      }
+    }
+    quad = p4est_quadrant_array_push (&tree->quadrants);
+    *quad = a;
+    p4est_quadrant_init_data (p4est, jt, quad, init_fn);
+    tree->maxlevel = a.level;
+    ++tree->quadrants_per_level[a.level];
+    p4est_quadrant_first_descendant (&a, &tree->first_desc, P4EST_QMAXLEVEL);
+
+    /* fill the gaps between successive points */
+    prev = a;
+    for (; zz < zend; ++zz) {
+      quad = p4est_quadrant_array_index (points, zz);
+      p4est_points_fill (p4est, jt, tree, &gap, &prev, quad, 1, init_fn);
+      prev = *quad;
+    }
+
+    /* complete the tree up to its end or up to the next process */
+    if (jt < next_tree) {
+      p4est_quadrant_last_descendant (&prev, &l, maxlevel);
+      p4est_quadrant_set_morton (&b, 0, 0);
+      p4est_quadrant_last_descendant (&b, &b, maxlevel);
+      if (!p4est_quadrant_is_equal (&l, &b)) {
+        for (c = b; p4est_quadrant_child_id (&c) == P4EST_CHILDREN - 1; b = c) {
+          p4est_quadrant_parent (&c, &c);
+          p4est_quadrant_first_descendant (&c, &f, maxlevel);
+          if (p4est_quadrant_compare (&l, &f) >= 0) {
+            break;
+          }
+        }
+        p4est_points_fill (p4est, jt, tree, &gap, &prev, &b, 1, init_fn);
+      }
+    }
+    else {
+      p4est_points_fill (p4est, jt, tree, &gap, &prev, &n, 0, init_fn);
+    }
+    quad = p4est_quadrant_array_index (&tree->quadrants,
+                                       tree->quadrants.elem_count - 1);
+    tree->quadrants_offset = p4est->local_num_quadrants;
+    p4est->local_num_quadrants += tree->quadrants.elem_count;
+    p4est_quadrant_last_descendant (quad, &tree->last_desc, P4EST_QMAXLEVEL);
+    P4EST_ASSERT (p4est_tree_is_complete (tree));
+  }
+  P4EST_ASSERT (zz == num_points);
+  sc_array_reset (&gap.quadrants);
+  if (last_tree >= 0) {
+    for (; jt < num_trees; ++jt) {
+      tree = p4est_tree_array_index (p4est->trees, jt);
+      tree->quadrants_offset = p4est->local_num_quadrants;
+    }
+  }
+
+  /* compute some member variables */
+  p4est->global_first_quadrant = P4EST_ALLOC (p4est_gloidx_t, num_procs + 1);
+  p4est_comm_count_quadrants (p4est);
+
+  /* print more statistics */
+  P4EST_VERBOSEF ("total local quadrants %lld from %lld unique points\n",
+                  (long long) p4est->local_num_quadrants,
+                  (long long) num_points);
+
+  P4EST_ASSERT (p4est_is_valid (p4est));
+  p4est_log_indent_pop ();
+  P4EST_GLOBAL_PRODUCTIONF ("Done " P4EST_STRING
+                            "_new_points_bottomup with %lld total quadrants\n",
+                            (long long) p4est->global_num_quadrants);
+
+  return p4est;
+}
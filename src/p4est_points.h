@@ -70,6 +70,46 @@ p4est_t            *p4est_new_points (sc_MPI_Comm mpicomm,
                                       size_t data_size, p4est_init_t init_fn,
                                       void *user_pointer);
 
+/** Create a new forest bottom-up from a distributed set of points.
+ * Every point is replaced by the quadrant of level \a maxlevel containing it
+ * and duplicates are removed.  These quadrants are sorted by a parallel
+ * sample sort and the gaps between successive quadrants are filled with the
+ * coarsest quadrants possible.  Away from process boundaries, this yields the
+ * same refinement as p4est_new_points with \a max_points 0, but in time
+ * linear in the number of quadrants and without the parallel sort in sc.
+ * The forest is partitioned such that each process owns the quadrants
+ * that it holds after the sort.
+ *
+ * \param [in] mpicomm       A valid MPI communicator.
+ * \param [in] connectivity  This is the connectivity information that
+ *                           the forest is built with.  Note the p4est
+ *                           does not take ownership of the memory.
+ * \param [in] maxlevel      Level of the quadrants containing the points.
+ * \param [in,out] points    Array of type p4est_quadrant_t.  On input an
+ *                           unsorted collection of clamped quadrant nodes with
+ *                           the tree id stored in p.which_tree.  On output
+ *                           the sorted, unique quadrants of level \a maxlevel
+ *                           that contain the points local to this process.
+ * \param [in] data_size     This is the size of data for each quadrant which
+ *                           can be zero.  Then user_data_pool is set to NULL.
+ * \param [in] init_fn       Callback function to initialize the user_data
+ *                           which is already allocated automatically.
+ * \param [in] user_pointer  Assign to the user_pointer member of the p4est
+ *                           before init_fn is called the first time.
+ *
+ * \return This returns a valid forest.
+ *
+ * \note The connectivity structure must not be destroyed
+ *       during the lifetime of this forest.
+ */
+p4est_t            *p4est_new_points_bottomup (sc_MPI_Comm mpicomm,
+                                               p4est_connectivity_t *
+                                               connectivity, int maxlevel,
+                                               sc_array_t * points,
+                                               size_t data_size,
+                                               p4est_init_t init_fn,
+                                               void *user_pointer);
+
 SC_EXTERN_C_END;
 
 #endif /* !P4EST_POINTS_H */
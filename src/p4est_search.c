@@ -31,6 +31,9 @@
 #include <p8est_communication.h>
 #include <p8est_search.h>
 #endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 ssize_t
 p4est_find_lower_bound (sc_array_t * array,
@@ -460,10 +463,74 @@ typedef struct p4est_local_recursion
   int                 call_post;        /**< Boolean to call quadrant twice. */
   p4est_search_local_t quadrant_fn;     /**< The quadrant callback. */
   p4est_search_local_t point_fn;        /**< The point callback. */
+  p4est_search_local_batch_t batch_fn;  /**< The batched point callback. */
   sc_array_t         *points;           /**< Array of points to search. */
+  size_t             *indices;          /**< Permutation of the points. */
+  uint8_t            *matches;          /**< Batch match flags. */
 }
 p4est_local_recursion_t;
 
+/** Determine the leaf situation of a quadrant in the local recursion.
+ * \param [in] rec          The recursion context.
+ * \param [in,out] quadrant Quadrant equal to or an ancestor of all quadrants
+ *                          in the array.  For a non-leaf it is coarsened
+ *                          to the nearest common ancestor of the array.
+ * \param [in] quadrants    Nonempty array view into a local tree.
+ * \param [out] local_num   For a leaf, its process-local index, else -1.
+ * \return                  The quadrant to pass to the callbacks:  the leaf
+ *                          in forest storage if there is only one, else
+ *                          \b quadrant.
+ */
+static p4est_quadrant_t *
+p4est_local_recursion_enter (const p4est_local_recursion_t * rec,
+                             p4est_quadrant_t * quadrant,
+                             sc_array_t * quadrants,
+                             p4est_locidx_t * local_num)
+{
+  int                 level;
+  p4est_quadrant_t   *q, *lq;
+
+  P4EST_ASSERT (quadrants->elem_count > 0);
+
+  q = p4est_quadrant_array_index (quadrants, 0);
+  if (quadrants->elem_count > 1) {
+    P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, q));
+    *local_num = -1;
+    lq = p4est_quadrant_array_index (quadrants, quadrants->elem_count - 1);
+    P4EST_ASSERT (!p4est_quadrant_is_equal (q, lq) &&
+                  p4est_quadrant_is_ancestor (quadrant, lq));
+
+    /* skip unnecessary intermediate levels if possible */
+    level = (int) quadrant->level;
+    if (p4est_quadrant_ancestor_id (q, level + 1) ==
+        p4est_quadrant_ancestor_id (lq, level + 1)) {
+      p4est_nearest_common_ancestor (q, lq, quadrant);
+      P4EST_ASSERT (level < (int) quadrant->level);
+      P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, q));
+      P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, lq));
+    }
+    return quadrant;
+  }
+  else {
+    p4est_locidx_t      offset;
+    p4est_tree_t       *tree;
+
+    P4EST_ASSERT (p4est_quadrant_is_equal (quadrant, q) ||
+                  p4est_quadrant_is_ancestor (quadrant, q));
+
+    /* determine offset of quadrant in local forest */
+    tree = p4est_tree_array_index (rec->p4est->trees, rec->which_tree);
+    offset = (p4est_locidx_t) ((quadrants->array - tree->quadrants.array)
+                               / sizeof (p4est_quadrant_t));
+    P4EST_ASSERT (offset >= 0 &&
+                  (size_t) offset < tree->quadrants.elem_count);
+    *local_num = tree->quadrants_offset + offset;
+
+    /* skip unnecessary intermediate levels if possible */
+    return q;
+  }
+}
+
 static void
 p4est_local_recursion (const p4est_local_recursion_t * rec,
                        p4est_quadrant_t * quadrant,
@@ -471,12 +538,11 @@ p4est_local_recursion (const p4est_local_recursion_t * rec,
 {
   int                 i;
   int                 is_leaf, is_match;
-  int                 level;
   size_t              qcount, act_count;
   size_t              zz, *pz, *qz;
   size_t              split[P4EST_CHILDREN + 1];
   p4est_locidx_t      local_num;
-  p4est_quadrant_t   *q, *lq, child;
+  p4est_quadrant_t    child;
   sc_array_t          child_quadrants, child_actives, *chact;
 
   /*
@@ -504,44 +570,9 @@ p4est_local_recursion (const p4est_local_recursion_t * rec,
     return;
 
   /* determine leaf situation */
-  q = p4est_quadrant_array_index (quadrants, 0);
-  if (qcount > 1) {
-    P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, q));
-    is_leaf = 0;
-    local_num = -1;
-    lq = p4est_quadrant_array_index (quadrants, quadrants->elem_count - 1);
-    P4EST_ASSERT (!p4est_quadrant_is_equal (q, lq) &&
-                  p4est_quadrant_is_ancestor (quadrant, lq));
-
-    /* skip unnecessary intermediate levels if possible */
-    level = (int) quadrant->level;
-    if (p4est_quadrant_ancestor_id (q, level + 1) ==
-        p4est_quadrant_ancestor_id (lq, level + 1)) {
-      p4est_nearest_common_ancestor (q, lq, quadrant);
-      P4EST_ASSERT (level < (int) quadrant->level);
-      P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, q));
-      P4EST_ASSERT (p4est_quadrant_is_ancestor (quadrant, lq));
-    }
-  }
-  else {
-    p4est_locidx_t      offset;
-    p4est_tree_t       *tree;
-
-    P4EST_ASSERT (p4est_quadrant_is_equal (quadrant, q) ||
-                  p4est_quadrant_is_ancestor (quadrant, q));
-    is_leaf = 1;
-
-    /* determine offset of quadrant in local forest */
-    tree = p4est_tree_array_index (rec->p4est->trees, rec->which_tree);
-    offset = (p4est_locidx_t) ((quadrants->array - tree->quadrants.array)
-                               / sizeof (p4est_quadrant_t));
-    P4EST_ASSERT (offset >= 0 &&
-                  (size_t) offset < tree->quadrants.elem_count);
-    local_num = tree->quadrants_offset + offset;
-
-    /* skip unnecessary intermediate levels if possible */
-    quadrant = q;
-  }
+  quadrant = p4est_local_recursion_enter (rec, quadrant, quadrants,
+                                          &local_num);
+  is_leaf = local_num >= 0;
 
   /* execute pre-quadrant callback if present, which may stop the recursion */
   if (rec->quadrant_fn != NULL &&
@@ -607,6 +638,94 @@ p4est_local_recursion (const p4est_local_recursion_t * rec,
   }
 }
 
+/** Recursion for \ref p4est_search_local_batch.
+ * Instead of an array of active points, each level works on a range of the
+ * permutation array in the context, where the matching points of a quadrant
+ * are moved to the front of its range and passed on to its children.
+ */
+static void
+p4est_local_batch_recursion (const p4est_local_recursion_t * rec,
+                             p4est_quadrant_t * quadrant,
+                             sc_array_t * quadrants, size_t begin, size_t end)
+{
+  int                 i;
+  int                 is_leaf;
+  size_t              zz, num_active, num_match, swap;
+  size_t              split[P4EST_CHILDREN + 1];
+  size_t             *indices;
+  uint8_t            *matches;
+  p4est_locidx_t      local_num;
+  p4est_quadrant_t    child;
+  sc_array_t          child_quadrants;
+
+  P4EST_ASSERT (rec != NULL && rec->batch_fn != NULL);
+  P4EST_ASSERT (quadrant != NULL && quadrants != NULL);
+  P4EST_ASSERT (begin <= end && end <= rec->points->elem_count);
+
+  /* return if there are no quadrants or active points */
+  if (quadrants->elem_count == 0 || begin == end) {
+    return;
+  }
+
+  /* determine leaf situation */
+  quadrant = p4est_local_recursion_enter (rec, quadrant, quadrants,
+                                          &local_num);
+  is_leaf = local_num >= 0;
+
+  /* execute pre-quadrant callback if present, which may stop the recursion */
+  if (rec->quadrant_fn != NULL &&
+      !rec->quadrant_fn (rec->p4est, rec->which_tree,
+                         quadrant, local_num, NULL)) {
+    return;
+  }
+
+  /* query callback for all active points at once */
+  num_active = end - begin;
+  indices = rec->indices + begin;
+  matches = rec->matches + begin;
+  rec->batch_fn (rec->p4est, rec->which_tree, quadrant, local_num,
+                 rec->points, indices, num_active, matches);
+
+  /* move the matching points to the front of the range */
+  num_match = 0;
+  if (!is_leaf) {
+    for (zz = 0; zz < num_active; ++zz) {
+      if (matches[zz]) {
+        swap = indices[num_match];
+        indices[num_match++] = indices[zz];
+        indices[zz] = swap;
+      }
+    }
+  }
+
+  /* call post-quadrant callback, which may also terminate the recursion */
+  if (rec->call_post && rec->quadrant_fn != NULL &&
+      !rec->quadrant_fn (rec->p4est, rec->which_tree,
+                         quadrant, local_num, NULL)) {
+    return;
+  }
+  if (num_match == 0) {
+    return;
+  }
+
+  /* leaf situation has returned above */
+  P4EST_ASSERT (!is_leaf);
+  P4EST_ASSERT (quadrant->level < P4EST_QMAXLEVEL);
+
+  /* split quadrant array and run recursion */
+  p4est_split_array (quadrants, (int) quadrant->level, split);
+  for (i = 0; i < P4EST_CHILDREN; ++i) {
+    p4est_quadrant_child (quadrant, &child, i);
+    if (split[i] < split[i + 1]) {
+      sc_array_init_view (&child_quadrants, quadrants,
+                          split[i], split[i + 1] - split[i]);
+      p4est_local_batch_recursion (rec, &child, &child_quadrants,
+                                   begin, begin + num_match);
+      sc_array_reset (&child_quadrants);
+    }
+  }
+}
+
 void
 p4est_search_local (p4est_t * p4est,
                     int call_post, p4est_search_local_t quadrant_fn,
@@ -634,7 +753,10 @@ p4est_search_local (p4est_t * p4est,
   rec->call_post = call_post;
   rec->quadrant_fn = quadrant_fn;
   rec->point_fn = point_fn;
+  rec->batch_fn = NULL;
   rec->points = points;
+  rec->indices = NULL;
+  rec->matches = NULL;
   for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
     rec->which_tree = jt;
 
@@ -659,6 +781,263 @@ p4est_search (p4est_t * p4est, p4est_search_query_t quadrant_fn,
   p4est_search_local (p4est, 0, quadrant_fn, point_fn, points);
 }
 
+void
+p4est_search_local_batch (p4est_t * p4est, int call_post,
+                          p4est_search_local_t quadrant_fn,
+                          p4est_search_local_batch_t point_fn,
+                          sc_array_t * points)
+{
+  size_t              zz, num_points;
+  p4est_topidx_t      jt;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t    root;
+  p4est_quadrant_t   *f, *l;
+  p4est_local_recursion_t srec, *rec = &srec;
+  sc_array_t         *tquadrants;
+
+  /* correct call convention? */
+  P4EST_ASSERT (p4est != NULL);
+  P4EST_ASSERT (points == NULL || point_fn != NULL);
+
+  /* without points there is nothing to batch */
+  if (points == NULL) {
+    p4est_search_local (p4est, call_post, quadrant_fn, NULL, NULL);
+    return;
+  }
+
+  /* the recursion stops immediately for an empty array of points */
+  num_points = points->elem_count;
+  if (num_points == 0) {
+    return;
+  }
+
+  /* set recursion context */
+  rec->p4est = p4est;
+  rec->which_tree = -1;
+  rec->call_post = call_post;
+  rec->quadrant_fn = quadrant_fn;
+  rec->point_fn = NULL;
+  rec->batch_fn = point_fn;
+  rec->points = points;
+  rec->indices = P4EST_ALLOC (size_t, num_points);
+  rec->matches = P4EST_ALLOC (uint8_t, num_points);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    rec->which_tree = jt;
+
+    /* grab complete tree quadrant array */
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    tquadrants = &tree->quadrants;
+
+    /* find the smallest quadrant that contains all of this tree */
+    f = p4est_quadrant_array_index (tquadrants, 0);
+    l = p4est_quadrant_array_index (tquadrants, tquadrants->elem_count - 1);
+    p4est_nearest_common_ancestor (f, l, &root);
+
+    /* every tree starts with all points in their original order */
+    for (zz = 0; zz < num_points; ++zz) {
+      rec->indices[zz] = zz;
+    }
+
+    /* perform top-down search */
+    p4est_local_batch_recursion (rec, &root, tquadrants, 0, num_points);
+  }
+  P4EST_FREE (rec->indices);
+  P4EST_FREE (rec->matches);
+}
+
+/** Sort key of a point to be located in the forest. */
+typedef struct p4est_locate_key
+{
+  uint64_t            key;      /**< Morton index at P4EST_QMAXLEVEL. */
+  p4est_topidx_t      which_tree;       /**< Tree of the point. */
+  size_t              index;    /**< Original position of the point. */
+}
+p4est_locate_key_t;
+
+/** Return the sort key of a quadrant. */
+static              uint64_t
+p4est_locate_quadrant_key (const p4est_quadrant_t * q)
+{
+  return p4est_quadrant_linear_id (q, (int) q->level) <<
+    (P4EST_DIM * (P4EST_QMAXLEVEL - (int) q->level));
+}
+
+/** Compare a point key with a quadrant position of level P4EST_QMAXLEVEL.
+ * \return  Negative, zero or positive, like a qsort comparison.
+ */
+static int
+p4est_locate_compare (const p4est_locate_key_t * k,
+                      p4est_topidx_t which_tree, uint64_t key)
+{
+  if (k->which_tree != which_tree) {
+    return k->which_tree < which_tree ? -1 : 1;
+  }
+  return k->key < key ? -1 : k->key > key ? 1 : 0;
+}
+
+/** Sort point keys by tree and Morton index with a least significant digit
+ * radix sort.  Digits that are the same for all keys are skipped.
+ * \param [in,out] keys     On output points to the sorted keys.
+ * \param [in,out] temp     Scratch space of the same size.
+ * \param [in] num_keys     Number of keys in either array.
+ */
+static void
+p4est_locate_radix_sort (p4est_locate_key_t ** keys,
+                         p4est_locate_key_t ** temp, size_t num_keys)
+{
+  int                 pass, digit;
+  size_t              zz, sum, count[256];
+  uint64_t            value;
+  p4est_locate_key_t *in, *out, *swap;
+
+  in = *keys;
+  out = *temp;
+  for (pass = 0; pass < 12; ++pass) {
+    /* the first eight bytes hold the Morton index, the last four the tree */
+    memset (count, 0, sizeof (count));
+    for (zz = 0; zz < num_keys; ++zz) {
+      value = pass < 8 ? in[zz].key : (uint64_t) in[zz].which_tree;
+      ++count[(value >> (8 * (pass % 8))) & 0xff];
+    }
+    for (digit = 0; digit < 256; ++digit) {
+      if (count[digit] == num_keys) {
+        break;
+      }
+    }
+    if (digit < 256) {
+      /* all keys share this digit */
+      continue;
+    }
+    for (sum = 0, digit = 0; digit < 256; ++digit) {
+      zz = count[digit];
+      count[digit] = sum;
+      sum += zz;
+    }
+    for (zz = 0; zz < num_keys; ++zz) {
+      value = pass < 8 ? in[zz].key : (uint64_t) in[zz].which_tree;
+      out[count[(value >> (8 * (pass % 8))) & 0xff]++] = in[zz];
+    }
+    swap = in;
+    in = out;
+    out = swap;
+  }
+  *keys = in;
+  *temp = out;
+}
+
+void
+p4est_locate_points (p4est_t * p4est, size_t num_points,
+                     const p4est_topidx_t * which_tree,
+                     double *const coords[],
+                     p4est_locidx_t * local_num, int *owner)
+{
+  const p4est_qcoord_t qlast =
+    P4EST_ROOT_LEN - P4EST_QUADRANT_LEN (P4EST_QMAXLEVEL);
+  const p4est_qcoord_t qmask = ~(P4EST_QUADRANT_LEN (P4EST_QMAXLEVEL) - 1);
+  const int           num_procs = p4est->mpisize;
+  const int           rank = p4est->mpirank;
+  int                 j, p;
+  size_t              zz, lz, lcount;
+  uint64_t            lkey, lend;
+  p4est_qcoord_t      qc[P4EST_DIM];
+  p4est_topidx_t      jt;
+  p4est_locidx_t      offset;
+  p4est_quadrant_t    a, *lq;
+  p4est_tree_t       *tree;
+  p4est_locate_key_t *keys, *temp, *k;
+  const p4est_quadrant_t *gfp = p4est->global_first_position;
+
+  P4EST_ASSERT (p4est != NULL);
+  P4EST_ASSERT (num_points == 0 || (which_tree != NULL && coords != NULL));
+  P4EST_ASSERT (local_num != NULL || owner != NULL);
+
+  if (num_points == 0) {
+    return;
+  }
+
+  /* compute the Morton index of every point */
+  keys = P4EST_ALLOC (p4est_locate_key_t, num_points);
+  temp = P4EST_ALLOC (p4est_locate_key_t, num_points);
+  P4EST_QUADRANT_INIT (&a);
+  a.level = P4EST_QMAXLEVEL;
+  for (zz = 0; zz < num_points; ++zz) {
+    P4EST_ASSERT (0 <= which_tree[zz] &&
+                  which_tree[zz] < p4est->connectivity->num_trees);
+    for (j = 0; j < P4EST_DIM; ++j) {
+      P4EST_ASSERT (0. <= coords[j][zz] && coords[j][zz] <= 1.);
+      /* leaves are half open, only the tree boundary at 1 is clamped */
+      qc[j] = (p4est_qcoord_t) (coords[j][zz] * P4EST_ROOT_LEN);
+      qc[j] = SC_MAX (0, SC_MIN (qlast, qc[j] & qmask));
+    }
+    a.x = qc[0];
+    a.y = qc[1];
+#ifdef P4_TO_P8
+    a.z = qc[2];
+#endif
+    k = keys + zz;
+    k->key = p4est_quadrant_linear_id (&a, P4EST_QMAXLEVEL);
+    k->which_tree = which_tree[zz];
+    k->index = zz;
+  }
+  p4est_locate_radix_sort (&keys, &temp, num_points);
+  P4EST_FREE (temp);
+
+  /* merge the sorted points with the partition and the local leaves */
+  p = 0;
+  jt = p4est->first_local_tree;
+  tree = NULL;
+  lz = lcount = 0;
+  lkey = lend = 0;
+  lq = NULL;
+  for (zz = 0; zz < num_points; ++zz) {
+    k = keys + zz;
+
+    /* find the last process that begins at or before the point */
+    while (p4est_locate_compare (k, gfp[p + 1].p.which_tree,
+                                 p4est_quadrant_linear_id
+                                 (&gfp[p + 1], P4EST_QMAXLEVEL)) >= 0) {
+      ++p;
+      P4EST_ASSERT (p < num_procs);
+    }
+    if (owner != NULL) {
+      owner[k->index] = p;
+    }
+    if (local_num == NULL) {
+      continue;
+    }
+    if (p != rank) {
+      local_num[k->index] = -1;
+      continue;
+    }
+
+    /* advance through the local leaves to the one containing the point */
+    P4EST_ASSERT (p4est->first_local_tree <= k->which_tree &&
+                  k->which_tree <= p4est->last_local_tree);
+    while (tree == NULL || jt < k->which_tree ||
+           (lq != NULL && lend < k->key)) {
+      if (tree == NULL || jt < k->which_tree) {
+        /* enter the tree of the point */
+        jt = k->which_tree;
+        tree = p4est_tree_array_index (p4est->trees, jt);
+        lcount = tree->quadrants.elem_count;
+        lz = 0;
+      }
+      else {
+        ++lz;
+      }
+      P4EST_ASSERT (lz < lcount);
+      lq = p4est_quadrant_array_index (&tree->quadrants, lz);
+      lkey = p4est_locate_quadrant_key (lq);
+      lend = lkey + ((uint64_t) 1 <<
+                     (P4EST_DIM * (P4EST_QMAXLEVEL - (int) lq->level))) - 1;
+    }
+    P4EST_ASSERT (lkey <= k->key && k->key <= lend);
+    offset = tree->quadrants_offset;
+    local_num[k->index] = offset + (p4est_locidx_t) lz;
+  }
+  P4EST_FREE (keys);
+}
+
 static              size_t
 p4est_traverse_array_index (sc_array_t * array, p4est_topidx_t tt)
 {
@@ -1066,9 +1445,24 @@ typedef struct p4est_all_recursion
   sc_array_t         *points;           /**< Array of points to search. */
   sc_array_t         *position_array;   /**< Array view of p4est's
                                              global_first_position */
+  int                 split_level;      /**< Level to defer branches at. */
+  sc_array_t         *tasks;            /**< If not NULL, collect branches
+                                             at split_level as tasks. */
 }
 p4est_all_recursion_t;
 
+/** A branch of the forest deferred for a threaded search. */
+typedef struct p4est_all_task
+{
+  p4est_quadrant_t    quadrant;         /**< Root of the branch. */
+  int                 pfirst;           /**< First process in branch. */
+  int                 plast;            /**< Last process in branch. */
+  int                 is_local;         /**< Boolean: quadrants is valid. */
+  sc_array_t          quadrants;        /**< View of local quadrants. */
+  sc_array_t         *actives;          /**< Active points or NULL. */
+}
+p4est_all_task_t;
+
 static void
 p4est_all_recursion (const p4est_all_recursion_t * rec,
                      p4est_quadrant_t * quadrant, int pfirst, int plast,
@@ -1083,6 +1477,7 @@ p4est_all_recursion (const p4est_all_recursion_t * rec,
   size_t              split[P4EST_CHILDREN + 1];
   p4est_locidx_t      local_num;
   p4est_quadrant_t   *q, child;
+  p4est_all_task_t   *task;
   sc_array_t          pview, offsets;
   sc_array_t          child_quadrants, *chpass, child_actives, *chact;
 
@@ -1109,6 +1504,23 @@ p4est_all_recursion (const p4est_all_recursion_t * rec,
   if (rec->points != NULL && act_count == 0)
     return;
 
+  /* defer this branch to be searched by any thread */
+  if (rec->tasks != NULL && (int) quadrant->level == rec->split_level) {
+    task = (p4est_all_task_t *) sc_array_push (rec->tasks);
+    task->quadrant = *quadrant;
+    task->pfirst = pfirst;
+    task->plast = plast;
+    if ((task->is_local = (quadrants != NULL))) {
+      task->quadrants = *quadrants;
+    }
+    task->actives = NULL;
+    if (actives != NULL) {
+      task->actives = sc_array_new (sizeof (size_t));
+      sc_array_copy (task->actives, actives);
+    }
+    return;
+  }
+
   /* check out local quadrant portion */
   qcount = 0;
   is_leaf = 0;
@@ -1293,25 +1705,85 @@ p4est_all_recursion (const p4est_all_recursion_t * rec,
   sc_array_reset (&pview);
 }
 
-void
-p4est_search_all (p4est_t * p4est,
-                  int call_post, p4est_search_all_t quadrant_fn,
-                  p4est_search_all_t point_fn, sc_array_t * points)
+/** Execute the deferred branches of a threaded search.
+ * \param [in] rec          Recursion context of the calling thread.
+ * \param [in] num_threads  Number of threads to use.
+ * \param [in] thread_users If not NULL, user pointers by thread number.
+ */
+static void
+p4est_all_run_tasks (const p4est_all_recursion_t * rec, int num_threads,
+                     void **thread_users)
+{
+  const long          num_tasks = (long) rec->tasks->elem_count;
+
+  P4EST_ASSERT (num_threads >= 1);
+#ifdef _OPENMP
+#pragma omp parallel num_threads (num_threads)
+#endif
+  {
+    long                lt;
+    int                 tid;
+    p4est_t             tforest;
+    p4est_all_recursion_t trec;
+    p4est_all_task_t   *task;
+
+    /* every thread sees a private copy of the forest's user pointer */
+#ifdef _OPENMP
+    tid = omp_get_thread_num ();
+#else
+    tid = 0;
+#endif
+    tforest = *rec->p4est;
+    if (thread_users != NULL) {
+      tforest.user_pointer = thread_users[tid];
+    }
+    trec = *rec;
+    trec.p4est = &tforest;
+    trec.tasks = NULL;
+
+    /* idle threads grab the next branch */
+#ifdef _OPENMP
+#pragma omp for schedule (dynamic, 1)
+#endif
+    for (lt = 0; lt < num_tasks; ++lt) {
+      task = (p4est_all_task_t *) sc_array_index_long (rec->tasks, lt);
+      trec.which_tree = task->quadrant.p.which_tree;
+      p4est_all_recursion (&trec, &task->quadrant, task->pfirst, task->plast,
+                           task->is_local ? &task->quadrants : NULL,
+                           task->actives);
+    }
+  }
+}
+
+/** Top-down search of the forest, optionally deferring branches to threads.
+ * \param [in] split_level  If negative, search serially.  Otherwise, the
+ *                          branches of this level are searched by threads.
+ * For the remaining parameters see \ref p4est_search_all_threaded.
+ */
+static void
+p4est_all_search (p4est_t * p4est, int call_post,
+                  p4est_search_all_t quadrant_fn,
+                  p4est_search_all_t point_fn, sc_array_t * points,
+                  int split_level, int num_threads, void **thread_users)
 {
   const int           num_procs = p4est->mpisize;
   const p4est_topidx_t num_trees = p4est->connectivity->num_trees;
   int                 pfirst, plast, pnext;
+  size_t              zz;
   sc_array_t          position_array;
   sc_array_t         *tree_offsets;
   sc_array_t         *tquadrants;
   p4est_topidx_t      tt;
   p4est_tree_t       *tree;
   p4est_quadrant_t    root;
+  p4est_t             mforest;
+  p4est_all_task_t   *task;
   p4est_all_recursion_t srec, *rec = &srec;
 
   /* we do nothing if there is nothing to be done */
   P4EST_ASSERT (p4est != NULL);
   P4EST_ASSERT (points == NULL || point_fn != NULL);
+  P4EST_ASSERT (split_level <= P4EST_QMAXLEVEL);
   if (quadrant_fn == NULL && points == NULL) {
     return;
   }
@@ -1342,6 +1814,17 @@ p4est_search_all (p4est_t * p4est,
   rec->point_fn = point_fn;
   rec->points = points;
   rec->position_array = &position_array;
+  rec->split_level = split_level;
+  rec->tasks = NULL;
+  if (split_level >= 0) {
+    /* the branches above the split level are searched by the first thread */
+    rec->tasks = sc_array_new (sizeof (p4est_all_task_t));
+    mforest = *p4est;
+    if (thread_users != NULL) {
+      mforest.user_pointer = thread_users[0];
+    }
+    rec->p4est = &mforest;
+  }
   p4est_quadrant_set_morton (&root, 0, 0);
   for (pfirst = 0, tt = 0; tt < num_trees; pfirst = pnext, ++tt) {
     /* pfirst is the first processor indexed for this tree */
@@ -1405,7 +1888,851 @@ p4est_search_all (p4est_t * p4est,
     p4est_all_recursion (rec, &root, pfirst, plast, tquadrants, NULL);
   }
 
+  /* search the deferred branches in parallel */
+  if (rec->tasks != NULL) {
+    p4est_all_run_tasks (rec, num_threads, thread_users);
+    for (zz = 0; zz < rec->tasks->elem_count; ++zz) {
+      task = (p4est_all_task_t *) sc_array_index (rec->tasks, zz);
+      if (task->actives != NULL) {
+        sc_array_destroy (task->actives);
+      }
+    }
+    sc_array_destroy (rec->tasks);
+  }
+
   /* cleanup */
   sc_array_destroy (tree_offsets);
   sc_array_reset (&position_array);
 }
+
+void
+p4est_search_all (p4est_t * p4est,
+                  int call_post, p4est_search_all_t quadrant_fn,
+                  p4est_search_all_t point_fn, sc_array_t * points)
+{
+  p4est_all_search (p4est, call_post, quadrant_fn, point_fn, points,
+                    -1, 1, NULL);
+}
+
+void
+p4est_search_all_threaded (p4est_t * p4est, int call_post,
+                           p4est_search_all_t quadrant_fn,
+                           p4est_search_all_t point_fn, sc_array_t * points,
+                           int split_level, int num_threads,
+                           void **thread_users)
+{
+  P4EST_ASSERT (0 <= split_level && split_level <= P4EST_QMAXLEVEL);
+  if (num_threads <= 0) {
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads ();
+#else
+    num_threads = 1;
+#endif
+  }
+  p4est_all_search (p4est, call_post, quadrant_fn, point_fn, points,
+                    split_level, num_threads, thread_users);
+}
+
+/** Shared context of the callbacks of \ref p4est_search_migrate. */
+typedef struct p4est_migrate_context
+{
+  p4est_search_migrate_t point_fn;      /**< The user's point callback. */
+}
+p4est_migrate_context_t;
+
+/** Per-record bookkeeping of \ref p4est_search_migrate. */
+typedef struct p4est_migrate_point
+{
+  const p4est_migrate_context_t *ctx;  /**< Shared search context. */
+  void               *record;   /**< The user's record. */
+  int                 owner;    /**< Owner process or -1 if not found. */
+  p4est_locidx_t      local_num;        /**< Local leaf or -1 if not found. */
+}
+p4est_migrate_point_t;
+
+static int
+p4est_migrate_partition_point (p4est_t * p4est, p4est_topidx_t which_tree,
+                               p4est_quadrant_t * quadrant, int pfirst,
+                               int plast, void *point)
+{
+  p4est_migrate_point_t *mp = (p4est_migrate_point_t *) point;
+
+  /* the partition is traversed in order, thus the lowest match wins */
+  if (mp->owner >= 0) {
+    return 0;
+  }
+  if (!mp->ctx->point_fn (p4est, which_tree, quadrant, mp->record)) {
+    return 0;
+  }
+  if (pfirst == plast) {
+    mp->owner = pfirst;
+  }
+  return 1;
+}
+
+static int
+p4est_migrate_local_point (p4est_t * p4est, p4est_topidx_t which_tree,
+                           p4est_quadrant_t * quadrant,
+                           p4est_locidx_t local_num, void *point)
+{
+  p4est_migrate_point_t *mp = (p4est_migrate_point_t *) point;
+
+  /* the first local leaf to match wins */
+  if (mp->local_num >= 0) {
+    return 0;
+  }
+  if (!mp->ctx->point_fn (p4est, which_tree, quadrant, mp->record)) {
+    return 0;
+  }
+  if (local_num >= 0) {
+    mp->local_num = local_num;
+    return 0;
+  }
+  return 1;
+}
+
+/** Wrap contiguous records into an array of search points.
+ * \param [in] ctx          The context that all points refer to.
+ * \param [in] num_records  Number of records in \b record_data.
+ * \param [in] record_data  Contiguous records referenced by the points.
+ * \param [in] record_size  Size of one record in bytes.
+ * \return                  Newly allocated array of p4est_migrate_point_t.
+ */
+static sc_array_t  *
+p4est_migrate_points_new (const p4est_migrate_context_t * ctx,
+                          size_t num_records, char *record_data,
+                          size_t record_size)
+{
+  size_t              zz;
+  sc_array_t         *mpoints;
+  p4est_migrate_point_t *mp;
+
+  mpoints = sc_array_new_count (sizeof (p4est_migrate_point_t), num_records);
+  for (zz = 0; zz < num_records; ++zz) {
+    mp = (p4est_migrate_point_t *) sc_array_index (mpoints, zz);
+    mp->ctx = ctx;
+    mp->record = record_data + zz * record_size;
+    mp->owner = -1;
+    mp->local_num = -1;
+  }
+  return mpoints;
+}
+
+p4est_locidx_t
+p4est_search_migrate (p4est_t * p4est, p4est_search_migrate_t point_fn,
+                      sc_array_t * records, sc_array_t * offsets)
+{
+  const int           num_procs = p4est->mpisize;
+  const int           rank = p4est->mpirank;
+  const size_t        esize = records->elem_size;
+  const p4est_locidx_t lnq = p4est->local_num_quadrants;
+  int                 mpiret;
+  int                 p;
+  int                 num_receivers, num_senders;
+  int                 byte_count;
+  int                *receivers, *senders;
+  int                 is_placed;
+  int                *recv_counts;
+  size_t              zz, num_records, num_kept, num_recv;
+  size_t              num_local, local_offset;
+  size_t             *send_offsets, *send_pos, *recv_offsets;
+  char               *send_data, *recv_data;
+  p4est_locidx_t      num_lost, lq;
+  p4est_locidx_t     *qoffsets, *qpos;
+  p4est_migrate_context_t sctx, *ctx = &sctx;
+  p4est_migrate_point_t *mp;
+  sc_array_t         *mpoints;
+  sc_MPI_Request     *send_requests, *recv_requests;
+  sc_MPI_Status       probe_status;
+  sc_MPI_Comm         mpicomm = p4est->mpicomm;
+
+  P4EST_ASSERT (p4est != NULL);
+  P4EST_ASSERT (point_fn != NULL);
+  P4EST_ASSERT (records != NULL && esize > 0);
+  P4EST_ASSERT (offsets == NULL ||
+                offsets->elem_size == sizeof (p4est_locidx_t));
+
+  /* find the owner process of every record in the partition */
+  ctx->point_fn = point_fn;
+  num_records = records->elem_count;
+  mpoints = p4est_migrate_points_new (ctx, num_records, records->array,
+                                      esize);
+  p4est_search_partition (p4est, 0, NULL, p4est_migrate_partition_point,
+                          mpoints);
+
+  /* bucket the records by owner by a stable counting sort */
+  send_offsets = P4EST_ALLOC_ZERO (size_t, num_procs + 1);
+  num_lost = 0;
+  for (zz = 0; zz < num_records; ++zz) {
+    mp = (p4est_migrate_point_t *) sc_array_index (mpoints, zz);
+    if (mp->owner < 0) {
+      ++num_lost;
+      continue;
+    }
+    P4EST_ASSERT (mp->owner < num_procs);
+    ++send_offsets[mp->owner + 1];
+  }
+  for (p = 0; p < num_procs; ++p) {
+    send_offsets[p + 1] += send_offsets[p];
+  }
+  num_kept = send_offsets[num_procs];
+  P4EST_ASSERT (num_kept + (size_t) num_lost == num_records);
+  send_data = P4EST_ALLOC (char, num_kept * esize);
+  send_pos = P4EST_ALLOC (size_t, num_procs);
+  memcpy (send_pos, send_offsets, num_procs * sizeof (size_t));
+  for (zz = 0; zz < num_records; ++zz) {
+    mp = (p4est_migrate_point_t *) sc_array_index (mpoints, zz);
+    if (mp->owner >= 0) {
+      memcpy (send_data + send_pos[mp->owner]++ * esize,
+              mp->record, esize);
+    }
+  }
+  sc_array_destroy (mpoints);
+
+  /* post non-blocking sends to all receivers right away; every receiver
+   * takes exactly one message from each of its senders per call, so the
+   * messages of consecutive calls cannot overtake each other */
+  receivers = P4EST_ALLOC (int, num_procs);
+  senders = P4EST_ALLOC (int, num_procs);
+  send_requests = P4EST_ALLOC (sc_MPI_Request, num_procs);
+  num_receivers = 0;
+  for (p = 0; p < num_procs; ++p) {
+    if (p == rank || send_offsets[p] == send_offsets[p + 1]) {
+      continue;
+    }
+    SC_CHECK_ABORT ((send_offsets[p + 1] - send_offsets[p]) * esize <=
+                    (size_t) INT_MAX, "Migrate message exceeds int range");
+    mpiret = sc_MPI_Isend (send_data + send_offsets[p] * esize,
+                           (int) ((send_offsets[p + 1] - send_offsets[p]) *
+                                  esize), sc_MPI_BYTE, p,
+                           P4EST_COMM_SEARCH_MIGRATE, mpicomm,
+                           send_requests + num_receivers);
+    SC_CHECK_MPI (mpiret);
+    receivers[num_receivers++] = p;
+  }
+
+  /* reverse the sparse communication pattern */
+  mpiret = p4est_comm_notify_nbx (receivers, num_receivers,
+                                  senders, &num_senders, mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_FREE (receivers);
+
+  /* lay out the receive buffer by sender rank with the local records inside */
+  recv_offsets = P4EST_ALLOC (size_t, num_senders);
+  recv_counts = P4EST_ALLOC (int, num_senders);
+  num_local = send_offsets[rank + 1] - send_offsets[rank];
+  local_offset = 0;
+  num_recv = 0;
+  is_placed = 0;
+  for (p = 0; p < num_senders; ++p) {
+    P4EST_ASSERT (senders[p] != rank);
+    P4EST_ASSERT (p == 0 || senders[p - 1] < senders[p]);
+    if (!is_placed && senders[p] > rank) {
+      local_offset = num_recv;
+      num_recv += num_local;
+      is_placed = 1;
+    }
+    mpiret = sc_MPI_Probe (senders[p], P4EST_COMM_SEARCH_MIGRATE,
+                           mpicomm, &probe_status);
+    SC_CHECK_MPI (mpiret);
+    mpiret = sc_MPI_Get_count (&probe_status, sc_MPI_BYTE, &byte_count);
+    SC_CHECK_MPI (mpiret);
+    P4EST_ASSERT (byte_count > 0 && (size_t) byte_count % esize == 0);
+    recv_offsets[p] = num_recv;
+    recv_counts[p] = byte_count;
+    num_recv += (size_t) byte_count / esize;
+  }
+  if (!is_placed) {
+    local_offset = num_recv;
+    num_recv += num_local;
+  }
+
+  /* receive the records and wait for all communication to complete */
+  recv_data = P4EST_ALLOC (char, num_recv * esize);
+  recv_requests = P4EST_ALLOC (sc_MPI_Request, num_senders);
+  for (p = 0; p < num_senders; ++p) {
+    mpiret = sc_MPI_Irecv (recv_data + recv_offsets[p] * esize,
+                           recv_counts[p], sc_MPI_BYTE, senders[p],
+                           P4EST_COMM_SEARCH_MIGRATE, mpicomm,
+                           recv_requests + p);
+    SC_CHECK_MPI (mpiret);
+  }
+  if (num_local > 0) {
+    memcpy (recv_data + local_offset * esize,
+            send_data + send_offsets[rank] * esize, num_local * esize);
+  }
+  mpiret = sc_MPI_Waitall (num_senders, recv_requests, sc_MPI_STATUSES_IGNORE);
+  SC_CHECK_MPI (mpiret);
+  mpiret = sc_MPI_Waitall (num_receivers, send_requests,
+                           sc_MPI_STATUSES_IGNORE);
+  SC_CHECK_MPI (mpiret);
+  P4EST_FREE (recv_requests);
+  P4EST_FREE (send_requests);
+  P4EST_FREE (recv_counts);
+  P4EST_FREE (recv_offsets);
+  P4EST_FREE (senders);
+  P4EST_FREE (send_data);
+  P4EST_FREE (send_offsets);
+
+  /* find the local quadrant of every record received */
+  mpoints = p4est_migrate_points_new (ctx, num_recv, recv_data, esize);
+  p4est_search_local (p4est, 0, NULL, p4est_migrate_local_point, mpoints);
+
+  /* sort the records by local quadrant by a stable counting sort */
+  qoffsets = P4EST_ALLOC_ZERO (p4est_locidx_t, lnq + 1);
+  for (zz = 0; zz < num_recv; ++zz) {
+    mp = (p4est_migrate_point_t *) sc_array_index (mpoints, zz);
+    if (mp->local_num < 0) {
+      /* the callback contradicts its result in the partition search */
+      ++num_lost;
+      continue;
+    }
+    P4EST_ASSERT (mp->local_num < lnq);
+    ++qoffsets[mp->local_num + 1];
+  }
+  for (lq = 0; lq < lnq; ++lq) {
+    qoffsets[lq + 1] += qoffsets[lq];
+  }
+  sc_array_resize (records, (size_t) qoffsets[lnq]);
+  qpos = P4EST_ALLOC (p4est_locidx_t, lnq + 1);
+  memcpy (qpos, qoffsets, (lnq + 1) * sizeof (p4est_locidx_t));
+  for (zz = 0; zz < num_recv; ++zz) {
+    mp = (p4est_migrate_point_t *) sc_array_index (mpoints, zz);
+    if (mp->local_num >= 0) {
+      memcpy (sc_array_index (records, (size_t) qpos[mp->local_num]++),
+              mp->record, esize);
+    }
+  }
+  P4EST_FREE (qpos);
+  sc_array_destroy (mpoints);
+  P4EST_FREE (recv_data);
+
+  /* optionally return the range of records for each local quadrant */
+  if (offsets != NULL) {
+    sc_array_resize (offsets, (size_t) lnq + 1);
+    memcpy (offsets->array, qoffsets, (lnq + 1) * sizeof (p4est_locidx_t));
+  }
+  P4EST_FREE (qoffsets);
+
+  return num_lost;
+}
+
+/** A branch of local or ghost leaves in the best-first search. */
+typedef struct p4est_nearest_node
+{
+  double              dist2;    /**< Squared distance to bounding box. */
+  int                 is_ghost; /**< Boolean: leaves are ghosts. */
+  size_t              begin;    /**< First leaf in the tree or ghost array. */
+  size_t              end;      /**< Exclusive end of the leaf range. */
+  p4est_quadrant_t    quadrant; /**< Smallest ancestor of the leaf range. */
+}
+p4est_nearest_node_t;
+
+/** Context of the best-first search over local leaves and ghosts. */
+typedef struct p4est_nearest_context
+{
+  p4est_t            *p4est;    /**< The forest searched. */
+  p4est_ghost_t      *ghost;    /**< Ghost layer, may be NULL. */
+  p4est_geometry_t   *geom;     /**< Geometry, if NULL use the vertices. */
+  p4est_bbox_cache_t *cache;    /**< Boxes of local branches, may be NULL. */
+  const double       *xyz;      /**< The query point. */
+  sc_array_t          heap;     /**< Binary min heap of search nodes. */
+}
+p4est_nearest_context_t;
+
+/** Compute the bounding box of the images of a quadrant's corners.
+ * \param [in] conn         Connectivity with vertices, used if no \b geom.
+ * \param [in] geom         If not NULL, maps the reference coordinates.
+ * \param [in] which_tree   The tree containing the quadrant.
+ * \param [in] q            The quadrant whose box is computed.
+ * \param [out] lower       The lower corner of the box.
+ * \param [out] upper       The upper corner of the box.
+ */
+static void
+p4est_quadrant_corner_box (p4est_connectivity_t * conn,
+                           p4est_geometry_t * geom,
+                           p4est_topidx_t which_tree,
+                           const p4est_quadrant_t * q,
+                           double lower[3], double upper[3])
+{
+  int                 c, j;
+  double              vxyz[3], abc[3];
+  const p4est_qcoord_t h = P4EST_QUADRANT_LEN (q->level);
+  p4est_qcoord_t      qx, qy;
+#ifdef P4_TO_P8
+  p4est_qcoord_t      qz;
+#endif
+
+  /* the images of the corners bound the quadrant for multilinear maps */
+  for (c = 0; c < P4EST_CHILDREN; ++c) {
+    qx = q->x + ((c & 1) ? h : 0);
+    qy = q->y + ((c & 2) ? h : 0);
+#ifdef P4_TO_P8
+    qz = q->z + ((c & 4) ? h : 0);
+#endif
+    if (geom != NULL) {
+      abc[0] = qx / (double) P4EST_ROOT_LEN;
+      abc[1] = qy / (double) P4EST_ROOT_LEN;
+#ifndef P4_TO_P8
+      abc[2] = 0.;
+#else
+      abc[2] = qz / (double) P4EST_ROOT_LEN;
+#endif
+      geom->X (geom, which_tree, abc, vxyz);
+    }
+    else {
+      p4est_qcoord_to_vertex (conn, which_tree, qx, qy,
+#ifdef P4_TO_P8
+                              qz,
+#endif
+                              vxyz);
+    }
+    for (j = 0; j < 3; ++j) {
+      if (c == 0 || vxyz[j] < lower[j]) {
+        lower[j] = vxyz[j];
+      }
+      if (c == 0 || vxyz[j] > upper[j]) {
+        upper[j] = vxyz[j];
+      }
+    }
+  }
+}
+
+/** Compute the squared distance of a point to a quadrant's box.
+ * Local quadrants are looked up in the cache if there is one.
+ * \param [in] local_num    Process-local number of a local leaf, or -1.
+ */
+static double
+p4est_nearest_distance (p4est_nearest_context_t * nc, int is_ghost,
+                        p4est_topidx_t which_tree, p4est_quadrant_t * q,
+                        p4est_locidx_t local_num)
+{
+  int                 j;
+  double              d, dist2;
+  double              lower[3], upper[3];
+
+  if (nc->cache != NULL && !is_ghost) {
+    p4est_bbox_cache_get (nc->cache, which_tree, q, local_num, lower, upper);
+  }
+  else {
+    p4est_quadrant_corner_box (nc->p4est->connectivity, nc->geom,
+                               which_tree, q, lower, upper);
+  }
+
+  /* distance of the query point to the box, zero inside */
+  dist2 = 0.;
+  for (j = 0; j < 3; ++j) {
+    d = nc->xyz[j] < lower[j] ? lower[j] - nc->xyz[j] :
+      nc->xyz[j] > upper[j] ? nc->xyz[j] - upper[j] : 0.;
+    dist2 += d * d;
+  }
+  return dist2;
+}
+
+/** Access the array that a search node's leaf range refers to. */
+static sc_array_t  *
+p4est_nearest_leaves (p4est_nearest_context_t * nc, int is_ghost,
+                      p4est_topidx_t which_tree)
+{
+  if (is_ghost) {
+    return &nc->ghost->ghosts;
+  }
+  return &p4est_tree_array_index (nc->p4est->trees, which_tree)->quadrants;
+}
+
+/** Push the smallest branch containing a range of leaves onto the heap. */
+static void
+p4est_nearest_push (p4est_nearest_context_t * nc, int is_ghost,
+                    p4est_topidx_t which_tree, size_t begin, size_t end)
+{
+  size_t              zz, parent;
+  p4est_locidx_t      local_num;
+  sc_array_t         *leaves;
+  p4est_nearest_node_t *node, *pnode, swap;
+
+  P4EST_ASSERT (begin < end);
+  leaves = p4est_nearest_leaves (nc, is_ghost, which_tree);
+  P4EST_ASSERT (end <= leaves->elem_count);
+
+  /* shrink the branch to the smallest quadrant containing the range */
+  node = (p4est_nearest_node_t *) sc_array_push (&nc->heap);
+  node->is_ghost = is_ghost;
+  node->begin = begin;
+  node->end = end;
+  p4est_nearest_common_ancestor (p4est_quadrant_array_index (leaves, begin),
+                                 p4est_quadrant_array_index (leaves, end - 1),
+                                 &node->quadrant);
+  node->quadrant.p.which_tree = which_tree;
+  local_num = -1;
+  if (!is_ghost && begin + 1 == end) {
+    local_num = p4est_tree_array_index (nc->p4est->trees, which_tree)
+      ->quadrants_offset + (p4est_locidx_t) begin;
+  }
+  node->dist2 = p4est_nearest_distance (nc, is_ghost, which_tree,
+                                        &node->quadrant, local_num);
+
+  /* sift up */
+  for (zz = nc->heap.elem_count - 1; zz > 0; zz = parent) {
+    parent = (zz - 1) / 2;
+    node = (p4est_nearest_node_t *) sc_array_index (&nc->heap, zz);
+    pnode = (p4est_nearest_node_t *) sc_array_index (&nc->heap, parent);
+    if (pnode->dist2 <= node->dist2) {
+      break;
+    }
+    swap = *node;
+    *node = *pnode;
+    *pnode = swap;
+  }
+}
+
+/** Remove the closest branch from the heap. */
+static void
+p4est_nearest_pop (p4est_nearest_context_t * nc, p4est_nearest_node_t * top)
+{
+  size_t              zz, child, num;
+  p4est_nearest_node_t *node, *cnode, swap;
+
+  P4EST_ASSERT (nc->heap.elem_count > 0);
+  *top = *(p4est_nearest_node_t *) sc_array_index (&nc->heap, 0);
+  *(p4est_nearest_node_t *) sc_array_index (&nc->heap, 0) =
+    *(p4est_nearest_node_t *) sc_array_pop (&nc->heap);
+
+  /* sift down */
+  num = nc->heap.elem_count;
+  for (zz = 0; (child = 2 * zz + 1) < num; zz = child) {
+    cnode = (p4est_nearest_node_t *) sc_array_index (&nc->heap, child);
+    if (child + 1 < num && cnode[1].dist2 < cnode->dist2) {
+      ++cnode;
+      ++child;
+    }
+    node = (p4est_nearest_node_t *) sc_array_index (&nc->heap, zz);
+    if (node->dist2 <= cnode->dist2) {
+      break;
+    }
+    swap = *node;
+    *node = *cnode;
+    *cnode = swap;
+  }
+}
+
+/** Run the best-first search for at most \b k leaves within a radius.
+ * \param [in] k            Maximum number of results; negative: no limit.
+ * \param [in] radius2      Squared radius; negative: no limit.
+ */
+static void
+p4est_nearest_search (p4est_t * p4est, p4est_ghost_t * ghost,
+                      p4est_geometry_t * geom, p4est_bbox_cache_t * cache,
+                      const double xyz[3],
+                      int k, double radius2, sc_array_t * results)
+{
+  int                 i;
+  size_t              split[P4EST_CHILDREN + 1];
+  p4est_topidx_t      jt;
+  p4est_tree_t       *tree;
+  p4est_nearest_node_t top;
+  p4est_nearest_context_t snc, *nc = &snc;
+  p4est_search_nearest_t *match;
+  sc_array_t         *leaves, view;
+
+  P4EST_ASSERT (p4est != NULL);
+  P4EST_ASSERT (geom != NULL || p4est->connectivity->vertices != NULL);
+  P4EST_ASSERT (xyz != NULL);
+  P4EST_ASSERT (results != NULL &&
+                results->elem_size == sizeof (p4est_search_nearest_t));
+
+  sc_array_resize (results, 0);
+  if (k == 0) {
+    return;
+  }
+
+  /* the roots of the search are the local and the ghost trees */
+  nc->p4est = p4est;
+  nc->ghost = ghost;
+  nc->geom = geom;
+  nc->cache = cache;
+  nc->xyz = xyz;
+  sc_array_init (&nc->heap, sizeof (p4est_nearest_node_t));
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    if (tree->quadrants.elem_count > 0) {
+      p4est_nearest_push (nc, 0, jt, 0, tree->quadrants.elem_count);
+    }
+  }
+  if (ghost != NULL) {
+    for (jt = 0; jt < p4est->connectivity->num_trees; ++jt) {
+      if (ghost->tree_offsets[jt] < ghost->tree_offsets[jt + 1]) {
+        p4est_nearest_push (nc, 1, jt, (size_t) ghost->tree_offsets[jt],
+                            (size_t) ghost->tree_offsets[jt + 1]);
+      }
+    }
+  }
+
+  /* expand the closest branch until enough leaves are found */
+  while (nc->heap.elem_count > 0) {
+    p4est_nearest_pop (nc, &top);
+    if (radius2 >= 0. && top.dist2 > radius2) {
+      break;
+    }
+    jt = top.quadrant.p.which_tree;
+    if (top.begin + 1 == top.end) {
+      /* a leaf is not farther away than any branch left in the heap */
+      match = (p4est_search_nearest_t *) sc_array_push (results);
+      match->which_tree = jt;
+      match->is_ghost = top.is_ghost;
+      match->local_num = (p4est_locidx_t) top.begin;
+      if (!top.is_ghost) {
+        tree = p4est_tree_array_index (p4est->trees, jt);
+        match->local_num += tree->quadrants_offset;
+      }
+      match->distance = sqrt (top.dist2);
+      if (k > 0 && results->elem_count == (size_t) k) {
+        break;
+      }
+      continue;
+    }
+
+    /* split the branch into its children */
+    leaves = p4est_nearest_leaves (nc, top.is_ghost, jt);
+    sc_array_init_view (&view, leaves, top.begin, top.end - top.begin);
+    p4est_split_array (&view, (int) top.quadrant.level, split);
+    for (i = 0; i < P4EST_CHILDREN; ++i) {
+      if (split[i] < split[i + 1]) {
+        p4est_nearest_push (nc, top.is_ghost, jt, top.begin + split[i],
+                            top.begin + split[i + 1]);
+      }
+    }
+    sc_array_reset (&view);
+  }
+  sc_array_reset (&nc->heap);
+}
+
+void
+p4est_search_knn (p4est_t * p4est, p4est_ghost_t * ghost,
+                  p4est_geometry_t * geom, const double xyz[3], int k,
+                  sc_array_t * results)
+{
+  P4EST_ASSERT (k >= 0);
+  p4est_nearest_search (p4est, ghost, geom, NULL, xyz, k, -1., results);
+}
+
+void
+p4est_search_ball (p4est_t * p4est, p4est_ghost_t * ghost,
+                   p4est_geometry_t * geom, const double xyz[3],
+                   double radius, sc_array_t * results)
+{
+  P4EST_ASSERT (radius >= 0.);
+  p4est_nearest_search (p4est, ghost, geom, NULL, xyz, -1, radius * radius,
+                        results);
+}
+
+/** The cached bounding box of a branch of the local forest. */
+typedef struct p4est_bbox_branch
+{
+  p4est_quadrant_t    quadrant; /**< The branch with its tree number. */
+  double              box[6];   /**< Lower and upper corner. */
+}
+p4est_bbox_branch_t;
+
+struct p4est_bbox_cache
+{
+  p4est_t            *p4est;    /**< The forest whose boxes are cached. */
+  p4est_geometry_t   *geom;     /**< Geometry, if NULL use the vertices. */
+  int                 maxlevel; /**< Deepest level of cached branches. */
+  int                 is_built; /**< Boolean: the boxes are computed. */
+  long                revision; /**< Forest revision of the boxes. */
+  sc_array_t         *leaf_boxes;       /**< Six doubles per local leaf. */
+  sc_array_t         *branches; /**< Sorted p4est_bbox_branch_t. */
+};
+
+p4est_bbox_cache_t *
+p4est_bbox_cache_new (p4est_t * p4est, p4est_geometry_t * geom,
+                      int maxlevel)
+{
+  p4est_bbox_cache_t *cache;
+
+  P4EST_ASSERT (p4est != NULL);
+  P4EST_ASSERT (geom != NULL || p4est->connectivity->vertices != NULL);
+  P4EST_ASSERT (maxlevel <= P4EST_QMAXLEVEL);
+
+  cache = P4EST_ALLOC_ZERO (p4est_bbox_cache_t, 1);
+  cache->p4est = p4est;
+  cache->geom = geom;
+  cache->maxlevel = maxlevel;
+  cache->is_built = 0;
+  cache->revision = -1;
+  cache->leaf_boxes = sc_array_new (6 * sizeof (double));
+  cache->branches = sc_array_new (sizeof (p4est_bbox_branch_t));
+
+  return cache;
+}
+
+void
+p4est_bbox_cache_destroy (p4est_bbox_cache_t * cache)
+{
+  sc_array_destroy (cache->leaf_boxes);
+  sc_array_destroy (cache->branches);
+  P4EST_FREE (cache);
+}
+
+/** Enlarge a box to contain another one. */
+static void
+p4est_bbox_union (double box[6], const double add[6])
+{
+  int                 j;
+
+  for (j = 0; j < 3; ++j) {
+    box[j] = SC_MIN (box[j], add[j]);
+    box[3 + j] = SC_MAX (box[3 + j], add[3 + j]);
+  }
+}
+
+/** Compute the boxes of the local leaves and of their ancestors.
+ * The leaves are visited in order, such that the ancestors of one level
+ * change monotonically and each can be completed before the next begins.
+ */
+static void
+p4est_bbox_cache_build (p4est_bbox_cache_t * cache)
+{
+  p4est_t            *p4est = cache->p4est;
+  int                 l, top;
+  int                *have;
+  size_t              zz;
+  double             *box;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      lq;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, a;
+  p4est_bbox_branch_t *cur;
+
+  /* the leaf boxes are indexed by local quadrant number */
+  sc_array_resize (cache->leaf_boxes, (size_t) p4est->local_num_quadrants);
+  sc_array_resize (cache->branches, 0);
+  have = NULL;
+  cur = NULL;
+  if (cache->maxlevel >= 0) {
+    have = P4EST_ALLOC (int, cache->maxlevel + 1);
+    cur = P4EST_ALLOC (p4est_bbox_branch_t, cache->maxlevel + 1);
+  }
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (l = 0; l <= cache->maxlevel; ++l) {
+      have[l] = 0;
+    }
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      box = (double *) sc_array_index (cache->leaf_boxes, (size_t) lq);
+      p4est_quadrant_corner_box (p4est->connectivity, cache->geom,
+                                 jt, q, box, box + 3);
+
+      /* merge the leaf box into its ancestors up to the maximum level */
+      top = SC_MIN ((int) q->level, cache->maxlevel);
+      for (l = 0; l <= cache->maxlevel; ++l) {
+        if (l <= top) {
+          if (l < (int) q->level) {
+            p4est_quadrant_ancestor (q, l, &a);
+          }
+          else {
+            a = *q;
+          }
+          if (have[l] && p4est_quadrant_is_equal (&cur[l].quadrant, &a)) {
+            p4est_bbox_union (cur[l].box, box);
+            continue;
+          }
+        }
+        if (have[l]) {
+          /* this branch does not receive any more leaves */
+          *(p4est_bbox_branch_t *) sc_array_push (cache->branches) = cur[l];
+          have[l] = 0;
+        }
+        if (l <= top) {
+          cur[l].quadrant = a;
+          cur[l].quadrant.p.which_tree = jt;
+          memcpy (cur[l].box, box, 6 * sizeof (double));
+          have[l] = 1;
+        }
+      }
+    }
+    for (l = 0; l <= cache->maxlevel; ++l) {
+      if (have[l]) {
+        *(p4est_bbox_branch_t *) sc_array_push (cache->branches) = cur[l];
+      }
+    }
+  }
+  P4EST_FREE (have);
+  P4EST_FREE (cur);
+
+  /* sort the branches by tree and Morton index for binary search */
+  sc_array_sort (cache->branches, p4est_quadrant_compare_piggy);
+
+  cache->is_built = 1;
+  cache->revision = p4est->revision;
+}
+
+void
+p4est_bbox_cache_get (p4est_bbox_cache_t * cache, p4est_topidx_t which_tree,
+                      const p4est_quadrant_t * quadrant,
+                      p4est_locidx_t local_num,
+                      double lower[3], double upper[3])
+{
+  ssize_t             si;
+  const double       *box;
+  p4est_bbox_branch_t key;
+
+  P4EST_ASSERT (cache != NULL);
+  P4EST_ASSERT (quadrant != NULL);
+
+  /* rebuild lazily whenever the forest has changed */
+  if (!cache->is_built || cache->revision != cache->p4est->revision) {
+    p4est_bbox_cache_build (cache);
+  }
+
+  box = NULL;
+  if (local_num >= 0) {
+    /* the quadrant is a local leaf */
+    P4EST_ASSERT (local_num < cache->p4est->local_num_quadrants);
+    box = (const double *) sc_array_index (cache->leaf_boxes,
+                                           (size_t) local_num);
+  }
+  else if ((int) quadrant->level <= cache->maxlevel) {
+    /* the quadrant may be a cached branch */
+    key.quadrant = *quadrant;
+    key.quadrant.p.which_tree = which_tree;
+    si = sc_array_bsearch (cache->branches, &key,
+                           p4est_quadrant_compare_piggy);
+    if (si >= 0) {
+      box = ((const p4est_bbox_branch_t *)
+             sc_array_index_ssize_t (cache->branches, si))->box;
+    }
+  }
+  if (box != NULL) {
+    memcpy (lower, box, 3 * sizeof (double));
+    memcpy (upper, box + 3, 3 * sizeof (double));
+  }
+  else {
+    /* fall back to computing the box on the fly */
+    p4est_quadrant_corner_box (cache->p4est->connectivity, cache->geom,
+                               which_tree, quadrant, lower, upper);
+  }
+}
+
+void
+p4est_search_knn_ext (p4est_bbox_cache_t * cache, p4est_ghost_t * ghost,
+                      const double xyz[3], int k, sc_array_t * results)
+{
+  P4EST_ASSERT (cache != NULL);
+  P4EST_ASSERT (k >= 0);
+  p4est_nearest_search (cache->p4est, ghost, cache->geom, cache,
+                        xyz, k, -1., results);
+}
+
+void
+p4est_search_ball_ext (p4est_bbox_cache_t * cache, p4est_ghost_t * ghost,
+                       const double xyz[3], double radius,
+                       sc_array_t * results)
+{
+  P4EST_ASSERT (cache != NULL);
+  P4EST_ASSERT (radius >= 0.);
+  p4est_nearest_search (cache->p4est, ghost, cache->geom, cache,
+                        xyz, -1, radius * radius, results);
+}
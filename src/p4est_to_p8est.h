@@ -72,6 +72,20 @@
 #define P4EST_WRAP_NONE                 P8EST_WRAP_NONE
 #define P4EST_WRAP_REFINE               P8EST_WRAP_REFINE
 #define P4EST_WRAP_COARSEN              P8EST_WRAP_COARSEN
+#define P4EST_LNODES_ORDER_SFC          P8EST_LNODES_ORDER_SFC
+#define P4EST_LNODES_ORDER_RCM          P8EST_LNODES_ORDER_RCM
+#define P4EST_PARTITION_STATS_QUADRANTS P8EST_PARTITION_STATS_QUADRANTS
+#define P4EST_PARTITION_STATS_WEIGHT    P8EST_PARTITION_STATS_WEIGHT
+#define P4EST_PARTITION_STATS_PEERS     P8EST_PARTITION_STATS_PEERS
+#define P4EST_PARTITION_STATS_FACES     P8EST_PARTITION_STATS_FACES
+#define P4EST_PARTITION_STATS_MIRRORS   P8EST_PARTITION_STATS_MIRRORS
+#define P4EST_PARTITION_STATS_BYTES     P8EST_PARTITION_STATS_BYTES
+#define P4EST_PARTITION_STATS_LAST      P8EST_PARTITION_STATS_LAST
+#define P4EST_VTK_FORMAT_ASCII          P8EST_VTK_FORMAT_ASCII
+#define P4EST_VTK_FORMAT_BINARY         P8EST_VTK_FORMAT_BINARY
+#define P4EST_VTK_FORMAT_COMPRESSED     P8EST_VTK_FORMAT_COMPRESSED
+#define P4EST_VTK_BLOCK_SIZE            P8EST_VTK_BLOCK_SIZE
+#define P4EST_VTK_BATCH_BLOCKS          P8EST_VTK_BATCH_BLOCKS
 
 /* redefine types */
 #ifdef P4EST_BACKWARD_DEALII
@@ -82,11 +96,13 @@
 #define p4est_connectivity_t            p8est_connectivity_t
 #define p4est_corner_transform_t        p8est_corner_transform_t
 #define p4est_corner_info_t             p8est_corner_info_t
+#define p4est_geometry_cache_t          p8est_geometry_cache_t
 #define p4est_geometry_t                p8est_geometry_t
 #define p4est_t                         p8est_t
 #define p4est_tree_t                    p8est_tree_t
 #define p4est_quadrant_t                p8est_quadrant_t
 #define p4est_inspect_t                 p8est_inspect_t
+#define p4est_partition_context_t       p8est_partition_context_t
 #define p4est_position_t                p8est_position_t
 #define p4est_init_t                    p8est_init_t
 #define p4est_refine_t                  p8est_refine_t
@@ -94,12 +110,16 @@
 #define p4est_weight_t                  p8est_weight_t
 #define p4est_ghost_t                   p8est_ghost_t
 #define p4est_ghost_exchange_t          p8est_ghost_exchange_t
+#define p4est_partition_stats_type_t    p8est_partition_stats_type_t
 #define p4est_indep_t                   p8est_indep_t
 #define p4est_nodes_t                   p8est_nodes_t
 #define p4est_lnodes_t                  p8est_lnodes_t
 #define p4est_lnodes_code_t             p8est_lnodes_code_t
 #define p4est_lnodes_rank_t             p8est_lnodes_rank_t
 #define p4est_lnodes_buffer_t           p8est_lnodes_buffer_t
+#define p4est_lnodes_order_t            p8est_lnodes_order_t
+#define p4est_lnodes_hanging            p8est_lnodes_hanging
+#define p4est_lnodes_hanging_t          p8est_lnodes_hanging_t
 #define p4est_iter_volume_t             p8est_iter_volume_t
 #define p4est_iter_volume_info_t        p8est_iter_volume_info_t
 #define p4est_iter_face_t               p8est_iter_face_t
@@ -110,18 +130,27 @@
 #define p4est_iter_corner_info_t        p8est_iter_corner_info_t
 #define p4est_search_query_t            p8est_search_query_t
 #define p4est_search_local_t            p8est_search_local_t
+#define p4est_search_local_batch_t      p8est_search_local_batch_t
+#define p4est_search_migrate_t          p8est_search_migrate_t
+#define p4est_search_nearest_t          p8est_search_nearest_t
+#define p4est_bbox_cache                p8est_bbox_cache
+#define p4est_bbox_cache_t              p8est_bbox_cache_t
 #define p4est_search_partition_t        p8est_search_partition_t
 #define p4est_search_all_t              p8est_search_all_t
 #define p4est_build                     p8est_build
 #define p4est_build_t                   p8est_build_t
 #define p4est_transfer_comm_t           p8est_transfer_comm_t
 #define p4est_transfer_context_t        p8est_transfer_context_t
+#define p4est_comm_owner_lookup_t       p8est_comm_owner_lookup_t
 #define p4est_mesh_t                    p8est_mesh_t
 #define p4est_mesh_face_neighbor_t      p8est_mesh_face_neighbor_t
+#define p4est_hierarchy_t               p8est_hierarchy_t
+#define p4est_hierarchy_level_t         p8est_hierarchy_level_t
 #define p4est_wrap_t                    p8est_wrap_t
 #define p4est_wrap_leaf_t               p8est_wrap_leaf_t
 #define p4est_wrap_flags_t              p8est_wrap_flags_t
 #define p4est_vtk_context_t             p8est_vtk_context_t
+#define p4est_vtk_format_t              p8est_vtk_format_t
 
 /* redefine external variables */
 #define p4est_face_corners              p8est_face_corners
@@ -192,14 +221,27 @@
 
 /* functions in p4est_extended */
 #define p4est_replace_t                 p8est_replace_t
+#define p4est_project                   p8est_project
+#define p4est_project_t                 p8est_project_t
+#define p4est_project_block             p8est_project_block
+#define p4est_project_block_t           p8est_project_block_t
+#define p4est_project_kernel_t          p8est_project_kernel_t
 #define p4est_new_ext                   p8est_new_ext
 #define p4est_mesh_new_ext              p8est_mesh_new_ext
+#define p4est_mesh_new_csr              p8est_mesh_new_csr
 #define p4est_copy_ext                  p8est_copy_ext
 #define p4est_refine_ext                p8est_refine_ext
+#define p4est_refine_flags              p8est_refine_flags
+#define p4est_adapt                     p8est_adapt
+#define p4est_project_new               p8est_project_new
+#define p4est_project_destroy           p8est_project_destroy
+#define p4est_project_apply             p8est_project_apply
 #define p4est_coarsen_ext               p8est_coarsen_ext
 #define p4est_balance_ext               p8est_balance_ext
 #define p4est_balance_subtree_ext       p8est_balance_subtree_ext
 #define p4est_partition_ext             p8est_partition_ext
+#define p4est_partition_begin           p8est_partition_begin
+#define p4est_partition_end             p8est_partition_end
 #define p4est_partition_for_coarsening  p8est_partition_for_coarsening
 #define p4est_save_ext                  p8est_save_ext
 #define p4est_load_ext                  p8est_load_ext
@@ -215,6 +257,7 @@
 
 /* functions in p4est_points */
 #define p4est_new_points                p8est_new_points
+#define p4est_new_points_bottomup       p8est_new_points_bottomup
 
 /* functions in p4est_bits */
 #define p4est_quadrant_print            p8est_quadrant_print
@@ -295,8 +338,19 @@
 #define p4est_find_range_boundaries     p8est_find_range_boundaries
 #define p4est_search                    p8est_search
 #define p4est_search_local              p8est_search_local
+#define p4est_search_local_batch        p8est_search_local_batch
+#define p4est_locate_points             p8est_locate_points
+#define p4est_search_migrate            p8est_search_migrate
+#define p4est_search_knn                p8est_search_knn
+#define p4est_search_ball               p8est_search_ball
+#define p4est_bbox_cache_new            p8est_bbox_cache_new
+#define p4est_bbox_cache_destroy        p8est_bbox_cache_destroy
+#define p4est_bbox_cache_get            p8est_bbox_cache_get
+#define p4est_search_knn_ext            p8est_search_knn_ext
+#define p4est_search_ball_ext           p8est_search_ball_ext
 #define p4est_search_partition          p8est_search_partition
 #define p4est_search_all                p8est_search_all
+#define p4est_search_all_threaded       p8est_search_all_threaded
 #define p4est_build_new                 p8est_build_new
 #define p4est_build_init_add            p8est_build_init_add
 #define p4est_build_add                 p8est_build_add
@@ -326,6 +380,8 @@
 #define p4est_partition_correction      p8est_partition_correction
 #define p4est_partition_for_coarsening  p8est_partition_for_coarsening
 #define p4est_partition_given           p8est_partition_given
+#define p4est_partition_given_begin     p8est_partition_given_begin
+#define p4est_partition_given_end       p8est_partition_given_end
 
 /* functions in p4est_communication */
 #define p4est_comm_parallel_env_assign  p8est_comm_parallel_env_assign
@@ -336,6 +392,8 @@
 #define p4est_comm_parallel_env_is_null p8est_comm_parallel_env_is_null
 #define p4est_comm_parallel_env_reduce  p8est_comm_parallel_env_reduce
 #define p4est_comm_parallel_env_reduce_ext p8est_comm_parallel_env_reduce_ext
+#define p4est_comm_hierarchy_split      p8est_comm_hierarchy_split
+#define p4est_comm_notify_nbx           p8est_comm_notify_nbx
 #define p4est_comm_count_quadrants      p8est_comm_count_quadrants
 #define p4est_comm_global_partition     p8est_comm_global_partition
 #define p4est_comm_count_pertree        p8est_comm_count_pertree
@@ -343,6 +401,10 @@
 #define p4est_comm_is_contained         p8est_comm_is_contained
 #define p4est_comm_is_owner             p8est_comm_is_owner
 #define p4est_comm_find_owner           p8est_comm_find_owner
+#define p4est_comm_owner_lookup_new     p8est_comm_owner_lookup_new
+#define p4est_comm_owner_lookup_destroy p8est_comm_owner_lookup_destroy
+#define p4est_comm_owner_lookup_find    p8est_comm_owner_lookup_find
+#define p4est_comm_owner_lookup_batch   p8est_comm_owner_lookup_batch
 #define p4est_comm_tree_info            p8est_comm_tree_info
 #define p4est_comm_neighborhood_owned   p8est_comm_neighborhood_owned
 #define p4est_comm_sync_flag            p8est_comm_sync_flag
@@ -365,6 +427,10 @@
 /* functions in p4est_geometry */
 #define p4est_geometry_destroy          p8est_geometry_destroy
 #define p4est_geometry_new_connectivity p8est_geometry_new_connectivity
+#define p4est_geometry_cache_new        p8est_geometry_cache_new
+#define p4est_geometry_cache_destroy    p8est_geometry_cache_destroy
+#define p4est_geometry_cache_is_current p8est_geometry_cache_is_current
+#define p4est_geometry_cache_update     p8est_geometry_cache_update
 
 /* functions in p4est_vtk */
 #define p4est_vtk_context_new           p8est_vtk_context_new
@@ -372,6 +438,7 @@
 #define p4est_vtk_context_set_geom      p8est_vtk_context_set_geom
 #define p4est_vtk_context_set_scale     p8est_vtk_context_set_scale
 #define p4est_vtk_context_set_continuous p8est_vtk_context_set_continuous
+#define p4est_vtk_context_set_format    p8est_vtk_context_set_format
 #define p4est_vtk_write_file            p8est_vtk_write_file
 #define p4est_vtk_write_header          p8est_vtk_write_header
 #define p4est_vtk_write_cell_dataf      p8est_vtk_write_cell_dataf
@@ -404,6 +471,7 @@
 #define p4est_is_balanced               p8est_is_balanced
 #define p4est_ghost_checksum            p8est_ghost_checksum
 #define p4est_ghost_expand              p8est_ghost_expand
+#define p4est_partition_stats           p8est_partition_stats
 
 /* functions in p4est_nodes */
 #define p4est_nodes_new                 p8est_nodes_new
@@ -413,6 +481,11 @@
 /* functions in p4est_lnodes */
 #define p4est_lnodes_new                p8est_lnodes_new
 #define p4est_lnodes_destroy            p8est_lnodes_destroy
+#define p4est_lnodes_reorder            p8est_lnodes_reorder
+#define p4est_lnodes_hanging_new        p8est_lnodes_hanging_new
+#define p4est_lnodes_hanging_destroy    p8est_lnodes_hanging_destroy
+#define p4est_lnodes_gather             p8est_lnodes_gather
+#define p4est_lnodes_scatter_add        p8est_lnodes_scatter_add
 #define p4est_ghost_support_lnodes      p8est_ghost_support_lnodes
 #define p4est_ghost_expand_by_lnodes    p8est_ghost_expand_by_lnodes
 #define p4est_partition_lnodes          p8est_partition_lnodes
@@ -439,6 +512,11 @@
 #define p4est_mesh_face_neighbor_next   p8est_mesh_face_neighbor_next
 #define p4est_mesh_face_neighbor_data   p8est_mesh_face_neighbor_data
 
+/* functions in p4est_hierarchy */
+#define p4est_hierarchy_new             p8est_hierarchy_new
+#define p4est_hierarchy_destroy         p8est_hierarchy_destroy
+#define p4est_hierarchy_transfer_fixed  p8est_hierarchy_transfer_fixed
+
 /* functions in p4est_balance */
 #define p4est_balance_seeds_face        p8est_balance_seeds_face
 #define p4est_balance_seeds_corner      p8est_balance_seeds_corner
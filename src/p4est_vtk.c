@@ -31,10 +31,24 @@
 #include <p4est_nodes.h>
 #define P4EST_VTK_CELL_TYPE      8      /* VTK_PIXEL */
 #endif /* !P4_TO_P8 */
+#ifdef P4EST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* default parameters for the vtk context */
 static const double p4est_vtk_scale = 0.95;
 static const int    p4est_vtk_continuous = 0;
+#ifndef P4EST_VTK_BINARY
+static const p4est_vtk_format_t p4est_vtk_format = P4EST_VTK_FORMAT_ASCII;
+#elif !defined P4EST_VTK_COMPRESSION
+static const p4est_vtk_format_t p4est_vtk_format = P4EST_VTK_FORMAT_BINARY;
+#else
+static const p4est_vtk_format_t p4est_vtk_format =
+  P4EST_VTK_FORMAT_COMPRESSED;
+#endif
 
 /* default parameters for p4est_vtk_write_file */
 static const int    p4est_vtk_write_tree = 1;
@@ -130,24 +144,8 @@ static
 #define P4EST_VTK_FLOAT_TYPE double
 #endif
 
-#ifndef P4EST_VTK_BINARY
-#define P4EST_VTK_ASCII 1
-#define P4EST_VTK_FORMAT_STRING "ascii"
-#else
-#define P4EST_VTK_FORMAT_STRING "binary"
-
-static int
-p4est_vtk_write_binary (FILE * vtkfile, char *numeric_data,
-                        size_t byte_length)
-{
-#ifndef P4EST_VTK_COMPRESSION
-  return sc_vtk_write_binary (vtkfile, numeric_data, byte_length);
-#else
-  return sc_vtk_write_compressed (vtkfile, numeric_data, byte_length);
-#endif /* P4EST_VTK_COMPRESSION */
-}
-
-#endif /* P4EST_VTK_BINARY */
+/* size of the buffer of encoded characters written at once */
+#define P4EST_VTK_OUT_SIZE ((size_t) 1 << 22)
 
 /** Opaque context type for writing VTK output with multiple function calls.
  *
@@ -168,7 +166,8 @@ p4est_vtk_write_binary (FILE * vtkfile, char *numeric_data,
  * The \a vtufile, \a pvtufile, and \a visitfile members are the vtk file
  * pointers; opened by \ref p4est_vtk_write_header and closed by \b
  * p4est_vtk_write_footer.
- *
+ * The remaining members stream the data arrays in the binary formats
+ * through fixed size buffers, such that no array is allocated in full.
  */
 struct p4est_vtk_context
 {
@@ -193,8 +192,388 @@ struct p4est_vtk_context
   FILE               *vtufile;     /**< File pointer for the VTU file. */
   FILE               *pvtufile;    /**< Paraview meta file. */
   FILE               *visitfile;   /**< Visit meta file. */
+
+  /* buffers for streaming binary data, allocated on first use */
+  p4est_vtk_format_t  format;      /**< Format of the data arrays. */
+  int                 stream_error;     /**< Set on encoding failure. */
+  size_t              stream_total;     /**< Bytes announced for array. */
+  size_t              stream_count;     /**< Bytes received for array. */
+  char               *raw;         /**< Raw bytes of the current batch. */
+  size_t              raw_count;   /**< Bytes in the current batch. */
+  char               *comp;        /**< Compressed blocks of a batch. */
+  size_t              comp_bound;  /**< Maximum size of a compressed block. */
+  size_t             *comp_sizes;  /**< Compressed sizes in a batch. */
+  uint32_t           *comp_header; /**< Block count, sizes of the array. */
+  size_t              comp_blocks; /**< Blocks compressed for the array. */
+  long                comp_offset; /**< File position of the header. */
+  char               *out;         /**< Encoded characters to be written. */
+  size_t              out_count;   /**< Characters in the output buffer. */
+  unsigned char       carry[3];    /**< Bytes left over by base64. */
+  int                 carry_count; /**< Number of left over bytes. */
 };
 
+/** Return the VTK format attribute of the data arrays of a context. */
+static const char  *
+p4est_vtk_format_string (const p4est_vtk_context_t * cont)
+{
+  return cont->format == P4EST_VTK_FORMAT_ASCII ? "ascii" : "binary";
+}
+
+static const char   p4est_vtk_base64_table[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/** Encode bytes to base64 characters.
+ * \param [in] in       Input bytes.
+ * \param [in] n        Number of input bytes.  If it is not a multiple
+ *                      of 3, the last characters are padded.
+ * \param [out] out     At least 4 * ceil (n / 3) characters.
+ * \return              Number of characters written.
+ */
+static size_t
+p4est_vtk_base64 (const unsigned char *in, size_t n, char *out)
+{
+  size_t              i, k;
+  uint32_t            w;
+
+  for (i = 0, k = 0; i + 3 <= n; i += 3) {
+    w = ((uint32_t) in[i] << 16) | ((uint32_t) in[i + 1] << 8) | in[i + 2];
+    out[k++] = p4est_vtk_base64_table[(w >> 18) & 63];
+    out[k++] = p4est_vtk_base64_table[(w >> 12) & 63];
+    out[k++] = p4est_vtk_base64_table[(w >> 6) & 63];
+    out[k++] = p4est_vtk_base64_table[w & 63];
+  }
+  if (i < n) {
+    w = (uint32_t) in[i] << 16;
+    if (i + 1 < n) {
+      w |= (uint32_t) in[i + 1] << 8;
+    }
+    out[k++] = p4est_vtk_base64_table[(w >> 18) & 63];
+    out[k++] = p4est_vtk_base64_table[(w >> 12) & 63];
+    out[k++] = i + 1 < n ? p4est_vtk_base64_table[(w >> 6) & 63] : '=';
+    out[k++] = '=';
+  }
+  return k;
+}
+
+/** Write the encoded characters of the output buffer to the file. */
+static void
+p4est_vtk_stream_flush (p4est_vtk_context_t * cont)
+{
+  if (cont->out_count > 0 &&
+      fwrite (cont->out, 1, cont->out_count, cont->vtufile) !=
+      cont->out_count) {
+    cont->stream_error = 1;
+  }
+  cont->out_count = 0;
+}
+
+/** Append bytes to the base64 encoded stream.
+ * Up to two bytes are kept back to be encoded with the next call.
+ */
+static void
+p4est_vtk_stream_encode (p4est_vtk_context_t * cont,
+                         const char *data, size_t n)
+{
+  const unsigned char *in = (const unsigned char *) data;
+  size_t              chunk;
+
+  /* complete a triple of bytes left over from before */
+  while (cont->carry_count > 0 && cont->carry_count < 3 && n > 0) {
+    cont->carry[cont->carry_count++] = *in++;
+    --n;
+  }
+  if (cont->carry_count == 3) {
+    if (cont->out_count + 4 > P4EST_VTK_OUT_SIZE) {
+      p4est_vtk_stream_flush (cont);
+    }
+    cont->out_count +=
+      p4est_vtk_base64 (cont->carry, 3, cont->out + cont->out_count);
+    cont->carry_count = 0;
+  }
+
+  /* encode whole triples in chunks that fit into the output buffer */
+  while (n >= 3) {
+    chunk = (P4EST_VTK_OUT_SIZE - cont->out_count) / 4 * 3;
+    if (chunk == 0) {
+      p4est_vtk_stream_flush (cont);
+      continue;
+    }
+    chunk = SC_MIN (chunk, n / 3 * 3);
+    cont->out_count += p4est_vtk_base64 (in, chunk, cont->out +
+                                         cont->out_count);
+    in += chunk;
+    n -= chunk;
+  }
+  while (n > 0) {
+    cont->carry[cont->carry_count++] = *in++;
+    --n;
+  }
+}
+
+/** Encode the bytes left over and terminate the base64 stream. */
+static void
+p4est_vtk_stream_encode_end (p4est_vtk_context_t * cont)
+{
+  if (cont->out_count + 4 > P4EST_VTK_OUT_SIZE) {
+    p4est_vtk_stream_flush (cont);
+  }
+  cont->out_count += p4est_vtk_base64 (cont->carry, cont->carry_count,
+                                       cont->out + cont->out_count);
+  cont->carry_count = 0;
+}
+
+/** Encode or compress the raw bytes collected so far.
+ * Compressed blocks are produced by all threads in parallel.
+ */
+static void
+p4est_vtk_stream_drain (p4est_vtk_context_t * cont)
+{
+#ifdef P4EST_HAVE_ZLIB
+  int                 b, nb, error;
+  size_t              zz;
+#endif
+
+  if (cont->format == P4EST_VTK_FORMAT_BINARY) {
+    p4est_vtk_stream_encode (cont, cont->raw, cont->raw_count);
+    cont->raw_count = 0;
+    return;
+  }
+
+#ifdef P4EST_HAVE_ZLIB
+  P4EST_ASSERT (cont->format == P4EST_VTK_FORMAT_COMPRESSED);
+  nb = (int) ((cont->raw_count + P4EST_VTK_BLOCK_SIZE - 1) /
+              P4EST_VTK_BLOCK_SIZE);
+  error = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule (static) reduction (|:error)
+#endif
+  for (b = 0; b < nb; ++b) {
+    const size_t        offset = b * P4EST_VTK_BLOCK_SIZE;
+    uLongf              length = (uLongf) cont->comp_bound;
+
+    if (compress2 ((Bytef *) cont->comp + b * cont->comp_bound, &length,
+                   (const Bytef *) cont->raw + offset,
+                   (uLong) SC_MIN (P4EST_VTK_BLOCK_SIZE,
+                                   cont->raw_count - offset),
+                   Z_BEST_SPEED) != Z_OK) {
+      error = 1;
+    }
+    cont->comp_sizes[b] = (size_t) length;
+  }
+  if (error) {
+    cont->stream_error = 1;
+  }
+
+  /* the compressed blocks are encoded in sequence */
+  for (b = 0; b < nb; ++b) {
+    zz = 3 + cont->comp_blocks++;
+    cont->comp_header[zz] = (uint32_t) cont->comp_sizes[b];
+    p4est_vtk_stream_encode (cont, cont->comp + b * cont->comp_bound,
+                             cont->comp_sizes[b]);
+  }
+  cont->raw_count = 0;
+#else
+  SC_ABORT ("Configure did not find a recent enough zlib.  Abort.\n");
+#endif
+}
+
+/** Start writing a binary or compressed data array.
+ * \param [in,out] cont         The context must be in binary format.
+ * \param [in] byte_length      The total number of bytes that will be
+ *                              passed to \ref p4est_vtk_stream_write.
+ *                              If it exceeds the 32 bit header of VTK,
+ *                              nothing is written and the array fails in
+ *                              \ref p4est_vtk_stream_end.
+ */
+static void
+p4est_vtk_stream_begin (p4est_vtk_context_t * cont, size_t byte_length)
+{
+  uint32_t            int_header;
+  size_t              num_blocks, header_bytes, zz;
+#ifndef P4EST_HAVE_ZLIB
+  if (cont->format == P4EST_VTK_FORMAT_COMPRESSED) {
+    SC_ABORT ("Configure did not find a recent enough zlib.  Abort.\n");
+  }
+#endif
+
+  P4EST_ASSERT (cont->format != P4EST_VTK_FORMAT_ASCII);
+
+  /* the buffers are reused for all data arrays of the context */
+  if (cont->raw == NULL) {
+    cont->raw = P4EST_ALLOC (char,
+                             P4EST_VTK_BATCH_BLOCKS * P4EST_VTK_BLOCK_SIZE);
+    cont->out = P4EST_ALLOC (char, P4EST_VTK_OUT_SIZE);
+#ifdef P4EST_HAVE_ZLIB
+    if (cont->format == P4EST_VTK_FORMAT_COMPRESSED) {
+      cont->comp_bound = (size_t) compressBound ((uLong)
+                                                 P4EST_VTK_BLOCK_SIZE);
+      cont->comp = P4EST_ALLOC (char,
+                                P4EST_VTK_BATCH_BLOCKS * cont->comp_bound);
+      cont->comp_sizes = P4EST_ALLOC (size_t, P4EST_VTK_BATCH_BLOCKS);
+    }
+#endif
+  }
+  cont->stream_total = byte_length;
+  cont->stream_count = 0;
+  cont->raw_count = 0;
+  cont->out_count = 0;
+  cont->carry_count = 0;
+
+  /* the headers of VTK data arrays hold 32 bit sizes */
+  if (byte_length > (size_t) UINT32_MAX) {
+    P4EST_LERRORF (P4EST_STRING "_vtk: Data array of %llu bytes exceeds"
+                   " the 32 bit VTK header\n",
+                   (unsigned long long) byte_length);
+    cont->stream_error = 1;
+    return;
+  }
+
+  if (cont->format == P4EST_VTK_FORMAT_BINARY) {
+    /* the byte count is encoded together with the data */
+    int_header = (uint32_t) byte_length;
+    p4est_vtk_stream_encode (cont, (char *) &int_header, sizeof (int_header));
+    return;
+  }
+
+  /* the header of the compressed blocks is known only at the end;
+   * we reserve its encoded length in the file and write it later */
+  num_blocks = (byte_length + P4EST_VTK_BLOCK_SIZE - 1) /
+    P4EST_VTK_BLOCK_SIZE;
+  cont->comp_header = P4EST_ALLOC (uint32_t, 3 + num_blocks);
+  cont->comp_header[0] = (uint32_t) num_blocks;
+  cont->comp_header[1] = (uint32_t) P4EST_VTK_BLOCK_SIZE;
+  cont->comp_header[2] = (uint32_t) (byte_length % P4EST_VTK_BLOCK_SIZE);
+  cont->comp_blocks = 0;
+  cont->comp_offset = ftell (cont->vtufile);
+  if (cont->comp_offset < 0) {
+    cont->stream_error = 1;
+  }
+  header_bytes = (3 + num_blocks) * sizeof (uint32_t);
+  for (zz = 0; zz < 4 * ((header_bytes + 2) / 3); ++zz) {
+    if (cont->out_count == P4EST_VTK_OUT_SIZE) {
+      p4est_vtk_stream_flush (cont);
+    }
+    cont->out[cont->out_count++] = '=';
+  }
+}
+
+/** Append raw data to the array started by \ref p4est_vtk_stream_begin. */
+static void
+p4est_vtk_stream_write (p4est_vtk_context_t * cont,
+                        const void *data, size_t byte_length)
+{
+  const size_t        raw_size =
+    P4EST_VTK_BATCH_BLOCKS * P4EST_VTK_BLOCK_SIZE;
+  const char         *in = (const char *) data;
+  size_t              n;
+
+  P4EST_ASSERT (cont->stream_count + byte_length <= cont->stream_total);
+  cont->stream_count += byte_length;
+  if (cont->stream_error) {
+    /* the array will not be valid, so we skip its encoding */
+    return;
+  }
+  while (byte_length > 0) {
+    n = SC_MIN (byte_length, raw_size - cont->raw_count);
+    memcpy (cont->raw + cont->raw_count, in, n);
+    cont->raw_count += n;
+    in += n;
+    byte_length -= n;
+    if (cont->raw_count == raw_size) {
+      p4est_vtk_stream_drain (cont);
+    }
+  }
+}
+
+/** Append a floating point number in the precision of the output. */
+static void
+p4est_vtk_stream_float (p4est_vtk_context_t * cont, double value)
+{
+  const P4EST_VTK_FLOAT_TYPE f = (P4EST_VTK_FLOAT_TYPE) value;
+
+  p4est_vtk_stream_write (cont, &f, sizeof (f));
+}
+
+/** Append a local index. */
+static void
+p4est_vtk_stream_locidx (p4est_vtk_context_t * cont, p4est_locidx_t value)
+{
+  p4est_vtk_stream_write (cont, &value, sizeof (value));
+}
+
+/** Append an unsigned byte. */
+static void
+p4est_vtk_stream_uint8 (p4est_vtk_context_t * cont, uint8_t value)
+{
+  p4est_vtk_stream_write (cont, &value, sizeof (value));
+}
+
+/** Finish the data array started by \ref p4est_vtk_stream_begin.
+ * \return          0 on success, -1 on an encoding or file error.
+ */
+static int
+p4est_vtk_stream_end (p4est_vtk_context_t * cont)
+{
+  size_t              header_length;
+  char               *header_chars;
+
+  P4EST_ASSERT (cont->stream_count == cont->stream_total);
+  if (cont->stream_error) {
+    /* the caller destroys the context with any buffers left */
+    return -1;
+  }
+
+  /* the last batch may end with a partial block */
+  if (cont->raw_count > 0) {
+    p4est_vtk_stream_drain (cont);
+  }
+  p4est_vtk_stream_encode_end (cont);
+  p4est_vtk_stream_flush (cont);
+
+  if (cont->format == P4EST_VTK_FORMAT_COMPRESSED) {
+    /* fill in the header reserved in p4est_vtk_stream_begin */
+    P4EST_ASSERT (cont->comp_blocks == (size_t) cont->comp_header[0]);
+    header_length = (3 + cont->comp_blocks) * sizeof (uint32_t);
+    header_chars = P4EST_ALLOC (char, 4 * ((header_length + 2) / 3));
+    header_length = p4est_vtk_base64 ((unsigned char *) cont->comp_header,
+                                      header_length, header_chars);
+    if (cont->stream_error ||
+        fseek (cont->vtufile, cont->comp_offset, SEEK_SET) ||
+        fwrite (header_chars, 1, header_length, cont->vtufile) !=
+        header_length || fseek (cont->vtufile, 0, SEEK_END)) {
+      cont->stream_error = 1;
+    }
+    P4EST_FREE (header_chars);
+    P4EST_FREE (cont->comp_header);
+    cont->comp_header = NULL;
+  }
+
+  return cont->stream_error ? -1 : 0;
+}
+
+/** Write the coordinates of one point in the format of the context. */
+static void
+p4est_vtk_write_xyz (p4est_vtk_context_t * cont, const double xyz[3])
+{
+  P4EST_VTK_FLOAT_TYPE w[3];
+
+  w[0] = (P4EST_VTK_FLOAT_TYPE) xyz[0];
+  w[1] = (P4EST_VTK_FLOAT_TYPE) xyz[1];
+  w[2] = (P4EST_VTK_FLOAT_TYPE) xyz[2];
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    fprintf (cont->vtufile,
+#ifdef P4EST_VTK_DOUBLES
+             "     %24.16e %24.16e %24.16e\n",
+#else
+             "          %16.8e %16.8e %16.8e\n",
+#endif
+             w[0], w[1], w[2]);
+  }
+  else {
+    p4est_vtk_stream_write (cont, w, sizeof (w));
+  }
+}
+
 p4est_vtk_context_t *
 p4est_vtk_context_new (p4est_t * p4est, const char *filename)
 {
@@ -211,6 +590,7 @@ p4est_vtk_context_new (p4est_t * p4est, const char *filename)
 
   cont->scale = p4est_vtk_scale;
   cont->continuous = p4est_vtk_continuous;
+  cont->format = p4est_vtk_format;
 
   return cont;
 }
@@ -244,6 +624,19 @@ p4est_vtk_context_set_continuous (p4est_vtk_context_t * cont, int continuous)
   cont->continuous = continuous;
 }
 
+void
+p4est_vtk_context_set_format (p4est_vtk_context_t * cont,
+                              p4est_vtk_format_t format)
+{
+  P4EST_ASSERT (cont != NULL);
+  P4EST_ASSERT (!cont->writing);
+  P4EST_ASSERT (format == P4EST_VTK_FORMAT_ASCII ||
+                format == P4EST_VTK_FORMAT_BINARY ||
+                format == P4EST_VTK_FORMAT_COMPRESSED);
+
+  cont->format = format;
+}
+
 void
 p4est_vtk_context_destroy (p4est_vtk_context_t * context)
 {
@@ -262,6 +655,13 @@ p4est_vtk_context_destroy (p4est_vtk_context_t * context)
   }
   P4EST_FREE (context->node_to_corner);
 
+  /* deallocate streaming buffers */
+  P4EST_FREE (context->raw);
+  P4EST_FREE (context->comp);
+  P4EST_FREE (context->comp_sizes);
+  P4EST_FREE (context->comp_header);
+  P4EST_FREE (context->out);
+
   /* Close all file pointers. */
   if (context->vtufile != NULL) {
     if (fclose (context->vtufile)) {
@@ -343,13 +743,7 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
   p4est_t            *p4est;
   p4est_connectivity_t *connectivity;
   p4est_geometry_t   *geom;
-#ifdef P4EST_VTK_ASCII
-  double              wx, wy, wz;
-#else
   int                 retval;
-  uint8_t            *uint8_data;
-  p4est_locidx_t     *locidx_data;
-#endif
   int                 xi, yi, j, k;
 #ifdef P4_TO_P8
   int                 zi;
@@ -361,7 +755,6 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
   p4est_topidx_t      vt[P4EST_CHILDREN];
   p4est_locidx_t      quad_count, Npoints;
   p4est_locidx_t      sk, il, ntcid, *ntc;
-  P4EST_VTK_FLOAT_TYPE *float_data;
   sc_array_t         *quadrants, *indeps;
   sc_array_t         *trees;
   p4est_tree_t       *tree;
@@ -447,9 +840,7 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
 
   /* Have each proc write to its own file */
   snprintf (cont->vtufilename, BUFSIZ, "%s_%04d.vtu", filename, mpirank);
-  /* Use "w" for writing the initial part of the file.
-   * For further parts, use "r+" and fseek so write_compressed succeeds.
-   */
+  /* Compressed data arrays fseek back to fill in their block headers. */
   cont->vtufile = fopen (cont->vtufilename, "wb");
   if (cont->vtufile == NULL) {
     P4EST_LERRORF ("Could not open %s for output\n", cont->vtufilename);
@@ -460,9 +851,9 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
   fprintf (cont->vtufile, "<?xml version=\"1.0\"?>\n");
   fprintf (cont->vtufile,
            "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\"");
-#if defined P4EST_VTK_BINARY && defined P4EST_VTK_COMPRESSION
-  fprintf (cont->vtufile, " compressor=\"vtkZLibDataCompressor\"");
-#endif
+  if (cont->format == P4EST_VTK_FORMAT_COMPRESSED) {
+    fprintf (cont->vtufile, " compressor=\"vtkZLibDataCompressor\"");
+  }
 #ifdef SC_IS_BIGENDIAN
   fprintf (cont->vtufile, " byte_order=\"BigEndian\">\n");
 #else
@@ -474,12 +865,15 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
            (long long) Npoints, (long long) Ncells);
   fprintf (cont->vtufile, "      <Points>\n");
 
-  float_data = P4EST_ALLOC (P4EST_VTK_FLOAT_TYPE, 3 * Npoints);
-
   /* write point position data */
   fprintf (cont->vtufile, "        <DataArray type=\"%s\" Name=\"Position\""
            " NumberOfComponents=\"3\" format=\"%s\">\n",
-           P4EST_VTK_FLOAT_NAME, P4EST_VTK_FORMAT_STRING);
+           P4EST_VTK_FLOAT_NAME, p4est_vtk_format_string (cont));
+  if (cont->format != P4EST_VTK_FORMAT_ASCII) {
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (P4EST_VTK_FLOAT_TYPE) * 3 *
+                            Npoints);
+  }
 
   if (nodes == NULL) {
     /* loop over the trees */
@@ -519,10 +913,7 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
                 xyz[1] = eta_y;
                 xyz[2] = eta_z;
                 geom->X (geom, jt, xyz, XYZ);
-                for (j = 0; j < 3; ++j) {
-                  float_data[3 * (P4EST_CHILDREN * quad_count + k) + j] =
-                    (P4EST_VTK_FLOAT_TYPE) XYZ[j];
-                }
+                p4est_vtk_write_xyz (cont, XYZ);
               }
               else {
                 for (j = 0; j < 3; ++j) {
@@ -540,9 +931,8 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
 #endif
             );
                   /* *INDENT-ON* */
-                  float_data[3 * (P4EST_CHILDREN * quad_count + k) + j] =
-                    (P4EST_VTK_FLOAT_TYPE) xyz[j];
                 }
+                p4est_vtk_write_xyz (cont, xyz);
               }
               ++k;
             }
@@ -583,9 +973,7 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
         xyz[1] = eta_y;
         xyz[2] = eta_z;
         geom->X (geom, jt, xyz, XYZ);
-        for (j = 0; j < 3; ++j) {
-          float_data[3 * zz + j] = (P4EST_VTK_FLOAT_TYPE) XYZ[j];
-        }
+        p4est_vtk_write_xyz (cont, XYZ);
       }
       else {
         for (j = 0; j < 3; ++j) {
@@ -603,44 +991,21 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
   #endif
             );
           /* *INDENT-ON* */
-
-          float_data[3 * zz + j] = (P4EST_VTK_FLOAT_TYPE) xyz[j];
         }
+        p4est_vtk_write_xyz (cont, xyz);
       }
     }
   }
 
-#ifdef P4EST_VTK_ASCII
-  for (il = 0; il < Npoints; ++il) {
-    wx = float_data[3 * il + 0];
-    wy = float_data[3 * il + 1];
-    wz = float_data[3 * il + 2];
-
-    fprintf (cont->vtufile,
-#ifdef P4EST_VTK_DOUBLES
-             "     %24.16e %24.16e %24.16e\n",
-#else
-             "          %16.8e %16.8e %16.8e\n",
-#endif
-             wx, wy, wz);
-  }
-#else
-  fprintf (cont->vtufile, "          ");
-  /* TODO: Don't allocate the full size of the array, only allocate
-   * the chunk that will be passed to zlib and do this a chunk
-   * at a time.
-   */
-  retval = p4est_vtk_write_binary (cont->vtufile, (char *) float_data,
-                                   sizeof (*float_data) * 3 * Npoints);
-  fprintf (cont->vtufile, "\n");
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding points\n");
-    p4est_vtk_context_destroy (cont);
-    P4EST_FREE (float_data);
-    return NULL;
+  if (cont->format != P4EST_VTK_FORMAT_ASCII) {
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding points\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
+    }
   }
-#endif
-  P4EST_FREE (float_data);
 
   fprintf (cont->vtufile, "        </DataArray>\n");
   fprintf (cont->vtufile, "      </Points>\n");
@@ -649,102 +1014,95 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
   /* write connectivity data */
   fprintf (cont->vtufile,
            "        <DataArray type=\"%s\" Name=\"connectivity\""
-           " format=\"%s\">\n", P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-  for (sk = 0, il = 0; il < Ncells; ++il) {
-    fprintf (cont->vtufile, "         ");
-    for (k = 0; k < P4EST_CHILDREN; ++sk, ++k) {
-      fprintf (cont->vtufile, " %lld", nodes == NULL ?
-               (long long) sk : (long long) nodes->local_nodes[sk]);
-    }
-    fprintf (cont->vtufile, "\n");
-  }
-#else
-  fprintf (cont->vtufile, "          ");
-  if (nodes == NULL) {
-    locidx_data = P4EST_ALLOC (p4est_locidx_t, Ncorners);
-    for (il = 0; il < Ncorners; ++il) {
-      locidx_data[il] = il;
+           " format=\"%s\">\n", P4EST_VTK_LOCIDX,
+           p4est_vtk_format_string (cont));
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    for (sk = 0, il = 0; il < Ncells; ++il) {
+      fprintf (cont->vtufile, "         ");
+      for (k = 0; k < P4EST_CHILDREN; ++sk, ++k) {
+        fprintf (cont->vtufile, " %lld", nodes == NULL ?
+                 (long long) sk : (long long) nodes->local_nodes[sk]);
+      }
+      fprintf (cont->vtufile, "\n");
     }
-    retval =
-      p4est_vtk_write_binary (cont->vtufile, (char *) locidx_data,
-                              sizeof (p4est_locidx_t) * Ncorners);
-    P4EST_FREE (locidx_data);
   }
   else {
-    retval =
-      p4est_vtk_write_binary (cont->vtufile, (char *) nodes->local_nodes,
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (p4est_locidx_t) * Ncorners);
+    if (nodes == NULL) {
+      for (il = 0; il < Ncorners; ++il) {
+        p4est_vtk_stream_locidx (cont, il);
+      }
+    }
+    else {
+      p4est_vtk_stream_write (cont, nodes->local_nodes,
                               sizeof (p4est_locidx_t) * Ncorners);
+    }
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding connectivity\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
+    }
   }
-  fprintf (cont->vtufile, "\n");
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding connectivity\n");
-    p4est_vtk_context_destroy (cont);
-    return NULL;
-  }
-#endif
   fprintf (cont->vtufile, "        </DataArray>\n");
 
   /* write offset data */
   fprintf (cont->vtufile, "        <DataArray type=\"%s\" Name=\"offsets\""
-           " format=\"%s\">\n", P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-  fprintf (cont->vtufile, "         ");
-  for (il = 1, sk = 1; il <= Ncells; ++il, ++sk) {
-    fprintf (cont->vtufile, " %lld", (long long) (P4EST_CHILDREN * il));
-    if (!(sk % 8) && il != Ncells)
-      fprintf (cont->vtufile, "\n         ");
-  }
-  fprintf (cont->vtufile, "\n");
-#else
-  locidx_data = P4EST_ALLOC (p4est_locidx_t, Ncells);
-  for (il = 1; il <= Ncells; ++il)
-    locidx_data[il - 1] = P4EST_CHILDREN * il;  /* same type */
-
-  fprintf (cont->vtufile, "          ");
-  retval = p4est_vtk_write_binary (cont->vtufile, (char *) locidx_data,
-                                   sizeof (p4est_locidx_t) * Ncells);
-  fprintf (cont->vtufile, "\n");
-
-  P4EST_FREE (locidx_data);
-
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding offsets\n");
-    p4est_vtk_context_destroy (cont);
-    return NULL;
+           " format=\"%s\">\n", P4EST_VTK_LOCIDX,
+           p4est_vtk_format_string (cont));
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    fprintf (cont->vtufile, "         ");
+    for (il = 1, sk = 1; il <= Ncells; ++il, ++sk) {
+      fprintf (cont->vtufile, " %lld", (long long) (P4EST_CHILDREN * il));
+      if (!(sk % 8) && il != Ncells)
+        fprintf (cont->vtufile, "\n         ");
+    }
+    fprintf (cont->vtufile, "\n");
+  }
+  else {
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (p4est_locidx_t) * Ncells);
+    for (il = 1; il <= Ncells; ++il) {
+      p4est_vtk_stream_locidx (cont, P4EST_CHILDREN * il);
+    }
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding offsets\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
+    }
   }
-#endif
   fprintf (cont->vtufile, "        </DataArray>\n");
 
   /* write type data */
   fprintf (cont->vtufile, "        <DataArray type=\"UInt8\" Name=\"types\""
-           " format=\"%s\">\n", P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-  fprintf (cont->vtufile, "         ");
-  for (il = 0, sk = 1; il < Ncells; ++il, ++sk) {
-    fprintf (cont->vtufile, " %d", P4EST_VTK_CELL_TYPE);
-    if (!(sk % 20) && il != (Ncells - 1))
-      fprintf (cont->vtufile, "\n         ");
-  }
-  fprintf (cont->vtufile, "\n");
-#else
-  uint8_data = P4EST_ALLOC (uint8_t, Ncells);
-  for (il = 0; il < Ncells; ++il)
-    uint8_data[il] = P4EST_VTK_CELL_TYPE;
-
-  fprintf (cont->vtufile, "          ");
-  retval = p4est_vtk_write_binary (cont->vtufile, (char *) uint8_data,
-                                   sizeof (*uint8_data) * Ncells);
-  fprintf (cont->vtufile, "\n");
-
-  P4EST_FREE (uint8_data);
-
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
-    p4est_vtk_context_destroy (cont);
-    return NULL;
+           " format=\"%s\">\n", p4est_vtk_format_string (cont));
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    fprintf (cont->vtufile, "         ");
+    for (il = 0, sk = 1; il < Ncells; ++il, ++sk) {
+      fprintf (cont->vtufile, " %d", P4EST_VTK_CELL_TYPE);
+      if (!(sk % 20) && il != (Ncells - 1))
+        fprintf (cont->vtufile, "\n         ");
+    }
+    fprintf (cont->vtufile, "\n");
+  }
+  else {
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (uint8_t) * Ncells);
+    for (il = 0; il < Ncells; ++il) {
+      p4est_vtk_stream_uint8 (cont, P4EST_VTK_CELL_TYPE);
+    }
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
+    }
   }
-#endif
   fprintf (cont->vtufile, "        </DataArray>\n");
   fprintf (cont->vtufile, "      </Cells>\n");
 
@@ -768,9 +1126,9 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
     fprintf (cont->pvtufile, "<?xml version=\"1.0\"?>\n");
     fprintf (cont->pvtufile,
              "<VTKFile type=\"PUnstructuredGrid\" version=\"0.1\"");
-#if defined P4EST_VTK_BINARY && defined P4EST_VTK_COMPRESSION
-    fprintf (cont->pvtufile, " compressor=\"vtkZLibDataCompressor\"");
-#endif
+    if (cont->format == P4EST_VTK_FORMAT_COMPRESSED) {
+      fprintf (cont->pvtufile, " compressor=\"vtkZLibDataCompressor\"");
+    }
 #ifdef SC_IS_BIGENDIAN
     fprintf (cont->pvtufile, " byte_order=\"BigEndian\">\n");
 #else
@@ -781,7 +1139,7 @@ p4est_vtk_write_header (p4est_vtk_context_t * cont)
     fprintf (cont->pvtufile, "    <PPoints>\n");
     fprintf (cont->pvtufile, "      <PDataArray type=\"%s\" Name=\"Position\""
              " NumberOfComponents=\"3\" format=\"%s\"/>\n",
-             P4EST_VTK_FLOAT_NAME, P4EST_VTK_FORMAT_STRING);
+             P4EST_VTK_FLOAT_NAME, p4est_vtk_format_string (cont));
     fprintf (cont->pvtufile, "    </PPoints>\n");
 
     if (ferror (cont->pvtufile)) {
@@ -966,13 +1324,15 @@ p4est_vtk_write_point_datav (p4est_vtk_context_t * cont,
     for (i = 0; i < num_point_scalars; ++all, i++)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"%s\" format=\"%s\"/>\n",
-               P4EST_VTK_FLOAT_NAME, names[all], P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_FLOAT_NAME, names[all],
+               p4est_vtk_format_string (cont));
 
     for (i = 0; i < num_point_vectors; ++all, i++)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"3\" "
                "format=\"%s\"/>\n",
-               P4EST_VTK_FLOAT_NAME, names[all], P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_FLOAT_NAME, names[all],
+               p4est_vtk_format_string (cont));
 
     fprintf (cont->pvtufile, "    </PPointData>\n");
 
@@ -1051,12 +1411,7 @@ p4est_vtk_write_cell_datav (p4est_vtk_context_t * cont,
   size_t              num_quads, zz;
   sc_array_t         *quadrants;
   p4est_quadrant_t   *quad;
-#ifdef P4EST_VTK_ASCII
   p4est_locidx_t      sk;
-#else
-  uint8_t            *uint8_data;
-  p4est_locidx_t     *locidx_data;
-#endif
   p4est_topidx_t      jt;
   p4est_locidx_t      il;
 
@@ -1160,100 +1515,93 @@ p4est_vtk_write_cell_datav (p4est_vtk_context_t * cont,
   fprintf (cont->vtufile, "      <CellData Scalars=\"%s\">\n",
            vtkCellDataString);
 
-#ifndef P4EST_VTK_ASCII
-  locidx_data = P4EST_ALLOC (p4est_locidx_t, Ncells);
-  uint8_data = P4EST_ALLOC (uint8_t, Ncells);
-#endif
-
   if (write_tree) {
     fprintf (cont->vtufile, "        <DataArray type=\"%s\" Name=\"treeid\""
-             " format=\"%s\">\n", P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-    fprintf (cont->vtufile, "         ");
-    for (il = 0, sk = 1, jt = first_local_tree; jt <= last_local_tree; ++jt) {
-      tree = p4est_tree_array_index (trees, jt);
-      num_quads = tree->quadrants.elem_count;
-      for (zz = 0; zz < num_quads; ++zz, ++sk, ++il) {
-        fprintf (cont->vtufile, " %lld", (long long) jt);
-        if (!(sk % 20) && il != (Ncells - 1))
-          fprintf (cont->vtufile, "\n         ");
+             " format=\"%s\">\n", P4EST_VTK_LOCIDX,
+             p4est_vtk_format_string (cont));
+    if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+      fprintf (cont->vtufile, "         ");
+      for (il = 0, sk = 1, jt = first_local_tree; jt <= last_local_tree;
+           ++jt) {
+        tree = p4est_tree_array_index (trees, jt);
+        num_quads = tree->quadrants.elem_count;
+        for (zz = 0; zz < num_quads; ++zz, ++sk, ++il) {
+          fprintf (cont->vtufile, " %lld", (long long) jt);
+          if (!(sk % 20) && il != (Ncells - 1))
+            fprintf (cont->vtufile, "\n         ");
+        }
       }
+      fprintf (cont->vtufile, "\n");
     }
-    fprintf (cont->vtufile, "\n");
-#else
-    for (il = 0, jt = first_local_tree; jt <= last_local_tree; ++jt) {
-      tree = p4est_tree_array_index (trees, jt);
-      num_quads = tree->quadrants.elem_count;
-      for (zz = 0; zz < num_quads; ++zz, ++il) {
-        locidx_data[il] = (p4est_locidx_t) jt;
+    else {
+      fprintf (cont->vtufile, "          ");
+      p4est_vtk_stream_begin (cont, sizeof (p4est_locidx_t) * Ncells);
+      for (il = 0, jt = first_local_tree; jt <= last_local_tree; ++jt) {
+        tree = p4est_tree_array_index (trees, jt);
+        num_quads = tree->quadrants.elem_count;
+        for (zz = 0; zz < num_quads; ++zz, ++il) {
+          p4est_vtk_stream_locidx (cont, (p4est_locidx_t) jt);
+        }
       }
-    }
-    fprintf (cont->vtufile, "          ");
-    retval = p4est_vtk_write_binary (cont->vtufile, (char *) locidx_data,
-                                     sizeof (*locidx_data) * Ncells);
-    fprintf (cont->vtufile, "\n");
-    if (retval) {
-      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
-      p4est_vtk_context_destroy (cont);
+      retval = p4est_vtk_stream_end (cont);
+      fprintf (cont->vtufile, "\n");
+      if (retval) {
+        P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
+        p4est_vtk_context_destroy (cont);
 
-      P4EST_FREE (values);
-      P4EST_FREE (names);
-      P4EST_FREE (locidx_data);
-      P4EST_FREE (uint8_data);
+        P4EST_FREE (values);
+        P4EST_FREE (names);
 
-      return NULL;
+        return NULL;
+      }
     }
-#endif
     fprintf (cont->vtufile, "        </DataArray>\n");
     P4EST_ASSERT (il == Ncells);
   }
 
   if (write_level) {
     fprintf (cont->vtufile, "        <DataArray type=\"%s\" Name=\"level\""
-             " format=\"%s\">\n", "UInt8", P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-    fprintf (cont->vtufile, "         ");
-    for (il = 0, sk = 1, jt = first_local_tree; jt <= last_local_tree; ++jt) {
-      tree = p4est_tree_array_index (trees, jt);
-      quadrants = &tree->quadrants;
-      num_quads = quadrants->elem_count;
-      for (zz = 0; zz < num_quads; ++zz, ++sk, ++il) {
-        quad = p4est_quadrant_array_index (quadrants, zz);
-        fprintf (cont->vtufile, " %d", (int) quad->level);
-        if (!(sk % 20) && il != (Ncells - 1))
-          fprintf (cont->vtufile, "\n         ");
+             " format=\"%s\">\n", "UInt8", p4est_vtk_format_string (cont));
+    if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+      fprintf (cont->vtufile, "         ");
+      for (il = 0, sk = 1, jt = first_local_tree; jt <= last_local_tree;
+           ++jt) {
+        tree = p4est_tree_array_index (trees, jt);
+        quadrants = &tree->quadrants;
+        num_quads = quadrants->elem_count;
+        for (zz = 0; zz < num_quads; ++zz, ++sk, ++il) {
+          quad = p4est_quadrant_array_index (quadrants, zz);
+          fprintf (cont->vtufile, " %d", (int) quad->level);
+          if (!(sk % 20) && il != (Ncells - 1))
+            fprintf (cont->vtufile, "\n         ");
+        }
       }
+      fprintf (cont->vtufile, "\n");
     }
-    fprintf (cont->vtufile, "\n");
-#else
-    for (il = 0, jt = first_local_tree; jt <= last_local_tree; ++jt) {
-      tree = p4est_tree_array_index (trees, jt);
-      quadrants = &tree->quadrants;
-      num_quads = quadrants->elem_count;
-      for (zz = 0; zz < num_quads; ++zz, ++il) {
-        quad = p4est_quadrant_array_index (quadrants, zz);
-        uint8_data[il] = (uint8_t) quad->level;
+    else {
+      fprintf (cont->vtufile, "          ");
+      p4est_vtk_stream_begin (cont, sizeof (uint8_t) * Ncells);
+      for (jt = first_local_tree; jt <= last_local_tree; ++jt) {
+        tree = p4est_tree_array_index (trees, jt);
+        quadrants = &tree->quadrants;
+        num_quads = quadrants->elem_count;
+        for (zz = 0; zz < num_quads; ++zz) {
+          quad = p4est_quadrant_array_index (quadrants, zz);
+          p4est_vtk_stream_uint8 (cont, (uint8_t) quad->level);
+        }
       }
-    }
-
-    fprintf (cont->vtufile, "          ");
-    retval = p4est_vtk_write_binary (cont->vtufile, (char *) uint8_data,
-                                     sizeof (*uint8_data) * Ncells);
-    fprintf (cont->vtufile, "\n");
-
-    P4EST_FREE (uint8_data);
-
-    if (retval) {
-      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
-      p4est_vtk_context_destroy (cont);
+      retval = p4est_vtk_stream_end (cont);
+      fprintf (cont->vtufile, "\n");
+      if (retval) {
+        P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
+        p4est_vtk_context_destroy (cont);
 
-      P4EST_FREE (values);
-      P4EST_FREE (names);
-      P4EST_FREE (locidx_data);
+        P4EST_FREE (values);
+        P4EST_FREE (names);
 
-      return NULL;
+        return NULL;
+      }
     }
-#endif
     fprintf (cont->vtufile, "        </DataArray>\n");
   }
 
@@ -1262,36 +1610,35 @@ p4est_vtk_write_cell_datav (p4est_vtk_context_t * cont,
       wrap_rank > 0 ? mpirank % wrap_rank : mpirank;
 
     fprintf (cont->vtufile, "        <DataArray type=\"%s\" Name=\"mpirank\""
-             " format=\"%s\">\n", P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-    fprintf (cont->vtufile, "         ");
-    for (il = 0, sk = 1; il < Ncells; ++il, ++sk) {
-      fprintf (cont->vtufile, " %d", wrapped_rank);
-      if (!(sk % 20) && il != (Ncells - 1))
-        fprintf (cont->vtufile, "\n         ");
+             " format=\"%s\">\n", P4EST_VTK_LOCIDX,
+             p4est_vtk_format_string (cont));
+    if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+      fprintf (cont->vtufile, "         ");
+      for (il = 0, sk = 1; il < Ncells; ++il, ++sk) {
+        fprintf (cont->vtufile, " %d", wrapped_rank);
+        if (!(sk % 20) && il != (Ncells - 1))
+          fprintf (cont->vtufile, "\n         ");
+      }
+      fprintf (cont->vtufile, "\n");
     }
-    fprintf (cont->vtufile, "\n");
-#else
-    for (il = 0; il < Ncells; ++il)
-      locidx_data[il] = (p4est_locidx_t) wrapped_rank;
-
-    fprintf (cont->vtufile, "          ");
-    retval = p4est_vtk_write_binary (cont->vtufile, (char *) locidx_data,
-                                     sizeof (*locidx_data) * Ncells);
-    fprintf (cont->vtufile, "\n");
-
-    P4EST_FREE (locidx_data);
+    else {
+      fprintf (cont->vtufile, "          ");
+      p4est_vtk_stream_begin (cont, sizeof (p4est_locidx_t) * Ncells);
+      for (il = 0; il < Ncells; ++il) {
+        p4est_vtk_stream_locidx (cont, (p4est_locidx_t) wrapped_rank);
+      }
+      retval = p4est_vtk_stream_end (cont);
+      fprintf (cont->vtufile, "\n");
+      if (retval) {
+        P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
+        p4est_vtk_context_destroy (cont);
 
-    if (retval) {
-      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding types\n");
-      p4est_vtk_context_destroy (cont);
+        P4EST_FREE (values);
+        P4EST_FREE (names);
 
-      P4EST_FREE (values);
-      P4EST_FREE (names);
-
-      return NULL;
+        return NULL;
+      }
     }
-#endif
     fprintf (cont->vtufile, "        </DataArray>\n");
   }
 
@@ -1341,29 +1688,31 @@ p4est_vtk_write_cell_datav (p4est_vtk_context_t * cont,
     if (write_tree)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"treeid\" format=\"%s\"/>\n",
-               P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_LOCIDX, p4est_vtk_format_string (cont));
 
     if (write_level)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"level\" format=\"%s\"/>\n",
-               "UInt8", P4EST_VTK_FORMAT_STRING);
+               "UInt8", p4est_vtk_format_string (cont));
 
     if (write_rank)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"mpirank\" format=\"%s\"/>\n",
-               P4EST_VTK_LOCIDX, P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_LOCIDX, p4est_vtk_format_string (cont));
 
     all = 0;
     for (i = 0; i < num_cell_scalars; ++all, i++)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" Name=\"%s\" format=\"%s\"/>\n",
-               P4EST_VTK_FLOAT_NAME, names[all], P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_FLOAT_NAME, names[all],
+               p4est_vtk_format_string (cont));
 
     for (i = 0; i < num_cell_vectors; ++all, i++)
       fprintf (cont->pvtufile, "      "
                "<PDataArray type=\"%s\" NumberOfComponents=\"3\" Name=\"%s\" "
                "format=\"%s\"/>\n",
-               P4EST_VTK_FLOAT_NAME, names[all], P4EST_VTK_FORMAT_STRING);
+               P4EST_VTK_FLOAT_NAME, names[all],
+               p4est_vtk_format_string (cont));
 
     fprintf (cont->pvtufile, "    </PCellData>\n");
 
@@ -1413,15 +1762,13 @@ p4est_vtk_write_point (p4est_vtk_context_t * cont,
 {
   p4est_locidx_t      il, ddl;
   int                 use_nodes;
+  int                 j, ncomp;
 #ifdef P4EST_ENABLE_DEBUG
   int                 Ncorners;
   int                 Nentries;
 #endif
   int                 Npoints;
-#ifndef P4EST_VTK_ASCII
   int                 retval;
-  P4EST_VTK_FLOAT_TYPE *float_data;
-#endif
   p4est_locidx_t     *ntc;
 
   P4EST_ASSERT (cont != NULL && cont->writing);
@@ -1431,6 +1778,7 @@ p4est_vtk_write_point (p4est_vtk_context_t * cont,
 #endif
   Npoints = cont->num_points;
   ntc = cont->node_to_corner;
+  ncomp = is_vector ? 3 : 1;
 
   P4EST_ASSERT (values != NULL && values->elem_count == (size_t) Nentries);
 
@@ -1451,84 +1799,60 @@ p4est_vtk_write_point (p4est_vtk_context_t * cont,
            " format=\"%s\">\n",
            P4EST_VTK_FLOAT_NAME,
            is_vector ? "NumberOfComponents=\"3\"" : "", field_name,
-           P4EST_VTK_FORMAT_STRING);
+           p4est_vtk_format_string (cont));
 
-#ifdef P4EST_VTK_ASCII
-  if (!is_vector) {
-    for (il = 0; il < Npoints; ++il) {
-      ddl = use_nodes ? ntc[il] : il;
-      P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    if (!is_vector) {
+      for (il = 0; il < Npoints; ++il) {
+        ddl = use_nodes ? ntc[il] : il;
+        P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
 
-      fprintf (cont->vtufile,
+        fprintf (cont->vtufile,
 #ifdef P4EST_VTK_DOUBLES
-               "     %24.16e\n",
+                 "     %24.16e\n",
 #else
-               "          %16.8e\n",
+                 "          %16.8e\n",
 #endif
-               *(double *) sc_array_index (values, ddl));
+                 *(double *) sc_array_index (values, ddl));
+      }
     }
-  }
-  else {
-    for (il = 0; il < Npoints; ++il) {
-      ddl = use_nodes ? ntc[il] : il;
-      P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
+    else {
+      for (il = 0; il < Npoints; ++il) {
+        ddl = use_nodes ? ntc[il] : il;
+        P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
 
-      fprintf (cont->vtufile,
+        fprintf (cont->vtufile,
 #ifdef P4EST_VTK_DOUBLES
-               "     %24.16e %24.16e %24.16e\n",
+                 "     %24.16e %24.16e %24.16e\n",
 #else
-               "          %16.8e %16.8e %16.8e\n",
+                 "          %16.8e %16.8e %16.8e\n",
 #endif
-               *(double *) sc_array_index (values, 3 * ddl),
-               *(double *) sc_array_index (values, 3 * ddl + 1),
-               *(double *) sc_array_index (values, 3 * ddl + 2));
-    }
-  }
-#else
-  if (!is_vector) {
-    float_data = P4EST_ALLOC (P4EST_VTK_FLOAT_TYPE, Npoints);
-    for (il = 0; il < Npoints; ++il) {
-      ddl = use_nodes ? ntc[il] : il;
-      P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
-      float_data[il] =
-        (P4EST_VTK_FLOAT_TYPE) * ((double *) sc_array_index (values, ddl));
+                 *(double *) sc_array_index (values, 3 * ddl),
+                 *(double *) sc_array_index (values, 3 * ddl + 1),
+                 *(double *) sc_array_index (values, 3 * ddl + 2));
+      }
     }
   }
   else {
-    float_data = P4EST_ALLOC (P4EST_VTK_FLOAT_TYPE, Npoints * 3);
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (P4EST_VTK_FLOAT_TYPE) *
+                            Npoints * ncomp);
     for (il = 0; il < Npoints; ++il) {
       ddl = use_nodes ? ntc[il] : il;
       P4EST_ASSERT (0 <= ddl && ddl < Ncorners);
-      float_data[3 * il] =
-        (P4EST_VTK_FLOAT_TYPE) *
-        ((double *) sc_array_index (values, 3 * ddl));
-      float_data[3 * il + 1] =
-        (P4EST_VTK_FLOAT_TYPE) *
-        ((double *) sc_array_index (values, 3 * ddl + 1));
-      float_data[3 * il + 2] =
-        (P4EST_VTK_FLOAT_TYPE) *
-        ((double *) sc_array_index (values, 3 * ddl + 2));
+      for (j = 0; j < ncomp; ++j) {
+        p4est_vtk_stream_float
+          (cont, *(double *) sc_array_index (values, ncomp * ddl + j));
+      }
+    }
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding points\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
     }
   }
-
-  fprintf (cont->vtufile, "          ");
-  /* TODO: Don't allocate the full size of the array, only allocate
-   * the chunk that will be passed to zlib and do this a chunk
-   * at a time.
-   */
-  retval = p4est_vtk_write_binary (cont->vtufile, (char *) float_data,
-                                   sizeof (*float_data) * Npoints
-                                   * (is_vector ? 3 : 1));
-  fprintf (cont->vtufile, "\n");
-
-  P4EST_FREE (float_data);
-
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding points\n");
-    p4est_vtk_context_destroy (cont);
-    return NULL;
-  }
-#endif
   fprintf (cont->vtufile, "        </DataArray>\n");
 
   if (ferror (cont->vtufile)) {
@@ -1563,11 +1887,9 @@ p4est_vtk_write_cell (p4est_vtk_context_t * cont,
                       int is_vector)
 {
   const p4est_locidx_t Ncells = cont->p4est->local_num_quadrants;
+  const int           ncomp = is_vector ? 3 : 1;
   p4est_locidx_t      il;
-#ifndef P4EST_VTK_ASCII
   int                 retval;
-  P4EST_VTK_FLOAT_TYPE *float_data;
-#endif
 
   P4EST_ASSERT (cont != NULL && cont->writing);
 
@@ -1575,74 +1897,49 @@ p4est_vtk_write_cell (p4est_vtk_context_t * cont,
   fprintf (cont->vtufile, "        <DataArray type=\"%s\" %s Name=\"%s\""
            " format=\"%s\">\n",
            P4EST_VTK_FLOAT_NAME, is_vector ? "NumberOfComponents=\"3\"" : "",
-           field_name, P4EST_VTK_FORMAT_STRING);
-#ifdef P4EST_VTK_ASCII
-  if (!is_vector) {
-    for (il = 0; il < Ncells; ++il) {
-      fprintf (cont->vtufile,
+           field_name, p4est_vtk_format_string (cont));
+  if (cont->format == P4EST_VTK_FORMAT_ASCII) {
+    if (!is_vector) {
+      for (il = 0; il < Ncells; ++il) {
+        fprintf (cont->vtufile,
 #ifdef P4EST_VTK_DOUBLES
-               "     %24.16e\n",
+                 "     %24.16e\n",
 #else
-               "          %16.8e\n",
+                 "          %16.8e\n",
 #endif
-               *(double *) sc_array_index (values, il));
+                 *(double *) sc_array_index (values, il));
+      }
     }
-  }
-  else {
-    /* Write vector data */
-    for (il = 0; il < Ncells; ++il) {
-      fprintf (cont->vtufile,
+    else {
+      /* Write vector data */
+      for (il = 0; il < Ncells; ++il) {
+        fprintf (cont->vtufile,
 #ifdef P4EST_VTK_DOUBLES
-               "     %24.16e  %24.16e  %24.16e\n",
+                 "     %24.16e  %24.16e  %24.16e\n",
 #else
-               "          %16.8e  %16.8e  %16.8e\n",
+                 "          %16.8e  %16.8e  %16.8e\n",
 #endif
-               *(double *) sc_array_index (values, 3 * il),
-               *(double *) sc_array_index (values, 3 * il + 1),
-               *(double *) sc_array_index (values, 3 * il + 2));
-    }
-  }
-#else
-  if (!is_vector) {
-    float_data = P4EST_ALLOC (P4EST_VTK_FLOAT_TYPE, Ncells);
-    for (il = 0; il < Ncells; ++il) {
-      float_data[il] =
-        (P4EST_VTK_FLOAT_TYPE) * ((double *) sc_array_index (values, il));
+                 *(double *) sc_array_index (values, 3 * il),
+                 *(double *) sc_array_index (values, 3 * il + 1),
+                 *(double *) sc_array_index (values, 3 * il + 2));
+      }
     }
   }
   else {
-    /* vector data */
-    float_data = P4EST_ALLOC (P4EST_VTK_FLOAT_TYPE, 3 * Ncells);
-    for (il = 0; il < Ncells; ++il) {
-      float_data[3 * il] =
-        (P4EST_VTK_FLOAT_TYPE) * ((double *) sc_array_index (values, 3 * il));
-      float_data[3 * il + 1] =
-        (P4EST_VTK_FLOAT_TYPE) *
-        ((double *) sc_array_index (values, 3 * il + 1));
-      float_data[3 * il + 2] =
-        (P4EST_VTK_FLOAT_TYPE) *
-        ((double *) sc_array_index (values, 3 * il + 2));
+    fprintf (cont->vtufile, "          ");
+    p4est_vtk_stream_begin (cont, sizeof (P4EST_VTK_FLOAT_TYPE) *
+                            Ncells * ncomp);
+    for (il = 0; il < ncomp * Ncells; ++il) {
+      p4est_vtk_stream_float (cont, *(double *) sc_array_index (values, il));
+    }
+    retval = p4est_vtk_stream_end (cont);
+    fprintf (cont->vtufile, "\n");
+    if (retval) {
+      P4EST_LERROR (P4EST_STRING "_vtk: Error encoding scalar cell data\n");
+      p4est_vtk_context_destroy (cont);
+      return NULL;
     }
   }
-
-  fprintf (cont->vtufile, "          ");
-  /* TODO: Don't allocate the full size of the array, only allocate
-   * the chunk that will be passed to zlib and do this a chunk
-   * at a time.
-   */
-  retval = p4est_vtk_write_binary (cont->vtufile, (char *) float_data,
-                                   sizeof (*float_data) * Ncells
-                                   * (is_vector ? 3 : 1));
-  fprintf (cont->vtufile, "\n");
-
-  P4EST_FREE (float_data);
-
-  if (retval) {
-    P4EST_LERROR (P4EST_STRING "_vtk: Error encoding scalar cell data\n");
-    p4est_vtk_context_destroy (cont);
-    return NULL;
-  }
-#endif
   fprintf (cont->vtufile, "        </DataArray>\n");
 
   if (ferror (cont->vtufile)) {
@@ -312,6 +312,30 @@ int                 p8est_next_nonempty_process (int rank,
                                                  p4est_locidx_t *
                                                  num_quadrants_in_proc);
 
+/** Begin to partition \a p8est given the number of quadrants per proc.
+ * The messages are posted, but the forest is not changed until
+ * \ref p8est_partition_given_end is called.
+ *
+ * \param [in] p8est     the forest that is partitioned.
+ * \param [in] num_quadrants_in_proc  an integer array of the number of
+ *                        quadrants desired per processor.  It may be
+ *                        freed after this function returns.
+ * \return               Context to be passed to
+ *                        \ref p8est_partition_given_end.
+ */
+p8est_partition_context_t *p8est_partition_given_begin (p8est_t * p8est,
+                                                        const p4est_locidx_t
+                                                        *
+                                                        num_quadrants_in_proc);
+
+/** Complete a partition started by \ref p8est_partition_given_begin.
+ *
+ * \param [in] pc        The context is deallocated before returning.
+ * \return               Returns the global count of shipped quadrants.
+ */
+p4est_gloidx_t      p8est_partition_given_end (p8est_partition_context_t *
+                                               pc);
+
 /** Partition \a p8est given the number of quadrants per proc.
  *
  * Given the desired number of quadrants per proc \a num_quadrants_in_proc
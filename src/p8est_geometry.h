@@ -30,7 +30,7 @@
 #ifndef P8EST_GEOMETRY_H
 #define P8EST_GEOMETRY_H
 
-#include <p8est_connectivity.h>
+#include <p8est_ghost.h>
 
 SC_EXTERN_C_BEGIN;
 
@@ -64,6 +64,62 @@ struct p8est_geometry
                                              NULL, P4EST_FREE is called. */
 };
 
+/** Geometric data of the local and ghost octants of a forest.
+ * It is computed at a tensor product of Gauss-Legendre points on every
+ * octant and is meant to replace the repeated evaluation of the geometry
+ * in time stepping loops.  All derivatives are taken with respect to the
+ * octant reference coordinates in [0, 1]^3, such that the
+ * integral of a function over an octant is the sum over its points
+ * of the function times \a weights times \a detJ.
+ *
+ * The data is stored as a structure of arrays.  For each field, all values
+ * of one component are contiguous, octant by octant, and point by point
+ * within an octant.  Octant q runs over the local octants followed by
+ * the ghosts, and the volume points are ordered with x running fastest.
+ * The face points of face f are ordered likewise over the directions
+ * tangential to the face.  With nq = local_num_quadrants +
+ * ghost_num_quadrants, np = num_points and nfp = num_face_points:
+ *
+ *  - xyz[(j * nq + q) * np + i] is physical coordinate j of point i.
+ *  - jacobian[((3 * k + j) * nq + q) * np + i] is the derivative of
+ *    physical coordinate j with respect to reference coordinate k.
+ *  - detJ[q * np + i] is the Jacobian determinant.
+ *  - volume[q] is the volume of the octant.
+ *  - normal[((j * nq + q) * P8EST_FACES + f) * nfp + i] is component j of
+ *    the unit outward normal on face f.
+ *  - face_detJ[(q * P8EST_FACES + f) * nfp + i] is the area element
+ *    of the face.
+ *
+ * The cache stays valid until the forest changes, which is detected by
+ * its revision counter; see p8est_geometry_cache_update.
+ */
+typedef struct p8est_geometry_cache
+{
+  p8est_t            *p4est;            /**< The forest referenced. */
+  p8est_geometry_t   *geom;             /**< The geometry referenced, or
+                                             NULL for the vertices of the
+                                             connectivity. */
+  long                revision;         /**< Revision of the forest at the
+                                             time of computation. */
+  int                 degree;           /**< Gauss points per direction. */
+  int                 num_points;       /**< Points per octant. */
+  int                 num_face_points;  /**< Points per face. */
+  p4est_locidx_t      local_num_quadrants;      /**< Local octants. */
+  p4est_locidx_t      ghost_num_quadrants;      /**< Ghost octants, 0 if
+                                                     no ghost layer given. */
+  double             *points;           /**< The \a degree Gauss points
+                                             in [0, 1]. */
+  double             *weights;          /**< Weights of the volume points. */
+  double             *face_weights;     /**< Weights of the face points. */
+  double             *xyz;              /**< 3 components. */
+  double             *jacobian;         /**< 9 components. */
+  double             *detJ;             /**< Jacobian determinants. */
+  double             *volume;           /**< One value per octant. */
+  double             *normal;           /**< 3 components. */
+  double             *face_detJ;        /**< Surface Jacobians. */
+}
+p8est_geometry_cache_t;
+
 /** Can be used to conveniently destroy a geometry structure.
  * The user is free not to call this function at all if they handle the
  * memory of the p8est_geometry_t in their own way.
@@ -101,6 +157,55 @@ p8est_geometry_t   *p8est_geometry_new_sphere (p8est_connectivity_t * conn,
                                                double R2, double R1,
                                                double R0);
 
+/** Compute the geometric data of all local octants and the ghosts.
+ * The local data is computed independently on each process, while the
+ * ghost data is received by a ghost exchange.  This function is collective
+ * if and only if \a ghost is not NULL.
+ * If \a geom is NULL, the multilinear map of the tree vertices is
+ * differentiated exactly.  Otherwise the derivatives of the geometry are
+ * approximated by second order differences with a step of 1e-4 times the
+ * octant length, but at least 1.5e-8 in the unit tree to limit rounding.
+ * For maps whose derivatives vary on the scale of the tree, the relative
+ * error of the Jacobian is thus about 1e-8 independent of the octant
+ * level; maps that vary on much shorter scales are less accurate.
+ * \param [in] p4est    The forest is not modified.  It must stay alive
+ *                      and the cache must be updated after it changes.
+ * \param [in] ghost    If not NULL, the ghost layer of \a p4est whose data
+ *                      is appended after the local octants.
+ * \param [in] geom     If not NULL, the geometry transformation used.
+ *                      Must stay alive until the cache is destroyed.
+ *                      If NULL, the vertices of the connectivity are used.
+ * \param [in] degree   Number of Gauss points per direction, positive.
+ * \return              A cache to be freed with p8est_geometry_cache_destroy.
+ */
+p8est_geometry_cache_t *p8est_geometry_cache_new (p8est_t * p4est,
+                                                  p8est_ghost_t * ghost,
+                                                  p8est_geometry_t * geom,
+                                                  int degree);
+
+/** Free the memory of a geometry cache. */
+void                p8est_geometry_cache_destroy (p8est_geometry_cache_t *
+                                                  cache);
+
+/** Check whether the forest has changed since the cache was computed.
+ * \param [in] cache    A valid geometry cache.
+ * \return              True if the revision of the forest matches.
+ */
+int                 p8est_geometry_cache_is_current (p8est_geometry_cache_t *
+                                                     cache);
+
+/** Recompute the geometry cache if the forest has changed.
+ * This function is collective if and only if \a ghost is not NULL.
+ * To use a different ghost layer with an unchanged forest, destroy the
+ * cache and create it anew.
+ * \param [in,out] cache    A valid geometry cache.
+ * \param [in] ghost    If not NULL, the current ghost layer of the forest.
+ * \return              True if the data has been recomputed.
+ */
+int                 p8est_geometry_cache_update (p8est_geometry_cache_t *
+                                                 cache,
+                                                 p8est_ghost_t * ghost);
+
 SC_EXTERN_C_END;
 
 #endif /* !P8EST_GEOMETRY_H */
@@ -33,6 +33,7 @@
 #define P8EST_GHOST_H
 
 #include <p8est.h>
+#include <sc_statistics.h>
 
 SC_EXTERN_C_BEGIN;
 
@@ -381,6 +382,44 @@ void                p8est_ghost_exchange_custom_levels_end
 void                p8est_ghost_expand (p8est_t * p8est,
                                         p8est_ghost_t * ghost);
 
+/** Indices into the statistics computed by \ref p8est_partition_stats. */
+typedef enum
+{
+  P8EST_PARTITION_STATS_QUADRANTS,      /**< Number of local quadrants. */
+  P8EST_PARTITION_STATS_WEIGHT,         /**< Sum of local quadrant weights. */
+  P8EST_PARTITION_STATS_PEERS,          /**< Number of processes that we
+                                             exchange ghost data with. */
+  P8EST_PARTITION_STATS_FACES,          /**< Number of local quadrant faces
+                                             that touch a remote process. */
+  P8EST_PARTITION_STATS_MIRRORS,        /**< Number of mirror quadrants. */
+  P8EST_PARTITION_STATS_BYTES,          /**< Bytes sent by one ghost
+                                             exchange of \a data_size. */
+  P8EST_PARTITION_STATS_LAST            /**< Number of statistics. */
+}
+p8est_partition_stats_type_t;
+
+/** Compute metrics to judge the quality of the current partition.
+ * The faces are counted by a scan over the mirror quadrants only.
+ * This function is collective.
+ * \param [in] p8est        The forest whose partition is measured.
+ * \param [in] ghost        Ghost layer of the forest of any connect type.
+ * \param [in] weight_fn    Partition weight callback as in
+ *                          \ref p8est_partition.  If NULL, each quadrant
+ *                          has weight one.
+ * \param [in] data_size    Bytes per quadrant in a ghost exchange.
+ * \param [out] values      If not NULL, P8EST_PARTITION_STATS_LAST entries
+ *                          are filled with the values on this process.
+ * \param [out] stats       If not NULL, P8EST_PARTITION_STATS_LAST entries
+ *                          are filled with the global minimum, maximum and
+ *                          average over all processes.  If NULL, the
+ *                          statistics are printed at SC_LP_STATISTICS.
+ */
+void                p8est_partition_stats (p8est_t * p8est,
+                                           p8est_ghost_t * ghost,
+                                           p8est_weight_t weight_fn,
+                                           size_t data_size, double *values,
+                                           sc_statinfo_t * stats);
+
 SC_EXTERN_C_END;
 
 #endif /* !P8EST_GHOST_H */
@@ -251,6 +251,90 @@ p8est_lnodes_t     *p8est_lnodes_new (p8est_t * p8est,
 
 void                p8est_lnodes_destroy (p8est_lnodes_t * lnodes);
 
+/** Orderings of the owned nodes for \ref p8est_lnodes_reorder. */
+typedef enum
+{
+  P8EST_LNODES_ORDER_SFC,       /**< Order of first touch by the elements,
+                                     which follow the space filling curve. */
+  P8EST_LNODES_ORDER_RCM        /**< Reverse Cuthill-McKee order of the graph
+                                     of nodes sharing an element. */
+}
+p8est_lnodes_order_t;
+
+/** Renumber the owned nodes of every process to improve locality.
+ * The element_nodes, nonlocal_nodes and sharers are updated consistently,
+ * such that the nodes owned by another process remain sorted by their
+ * global numbers.  The global numbers of owned nodes change, while the
+ * number of nodes per process and the global offsets are kept.
+ * This function is collective.
+ * \param [in,out] lnodes   The node numbering to change.
+ * \param [in] order        The ordering of the owned nodes.
+ * \param [out] bandwidth   If not NULL, the local bandwidth before and after,
+ *                          that is the largest difference between the owned
+ *                          nodes of any one element.
+ */
+void                p8est_lnodes_reorder (p8est_lnodes_t * lnodes,
+                                          p8est_lnodes_order_t order,
+                                          p4est_locidx_t bandwidth[2]);
+
+/** Opaque interpolation tables for the hanging nodes of a p8est_lnodes_t,
+ * created by \ref p8est_lnodes_hanging_new. */
+typedef struct p8est_lnodes_hanging p8est_lnodes_hanging_t;
+
+/** Precompute the hanging node interpolation for every face_code
+ * that occurs in a node numbering of positive degree.
+ * The value at a hanging node is interpolated from the nodes of the parent
+ * octant on the same hanging face or edge, which are referenced by the
+ * element_nodes entries of the hanging face or edge.
+ * \param [in] lnodes   Node numbering with positive degree.  It must stay
+ *                      alive and unchanged while the tables are used.
+ * \param [in] points   The degree + 1 ascending coordinates of the nodes in
+ *                      one dimension on the reference interval [-1, 1],
+ *                      such as the Gauss-Lobatto points.
+ *                      If NULL, the nodes are equidistant.
+ * \return              Free with \ref p8est_lnodes_hanging_destroy.
+ */
+p8est_lnodes_hanging_t *p8est_lnodes_hanging_new (p8est_lnodes_t * lnodes,
+                                                  const double *points);
+
+/** Free the interpolation tables.
+ * \param [in] hanging  Tables created by \ref p8est_lnodes_hanging_new.
+ */
+void                p8est_lnodes_hanging_destroy (p8est_lnodes_hanging_t *
+                                                  hanging);
+
+/** Gather the element values of a range of elements from a node vector
+ * and interpolate them at hanging nodes.
+ * \param [in] hanging  Tables created by \ref p8est_lnodes_hanging_new.
+ * \param [in] u        One value for each local node.
+ * \param [in] first    The first element of the range.
+ * \param [in] count    The number of elements in the range.
+ * \param [out] ue      For each element of the range, vnodes values
+ *                      in the order of element_nodes.
+ */
+void                p8est_lnodes_gather (p8est_lnodes_hanging_t * hanging,
+                                         const double *u,
+                                         p4est_locidx_t first,
+                                         p4est_locidx_t count, double *ue);
+
+/** Add the element values of a range of elements into a node vector,
+ * applying the transpose of the hanging node interpolation.
+ * This is the transpose of \ref p8est_lnodes_gather.
+ * Values are only added locally; nodes shared with other processes may
+ * be summed with \ref p8est_lnodes_share_all.
+ * \param [in] hanging  Tables created by \ref p8est_lnodes_hanging_new.
+ * \param [in] ue       For each element of the range, vnodes values
+ *                      in the order of element_nodes.
+ * \param [in] first    The first element of the range.
+ * \param [in] count    The number of elements in the range.
+ * \param [in,out] u    One value for each local node, added to.
+ */
+void                p8est_lnodes_scatter_add (p8est_lnodes_hanging_t *
+                                              hanging, const double *ue,
+                                              p4est_locidx_t first,
+                                              p4est_locidx_t count,
+                                              double *u);
+
 /** Partition using weights based on the number of nodes assigned to each
  * element in lnodes
  *
@@ -84,8 +84,39 @@ SC_EXTERN_C_BEGIN;
  * in corner_quad, and the corner number from the neighbor as corner_corner.
  *
  * Intra-tree corners and inter-tree face and corner corners are implemented.
- * Edge inter-tree corners are NOT IMPLEMENTED and are assigned the value -2.
+ * Edge inter-tree corners are only found by p8est_mesh_new_csr;
+ * p8est_mesh_new_ext assigns them the value -2.
  * Corners with no diagonal neighbor at all are assigned the value -1.
+ *
+ * The quad_to_edge list stores edge neighbors that are not face neighbors.
+ * It is only created by p8est_mesh_new_csr for P8EST_CONNECT_EDGE or higher.
+ * A single same-size neighbor on the inside of a tree is encoded directly as
+ * for quad_to_quad, and its matching edge is e ^ 3 for the local edge e.
+ * All other edges with neighbors store a value in
+ *    local_num_quadrants + local_num_ghosts + [0 .. local_num_edges - 1]
+ * that indexes into edge_offset, just like the corner groups above.
+ * Each group lists the neighbors in edge_quad and their codes in edge_edge.
+ * With ne = 0..11 the neighbor's edge and o = 0..1 its relative orientation
+ * as in the edge_to_edge array of p8est_connectivity_t, a code is either:
+ * 1. A value of v = 0..23 for a same-size neighbor, v = o * 12 + ne.
+ * 2. A value of v = 24..71 for a double-size neighbor,
+ *    v = 24 + h * 24 + o * 12 + ne, where h = 0..1 is the half of the
+ *    neighbor's edge covered, counted along the local edge.
+ * 3. A value of v = -24..-1 for each of two half-size neighbors that follow
+ *    each other in the order of their edge corners, v = -24 + o * 12 + ne.
+ * Edges on the boundary of the forest or hanging on a larger neighbor face
+ * are assigned the value -1.
+ *
+ * A mesh created by p8est_mesh_new_csr stores the face neighbors in the
+ * face_offset, face_quad and face_code arrays in compressed sparse row
+ * format instead, and its quad_to_quad, quad_to_face and quad_to_half
+ * members are NULL.  The neighbors across face f
+ * of local octant q are face_quad[i] for face_offset[6 * q + f] <= i <
+ * face_offset[6 * q + f + 1], encoded like the quad_to_quad values.
+ * Each face_code[i] holds the matching quad_to_face value, which is negative
+ * for all entries of a face with half-size neighbors.  A face on the boundary
+ * of the forest has no entries.  These arrays are NULL unless the mesh is
+ * created by p8est_mesh_new_csr.
  */
 typedef struct
 {
@@ -103,12 +134,27 @@ typedef struct
                                              NULL by default */
 
   /* These members are NULL if the connect_t is not P4EST_CONNECT_CORNER */
-  /* CAUTION: tree-boundary corners not yet implemented */
+  /* CAUTION: p8est_mesh_new_ext sets corners across tree edges to -2 */
   p4est_locidx_t      local_num_corners;        /* tree-boundary corners */
   p4est_locidx_t     *quad_to_corner;   /* 8 indices for each local quad */
   sc_array_t         *corner_offset;    /* local_num_corners + 1 entries */
   sc_array_t         *corner_quad;      /* corner_offset indexes into this */
   sc_array_t         *corner_corner;    /* and this one too (type int8_t) */
+
+  /* These members are NULL unless the mesh is created by p8est_mesh_new_csr,
+   * which leaves quad_to_quad, quad_to_face and quad_to_half NULL instead */
+  p4est_locidx_t     *face_offset;      /**< 6 * local_num_quadrants + 1
+                                             offsets into face_quad */
+  p4est_locidx_t     *face_quad;        /**< face neighbors of all octants */
+  int8_t             *face_code;        /**< one quad_to_face value each */
+
+  /* These members are only created by p8est_mesh_new_csr for at least
+     P8EST_CONNECT_EDGE, and are NULL otherwise */
+  p4est_locidx_t      local_num_edges;  /* edges with a group of neighbors */
+  p4est_locidx_t     *quad_to_edge;     /* 12 indices for each local quad */
+  sc_array_t         *edge_offset;      /* local_num_edges + 1 entries */
+  sc_array_t         *edge_quad;        /* edge_offset indexes into this */
+  sc_array_t         *edge_edge;        /* and this one too (type int8_t) */
 }
 p8est_mesh_t;
 
@@ -57,7 +57,8 @@
  * \ingroup p8est
  */
 
-#include <p8est.h>
+#include <p8est_geometry.h>
+#include <p8est_ghost.h>
 
 SC_EXTERN_C_BEGIN;
 
@@ -161,6 +162,36 @@ typedef int         (*p8est_search_local_t) (p8est_t * p4est,
 /** This typedef is provided for backwards compatibility. */
 typedef p8est_search_local_t p8est_search_query_t;
 
+/** Callback function to query the match of a batch of points with a octant.
+ *
+ * This function is called by \ref p8est_search_local_batch once per octant
+ * for all points that are still active there.  Testing many points in one
+ * call allows for vectorized tests, such as against a bounding box.
+ *
+ * \param [in] p4est        The forest to be queried.
+ * \param [in] which_tree   The tree id under consideration.
+ * \param [in] quadrant     The octant under consideration, see
+ *                          \ref p8est_search_local_t.
+ * \param [in] local_num    If the octant is not a leaf, this is < 0.
+ *                          Otherwise it is the (non-negative) index of the
+ *                          octant relative to the processor-local storage.
+ * \param [in] points       The array of points passed to the search.
+ * \param [in] indices      Indices into \b points of the active points.
+ * \param [in] num_indices  Number of active points, at least one.
+ * \param [out] matches     Mask of length \b num_indices.  Set entry i to
+ *                          nonzero if the point indices[i] may be contained
+ *                          in the octant and to zero otherwise.  The mask has
+ *                          no effect on a leaf.
+ */
+typedef void        (*p8est_search_local_batch_t) (p8est_t * p4est,
+                                                   p4est_topidx_t which_tree,
+                                                   p8est_quadrant_t * quadrant,
+                                                   p4est_locidx_t local_num,
+                                                   sc_array_t * points,
+                                                   const size_t * indices,
+                                                   size_t num_indices,
+                                                   uint8_t * matches);
+
 /** Search through the local part of a forest.
  * The search is especially efficient if multiple targets, called "points"
  * below, are searched for simultaneously.
@@ -224,6 +255,59 @@ void                p8est_search_local (p8est_t * p4est, int call_post,
                                         p8est_search_local_t point_fn,
                                         sc_array_t * points);
 
+/** Search through the local part of a forest with batched point queries.
+ * This function works like \ref p8est_search_local, except that the point
+ * callback is executed once per octant for all of its active points.
+ * The active points of a octant are kept as a contiguous range of an internal
+ * permutation of the point indices, such that no per-point callback or
+ * per-level allocation is required.
+ * The order in which the points are passed to the callback is unspecified.
+ *
+ * \param [in] p4est        The forest to be searched.
+ * \param [in] call_post    If true, call octant callback both pre and post.
+ * \param [in] quadrant_fn  See \ref p8est_search_local.
+ * \param [in] point_fn     If \b points is not NULL, must be not NULL.
+ *                          Shall flag any possible matching point.
+ * \param [in] points       User-defined array of "points".
+ *                          If NULL, only the \b quadrant_fn callback
+ *                          is executed.  If empty, this function noops.
+ */
+void                p8est_search_local_batch (p8est_t * p4est, int call_post,
+                                              p8est_search_local_t quadrant_fn,
+                                              p8est_search_local_batch_t
+                                              point_fn, sc_array_t * points);
+
+/** Locate points given by reference coordinates in the forest.
+ * This is a fast path for the common case of \ref p8est_search_local where
+ * the points are coordinates in the reference space of their trees.
+ * Each point is converted to its Morton index at P8EST_QMAXLEVEL.
+ * The indices are sorted by a radix sort and merged with the partition
+ * and the local leaves in one linear pass.  The cost is thus proportional
+ * to the number of points plus local octants plus processes.
+ * This function is not collective.
+ *
+ * \param [in] p4est        The forest, which is not modified.
+ * \param [in] num_points   Number of points to locate.
+ * \param [in] which_tree   For each point, its tree number.
+ * \param [in] coords       For each dimension, an array of the points'
+ *                          reference coordinates (x, y, z) in [0, 1].
+ *                          A point on a face between two leaves is
+ *                          assigned to the upper one, since every leaf
+ *                          contains its lower but not its upper faces.
+ *                          Only the coordinate 1 on the tree boundary is
+ *                          assigned to the leaf below it.
+ * \param [out] local_num   If not NULL, for each point the process-local
+ *                          number of the leaf containing it, or -1 if the
+ *                          leaf is not local.
+ * \param [out] owner       If not NULL, for each point the process owning
+ *                          the leaf containing it.
+ */
+void                p8est_locate_points (p8est_t * p4est, size_t num_points,
+                                         const p4est_topidx_t * which_tree,
+                                         double *const coords[],
+                                         p4est_locidx_t * local_num,
+                                         int *owner);
+
 /** This function is provided for backwards compatibility.
  * We call \ref p8est_search_local with call_post = 0.
  */
@@ -404,6 +488,236 @@ void                p8est_search_all (p8est_t * p4est, int call_post,
                                       p8est_search_all_t point_fn,
                                       sc_array_t * points);
 
+/** Perform a top-down search on the whole forest using threads.
+ * This function works like \ref p8est_search_all.  The recursion proceeds
+ * serially down to the branches of \b split_level, which are collected
+ * as independent tasks.  The tasks are then searched by a team of threads,
+ * where an idle thread takes the next task not yet taken by another.
+ * If p4est is compiled without OpenMP, the tasks are searched serially.
+ * Since the search allocates memory within the threads, libsc must be
+ * configured with thread support to count memory safely.
+ *
+ * The callbacks are executed concurrently and must be thread safe.
+ * They are passed a shallow copy of the forest whose user_pointer is
+ * replaced by the context of the executing thread.  They must not modify
+ * the forest.  The callbacks above \b split_level are executed by the
+ * calling thread with the context of thread 0.  The order in which the
+ * branches are searched is unspecified.
+ *
+ * \param [in] p4est        The forest to be searched.
+ * \param [in] call_post    See \ref p8est_search_all.
+ * \param [in] quadrant_fn  See \ref p8est_search_all.
+ * \param [in] point_fn     See \ref p8est_search_all.
+ * \param [in] points       See \ref p8est_search_all.  The array is
+ *                          shared between the threads.
+ * \param [in] split_level  Level of the branches searched as tasks.
+ *                          Zero makes every tree one task.  It should be
+ *                          large enough to yield several tasks per thread.
+ * \param [in] num_threads  Number of threads.  If less or equal zero, use
+ *                          the OpenMP default.
+ * \param [in] thread_users If not NULL, an array of \b num_threads user
+ *                          contexts, set as user_pointer of the forest
+ *                          passed to the callbacks of the respective thread.
+ *                          If NULL, the forest's user_pointer is used.
+ */
+void                p8est_search_all_threaded (p8est_t * p4est,
+                                               int call_post,
+                                               p8est_search_all_t quadrant_fn,
+                                               p8est_search_all_t point_fn,
+                                               sc_array_t * points,
+                                               int split_level,
+                                               int num_threads,
+                                               void **thread_users);
+
+/** Callback function to locate a record in \ref p8est_search_migrate.
+ * It is called both for branches of the global partition and for local
+ * octants, and must give consistent answers for the same octant.
+ * \param [in] p4est        The forest being searched.
+ * \param [in] which_tree   The tree number under consideration.
+ * \param [in] octant     The octant under consideration.  It is not from
+ *                          local forest storage, and its user data is
+ *                          undefined, unless it is a local leaf.
+ * \param [in] record       Pointer to the user's record.
+ * \return                  True if the record may be contained in
+ *                          \b octant.  It is allowed to return true for
+ *                          more than one leaf due to roundoff.
+ */
+typedef int         (*p8est_search_migrate_t) (p8est_t * p4est,
+                                               p4est_topidx_t which_tree,
+                                               p8est_quadrant_t * octant,
+                                               void *record);
+
+/** Send records to the processes that own them and sort them locally.
+ * Every record is searched in the partition by \ref p8est_search_partition.
+ * Its owner is the lowest process with a leaf matched by \b point_fn.
+ * The records are bucketed by owner and sent by non-blocking messages.
+ * The senders are identified by \ref p8est_comm_notify_nbx, such that
+ * there is no communication between processes that do not exchange records.
+ * On the receiving side, the records are located in the local leaves by
+ * \ref p8est_search_local and sorted by local octant number.
+ * The relative order of records in the same octant is preserved,
+ * where records from lower processes come first.
+ * Records that are not matched by any leaf are dropped.
+ * This function is collective.  The records sent to one process must not
+ * exceed INT_MAX bytes, since they go into a single message.
+ *
+ * \param [in] p4est        The forest to search.  Not modified.
+ * \param [in] point_fn     Locates a record, must not be NULL.
+ * \param [in,out] records  On input, records of fixed size to be migrated.
+ *                          The element size must be the same on all
+ *                          processes.  On output, the records owned by
+ *                          this process, sorted by local octant.
+ * \param [out] offsets     If not NULL, must have element size
+ *                          sizeof (p4est_locidx_t).  It is resized to
+ *                          local_num_quadrants + 1 entries such that the
+ *                          records in local octant q have the indices
+ *                          [offsets[q], offsets[q + 1]).
+ * \return                  The number of records dropped on this process.
+ */
+p4est_locidx_t      p8est_search_migrate (p8est_t * p4est,
+                                          p8est_search_migrate_t point_fn,
+                                          sc_array_t * records,
+                                          sc_array_t * offsets);
+
+/** A leaf found by \ref p8est_search_knn or \ref p8est_search_ball. */
+typedef struct p8est_search_nearest
+{
+  p4est_topidx_t      which_tree;       /**< The tree containing the leaf. */
+  int                 is_ghost;         /**< Boolean: the leaf is a ghost. */
+  p4est_locidx_t      local_num;        /**< The process-local number of a
+                                             local leaf, or the index into
+                                             the ghost layer's ghosts. */
+  double              distance;         /**< Distance of the query point to
+                                             the leaf's bounding box. */
+}
+p8est_search_nearest_t;
+
+/** Find the k leaves closest to a point in physical space.
+ * The leaves considered are the local ones and optionally the ghosts.
+ * We use the axis-aligned bounding box of the images of a octant's
+ * corners, which contains the octant exactly for the multilinear vertex
+ * mapping of the connectivity and approximately for curved geometries.
+ * The forest is traversed best-first by a priority queue of branches
+ * ordered by the distance to their bounding boxes, such that only the
+ * branches close to the point are entered.
+ * This function is not collective.
+ *
+ * \param [in] p4est        The forest to search.  Not modified.
+ * \param [in] ghost        If not NULL, the ghosts are searched as well.
+ * \param [in] geom         If not NULL, maps the reference coordinates of a
+ *                          tree into physical space.  Otherwise, the
+ *                          connectivity must have vertices.
+ * \param [in] xyz          The query point in physical space.
+ * \param [in] k            Maximum number of leaves returned.
+ * \param [in,out] results  Array of element size
+ *                          sizeof (p8est_search_nearest_t).
+ *                          On output, the min (k, number of leaves) closest
+ *                          leaves sorted by ascending distance.
+ */
+void                p8est_search_knn (p8est_t * p4est, p8est_ghost_t * ghost,
+                                      p8est_geometry_t * geom,
+                                      const double xyz[3], int k,
+                                      sc_array_t * results);
+
+/** Find all leaves within a distance from a point in physical space.
+ * This function works like \ref p8est_search_knn, except that the search is
+ * bounded by a radius instead of the number of results.
+ *
+ * \param [in] p4est        The forest to search.  Not modified.
+ * \param [in] ghost        If not NULL, the ghosts are searched as well.
+ * \param [in] geom         See \ref p8est_search_knn.
+ * \param [in] xyz          The query point in physical space.
+ * \param [in] radius       Non-negative search radius.
+ * \param [in,out] results  Array of element size
+ *                          sizeof (p8est_search_nearest_t).
+ *                          On output, all leaves whose bounding box is at
+ *                          most \b radius away, sorted by ascending distance.
+ */
+void                p8est_search_ball (p8est_t * p4est, p8est_ghost_t * ghost,
+                                       p8est_geometry_t * geom,
+                                       const double xyz[3], double radius,
+                                       sc_array_t * results);
+
+/** Opaque cache of physical bounding boxes of local leaves and branches. */
+typedef struct p8est_bbox_cache p8est_bbox_cache_t;
+
+/** Create a cache of bounding boxes for geometry-aware searches.
+ * The box of a leaf is the axis-aligned bounding box of the images of its
+ * corners.  The box of a branch down to \b maxlevel is the union of the
+ * boxes of the local leaves it contains, which makes it suitable for
+ * \ref p8est_search_local, \ref p8est_search_knn_ext and
+ * \ref p8est_search_ball_ext.  The cache is computed lazily on first access
+ * and recomputed whenever the revision counter of the forest changes.
+ * It is not thread safe.
+ * \param [in] p4est        The forest.  It must stay alive with the cache.
+ * \param [in] geom         If not NULL, maps the reference coordinates of a
+ *                          tree into physical space.  Otherwise, the
+ *                          connectivity must have vertices.
+ * \param [in] maxlevel     Deepest level of branches whose boxes are cached.
+ *                          If negative, only the leaf boxes are cached.
+ * \return                  The new cache; free with
+ *                          \ref p8est_bbox_cache_destroy.
+ */
+p8est_bbox_cache_t *p8est_bbox_cache_new (p8est_t * p4est,
+                                          p8est_geometry_t * geom,
+                                          int maxlevel);
+
+/** Free the memory of a bounding box cache. */
+void                p8est_bbox_cache_destroy (p8est_bbox_cache_t * cache);
+
+/** Look up the bounding box of a octant.
+ * Octants that are neither local leaves nor cached branches are computed
+ * on the fly, so the result is always defined.
+ * \param [in,out] cache    The cache, which is updated if outdated.
+ * \param [in] which_tree   The tree containing the octant.
+ * \param [in] octant     A local leaf or a branch of the local forest,
+ *                          such as passed to a \ref p8est_search_local_t.
+ * \param [in] local_num    If non-negative, the octant is the local leaf
+ *                          of this process-local number.
+ * \param [out] lower       The lower corner of the box.
+ * \param [out] upper       The upper corner of the box.
+ */
+void                p8est_bbox_cache_get (p8est_bbox_cache_t * cache,
+                                          p4est_topidx_t which_tree,
+                                          const p8est_quadrant_t * octant,
+                                          p4est_locidx_t local_num,
+                                          double lower[3], double upper[3]);
+
+/** Find the k leaves closest to a point using a bounding box cache.
+ * This function works like \ref p8est_search_knn with the forest and
+ * geometry of the cache, but takes the boxes of local leaves and branches
+ * from the cache instead of mapping their corners on every visit.
+ * The boxes of the ghosts are computed on the fly.
+ * This function is not collective.
+ *
+ * \param [in,out] cache    The cache, which is updated if outdated.
+ * \param [in] ghost        If not NULL, the ghosts are searched as well.
+ * \param [in] xyz          The query point in physical space.
+ * \param [in] k            Maximum number of leaves returned.
+ * \param [in,out] results  See \ref p8est_search_knn.
+ */
+void                p8est_search_knn_ext (p8est_bbox_cache_t * cache,
+                                          p8est_ghost_t * ghost,
+                                          const double xyz[3], int k,
+                                          sc_array_t * results);
+
+/** Find all leaves within a distance from a point using a box cache.
+ * This function works like \ref p8est_search_ball with the forest and
+ * geometry of the cache, taking the boxes of local leaves and branches
+ * from the cache as \ref p8est_search_knn_ext does.
+ *
+ * \param [in,out] cache    The cache, which is updated if outdated.
+ * \param [in] ghost        If not NULL, the ghosts are searched as well.
+ * \param [in] xyz          The query point in physical space.
+ * \param [in] radius       Non-negative search radius.
+ * \param [in,out] results  See \ref p8est_search_ball.
+ */
+void                p8est_search_ball_ext (p8est_bbox_cache_t * cache,
+                                           p8est_ghost_t * ghost,
+                                           const double xyz[3],
+                                           double radius,
+                                           sc_array_t * results);
+
 SC_EXTERN_C_END;
 
 #endif /* !P8EST_SEARCH_H */
@@ -41,6 +41,24 @@ SC_EXTERN_C_BEGIN;
  */
 typedef struct p8est_vtk_context p8est_vtk_context_t;
 
+/** Encoding of the data arrays in the VTK files. */
+typedef enum
+{
+  P8EST_VTK_FORMAT_ASCII,          /**< Numbers printed as text. */
+  P8EST_VTK_FORMAT_BINARY,         /**< Raw data encoded in base64. */
+  P8EST_VTK_FORMAT_COMPRESSED      /**< Blocks of raw data compressed with
+                                     zlib, then encoded in base64. */
+}
+p8est_vtk_format_t;
+
+/** Size in bytes of the raw data blocks that are compressed separately
+ * in the format P8EST_VTK_FORMAT_COMPRESSED. */
+#define P8EST_VTK_BLOCK_SIZE ((size_t) 1 << 15)
+
+/** Number of raw data blocks that the binary formats collect before
+ * encoding or compressing them; this bounds the memory of the buffers. */
+#define P8EST_VTK_BATCH_BLOCKS 64
+
 /** Write the p8est in VTK format.
  *
  * This is a convenience function for the special case of writing out
@@ -118,6 +136,22 @@ void                p8est_vtk_context_set_scale (p8est_vtk_context_t * cont,
  */
 void                p8est_vtk_context_set_continuous (p8est_vtk_context_t *
                                                       cont, int continuous);
+
+/** Modify the context parameter for the encoding of the data arrays.
+ * After \ref p8est_vtk_context_new, it is at the default chosen by configure:
+ * compressed, binary with --disable-vtk-zlib, ASCII with --disable-vtk-binary.
+ * The binary formats are streamed in blocks without allocating any array
+ * in full.  Compressed blocks are produced by multiple threads if OpenMP
+ * is enabled.  Selecting compression aborts in the header if configure did
+ * not find zlib.
+ * \param [in,out] cont         The context is modified.
+ *                              It must not yet have been used to start writing
+ *                              in \ref p8est_vtk_write_header.
+ * \param [in] format           The encoding of all data arrays.
+ */
+void                p8est_vtk_context_set_format (p8est_vtk_context_t * cont,
+                                              p8est_vtk_format_t format);
+
 /** Cleanly destroy a \ref p8est_vtk_context_t structure.
  *
  * This function closes all the file pointers and frees the context.
@@ -0,0 +1,244 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef P4_TO_P8
+#include <p4est_bits.h>
+#include <p4est_extended.h>
+#include <p4est_geometry.h>
+#else
+#include <p8est_bits.h>
+#include <p8est_extended.h>
+#include <p8est_geometry.h>
+#endif
+
+static int          refine_level = 5;
+
+static int
+refine_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+           p4est_quadrant_t * quadrant)
+{
+  if ((int) quadrant->level >= refine_level) {
+    return 0;
+  }
+  if ((int) quadrant->level < refine_level - 2) {
+    return 1;
+  }
+  return p4est_quadrant_child_id (quadrant) % 3 == 0;
+}
+
+/* map the unit tree to an annulus sector with radii 1 and 2 */
+static void
+annulus_X (p4est_geometry_t * geom, p4est_topidx_t which_tree,
+           const double abc[3], double xyz[3])
+{
+  const double        r = 1. + abc[0];
+  const double        theta = M_PI_2 * abc[1];
+
+  xyz[0] = r * cos (theta);
+  xyz[1] = r * sin (theta);
+  xyz[2] = abc[2];
+}
+
+/* return local quadrant or ghost number qid */
+static p4est_quadrant_t *
+test_quadrant (p4est_t * p4est, p4est_ghost_t * ghost, p4est_locidx_t qid)
+{
+  p4est_topidx_t      jt;
+  p4est_tree_t       *tree;
+
+  if (qid >= p4est->local_num_quadrants) {
+    return p4est_quadrant_array_index
+      (&ghost->ghosts, (size_t) (qid - p4est->local_num_quadrants));
+  }
+  for (jt = p4est->first_local_tree;; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    if (qid < tree->quadrants_offset +
+        (p4est_locidx_t) tree->quadrants.elem_count) {
+      return p4est_quadrant_array_index
+        (&tree->quadrants, (size_t) (qid - tree->quadrants_offset));
+    }
+  }
+}
+
+/* check the cache against the unit tree or the annulus sector */
+static void
+test_cache (p4est_geometry_cache_t * cache, p4est_ghost_t * ghost,
+            int annulus)
+{
+  int                 mpiret;
+  int                 i, j, f;
+  const int           np = cache->num_points;
+  const int           nfp = cache->num_face_points;
+  p4est_t            *p4est = cache->p4est;
+  p4est_locidx_t      qid, nq;
+  p4est_quadrant_t   *q;
+  size_t              zf;
+  double              qlen, n, volume, outer, sums[2], gsums[2];
+
+  SC_CHECK_ABORT (p4est_geometry_cache_is_current (cache),
+                  "Geometry cache outdated");
+  SC_CHECK_ABORT (cache->local_num_quadrants == p4est->local_num_quadrants
+                  && cache->ghost_num_quadrants ==
+                  (p4est_locidx_t) ghost->ghosts.elem_count,
+                  "Geometry cache counts");
+  nq = cache->local_num_quadrants + cache->ghost_num_quadrants;
+  sums[0] = sums[1] = 0.;
+  for (qid = 0; qid < nq; ++qid) {
+    q = test_quadrant (p4est, ghost, qid);
+    qlen = (double) P4EST_QUADRANT_LEN (q->level) / P4EST_ROOT_LEN;
+
+    /* the volume is the sum of the weighted determinants */
+    volume = 0.;
+    for (i = 0; i < np; ++i) {
+      volume += cache->weights[i] * cache->detJ[qid * np + i];
+    }
+    SC_CHECK_ABORT (fabs (volume - cache->volume[qid]) < 1e-12,
+                    "Geometry cache volume sum");
+
+    /* the derivatives of the vertex geometry are exact */
+    if (!annulus) {
+      for (i = 0; i < np; ++i) {
+        for (j = 0; j < 3 * P4EST_DIM; ++j) {
+          SC_CHECK_ABORT (fabs (cache->jacobian[((size_t) j * nq + qid) *
+                                                np + i] -
+                                (j % 4 == 0 ? qlen : 0.)) < 1e-14 * qlen,
+                          "Geometry cache Jacobian");
+        }
+      }
+    }
+
+    /* outward normals have unit length */
+    for (f = 0; f < P4EST_FACES; ++f) {
+      for (i = 0; i < nfp; ++i) {
+        zf = ((size_t) qid * P4EST_FACES + f) * nfp + i;
+        n = 0.;
+        for (j = 0; j < 3; ++j) {
+          n += cache->normal[(size_t) j * nq * P4EST_FACES * nfp + zf] *
+            cache->normal[(size_t) j * nq * P4EST_FACES * nfp + zf];
+          if (!annulus) {
+            SC_CHECK_ABORT (fabs (cache->normal[(size_t) j * nq *
+                                                P4EST_FACES * nfp + zf] -
+                                  (j == f / 2 ? 2. * (f % 2) - 1. : 0.)) <
+                            1e-14, "Geometry cache normal");
+          }
+        }
+        SC_CHECK_ABORT (fabs (n - 1.) < 1e-10, "Geometry cache unit normal");
+        if (!annulus) {
+          SC_CHECK_ABORT (fabs (cache->face_detJ[zf] -
+                                pow (qlen, P4EST_DIM - 1)) < 1e-14,
+                          "Geometry cache face Jacobian");
+        }
+        if (annulus && f == 1 && qid < cache->local_num_quadrants &&
+            q->x + P4EST_QUADRANT_LEN (q->level) == P4EST_ROOT_LEN) {
+          sums[1] += cache->face_weights[i] * cache->face_detJ[zf];
+        }
+      }
+    }
+    if (!annulus) {
+      SC_CHECK_ABORT (fabs (cache->volume[qid] - pow (qlen, P4EST_DIM)) <
+                      1e-14, "Geometry cache volume");
+    }
+    if (qid < cache->local_num_quadrants) {
+      sums[0] += cache->volume[qid];
+    }
+  }
+
+  /* the domain is covered exactly once by the local quadrants */
+  mpiret = sc_MPI_Allreduce (sums, gsums, 2, sc_MPI_DOUBLE, sc_MPI_SUM,
+                             p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  volume = annulus ? .75 * M_PI : 1.;
+  outer = annulus ? M_PI : 0.;
+  SC_CHECK_ABORT (fabs (gsums[0] - volume) < 1e-6,
+                  "Geometry cache total volume");
+  SC_CHECK_ABORT (fabs (gsums[1] - outer) < 1e-6,
+                  "Geometry cache outer surface");
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  sc_MPI_Comm         mpicomm;
+  p4est_connectivity_t *connectivity;
+  p4est_t            *p4est;
+  p4est_ghost_t      *ghost;
+  p4est_geometry_t    annulus;
+  p4est_geometry_cache_t *cache;
+
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+#ifndef P4_TO_P8
+  connectivity = p4est_connectivity_new_unitsquare ();
+#else
+  connectivity = p8est_connectivity_new_unitcube ();
+  refine_level = 3;
+#endif
+  p4est = p4est_new_ext (mpicomm, connectivity, 0, 1, 1, 0, NULL, NULL);
+  p4est_refine (p4est, 1, refine_fn, NULL);
+  p4est_partition (p4est, 0, NULL);
+  ghost = p4est_ghost_new (p4est, P4EST_CONNECT_FULL);
+
+  /* the vertices of the unit tree give the identity */
+  cache = p4est_geometry_cache_new (p4est, ghost, NULL, 2);
+  test_cache (cache, ghost, 0);
+  SC_CHECK_ABORT (!p4est_geometry_cache_update (cache, ghost),
+                  "Geometry cache recomputed");
+  p4est_geometry_cache_destroy (cache);
+
+  /* a curved geometry */
+  memset (&annulus, 0, sizeof (annulus));
+  annulus.name = "annulus";
+  annulus.X = annulus_X;
+  cache = p4est_geometry_cache_new (p4est, ghost, &annulus, 4);
+  test_cache (cache, ghost, 1);
+
+  /* the cache is invalidated by a change of the forest */
+  ++refine_level;
+  p4est_refine (p4est, 0, refine_fn, NULL);
+  p4est_partition (p4est, 0, NULL);
+  SC_CHECK_ABORT (!p4est_geometry_cache_is_current (cache),
+                  "Geometry cache not outdated");
+  p4est_ghost_destroy (ghost);
+  ghost = p4est_ghost_new (p4est, P4EST_CONNECT_FACE);
+  SC_CHECK_ABORT (p4est_geometry_cache_update (cache, ghost),
+                  "Geometry cache not recomputed");
+  test_cache (cache, ghost, 1);
+  p4est_geometry_cache_destroy (cache);
+
+  p4est_ghost_destroy (ghost);
+  p4est_destroy (p4est);
+  p4est_connectivity_destroy (connectivity);
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}
@@ -374,6 +374,40 @@ test_exchange_D (p4est_t * p4est, p4est_ghost_t * ghost)
   P4EST_FREE (ghost_struct_data);
 }
 
+static void
+test_partition_stats (p4est_t * p4est, p4est_ghost_t * ghost)
+{
+  double              values[P4EST_PARTITION_STATS_LAST];
+  sc_statinfo_t       stats[P4EST_PARTITION_STATS_LAST];
+
+  p4est_partition_stats (p4est, ghost, NULL, sizeof (test_exchange_t),
+                         values, stats);
+  SC_CHECK_ABORT (values[P4EST_PARTITION_STATS_QUADRANTS] ==
+                  (double) p4est->local_num_quadrants,
+                  "Partition stats quadrants");
+  SC_CHECK_ABORT (values[P4EST_PARTITION_STATS_WEIGHT] ==
+                  values[P4EST_PARTITION_STATS_QUADRANTS],
+                  "Partition stats weight");
+  SC_CHECK_ABORT (values[P4EST_PARTITION_STATS_MIRRORS] ==
+                  (double) ghost->mirrors.elem_count,
+                  "Partition stats mirrors");
+  SC_CHECK_ABORT (values[P4EST_PARTITION_STATS_BYTES] ==
+                  (double) ghost->mirror_proc_offsets[p4est->mpisize] *
+                  sizeof (test_exchange_t), "Partition stats bytes");
+  SC_CHECK_ABORT (stats[P4EST_PARTITION_STATS_QUADRANTS].sum_values ==
+                  (double) p4est->global_num_quadrants,
+                  "Partition stats sum");
+  if (p4est->mpisize == 1) {
+    SC_CHECK_ABORT (values[P4EST_PARTITION_STATS_PEERS] == 0. &&
+                    values[P4EST_PARTITION_STATS_FACES] == 0.,
+                    "Partition stats serial");
+  }
+
+  /* print the statistics */
+  p4est_partition_stats (p4est, ghost, NULL, sizeof (test_exchange_t),
+                         NULL, NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -421,6 +455,7 @@ main (int argc, char **argv)
   test_exchange_B (p4est, ghost);
   test_exchange_C (p4est, ghost);
   test_exchange_D (p4est, ghost);
+  test_partition_stats (p4est, ghost);
 
   for (i = 0; i < num_cycles; i++) {
     /* expand and test that the ghost layer can still exchange data properly
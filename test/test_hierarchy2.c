@@ -0,0 +1,196 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef P4_TO_P8
+#include <p4est_algorithms.h>
+#include <p4est_bits.h>
+#include <p4est_extended.h>
+#include <p4est_hierarchy.h>
+#else
+#include <p8est_algorithms.h>
+#include <p8est_bits.h>
+#include <p8est_extended.h>
+#include <p8est_hierarchy.h>
+#endif
+
+static int          refine_level = 6;
+
+static int
+refine_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+           p4est_quadrant_t * quadrant)
+{
+  int                 cid;
+
+  if ((int) quadrant->level >= refine_level) {
+    return 0;
+  }
+  if ((int) quadrant->level < refine_level - 3) {
+    return 1;
+  }
+  cid = p4est_quadrant_child_id (quadrant);
+  return cid == 0 || cid == P4EST_CHILDREN - 1 || which_tree % 3 == 1;
+}
+
+/* fill the quadrants of a forest, each with its tree number */
+static p4est_quadrant_t *
+test_quadrants (p4est_t * p4est)
+{
+  size_t              zz;
+  p4est_topidx_t      jt;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, *quads;
+
+  quads = P4EST_ALLOC (p4est_quadrant_t, p4est->local_num_quadrants);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = quads + tree->quadrants_offset + zz;
+      *q = *p4est_quadrant_array_index (&tree->quadrants, zz);
+      q->p.which_tree = jt;
+    }
+  }
+  return quads;
+}
+
+/* the partition of a coarse level must not split any family */
+static void
+test_families (p4est_t * p4est)
+{
+  int                 p;
+  p4est_locidx_t     *num_per_proc;
+
+  num_per_proc = P4EST_ALLOC (p4est_locidx_t, p4est->mpisize);
+  for (p = 0; p < p4est->mpisize; ++p) {
+    num_per_proc[p] = (p4est_locidx_t)
+      (p4est->global_first_quadrant[p + 1] -
+       p4est->global_first_quadrant[p]);
+  }
+  SC_CHECK_ABORT (p4est_partition_for_coarsening (p4est, num_per_proc) == 0,
+                  "Hierarchy family split");
+  P4EST_FREE (num_per_proc);
+}
+
+static void
+test_level (p4est_hierarchy_t * hierarchy, int l)
+{
+  p4est_locidx_t      lf, lc, nc;
+  p4est_t            *fine = hierarchy->levels[l - 1].p4est;
+  p4est_t            *coarse = hierarchy->levels[l].p4est;
+  p4est_hierarchy_level_t *level = hierarchy->levels + l;
+  p4est_quadrant_t   *fquads, *cquads, *moved, *f, *c;
+
+  /* bring the coarse quadrants back to the partition of the fine ones */
+  nc = level->num_coarse;
+  SC_CHECK_ABORT (level->coarse_gfq[fine->mpirank + 1] -
+                  level->coarse_gfq[fine->mpirank] == nc,
+                  "Hierarchy coarse count");
+  cquads = coarse != NULL ? test_quadrants (coarse) : NULL;
+  moved = P4EST_ALLOC (p4est_quadrant_t, nc);
+  p4est_hierarchy_transfer_fixed (hierarchy, l, 0, moved, cquads,
+                                  sizeof (p4est_quadrant_t));
+  P4EST_FREE (cquads);
+
+  /* every fine quadrant lies in the coarse quadrant it maps to */
+  fquads = test_quadrants (fine);
+  SC_CHECK_ABORT (level->coarse_to_fine[0] == 0 &&
+                  level->coarse_to_fine[nc] == fine->local_num_quadrants,
+                  "Hierarchy offsets");
+  for (lc = 0; lc < nc; ++lc) {
+    c = moved + lc;
+    SC_CHECK_ABORT (level->coarse_to_fine[lc] < level->coarse_to_fine[lc + 1],
+                    "Hierarchy empty coarse quadrant");
+    for (lf = level->coarse_to_fine[lc]; lf < level->coarse_to_fine[lc + 1];
+         ++lf) {
+      f = fquads + lf;
+      SC_CHECK_ABORT (level->fine_to_coarse[lf] == lc, "Hierarchy map");
+      SC_CHECK_ABORT (c->p.which_tree == f->p.which_tree &&
+                      (p4est_quadrant_is_equal (c, f) ||
+                       p4est_quadrant_is_ancestor (c, f)),
+                      "Hierarchy coarse quadrant mismatch");
+    }
+  }
+  P4EST_FREE (fquads);
+  P4EST_FREE (moved);
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  int                 l;
+  sc_MPI_Comm         mpicomm;
+  p4est_connectivity_t *connectivity;
+  p4est_t            *p4est;
+  p4est_hierarchy_t  *hierarchy;
+
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+#ifndef P4_TO_P8
+  connectivity = p4est_connectivity_new_star ();
+#else
+  connectivity = p8est_connectivity_new_rotcubes ();
+  refine_level = 4;
+#endif
+  p4est = p4est_new_ext (mpicomm, connectivity, 0, 0, 0, 0, NULL, NULL);
+  p4est_refine (p4est, 1, refine_fn, NULL);
+  p4est_balance (p4est, P4EST_CONNECT_FULL, NULL);
+  p4est_partition (p4est, 0, NULL);
+
+  /* the coarsest levels are packed onto fewer processes */
+  hierarchy = p4est_hierarchy_new (p4est, P4EST_QMAXLEVEL, 16,
+                                   P4EST_CONNECT_FULL);
+  SC_CHECK_ABORT (hierarchy->num_levels > 2, "Hierarchy too shallow");
+  SC_CHECK_ABORT (hierarchy->levels[0].p4est == p4est, "Hierarchy level 0");
+  for (l = 1; l < hierarchy->num_levels; ++l) {
+    if (hierarchy->levels[l - 1].p4est == NULL) {
+      break;
+    }
+    if (hierarchy->levels[l].p4est != NULL) {
+      SC_CHECK_ABORT (p4est_is_valid (hierarchy->levels[l].p4est) &&
+                      p4est_is_balanced (hierarchy->levels[l].p4est,
+                                         P4EST_CONNECT_FULL),
+                      "Hierarchy forest invalid");
+      SC_CHECK_ABORT (hierarchy->levels[l].p4est->global_num_quadrants <
+                      hierarchy->levels[l - 1].p4est->global_num_quadrants,
+                      "Hierarchy level not coarser");
+      test_families (hierarchy->levels[l].p4est);
+    }
+    test_level (hierarchy, l);
+  }
+  p4est_hierarchy_destroy (hierarchy);
+
+  p4est_destroy (p4est);
+  p4est_connectivity_destroy (connectivity);
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}
@@ -578,6 +578,59 @@ same_point (tpoint_t * a, tpoint_t * b, p4est_connectivity_t * conn)
 
 }
 
+/* gathering reproduces constants and scatter_add is its transpose */
+static void
+test_hanging (p4est_lnodes_t * lnodes)
+{
+  const p4est_locidx_t nel = lnodes->num_local_elements;
+  const p4est_locidx_t nlen = nel * lnodes->vnodes;
+  p4est_locidx_t      li, half;
+  double             *u, *v, *ue, *ve;
+  double              dot_e, dot_n;
+  p4est_lnodes_hanging_t *hanging;
+
+  hanging = p4est_lnodes_hanging_new (lnodes, NULL);
+  u = P4EST_ALLOC (double, lnodes->num_local_nodes);
+  v = P4EST_ALLOC_ZERO (double, lnodes->num_local_nodes);
+  ue = P4EST_ALLOC (double, nlen);
+  ve = P4EST_ALLOC (double, nlen);
+
+  for (li = 0; li < lnodes->num_local_nodes; ++li) {
+    u[li] = 1.;
+  }
+  half = nel / 2;
+  p4est_lnodes_gather (hanging, u, 0, half, ue);
+  p4est_lnodes_gather (hanging, u, half, nel - half,
+                       ue + half * lnodes->vnodes);
+  for (li = 0; li < nlen; ++li) {
+    SC_CHECK_ABORT (fabs (ue[li] - 1.) < 1e-12, "Lnodes gather constant");
+  }
+
+  for (li = 0; li < lnodes->num_local_nodes; ++li) {
+    u[li] = (double) (li % 7) - 3.;
+  }
+  for (li = 0; li < nlen; ++li) {
+    ve[li] = (double) (li % 5) - 2.;
+  }
+  p4est_lnodes_gather (hanging, u, 0, nel, ue);
+  p4est_lnodes_scatter_add (hanging, ve, 0, nel, v);
+  dot_e = dot_n = 0.;
+  for (li = 0; li < nlen; ++li) {
+    dot_e += ue[li] * ve[li];
+  }
+  for (li = 0; li < lnodes->num_local_nodes; ++li) {
+    dot_n += u[li] * v[li];
+  }
+  SC_CHECK_ABORT (fabs (dot_e - dot_n) <= 1e-10 * (1. + fabs (dot_e)),
+                  "Lnodes scatter transpose");
+
+  P4EST_FREE (u);
+  P4EST_FREE (v);
+  P4EST_FREE (ue);
+  P4EST_FREE (ve);
+  p4est_lnodes_hanging_destroy (hanging);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -750,11 +803,18 @@ main (int argc, char **argv)
         break;
       }
 
+      /* the checks below must hold for any node order */
+      if (j == 2 || j == 3) {
+        p4est_lnodes_reorder (lnodes, j == 2 ? P4EST_LNODES_ORDER_SFC :
+                              P4EST_LNODES_ORDER_RCM, NULL);
+      }
+
       if (j < 0) {
         p4est_lnodes_destroy (lnodes);
         p4est_log_indent_pop ();
         continue;
       }
+      test_hanging (lnodes);
       nin = lnodes->num_local_nodes;
       tpoints = P4EST_ALLOC (tpoint_t, nin);
       memset (tpoints, -1, nin * sizeof (tpoint_t));
@@ -0,0 +1,621 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef P4_TO_P8
+#include <p4est_bits.h>
+#include <p4est_extended.h>
+#include <p4est_iterate.h>
+#include <p4est_mesh.h>
+#else
+#include <p8est_bits.h>
+#include <p8est_extended.h>
+#include <p8est_iterate.h>
+#include <p8est_mesh.h>
+#endif
+
+#ifndef P4_TO_P8
+static int          refine_level = 5;
+#else
+static int          refine_level = 4;
+#endif
+
+static int
+refine_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+           p4est_quadrant_t * quadrant)
+{
+  if ((int) quadrant->level >= (refine_level - (int) (which_tree % 3))) {
+    return 0;
+  }
+  if (quadrant->level == 1 && p4est_quadrant_child_id (quadrant) == 3) {
+    return 1;
+  }
+  if (quadrant->x == P4EST_LAST_OFFSET (2) &&
+      quadrant->y == P4EST_LAST_OFFSET (2)) {
+    return 1;
+  }
+#ifndef P4_TO_P8
+  if (quadrant->x >= P4EST_QUADRANT_LEN (2)) {
+    return 0;
+  }
+#else
+  if (quadrant->z >= P8EST_QUADRANT_LEN (2)) {
+    return 0;
+  }
+#endif
+
+  return 1;
+}
+
+/* compare the face neighbors of p4est_mesh_new_csr to the iterated mesh */
+static void
+test_mesh_faces (p4est_mesh_t * mesh, p4est_mesh_t * csr)
+{
+  int                 f, nf;
+  p4est_locidx_t      K, kl, il, ql, i, count;
+  p4est_locidx_t     *halfs;
+
+  K = mesh->local_num_quadrants;
+  SC_CHECK_ABORT (csr->local_num_quadrants == K, "CSR quadrant count");
+  SC_CHECK_ABORT (csr->ghost_num_quadrants == mesh->ghost_num_quadrants,
+                  "CSR ghost count");
+  SC_CHECK_ABORT (csr->quad_to_quad == NULL && csr->quad_to_face == NULL &&
+                  csr->quad_to_half == NULL, "CSR dense faces allocated");
+  SC_CHECK_ABORT (csr->face_offset[0] == 0, "CSR first offset");
+
+  for (kl = 0; kl < K; ++kl) {
+    SC_CHECK_ABORTF (csr->quad_to_tree[kl] == mesh->quad_to_tree[kl],
+                     "CSR quad %lld tree mismatch", (long long) kl);
+    for (f = 0; f < P4EST_FACES; ++f) {
+      il = P4EST_FACES * kl + f;
+      ql = mesh->quad_to_quad[il];
+      nf = mesh->quad_to_face[il];
+      count = csr->face_offset[il + 1] - csr->face_offset[il];
+      for (i = csr->face_offset[il]; i < csr->face_offset[il + 1]; ++i) {
+        SC_CHECK_ABORTF (csr->face_code[i] == nf,
+                         "CSR quad %lld face %d code mismatch",
+                         (long long) kl, f);
+      }
+      if (nf < 0) {
+        halfs = (p4est_locidx_t *) sc_array_index (mesh->quad_to_half, ql);
+        SC_CHECK_ABORT (count == P4EST_HALF, "CSR half neighbor count");
+        for (i = 0; i < P4EST_HALF; ++i) {
+          SC_CHECK_ABORTF (csr->face_quad[csr->face_offset[il] + i] ==
+                           halfs[i], "CSR quad %lld face %d half mismatch",
+                           (long long) kl, f);
+        }
+      }
+      else if (ql == kl && nf == f) {
+        SC_CHECK_ABORT (count == 0, "CSR boundary face has neighbors");
+      }
+      else {
+        SC_CHECK_ABORTF (count == 1 &&
+                         csr->face_quad[csr->face_offset[il]] == ql,
+                         "CSR quad %lld face %d neighbor mismatch",
+                         (long long) kl, f);
+      }
+    }
+  }
+}
+
+/* the face neighbor iterator visits the same neighbors on both meshes */
+static void
+test_mesh_iterator (p4est_t * p4est, p4est_ghost_t * ghost,
+                    p4est_mesh_t * mesh, p4est_mesh_t * csr)
+{
+  int                 mface, cface;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      kl, mquad, cquad;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *mq, *cq;
+  p4est_mesh_face_neighbor_t mmfn, cmfn;
+
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (kl = 0; kl < (p4est_locidx_t) tree->quadrants.elem_count; ++kl) {
+      p4est_mesh_face_neighbor_init2 (&mmfn, p4est, ghost, mesh, jt, kl);
+      p4est_mesh_face_neighbor_init2 (&cmfn, p4est, ghost, csr, jt, kl);
+      do {
+        mq = p4est_mesh_face_neighbor_next (&mmfn, NULL, &mquad, &mface,
+                                            NULL);
+        cq = p4est_mesh_face_neighbor_next (&cmfn, NULL, &cquad, &cface,
+                                            NULL);
+        SC_CHECK_ABORT (mq == cq, "CSR iterator quadrant mismatch");
+        if (mq != NULL) {
+          SC_CHECK_ABORT (mmfn.current_qtq == cmfn.current_qtq &&
+                          mquad == cquad && mface == cface,
+                          "CSR iterator neighbor mismatch");
+        }
+      }
+      while (mq != NULL);
+    }
+  }
+}
+
+/* one expected or actual corner or edge neighbor of a local quadrant */
+typedef struct test_mesh_entry
+{
+  p4est_locidx_t      key;      /* index of the local corner or edge */
+  p4est_locidx_t      qid;      /* neighbor encoded as for quad_to_quad */
+  int                 code;     /* neighbor corner or edge code */
+  int                 pos;      /* position within a pair of half neighbors */
+}
+test_mesh_entry_t;
+
+/* the corner and edge neighbors found by p4est_iterate */
+typedef struct test_mesh_oracle
+{
+  p4est_locidx_t      K;
+  sc_array_t         *corners;
+  int8_t             *corner_inside;
+#ifdef P4_TO_P8
+  sc_array_t         *edges;
+  int8_t             *edge_inside;
+#endif
+}
+test_mesh_oracle_t;
+
+static int
+test_mesh_entry_compare (const void *v1, const void *v2)
+{
+  const test_mesh_entry_t *e1 = (const test_mesh_entry_t *) v1;
+  const test_mesh_entry_t *e2 = (const test_mesh_entry_t *) v2;
+
+  if (e1->key != e2->key) {
+    return e1->key < e2->key ? -1 : 1;
+  }
+  if (e1->qid != e2->qid) {
+    return e1->qid < e2->qid ? -1 : 1;
+  }
+  if (e1->code != e2->code) {
+    return e1->code < e2->code ? -1 : 1;
+  }
+  return e1->pos - e2->pos;
+}
+
+static void
+test_mesh_entry_push (sc_array_t * entries, p4est_locidx_t key,
+                      p4est_locidx_t qid, int code, int pos)
+{
+  test_mesh_entry_t  *e = (test_mesh_entry_t *) sc_array_push (entries);
+
+  e->key = key;
+  e->qid = qid;
+  e->code = code;
+  e->pos = pos;
+}
+
+/* return true if two sides of the iterator share a face or edge */
+static int
+test_mesh_common (const int8_t * a, const int8_t * b, int n)
+{
+  int                 j, l;
+
+  for (j = 0; j < n; ++j) {
+    for (l = 0; l < n; ++l) {
+      if (a[j] >= 0 && a[j] == b[l]) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static              p4est_locidx_t
+test_mesh_qid (p4est_t * p4est, p4est_locidx_t K, p4est_topidx_t treeid,
+               int is_ghost, p4est_quadrant_t * quad, p4est_locidx_t quadid)
+{
+  p4est_tree_t       *tree;
+
+  SC_CHECK_ABORT (quad != NULL, "Iterated neighbor not in ghost layer");
+  if (is_ghost) {
+    return K + quadid;
+  }
+  tree = p4est_tree_array_index (p4est->trees, treeid);
+  return tree->quadrants_offset + quadid;
+}
+
+/* two sides sharing neither face nor edge are corner neighbors */
+static void
+test_mesh_corner_fn (p4est_iter_corner_info_t * info, void *user_data)
+{
+  test_mesh_oracle_t *oracle = (test_mesh_oracle_t *) user_data;
+  size_t              zi, zk, cz = info->sides.elem_count;
+  p4est_locidx_t      ic;
+  p4est_iter_corner_side_t *si, *sk;
+
+  for (zi = 0; zi < cz; ++zi) {
+    si = (p4est_iter_corner_side_t *) sc_array_index (&info->sides, zi);
+    if (si->is_ghost) {
+      continue;
+    }
+    ic = P4EST_CHILDREN * test_mesh_qid (info->p4est, oracle->K, si->treeid,
+                                         0, si->quad, si->quadid)
+      + si->corner;
+    oracle->corner_inside[ic] = !info->tree_boundary;
+    for (zk = 0; zk < cz; ++zk) {
+      sk = (p4est_iter_corner_side_t *) sc_array_index (&info->sides, zk);
+      if (zk == zi || test_mesh_common (si->faces, sk->faces, P4EST_DIM)
+#ifdef P4_TO_P8
+          || test_mesh_common (si->edges, sk->edges, P4EST_DIM)
+#endif
+        ) {
+        continue;
+      }
+      test_mesh_entry_push (oracle->corners, ic,
+                            test_mesh_qid (info->p4est, oracle->K,
+                                           sk->treeid, sk->is_ghost,
+                                           sk->quad, sk->quadid),
+                            sk->corner, 0);
+    }
+  }
+}
+
+#ifdef P4_TO_P8
+
+/* two sides not sharing a face are edge neighbors */
+static void
+test_mesh_edge_fn (p8est_iter_edge_info_t * info, void *user_data)
+{
+  test_mesh_oracle_t *oracle = (test_mesh_oracle_t *) user_data;
+  int                 j, h, o, code;
+  size_t              zi, zk, cz = info->sides.elem_count;
+  p4est_locidx_t      K = oracle->K, ie;
+  p8est_iter_edge_side_t *si, *sk;
+
+  for (zi = 0; zi < cz; ++zi) {
+    si = (p8est_iter_edge_side_t *) sc_array_index (&info->sides, zi);
+    for (j = 0; j < (si->is_hanging ? 2 : 1); ++j) {
+      if (si->is_hanging ? si->is.hanging.is_ghost[j] : si->is.full.is_ghost) {
+        continue;
+      }
+      ie = P8EST_EDGES * (si->is_hanging ?
+                          test_mesh_qid (info->p4est, K, si->treeid, 0,
+                                         si->is.hanging.quad[j],
+                                         si->is.hanging.quadid[j]) :
+                          test_mesh_qid (info->p4est, K, si->treeid, 0,
+                                         si->is.full.quad,
+                                         si->is.full.quadid)) + si->edge;
+      oracle->edge_inside[ie] = !info->tree_boundary;
+      for (zk = 0; zk < cz; ++zk) {
+        sk = (p8est_iter_edge_side_t *) sc_array_index (&info->sides, zk);
+        if (zk == zi || test_mesh_common (si->faces, sk->faces, 2)) {
+          continue;
+        }
+        o = si->orientation ^ sk->orientation;
+        code = o * P8EST_EDGES + sk->edge;
+        if (!sk->is_hanging) {
+          /* a same-size or double-size neighbor */
+          test_mesh_entry_push (oracle->edges, ie,
+                                test_mesh_qid (info->p4est, K, sk->treeid,
+                                               sk->is.full.is_ghost,
+                                               sk->is.full.quad,
+                                               sk->is.full.quadid),
+                                si->is_hanging ?
+                                2 * P8EST_EDGES * (j + 1) + code : code, 0);
+        }
+        else if (!si->is_hanging) {
+          /* two half-size neighbors in the order of their edge corners */
+          for (h = 0; h < 2; ++h) {
+            test_mesh_entry_push (oracle->edges, ie,
+                                  test_mesh_qid (info->p4est, K, sk->treeid,
+                                                 sk->is.hanging.is_ghost[h],
+                                                 sk->is.hanging.quad[h],
+                                                 sk->is.hanging.quadid[h]),
+                                  code - 2 * P8EST_EDGES, h);
+          }
+        }
+        else {
+          /* the same-size neighbor at the same end of the edge */
+          h = j ^ o;
+          test_mesh_entry_push (oracle->edges, ie,
+                                test_mesh_qid (info->p4est, K, sk->treeid,
+                                               sk->is.hanging.is_ghost[h],
+                                               sk->is.hanging.quad[h],
+                                               sk->is.hanging.quadid[h]),
+                                code, 0);
+        }
+      }
+    }
+  }
+}
+
+#endif /* P4_TO_P8 */
+
+/* require two sorted lists of neighbors to be equal */
+static void
+test_mesh_entries_equal (sc_array_t * actual, sc_array_t * expected,
+                         const char *what)
+{
+  size_t              zz;
+
+  sc_array_sort (actual, test_mesh_entry_compare);
+  sc_array_sort (expected, test_mesh_entry_compare);
+  SC_CHECK_ABORTF (actual->elem_count == expected->elem_count,
+                   "CSR %s count mismatch", what);
+  for (zz = 0; zz < actual->elem_count; ++zz) {
+    SC_CHECK_ABORTF (!test_mesh_entry_compare (sc_array_index (actual, zz),
+                                               sc_array_index (expected, zz)),
+                     "CSR %s neighbor mismatch", what);
+  }
+}
+
+/* compare the corner neighbors of p4est_mesh_new_csr to the iterator */
+static void
+test_mesh_corners (p4est_mesh_t * csr, test_mesh_oracle_t * oracle)
+{
+  int                 corner;
+  p4est_locidx_t      K, QpG, ic, qtc, i, cstart, cend;
+  sc_array_t         *actual;
+
+  K = csr->local_num_quadrants;
+  QpG = K + csr->ghost_num_quadrants;
+  actual = sc_array_new (sizeof (test_mesh_entry_t));
+  for (ic = 0; ic < P4EST_CHILDREN * K; ++ic) {
+    corner = (int) (ic % P4EST_CHILDREN);
+    qtc = csr->quad_to_corner[ic];
+    SC_CHECK_ABORTF (qtc >= -1 && qtc < QpG + csr->local_num_corners,
+                     "CSR corner %lld range", (long long) ic);
+    if (qtc == -1) {
+      continue;
+    }
+    if (qtc < QpG) {
+      /* a diagonal neighbor on the inside of a tree is stored directly */
+      SC_CHECK_ABORTF (oracle->corner_inside[ic] == 1,
+                       "CSR corner %lld stored directly", (long long) ic);
+      test_mesh_entry_push (actual, ic, qtc, corner ^ (P4EST_CHILDREN - 1),
+                            0);
+      continue;
+    }
+    SC_CHECK_ABORTF (oracle->corner_inside[ic] == 0,
+                     "CSR corner %lld stored as group", (long long) ic);
+    qtc -= QpG;
+    cstart = *(p4est_locidx_t *) sc_array_index (csr->corner_offset, qtc);
+    cend = *(p4est_locidx_t *) sc_array_index (csr->corner_offset, qtc + 1);
+    SC_CHECK_ABORT (cstart < cend, "CSR corner group empty");
+    for (i = cstart; i < cend; ++i) {
+      test_mesh_entry_push (actual, ic, *(p4est_locidx_t *)
+                            sc_array_index (csr->corner_quad, i),
+                            *(int8_t *) sc_array_index (csr->corner_corner,
+                                                        i), 0);
+    }
+  }
+  test_mesh_entries_equal (actual, oracle->corners, "corner");
+  sc_array_destroy (actual);
+}
+
+#ifdef P4_TO_P8
+
+/* decode an edge code into edge, orientation and size relation */
+static void
+test_mesh_edge_decode (int code, int *ne, int *o, int *rel)
+{
+  if (code < 0) {
+    code += 2 * P8EST_EDGES;
+    *rel = -1;
+  }
+  else if (code >= 2 * P8EST_EDGES) {
+    code %= 2 * P8EST_EDGES;
+    *rel = 1;
+  }
+  else {
+    *rel = 0;
+  }
+  *o = code / P8EST_EDGES;
+  *ne = code % P8EST_EDGES;
+}
+
+/* compare the edge neighbors of p8est_mesh_new_csr to the iterator and
+ * check that each local neighbor lists the quadrant across its edge */
+static void
+test_mesh_edges (p4est_mesh_t * csr, test_mesh_oracle_t * oracle)
+{
+  int                 edge, ne, o, rel, rne, ro, rrel;
+  size_t              zz;
+  p4est_locidx_t      K, QpG, ie, qte, i, estart, eend, rkey;
+  p4est_locidx_t     *offsets;
+  sc_array_t         *actual;
+  test_mesh_entry_t  *e, *r;
+
+  K = csr->local_num_quadrants;
+  QpG = K + csr->ghost_num_quadrants;
+  SC_CHECK_ABORT (csr->edge_offset->elem_count ==
+                  (size_t) csr->local_num_edges + 1, "CSR edge count");
+  actual = sc_array_new (sizeof (test_mesh_entry_t));
+  for (ie = 0; ie < P8EST_EDGES * K; ++ie) {
+    edge = (int) (ie % P8EST_EDGES);
+    qte = csr->quad_to_edge[ie];
+    SC_CHECK_ABORTF (qte >= -1 && qte < QpG + csr->local_num_edges,
+                     "CSR edge %lld range", (long long) ie);
+    if (qte == -1) {
+      continue;
+    }
+    if (qte < QpG) {
+      /* a same-size neighbor on the inside of a tree is stored directly */
+      SC_CHECK_ABORTF (oracle->edge_inside[ie] == 1,
+                       "CSR edge %lld stored directly", (long long) ie);
+      test_mesh_entry_push (actual, ie, qte, edge ^ 3, 0);
+      continue;
+    }
+    qte -= QpG;
+    estart = *(p4est_locidx_t *) sc_array_index (csr->edge_offset, qte);
+    eend = *(p4est_locidx_t *) sc_array_index (csr->edge_offset, qte + 1);
+    SC_CHECK_ABORT (estart < eend, "CSR edge group empty");
+    for (i = estart; i < eend; ++i) {
+      rel = *(int8_t *) sc_array_index (csr->edge_edge, i);
+      test_mesh_entry_push (actual, ie, *(p4est_locidx_t *)
+                            sc_array_index (csr->edge_quad, i), rel, 0);
+      if (rel < 0) {
+        /* half-size neighbors come in pairs of equal code */
+        SC_CHECK_ABORT (i + 1 < eend && rel ==
+                        *(int8_t *) sc_array_index (csr->edge_edge, i + 1),
+                        "CSR edge half pair");
+        ++i;
+        test_mesh_entry_push (actual, ie, *(p4est_locidx_t *)
+                              sc_array_index (csr->edge_quad, i), rel, 1);
+      }
+    }
+  }
+
+  /* index the sorted entries by quadrant edge */
+  sc_array_sort (actual, test_mesh_entry_compare);
+  offsets = P4EST_ALLOC_ZERO (p4est_locidx_t, P8EST_EDGES * K + 1);
+  for (zz = 0; zz < actual->elem_count; ++zz) {
+    e = (test_mesh_entry_t *) sc_array_index (actual, zz);
+    ++offsets[e->key + 1];
+  }
+  for (ie = 0; ie < P8EST_EDGES * K; ++ie) {
+    offsets[ie + 1] += offsets[ie];
+  }
+
+  /* a local neighbor lists the quadrant across the matching edge */
+  for (zz = 0; zz < actual->elem_count; ++zz) {
+    e = (test_mesh_entry_t *) sc_array_index (actual, zz);
+    if (e->qid >= K) {
+      continue;
+    }
+    test_mesh_edge_decode (e->code, &ne, &o, &rel);
+    rkey = P8EST_EDGES * e->qid + ne;
+    for (i = offsets[rkey]; i < offsets[rkey + 1]; ++i) {
+      r = (test_mesh_entry_t *) sc_array_index (actual, (size_t) i);
+      test_mesh_edge_decode (r->code, &rne, &ro, &rrel);
+      if (r->qid == e->key / P8EST_EDGES &&
+          rne == (int) (e->key % P8EST_EDGES) && ro == o && rrel == -rel) {
+        break;
+      }
+    }
+    SC_CHECK_ABORTF (i < offsets[rkey + 1], "CSR edge %lld not symmetric",
+                     (long long) e->key);
+  }
+  P4EST_FREE (offsets);
+
+  test_mesh_entries_equal (actual, oracle->edges, "edge");
+  sc_array_destroy (actual);
+}
+
+#endif /* P4_TO_P8 */
+
+/* find the corner and edge neighbors by iteration and compare them */
+static void
+test_mesh_neighbors (p4est_t * p4est, p4est_ghost_t * ghost,
+                     p4est_mesh_t * csr)
+{
+  p4est_locidx_t      K = csr->local_num_quadrants;
+  test_mesh_oracle_t  oracle;
+
+  oracle.K = K;
+  oracle.corners = sc_array_new (sizeof (test_mesh_entry_t));
+  oracle.corner_inside = P4EST_ALLOC (int8_t, P4EST_CHILDREN * K);
+  memset (oracle.corner_inside, -1, P4EST_CHILDREN * K * sizeof (int8_t));
+#ifndef P4_TO_P8
+  p4est_iterate (p4est, ghost, &oracle, NULL, NULL, test_mesh_corner_fn);
+#else
+  oracle.edges = sc_array_new (sizeof (test_mesh_entry_t));
+  oracle.edge_inside = P4EST_ALLOC (int8_t, P8EST_EDGES * K);
+  memset (oracle.edge_inside, -1, P8EST_EDGES * K * sizeof (int8_t));
+  p8est_iterate (p4est, ghost, &oracle, NULL, NULL, test_mesh_edge_fn,
+                 test_mesh_corner_fn);
+#endif
+
+  if (csr->quad_to_corner != NULL) {
+    test_mesh_corners (csr, &oracle);
+  }
+#ifdef P4_TO_P8
+  if (csr->quad_to_edge != NULL) {
+    test_mesh_edges (csr, &oracle);
+  }
+  P4EST_FREE (oracle.edge_inside);
+  sc_array_destroy (oracle.edges);
+#endif
+  P4EST_FREE (oracle.corner_inside);
+  sc_array_destroy (oracle.corners);
+}
+
+static void
+test_mesh_run (sc_MPI_Comm mpicomm, p4est_connectivity_t * conn,
+               p4est_connect_type_t btype)
+{
+  p4est_t            *p4est;
+  p4est_ghost_t      *ghost;
+  p4est_mesh_t       *mesh, *csr;
+
+  p4est = p4est_new (mpicomm, conn, 0, NULL, NULL);
+  p4est_refine (p4est, 1, refine_fn, NULL);
+  p4est_balance (p4est, P4EST_CONNECT_FULL, NULL);
+  p4est_partition (p4est, 0, NULL);
+
+  ghost = p4est_ghost_new (p4est, P4EST_CONNECT_FULL);
+  mesh = p4est_mesh_new_ext (p4est, ghost, 1, 0, btype);
+  csr = p4est_mesh_new_csr (p4est, ghost, 1, 0, btype);
+  test_mesh_faces (mesh, csr);
+  test_mesh_iterator (p4est, ghost, mesh, csr);
+  test_mesh_neighbors (p4est, ghost, csr);
+
+  p4est_mesh_destroy (csr);
+  p4est_mesh_destroy (mesh);
+  p4est_ghost_destroy (ghost);
+  p4est_destroy (p4est);
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  int                 i;
+  sc_MPI_Comm         mpicomm;
+  p4est_connectivity_t *conn[3];
+
+  /* initialize MPI */
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+#ifndef P4_TO_P8
+  conn[0] = p4est_connectivity_new_moebius ();
+  conn[1] = p4est_connectivity_new_rotwrap ();
+#else
+  conn[0] = p8est_connectivity_new_rotcubes ();
+  conn[1] = p8est_connectivity_new_rotwrap ();
+#endif
+  conn[2] = p4est_connectivity_new_periodic ();
+
+  for (i = 0; i < 3; ++i) {
+    test_mesh_run (mpicomm, conn[i], P4EST_CONNECT_FACE);
+#ifdef P4_TO_P8
+    test_mesh_run (mpicomm, conn[i], P8EST_CONNECT_EDGE);
+#endif
+    test_mesh_run (mpicomm, conn[i], P4EST_CONNECT_FULL);
+    p4est_connectivity_destroy (conn[i]);
+  }
+
+  /* exit */
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}
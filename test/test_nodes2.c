@@ -24,10 +24,12 @@
 
 #ifndef P4_TO_P8
 #include <p4est.h>
+#include <p4est_bits.h>
 #include <p4est_extended.h>
 #include <p4est_nodes.h>
 #else
 #include <p8est.h>
+#include <p8est_bits.h>
 #include <p8est_extended.h>
 #include <p8est_nodes.h>
 #endif
@@ -58,7 +60,9 @@ main (int argc, char **argv)
   p4est_t            *p4est;
   p4est_connectivity_t *connectivity;
   p4est_ghost_t      *ghost;
-  p4est_nodes_t      *nodes1, *nodes2;
+  size_t              zz;
+  p4est_nodes_t      *nodes1, *nodes2, *nodes3;
+  p4est_indep_t      *in1, *in3;
 
   mpiret = sc_MPI_Init (&argc, &argv);
   SC_CHECK_MPI (mpiret);
@@ -88,9 +92,40 @@ main (int argc, char **argv)
   P4EST_GLOBAL_INFO ("Making nodes without ghosts\n");
   nodes2 = p4est_nodes_new (p4est, NULL);
 
+  /* the hash based collection of nodes must give the same result */
+  P4EST_GLOBAL_INFO ("Making nodes with hash arrays\n");
+  p4est->inspect = P4EST_ALLOC_ZERO (p4est_inspect_t, 1);
+  p4est->inspect->use_nodes_hash = 1;
+  nodes3 = p4est_nodes_new (p4est, ghost);
+  P4EST_FREE (p4est->inspect);
+  p4est->inspect = NULL;
+  SC_CHECK_ABORT (nodes3->num_owned_indeps == nodes1->num_owned_indeps &&
+                  nodes3->offset_owned_indeps == nodes1->offset_owned_indeps,
+                  "Nodes owned");
+  SC_CHECK_ABORT (nodes3->indep_nodes.elem_count ==
+                  nodes1->indep_nodes.elem_count, "Nodes indep count");
+  for (zz = 0; zz < nodes1->indep_nodes.elem_count; ++zz) {
+    in1 = (p4est_indep_t *) sc_array_index (&nodes1->indep_nodes, zz);
+    in3 = (p4est_indep_t *) sc_array_index (&nodes3->indep_nodes, zz);
+    SC_CHECK_ABORT (p4est_quadrant_is_equal_piggy ((p4est_quadrant_t *) in1,
+                                                   (p4est_quadrant_t *) in3)
+                    && in1->p.piggy3.local_num == in3->p.piggy3.local_num
+                    && in1->pad8 == in3->pad8, "Nodes indep");
+  }
+  SC_CHECK_ABORT (nodes3->face_hangings.elem_count ==
+                  nodes1->face_hangings.elem_count, "Nodes face hangings");
+#ifdef P4_TO_P8
+  SC_CHECK_ABORT (nodes3->edge_hangings.elem_count ==
+                  nodes1->edge_hangings.elem_count, "Nodes edge hangings");
+#endif
+  SC_CHECK_ABORT (!memcmp (nodes3->local_nodes, nodes1->local_nodes,
+                           P4EST_CHILDREN * nodes1->num_local_quadrants *
+                           sizeof (p4est_locidx_t)), "Nodes local");
+
   /* clean up and exit */
   p4est_nodes_destroy (nodes1);
   p4est_nodes_destroy (nodes2);
+  p4est_nodes_destroy (nodes3);
   p4est_ghost_destroy (ghost);
   p4est_destroy (p4est);
   p4est_connectivity_destroy (connectivity);
@@ -277,6 +277,49 @@ test_transfer_post (test_transfer_t * tt, p4est_t * p4est)
   P4EST_FREE (tt);
 }
 
+static void
+test_owner_lookup (p4est_t * p4est, int radix_bits)
+{
+  int                 p;
+  size_t              zz;
+  p4est_topidx_t      tt;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *quad;
+  p4est_comm_owner_lookup_t *lookup;
+  sc_array_t         *owners;
+
+  lookup = p4est_comm_owner_lookup_new (p4est, radix_bits);
+
+  /* every partition marker is owned by its own nonempty process */
+  for (p = 0; p < p4est->mpisize; ++p) {
+    if (!p4est_comm_is_empty (p4est, p)) {
+      quad = &p4est->global_first_position[p];
+      SC_CHECK_ABORT (p4est_comm_owner_lookup_find
+                      (lookup, quad->p.which_tree, quad) == p,
+                      "Owner lookup marker mismatch");
+    }
+  }
+
+  /* all local quadrants are owned by this process, also in batches */
+  owners = sc_array_new (sizeof (int));
+  for (tt = p4est->first_local_tree; tt <= p4est->last_local_tree; ++tt) {
+    tree = p4est_tree_array_index (p4est->trees, tt);
+    p4est_comm_owner_lookup_batch (lookup, tt, &tree->quadrants, owners);
+    SC_CHECK_ABORT (owners->elem_count == tree->quadrants.elem_count,
+                    "Owner batch count mismatch");
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      quad = p4est_quadrant_array_index (&tree->quadrants, zz);
+      SC_CHECK_ABORT (p4est_comm_owner_lookup_find (lookup, tt, quad) ==
+                      p4est->mpirank, "Owner lookup mismatch");
+      SC_CHECK_ABORT (*(int *) sc_array_index (owners, zz) ==
+                      p4est->mpirank, "Owner batch mismatch");
+    }
+  }
+  sc_array_destroy (owners);
+
+  p4est_comm_owner_lookup_destroy (lookup);
+}
+
 static void
 test_pertree (p4est_t * p4est, const p4est_gloidx_t * prev_pertree,
               p4est_gloidx_t * new_pertree)
@@ -306,6 +349,10 @@ test_pertree (p4est_t * p4est, const p4est_gloidx_t * prev_pertree,
 
   /* test traversal routine */
   p4est_search_partition (p4est, 1, traverse_fn, NULL, NULL);
+
+  /* test owner lookup with and without radix table */
+  test_owner_lookup (p4est, 0);
+  test_owner_lookup (p4est, P4EST_DIM + 1);
 }
 
 static void
@@ -426,6 +473,9 @@ main (int argc, char **argv)
   int64_t             sum;
   unsigned            crc;
   test_transfer_t    *tt;
+  p4est_partition_context_t *pc;
+  p4est_gloidx_t      keep_first;
+  p4est_locidx_t      keep_count;
 
   mpiret = sc_MPI_Init (&argc, &argv);
   SC_CHECK_MPI (mpiret);
@@ -546,6 +596,27 @@ main (int argc, char **argv)
   SC_CHECK_ABORT (crc == p4est_checksum (copy),
                   "bad checksum after unevenly weighted partition 3");
 
+  /* do a split partition and read the unchanged forest in between */
+  tt = test_transfer_pre (copy);
+  pc = p4est_partition_begin (copy, 0, weight_one);
+  SC_CHECK_ABORT (crc == p4est_checksum (copy),
+                  "bad checksum during split partition");
+  keep_first = copy->global_first_quadrant[rank] + pc->local_keep_first;
+  keep_count = pc->local_keep_count;
+  SC_CHECK_ABORT (0 <= pc->local_keep_first && 0 <= keep_count &&
+                  pc->local_keep_first + keep_count <=
+                  copy->local_num_quadrants, "bad kept range");
+  (void) p4est_partition_end (pc);
+  SC_CHECK_ABORT (keep_count == 0 ||
+                  (copy->global_first_quadrant[rank] <= keep_first &&
+                   keep_first + keep_count <=
+                   copy->global_first_quadrant[rank + 1]),
+                  "kept quadrants not local after split partition");
+  test_transfer_post (tt, copy);
+  test_pertree (copy, pertree1, pertree2);
+  SC_CHECK_ABORT (crc == p4est_checksum (copy),
+                  "bad checksum after split partition");
+
   /* check user data content */
   for (t = copy->first_local_tree; t <= copy->last_local_tree; ++t) {
     tree = p4est_tree_array_index (copy->trees, t);
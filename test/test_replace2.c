@@ -116,6 +116,191 @@ replace_fn (p4est_t * p4est, p4est_topidx_t which_tree,
                   "_replace_t incoming and outgoing don't align");
 }
 
+static void
+test_refine_flags (p4est_t * p4est)
+{
+  int8_t             *flags;
+  size_t              zz;
+  unsigned            crc;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      k, lq, num_old;
+  p4est_locidx_t     *old_to_new;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q;
+  p4est_quadrant_t   *old_quadrants;
+  p4est_t            *copy;
+
+  /* evaluate the refinement callback once for each local quadrant */
+  num_old = p4est->local_num_quadrants;
+  flags = P4EST_ALLOC (int8_t, num_old);
+  old_quadrants = P4EST_ALLOC (p4est_quadrant_t, num_old);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      flags[lq] = (int8_t) refine_fn (p4est, jt, q);
+      old_quadrants[lq] = *q;
+    }
+  }
+
+  /* refining by flags must match refining by callback */
+  copy = p4est_copy (p4est, 0);
+  p4est_refine_ext (copy, 0, -1, refine_fn, NULL, replace_fn);
+  crc = p4est_checksum (copy);
+  p4est_destroy (copy);
+  old_to_new = P4EST_ALLOC (p4est_locidx_t, num_old + 1);
+  p4est_refine_flags (p4est, flags, -1, NULL, replace_fn, old_to_new);
+  SC_CHECK_ABORT (p4est_checksum (p4est) == crc, "Refine flags checksum");
+
+  /* each old quadrant is kept or replaced by its children */
+  SC_CHECK_ABORT (old_to_new[0] == 0 &&
+                  old_to_new[num_old] == p4est->local_num_quadrants,
+                  "Refine flags map size");
+  k = 0;
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      if (k < num_old && lq == old_to_new[k]) {
+        /* the first new quadrant of an old one */
+        if (old_to_new[k + 1] - old_to_new[k] == 1) {
+          SC_CHECK_ABORT (p4est_quadrant_is_equal (q, old_quadrants + k),
+                          "Refine flags kept");
+        }
+        else {
+          SC_CHECK_ABORT (old_to_new[k + 1] - old_to_new[k] ==
+                          P4EST_CHILDREN &&
+                          p4est_quadrant_is_parent (old_quadrants + k, q),
+                          "Refine flags children");
+        }
+        ++k;
+      }
+    }
+  }
+  SC_CHECK_ABORT (k == num_old, "Refine flags map");
+
+  P4EST_FREE (flags);
+  P4EST_FREE (old_quadrants);
+  P4EST_FREE (old_to_new);
+}
+
+static void
+test_adapt (p4est_t * p4est)
+{
+  int                 i, *counts;
+  int8_t             *marks;
+  size_t              zz;
+  double             *old_data[2], *new_fields[2], *sums;
+  const double       *old_fields[2];
+  p4est_topidx_t      jt, *new_trees;
+  p4est_locidx_t      k, l, lq, num_old;
+  p4est_locidx_t     *offsets, *indices;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, **new_quadrants;
+  p4est_quadrant_t   *old_quadrants;
+  sc_array_t         *map_offsets, *map_indices;
+  p4est_project_t    *project;
+
+  /* mark for refinement and coarsening by the callbacks above */
+  num_old = p4est->local_num_quadrants;
+  marks = P4EST_ALLOC (int8_t, num_old);
+  old_quadrants = P4EST_ALLOC (p4est_quadrant_t, num_old);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      marks[lq] = (int8_t) (refine_fn (p4est, jt, q) ? 1 :
+                            q->y < P4EST_ROOT_LEN / 2 ? -1 : 0);
+      old_quadrants[lq] = *q;
+      old_quadrants[lq].p.which_tree = jt;
+    }
+  }
+
+  map_offsets = sc_array_new (sizeof (p4est_locidx_t));
+  map_indices = sc_array_new (sizeof (p4est_locidx_t));
+  p4est_adapt (p4est, marks, P4EST_CONNECT_FULL, NULL,
+               map_offsets, map_indices);
+  SC_CHECK_ABORT (p4est_is_balanced (p4est, P4EST_CONNECT_FULL),
+                  "Adapt balance");
+
+  /* every old quadrant overlaps exactly the new quadrants it maps to */
+  new_quadrants = P4EST_ALLOC (p4est_quadrant_t *,
+                               p4est->local_num_quadrants);
+  new_trees = P4EST_ALLOC (p4est_topidx_t, p4est->local_num_quadrants);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      new_quadrants[lq] = p4est_quadrant_array_index (&tree->quadrants, zz);
+      new_trees[lq] = jt;
+    }
+  }
+  SC_CHECK_ABORT (map_offsets->elem_count == (size_t) num_old + 1,
+                  "Adapt map size");
+  offsets = (p4est_locidx_t *) map_offsets->array;
+  indices = (p4est_locidx_t *) map_indices->array;
+  SC_CHECK_ABORT (offsets[0] == 0 &&
+                  offsets[num_old] == (p4est_locidx_t) map_indices->elem_count,
+                  "Adapt map offsets");
+  for (k = 0; k < num_old; ++k) {
+    SC_CHECK_ABORT (offsets[k] < offsets[k + 1], "Adapt map empty");
+    for (l = offsets[k]; l < offsets[k + 1]; ++l) {
+      SC_CHECK_ABORT (0 <= indices[l] &&
+                      indices[l] < p4est->local_num_quadrants,
+                      "Adapt map index");
+      q = new_quadrants[indices[l]];
+      SC_CHECK_ABORT (new_trees[indices[l]] == old_quadrants[k].p.which_tree &&
+                      p4est_quadrant_overlaps (q, old_quadrants + k),
+                      "Adapt map overlap");
+    }
+  }
+
+  /* project a constant and the old quadrant number with default kernels */
+  project = p4est_project_new (p4est, map_offsets, map_indices);
+  for (i = 0; i < 2; ++i) {
+    old_fields[i] = old_data[i] = P4EST_ALLOC (double, num_old);
+    new_fields[i] = P4EST_ALLOC (double, p4est->local_num_quadrants);
+  }
+  for (k = 0; k < num_old; ++k) {
+    old_data[0][k] = 3.;
+    old_data[1][k] = (double) k;
+  }
+  p4est_project_apply (project, 2, 1, old_fields, new_fields,
+                       NULL, NULL, NULL);
+  sums = P4EST_ALLOC_ZERO (double, p4est->local_num_quadrants);
+  counts = P4EST_ALLOC_ZERO (int, p4est->local_num_quadrants);
+  for (k = 0; k < num_old; ++k) {
+    for (l = offsets[k]; l < offsets[k + 1]; ++l) {
+      sums[indices[l]] += (double) k;
+      ++counts[indices[l]];
+    }
+  }
+  for (lq = 0; lq < p4est->local_num_quadrants; ++lq) {
+    SC_CHECK_ABORT (counts[lq] == 1 || counts[lq] == P4EST_CHILDREN,
+                    "Project relation");
+    SC_CHECK_ABORT (new_fields[0][lq] == 3., "Project constant");
+    SC_CHECK_ABORT (new_fields[1][lq] == sums[lq] / counts[lq],
+                    "Project value");
+  }
+  p4est_project_destroy (project);
+  for (i = 0; i < 2; ++i) {
+    P4EST_FREE (old_data[i]);
+    P4EST_FREE (new_fields[i]);
+  }
+  P4EST_FREE (sums);
+  P4EST_FREE (counts);
+
+  P4EST_FREE (new_quadrants);
+  P4EST_FREE (new_trees);
+  sc_array_destroy (map_offsets);
+  sc_array_destroy (map_indices);
+  P4EST_FREE (marks);
+  P4EST_FREE (old_quadrants);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -146,6 +331,8 @@ main (int argc, char **argv)
   p4est_refine_ext (p4est, 1, P4EST_QMAXLEVEL, refine_fn, NULL, replace_fn);
   p4est_coarsen_ext (p4est, 1, 0, coarsen_fn, NULL, replace_fn);
   p4est_balance_ext (p4est, P4EST_CONNECT_FULL, NULL, replace_fn);
+  test_refine_flags (p4est);
+  test_adapt (p4est);
 
   p4est_destroy (p4est);
   p4est_connectivity_destroy (connectivity);
@@ -26,6 +26,7 @@
 #include <p4est_algorithms.h>
 #include <p4est_bits.h>
 #include <p4est_build.h>
+#include <p4est_communication.h>
 #include <p4est_extended.h>
 #include <p4est_geometry.h>
 #include <p4est_search.h>
@@ -34,6 +35,7 @@
 #include <p8est_algorithms.h>
 #include <p8est_bits.h>
 #include <p8est_build.h>
+#include <p8est_communication.h>
 #include <p8est_extended.h>
 #include <p8est_geometry.h>
 #include <p8est_search.h>
@@ -99,6 +101,21 @@ count_callback (p4est_t * p4est, p4est_topidx_t which_tree,
   }
 }
 
+static int
+count_all_callback (p4est_t * p4est, p4est_topidx_t which_tree,
+                    p4est_quadrant_t * quadrant, int pfirst, int plast,
+                    p4est_locidx_t local_num, void *point)
+{
+  P4EST_ASSERT (point == NULL);
+
+  if (local_num >= 0) {
+    /* every thread counts into its own context */
+    P4EST_ASSERT (pfirst == p4est->mpirank && plast == p4est->mpirank);
+    ++*(p4est_locidx_t *) p4est->user_pointer;
+  }
+  return 1;
+}
+
 static int
 search_callback (p4est_t * p4est, p4est_topidx_t which_tree,
                  p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
@@ -150,6 +167,477 @@ search_callback (p4est_t * p4est, p4est_topidx_t which_tree,
   return is_match;
 }
 
+static void
+search_batch_callback (p4est_t * p4est, p4est_topidx_t which_tree,
+                       p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
+                       sc_array_t * points, const size_t * indices,
+                       size_t num_indices, uint8_t * matches)
+{
+  size_t              zz;
+
+  P4EST_ASSERT (num_indices > 0);
+  for (zz = 0; zz < num_indices; ++zz) {
+    P4EST_ASSERT (indices[zz] < points->elem_count);
+    matches[zz] = (uint8_t)
+      search_callback (p4est, which_tree, quadrant, local_num,
+                       sc_array_index (points, indices[zz]));
+  }
+}
+
+static void
+test_locate_points (p4est_t * p4est)
+{
+  int                 j, *owner;
+  size_t              zz, iz, num_points;
+  p4est_topidx_t      jt, *which_tree;
+  p4est_locidx_t     *local_num;
+  p4est_qcoord_t      h;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q, origin;
+  double             *xyz[P4EST_DIM];
+
+  num_points = (size_t) p4est->local_num_quadrants;
+  which_tree = P4EST_ALLOC (p4est_topidx_t, num_points);
+  for (j = 0; j < P4EST_DIM; ++j) {
+    xyz[j] = P4EST_ALLOC (double, num_points);
+  }
+  local_num = P4EST_ALLOC (p4est_locidx_t, num_points);
+  owner = P4EST_ALLOC (int, num_points);
+
+  /* locate the centers of the local leaves given in reverse order */
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      iz = num_points - 1 - (size_t) tree->quadrants_offset - zz;
+      h = P4EST_QUADRANT_LEN (q->level) / 2;
+      which_tree[iz] = jt;
+      xyz[0][iz] = (q->x + h) / (double) P4EST_ROOT_LEN;
+      xyz[1][iz] = (q->y + h) / (double) P4EST_ROOT_LEN;
+#ifdef P4_TO_P8
+      xyz[2][iz] = (q->z + h) / (double) P4EST_ROOT_LEN;
+#endif
+    }
+  }
+  p4est_locate_points (p4est, num_points, which_tree, xyz,
+                       local_num, owner);
+  for (iz = 0; iz < num_points; ++iz) {
+    SC_CHECK_ABORT ((size_t) local_num[iz] == num_points - 1 - iz,
+                    "Locate leaf");
+    SC_CHECK_ABORT (owner[iz] == p4est->mpirank, "Locate owner");
+  }
+
+  /* the lower corner of a leaf is on interior faces and belongs to it */
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      iz = (size_t) tree->quadrants_offset + zz;
+      xyz[0][iz] = q->x / (double) P4EST_ROOT_LEN;
+      xyz[1][iz] = q->y / (double) P4EST_ROOT_LEN;
+#ifdef P4_TO_P8
+      xyz[2][iz] = q->z / (double) P4EST_ROOT_LEN;
+#endif
+    }
+  }
+  p4est_locate_points (p4est, num_points, which_tree, xyz,
+                       local_num, owner);
+  for (iz = 0; iz < num_points; ++iz) {
+    SC_CHECK_ABORT ((size_t) local_num[iz] == iz, "Locate lower corner");
+  }
+
+  /* the center of the upper y face belongs to the leaf above, unless it
+   * is on the tree boundary where it is assigned to the leaf itself */
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      iz = (size_t) tree->quadrants_offset + zz;
+      h = P4EST_QUADRANT_LEN (q->level);
+      xyz[0][iz] = (q->x + h / 2) / (double) P4EST_ROOT_LEN;
+      xyz[1][iz] = (q->y + h) / (double) P4EST_ROOT_LEN;
+#ifdef P4_TO_P8
+      xyz[2][iz] = (q->z + h / 2) / (double) P4EST_ROOT_LEN;
+#endif
+    }
+  }
+  p4est_locate_points (p4est, num_points, which_tree, xyz,
+                       local_num, owner);
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      iz = (size_t) tree->quadrants_offset + zz;
+      h = P4EST_QUADRANT_LEN (q->level);
+      SC_CHECK_ABORT (((size_t) local_num[iz] == iz) ==
+                      (q->y + h == P4EST_ROOT_LEN), "Locate upper face");
+    }
+  }
+
+  /* locate the origins of the same trees, which may be remote */
+  for (iz = 0; iz < num_points; ++iz) {
+    for (j = 0; j < P4EST_DIM; ++j) {
+      xyz[j][iz] = 0.;
+    }
+  }
+  p4est_locate_points (p4est, num_points, which_tree, xyz,
+                       local_num, owner);
+  P4EST_QUADRANT_INIT (&origin);
+  origin.level = P4EST_QMAXLEVEL;
+  for (iz = 0; iz < num_points; ++iz) {
+    SC_CHECK_ABORT (owner[iz] == p4est_comm_find_owner
+                    (p4est, which_tree[iz], &origin, p4est->mpirank),
+                    "Locate origin owner");
+    SC_CHECK_ABORT ((owner[iz] == p4est->mpirank) == (local_num[iz] >= 0),
+                    "Locate origin leaf");
+  }
+
+  P4EST_FREE (which_tree);
+  for (j = 0; j < P4EST_DIM; ++j) {
+    P4EST_FREE (xyz[j]);
+  }
+  P4EST_FREE (local_num);
+  P4EST_FREE (owner);
+}
+
+typedef struct
+{
+  p4est_topidx_t      which_tree;
+  int                 origin;
+  double              xyz[P4EST_DIM];
+}
+test_record_t;
+
+static int
+test_quadrant_contains (p4est_quadrant_t * q, const double xyz[P4EST_DIM])
+{
+  int                 j;
+  double              lower[P4EST_DIM];
+  const double        h = P4EST_QUADRANT_LEN (q->level) /
+    (double) P4EST_ROOT_LEN;
+
+  lower[0] = q->x / (double) P4EST_ROOT_LEN;
+  lower[1] = q->y / (double) P4EST_ROOT_LEN;
+#ifdef P4_TO_P8
+  lower[2] = q->z / (double) P4EST_ROOT_LEN;
+#endif
+  for (j = 0; j < P4EST_DIM; ++j) {
+    if (!(lower[j] <= xyz[j] && xyz[j] <= lower[j] + h)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int
+migrate_callback (p4est_t * p4est, p4est_topidx_t which_tree,
+                  p4est_quadrant_t * quadrant, void *record)
+{
+  test_record_t      *r = (test_record_t *) record;
+
+  return r->which_tree == which_tree &&
+    test_quadrant_contains (quadrant, r->xyz);
+}
+
+static void
+test_search_migrate (p4est_t * p4est)
+{
+  int                 mpiret;
+  int                 j;
+  size_t              zz;
+  p4est_topidx_t      jt;
+  p4est_locidx_t      lq, num_lost;
+  p4est_locidx_t     *offsets;
+  p4est_gloidx_t      counts[2], gcounts[2];
+  p4est_qcoord_t      h;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q;
+  sc_array_t         *records, *aoffsets;
+  test_record_t      *r;
+
+  /* create one record at the mirror image of each local leaf center */
+  records = sc_array_new (sizeof (test_record_t));
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      h = P4EST_QUADRANT_LEN (q->level) / 2;
+      r = (test_record_t *) sc_array_push (records);
+      r->which_tree = p4est->connectivity->num_trees - 1 - jt;
+      r->origin = p4est->mpirank;
+      r->xyz[0] = 1. - (q->x + h) / (double) P4EST_ROOT_LEN;
+      r->xyz[1] = 1. - (q->y + h) / (double) P4EST_ROOT_LEN;
+#ifdef P4_TO_P8
+      r->xyz[2] = 1. - (q->z + h) / (double) P4EST_ROOT_LEN;
+#endif
+    }
+  }
+  counts[0] = (p4est_gloidx_t) records->elem_count;
+
+  /* every record must arrive in a matching local quadrant */
+  aoffsets = sc_array_new (sizeof (p4est_locidx_t));
+  num_lost = p4est_search_migrate (p4est, migrate_callback,
+                                   records, aoffsets);
+  SC_CHECK_ABORT (num_lost == 0, "Migrate lost");
+  SC_CHECK_ABORT (aoffsets->elem_count ==
+                  (size_t) p4est->local_num_quadrants + 1, "Migrate size");
+  offsets = (p4est_locidx_t *) aoffsets->array;
+  SC_CHECK_ABORT (offsets[0] == 0 && offsets[p4est->local_num_quadrants] ==
+                  (p4est_locidx_t) records->elem_count, "Migrate offsets");
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+      SC_CHECK_ABORT (offsets[lq] <= offsets[lq + 1], "Migrate range");
+      for (j = offsets[lq]; j < offsets[lq + 1]; ++j) {
+        r = (test_record_t *) sc_array_index_int (records, j);
+        SC_CHECK_ABORT (r->which_tree == jt &&
+                        test_quadrant_contains (q, r->xyz), "Migrate leaf");
+        SC_CHECK_ABORT (j == offsets[lq] || r[-1].origin <= r->origin,
+                        "Migrate order");
+      }
+    }
+  }
+
+  /* no record may be lost or duplicated */
+  counts[1] = (p4est_gloidx_t) records->elem_count;
+  mpiret = sc_MPI_Allreduce (counts, gcounts, 2, P4EST_MPI_GLOIDX,
+                             sc_MPI_SUM, p4est->mpicomm);
+  SC_CHECK_MPI (mpiret);
+  SC_CHECK_ABORT (gcounts[0] == p4est->global_num_quadrants &&
+                  gcounts[1] == gcounts[0], "Migrate count");
+
+  sc_array_destroy (aoffsets);
+  sc_array_destroy (records);
+}
+
+static void
+test_corner_mean (p4est_t * p4est, p4est_geometry_t * geom,
+                  p4est_topidx_t which_tree, p4est_quadrant_t * q,
+                  double xyz[3])
+{
+  int                 c, j;
+  double              vxyz[3], abc[3];
+  p4est_qcoord_t      h, qx, qy;
+#ifdef P4_TO_P8
+  p4est_qcoord_t      qz;
+#endif
+
+  h = P4EST_QUADRANT_LEN (q->level);
+  xyz[0] = xyz[1] = xyz[2] = 0.;
+  for (c = 0; c < P4EST_CHILDREN; ++c) {
+    qx = q->x + ((c & 1) ? h : 0);
+    qy = q->y + ((c & 2) ? h : 0);
+#ifdef P4_TO_P8
+    qz = q->z + ((c & 4) ? h : 0);
+#endif
+    if (geom != NULL) {
+      abc[0] = qx / (double) P4EST_ROOT_LEN;
+      abc[1] = qy / (double) P4EST_ROOT_LEN;
+#ifndef P4_TO_P8
+      abc[2] = 0.;
+#else
+      abc[2] = qz / (double) P4EST_ROOT_LEN;
+#endif
+      geom->X (geom, which_tree, abc, vxyz);
+    }
+    else {
+      p4est_qcoord_to_vertex (p4est->connectivity, which_tree, qx, qy,
+#ifdef P4_TO_P8
+                              qz,
+#endif
+                              vxyz);
+    }
+    for (j = 0; j < 3; ++j) {
+      xyz[j] += vxyz[j] / P4EST_CHILDREN;
+    }
+  }
+}
+
+static void
+test_search_nearest (p4est_t * p4est, p4est_geometry_t * geom)
+{
+  size_t              zz, iz;
+  double              xyz[3];
+  p4est_topidx_t      jt;
+  p4est_locidx_t      lq;
+  p4est_tree_t       *tree;
+  p4est_quadrant_t   *q;
+  p4est_ghost_t      *ghost;
+  p4est_search_nearest_t *match;
+  sc_array_t         *results;
+
+  ghost = p4est_ghost_new (p4est, P4EST_CONNECT_FULL);
+  results = sc_array_new (sizeof (p4est_search_nearest_t));
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      q = p4est_quadrant_array_index (&tree->quadrants, zz);
+      lq = tree->quadrants_offset + (p4est_locidx_t) zz;
+
+      /* the mean of the corners is inside their bounding box */
+      test_corner_mean (p4est, geom, jt, q, xyz);
+
+      /* the closest leaf is at distance zero up to roundoff */
+      p4est_search_knn (p4est, ghost, geom, xyz, 1, results);
+      SC_CHECK_ABORT (results->elem_count == 1, "Nearest count");
+      match = (p4est_search_nearest_t *) sc_array_index (results, 0);
+      SC_CHECK_ABORT (match->distance < 1e-12, "Nearest distance");
+
+      /* the leaf itself is among those touching the point */
+      p4est_search_ball (p4est, ghost, geom, xyz, 1e-12, results);
+      for (iz = 0; iz < results->elem_count; ++iz) {
+        match = (p4est_search_nearest_t *) sc_array_index (results, iz);
+        SC_CHECK_ABORT (match->distance <= 1e-12, "Ball distance");
+        if (!match->is_ghost && match->local_num == lq) {
+          SC_CHECK_ABORT (match->which_tree == jt, "Ball tree");
+          break;
+        }
+      }
+      SC_CHECK_ABORT (iz < results->elem_count, "Ball leaf");
+    }
+  }
+
+  /* asking for all leaves returns them in ascending order */
+  xyz[0] = xyz[1] = xyz[2] = 0.;
+  p4est_search_knn (p4est, ghost, geom, xyz,
+                    (int) (p4est->local_num_quadrants +
+                           ghost->ghosts.elem_count + 1), results);
+  SC_CHECK_ABORT (results->elem_count == (size_t) p4est->local_num_quadrants
+                  + ghost->ghosts.elem_count, "Nearest all");
+  for (iz = 1; iz < results->elem_count; ++iz) {
+    match = (p4est_search_nearest_t *) sc_array_index (results, iz);
+    SC_CHECK_ABORT (match[-1].distance <= match->distance, "Nearest order");
+  }
+
+  sc_array_destroy (results);
+  p4est_ghost_destroy (ghost);
+}
+
+typedef struct
+{
+  p4est_locidx_t      expected;
+  p4est_locidx_t      found;
+  double              xyz[3];
+}
+test_box_point_t;
+
+static int
+bbox_callback (p4est_t * p4est, p4est_topidx_t which_tree,
+               p4est_quadrant_t * quadrant, p4est_locidx_t local_num,
+               void *point)
+{
+  int                 j;
+  double              lower[3], upper[3];
+  test_box_point_t   *bp = (test_box_point_t *) point;
+
+  p4est_bbox_cache_get ((p4est_bbox_cache_t *) p4est->user_pointer,
+                        which_tree, quadrant, local_num, lower, upper);
+  for (j = 0; j < 3; ++j) {
+    if (!(lower[j] - 1e-12 <= bp->xyz[j] && bp->xyz[j] <= upper[j] + 1e-12)) {
+      return 0;
+    }
+  }
+  if (local_num == bp->expected) {
+    bp->found = local_num;
+  }
+  return 1;
+}
+
+static int
+bbox_refine_fn (p4est_t * p4est, p4est_topidx_t which_tree,
+                p4est_quadrant_t * quadrant)
+{
+  return p4est_quadrant_child_id (quadrant) == 0;
+}
+
+/** Search with the cache and compare with the searches computing boxes. */
+static void
+test_bbox_cache_search (p4est_t * p4est, p4est_geometry_t * geom,
+                        p4est_bbox_cache_t * cache)
+{
+  size_t              zz, iz;
+  void               *user_pointer;
+  p4est_topidx_t      jt;
+  p4est_tree_t       *tree;
+  sc_array_t         *points, *results, *cached;
+  test_box_point_t   *bp;
+  p4est_search_nearest_t *match, *cmatch;
+
+  /* one point per local leaf at the mean of its corners */
+  points = sc_array_new (sizeof (test_box_point_t));
+  for (jt = p4est->first_local_tree; jt <= p4est->last_local_tree; ++jt) {
+    tree = p4est_tree_array_index (p4est->trees, jt);
+    for (zz = 0; zz < tree->quadrants.elem_count; ++zz) {
+      bp = (test_box_point_t *) sc_array_push (points);
+      bp->expected = tree->quadrants_offset + (p4est_locidx_t) zz;
+      bp->found = -1;
+      test_corner_mean (p4est, geom, jt,
+                        p4est_quadrant_array_index (&tree->quadrants, zz),
+                        bp->xyz);
+    }
+  }
+
+  /* the cached branch boxes must lead every point to its leaf */
+  user_pointer = p4est->user_pointer;
+  p4est->user_pointer = cache;
+  p4est_search_local (p4est, 0, NULL, bbox_callback, points);
+  p4est->user_pointer = user_pointer;
+  for (zz = 0; zz < points->elem_count; ++zz) {
+    bp = (test_box_point_t *) sc_array_index (points, zz);
+    SC_CHECK_ABORT (bp->found == bp->expected, "Box cache search");
+  }
+
+  /* the nearest searches find the same distances with and without cache */
+  results = sc_array_new (sizeof (p4est_search_nearest_t));
+  cached = sc_array_new (sizeof (p4est_search_nearest_t));
+  for (zz = 0; zz < points->elem_count; zz += 7) {
+    bp = (test_box_point_t *) sc_array_index (points, zz);
+    p4est_search_knn (p4est, NULL, geom, bp->xyz, 5, results);
+    p4est_search_knn_ext (cache, NULL, bp->xyz, 5, cached);
+    SC_CHECK_ABORT (results->elem_count == cached->elem_count,
+                    "Box cache knn count");
+    for (iz = 0; iz < results->elem_count; ++iz) {
+      match = (p4est_search_nearest_t *) sc_array_index (results, iz);
+      cmatch = (p4est_search_nearest_t *) sc_array_index (cached, iz);
+      SC_CHECK_ABORT (match->distance == cmatch->distance,
+                      "Box cache knn distance");
+    }
+    p4est_search_ball (p4est, NULL, geom, bp->xyz, 1e-12, results);
+    p4est_search_ball_ext (cache, NULL, bp->xyz, 1e-12, cached);
+    SC_CHECK_ABORT (results->elem_count == cached->elem_count,
+                    "Box cache ball count");
+    for (iz = 0; iz < cached->elem_count; ++iz) {
+      cmatch = (p4est_search_nearest_t *) sc_array_index (cached, iz);
+      SC_CHECK_ABORT (!cmatch->is_ghost, "Box cache ball ghost");
+      if (cmatch->local_num == bp->expected) {
+        break;
+      }
+    }
+    SC_CHECK_ABORT (iz < cached->elem_count, "Box cache ball leaf");
+  }
+
+  sc_array_destroy (cached);
+  sc_array_destroy (results);
+  sc_array_destroy (points);
+}
+
+static void
+test_bbox_cache (p4est_t * p4est, p4est_geometry_t * geom)
+{
+  p4est_bbox_cache_t *cache;
+
+  cache = p4est_bbox_cache_new (p4est, geom, 2);
+  test_bbox_cache_search (p4est, geom, cache);
+
+  /* refining changes the revision and the cache must be rebuilt */
+  p4est_refine (p4est, 0, bbox_refine_fn, NULL);
+  test_bbox_cache_search (p4est, geom, cache);
+
+  p4est_bbox_cache_destroy (cache);
+}
+
 typedef struct
 {
   int                 maxlevel;
@@ -550,6 +1038,7 @@ main (int argc, char **argv)
   int                 found_total;
   p4est_locidx_t      jt, Al, Bl;
   p4est_locidx_t      local_count;
+  p4est_locidx_t      thread_counts[2];
   p4est_connectivity_t *conn;
   p4est_quadrant_t   *A, *B;
   p4est_geometry_t   *geom;
@@ -557,6 +1046,7 @@ main (int argc, char **argv)
   sc_array_t         *points;
   test_point_t       *p;
   const char         *vtkname;
+  void               *thread_users[2];
 
   /* Initialize MPI */
   mpiret = sc_MPI_Init (&argc, &argv);
@@ -637,11 +1127,37 @@ main (int argc, char **argv)
   SC_CHECK_ABORT (A->p.piggy3.local_num == Al, "Search A");
   SC_CHECK_ABORT (B->p.piggy3.local_num == Bl, "Search B");
 
+  /* Repeat with the batched point callback */
+  A->p.piggy3.local_num = B->p.piggy3.local_num = -1;
+  found_count = 0;
+  p4est_search_local_batch (p4est, 0, NULL, search_batch_callback, points);
+  mpiret = sc_MPI_Allreduce (&found_count, &found_total,
+                             1, sc_MPI_INT, sc_MPI_SUM, mpicomm);
+  SC_CHECK_MPI (mpiret);
+  SC_CHECK_ABORT (found_total == (int) points->elem_count, "Batch search");
+  SC_CHECK_ABORT (A->p.piggy3.local_num == Al, "Batch search A");
+  SC_CHECK_ABORT (B->p.piggy3.local_num == Bl, "Batch search B");
+
   /* Use another search to count local quadrants */
   local_count = 0;
   p4est_search_local (p4est, 0, count_callback, NULL, NULL);
   SC_CHECK_ABORT (local_count == p4est->local_num_quadrants, "Count search");
 
+  /* Repeat counting with a threaded search over the whole forest */
+  thread_counts[0] = thread_counts[1] = 0;
+  thread_users[0] = &thread_counts[0];
+  thread_users[1] = &thread_counts[1];
+  p4est_search_all_threaded (p4est, 0, count_all_callback, NULL, NULL,
+                             2, 2, thread_users);
+  SC_CHECK_ABORT (thread_counts[0] + thread_counts[1] ==
+                  p4est->local_num_quadrants, "Threaded count search");
+
+  /* Locate points by their reference coordinates */
+  test_locate_points (p4est);
+  test_search_migrate (p4est);
+  test_search_nearest (p4est, geom);
+  test_bbox_cache (p4est, geom);
+
   /* Clear memory */
   sc_array_destroy (points);
   p4est_destroy (p4est);
@@ -282,6 +282,50 @@ main (int argc, char **argv)
   SC_CHECK_MPI (mpiret);
   P4EST_GLOBAL_INFOF ("%s: Done test 4\n", this_fn_name);
 
+  /*
+   * Test 5: Reorder MPI communicator by a user-defined hierarchy
+   */
+
+  P4EST_GLOBAL_INFOF ("%s: Into test 5\n", this_fn_name);
+  {
+    p4est_t            *p4est_hier;
+    sc_MPI_Comm         hiercomm;
+    int                 levels[2], p, hiersize;
+    int                *all_levels;
+
+    /* group odd ranks first and reverse the order within the groups */
+    levels[0] = 1 - p4est->mpirank % 2;
+    levels[1] = mpisize - p4est->mpirank;
+    p4est_comm_hierarchy_split (mpicomm, 2, levels, &hiercomm);
+    mpiret = sc_MPI_Comm_size (hiercomm, &hiersize);
+    SC_CHECK_MPI (mpiret);
+    SC_CHECK_ABORT (hiersize == mpisize, "Hierarchy size mismatch");
+
+    /* the new rank order must be sorted by levels */
+    all_levels = P4EST_ALLOC (int, 2 * mpisize);
+    mpiret = sc_MPI_Allgather (levels, 2, sc_MPI_INT,
+                               all_levels, 2, sc_MPI_INT, hiercomm);
+    SC_CHECK_MPI (mpiret);
+    for (p = 1; p < mpisize; ++p) {
+      SC_CHECK_ABORT (all_levels[2 * (p - 1)] < all_levels[2 * p] ||
+                      (all_levels[2 * (p - 1)] == all_levels[2 * p] &&
+                       all_levels[2 * p - 1] < all_levels[2 * p + 1]),
+                      "Hierarchy order mismatch");
+    }
+    P4EST_FREE (all_levels);
+
+    /* a forest on the new communicator is partitioned in the new order */
+    p4est_hier = p4est_new_ext (hiercomm, connectivity, min_quadrants,
+                                min_level, fill_uniform, 0, NULL, NULL);
+    SC_CHECK_ABORT (p4est_is_valid (p4est_hier), "Hierarchy forest invalid");
+    p4est_destroy (p4est_hier);
+    mpiret = sc_MPI_Comm_free (&hiercomm);
+    SC_CHECK_MPI (mpiret);
+  }
+  mpiret = sc_MPI_Barrier (mpicomm);
+  SC_CHECK_MPI (mpiret);
+  P4EST_GLOBAL_INFOF ("%s: Done test 5\n", this_fn_name);
+
   /* destroy */
   P4EST_FREE (partition);
   p4est_destroy (p4est);
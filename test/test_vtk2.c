@@ -0,0 +1,386 @@
+/*
+  This file is part of p4est.
+  p4est is a C library to manage a collection (a forest) of multiple
+  connected adaptive quadtrees or octrees in parallel.
+
+  Copyright (C) 2010 The University of Texas System
+  Additional copyright (C) 2011 individual authors
+  Written by Carsten Burstedde, Lucas C. Wilcox, and Tobin Isaac
+
+  p4est is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  p4est is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with p4est; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef P4_TO_P8
+#include <p4est_extended.h>
+#include <p4est_vtk.h>
+#else
+#include <p8est_extended.h>
+#include <p8est_vtk.h>
+#endif
+#ifdef P4EST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/* the uniform level of the forests with large arrays */
+#ifndef P4_TO_P8
+#define TEST_VTK_LEVEL 8
+#else
+#define TEST_VTK_LEVEL 5
+#endif
+
+#ifndef P4EST_VTK_DOUBLES
+typedef float       test_vtk_float_t;
+#else
+typedef double      test_vtk_float_t;
+#endif
+
+static int
+test_vtk_refine_origin (p4est_t * p4est, p4est_topidx_t which_tree,
+                        p4est_quadrant_t * quadrant)
+{
+  return which_tree == 0 && quadrant->x == 0 && quadrant->y == 0
+#ifdef P4_TO_P8
+    && quadrant->z == 0
+#endif
+    ;
+}
+
+/** Decode base64 characters, skipping the padding.
+ * \return          The number of bytes written to \b out.
+ */
+static size_t
+test_vtk_base64_decode (const char *in, size_t n, unsigned char *out)
+{
+  static const char  *table =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t              zz, k;
+  int                 bits, nbits;
+  const char         *c;
+
+  bits = nbits = 0;
+  for (zz = 0, k = 0; zz < n && in[zz] != '='; ++zz) {
+    c = strchr (table, in[zz]);
+    SC_CHECK_ABORT (c != NULL && *c != '\0', "VTK base64 character");
+    bits = ((bits << 6) | (int) (c - table)) & 0xffffff;
+    nbits += 6;
+    if (nbits >= 8) {
+      nbits -= 8;
+      out[k++] = (unsigned char) ((bits >> nbits) & 0xff);
+    }
+  }
+  return k;
+}
+
+/* decode the data array of the given name and compare it with the data */
+static void
+test_vtk_decode (const char *filename, const char *name,
+                 p4est_vtk_format_t format, const char *data, size_t bytes)
+{
+  FILE               *file;
+  long                length;
+  char               *text, *pos, *end, tag[BUFSIZ];
+  unsigned char      *decoded;
+  size_t              nchars, ndec;
+  uint32_t            header;
+#ifdef P4EST_HAVE_ZLIB
+  unsigned char      *raw;
+  uint32_t           *blocks;
+  size_t              num_blocks, header_chars, zz, offset;
+  uLongf              raw_length;
+  int                 retval;
+#endif
+
+  /* read the whole file */
+  file = fopen (filename, "rb");
+  SC_CHECK_ABORT (file != NULL, "VTK open");
+  SC_CHECK_ABORT (!fseek (file, 0, SEEK_END), "VTK seek");
+  length = ftell (file);
+  SC_CHECK_ABORT (length > 0 && !fseek (file, 0, SEEK_SET), "VTK tell");
+  text = P4EST_ALLOC (char, length + 1);
+  SC_CHECK_ABORT (fread (text, 1, (size_t) length, file) == (size_t) length,
+                  "VTK read");
+  text[length] = '\0';
+  SC_CHECK_ABORT (!fclose (file), "VTK close");
+
+  /* the encoded characters follow the opening tag on their own line */
+  snprintf (tag, BUFSIZ, "Name=\"%s\"", name);
+  pos = strstr (text, tag);
+  SC_CHECK_ABORT (pos != NULL, "VTK data array");
+  pos = strchr (pos, '>');
+  SC_CHECK_ABORT (pos != NULL, "VTK data array tag");
+  pos += strspn (pos + 1, " \n") + 1;
+  end = strchr (pos, '\n');
+  SC_CHECK_ABORT (end != NULL, "VTK data array end");
+  nchars = (size_t) (end - pos);
+  decoded = P4EST_ALLOC (unsigned char, nchars);
+
+  if (format == P4EST_VTK_FORMAT_BINARY) {
+    /* the byte count is encoded together with the data */
+    ndec = test_vtk_base64_decode (pos, nchars, decoded);
+    SC_CHECK_ABORT (ndec == sizeof (uint32_t) + bytes, "VTK binary length");
+    memcpy (&header, decoded, sizeof (uint32_t));
+    SC_CHECK_ABORT ((size_t) header == bytes, "VTK binary header");
+    SC_CHECK_ABORT (!memcmp (decoded + sizeof (uint32_t), data, bytes),
+                    "VTK binary data");
+  }
+  else {
+#ifdef P4EST_HAVE_ZLIB
+    /* the header of block sizes is encoded separately from the blocks */
+    num_blocks = (bytes + P4EST_VTK_BLOCK_SIZE - 1) / P4EST_VTK_BLOCK_SIZE;
+    header_chars = 4 * ((sizeof (uint32_t) * (3 + num_blocks) + 2) / 3);
+    SC_CHECK_ABORT (header_chars <= nchars, "VTK compressed header length");
+    blocks = P4EST_ALLOC (uint32_t, 3 + num_blocks);
+    ndec = test_vtk_base64_decode (pos, header_chars,
+                                   (unsigned char *) blocks);
+    SC_CHECK_ABORT (ndec == sizeof (uint32_t) * (3 + num_blocks) &&
+                    (size_t) blocks[0] == num_blocks &&
+                    (size_t) blocks[1] == P4EST_VTK_BLOCK_SIZE &&
+                    (size_t) blocks[2] == bytes % P4EST_VTK_BLOCK_SIZE,
+                    "VTK compressed header");
+    ndec = test_vtk_base64_decode (pos + header_chars,
+                                   nchars - header_chars, decoded);
+
+    /* uncompress the blocks one by one */
+    raw = P4EST_ALLOC (unsigned char, bytes);
+    offset = 0;
+    for (zz = 0; zz < num_blocks; ++zz) {
+      raw_length = (uLongf) SC_MIN (P4EST_VTK_BLOCK_SIZE,
+                                    bytes - zz * P4EST_VTK_BLOCK_SIZE);
+      SC_CHECK_ABORT (offset + blocks[3 + zz] <= ndec,
+                      "VTK compressed block size");
+      retval = uncompress (raw + zz * P4EST_VTK_BLOCK_SIZE, &raw_length,
+                           decoded + offset, (uLong) blocks[3 + zz]);
+      SC_CHECK_ABORT (retval == Z_OK && (size_t) raw_length ==
+                      SC_MIN (P4EST_VTK_BLOCK_SIZE,
+                              bytes - zz * P4EST_VTK_BLOCK_SIZE),
+                      "VTK uncompress");
+      offset += blocks[3 + zz];
+    }
+    SC_CHECK_ABORT (offset == ndec, "VTK compressed length");
+    SC_CHECK_ABORT (!memcmp (raw, data, bytes), "VTK compressed data");
+    P4EST_FREE (raw);
+    P4EST_FREE (blocks);
+#else
+    SC_ABORT_NOT_REACHED ();
+#endif
+  }
+
+  P4EST_FREE (decoded);
+  P4EST_FREE (text);
+}
+
+/* remove the files written for a forest on one or all processes */
+static void
+test_vtk_remove (const char *filename, int mpirank, int is_root)
+{
+  char                name[BUFSIZ];
+
+  snprintf (name, BUFSIZ, "%s_%04d.vtu", filename, mpirank);
+  SC_CHECK_ABORT (!remove (name), "VTK remove");
+  if (is_root) {
+    snprintf (name, BUFSIZ, "%s.pvtu", filename);
+    SC_CHECK_ABORT (!remove (name), "VTK remove meta");
+    snprintf (name, BUFSIZ, "%s.visit", filename);
+    SC_CHECK_ABORT (!remove (name), "VTK remove visit");
+  }
+}
+
+/* write the forest with cell and point data in every VTK format and
+ * decode the cell data of the binary formats again */
+static void
+test_vtk_formats (p4est_t * p4est, p4est_geometry_t * geom)
+{
+  int                 f, retval;
+  char                filename[BUFSIZ], vtufilename[BUFSIZ];
+  const p4est_vtk_format_t formats[3] = {
+    P4EST_VTK_FORMAT_ASCII, P4EST_VTK_FORMAT_BINARY,
+    P4EST_VTK_FORMAT_COMPRESSED
+  };
+  size_t              zz;
+  sc_array_t         *cells, *points;
+  test_vtk_float_t   *expected;
+  p4est_vtk_context_t *cont;
+
+  cells = sc_array_new_count (sizeof (double), p4est->local_num_quadrants);
+  expected = P4EST_ALLOC (test_vtk_float_t, cells->elem_count);
+  for (zz = 0; zz < cells->elem_count; ++zz) {
+    *(double *) sc_array_index (cells, zz) = (double) zz;
+    expected[zz] = (test_vtk_float_t) zz;
+  }
+  points = sc_array_new_count (sizeof (double),
+                               P4EST_CHILDREN * p4est->local_num_quadrants);
+  for (zz = 0; zz < points->elem_count; ++zz) {
+    *(double *) sc_array_index (points, zz) = (double) (zz % P4EST_CHILDREN);
+  }
+#ifdef P4EST_HAVE_ZLIB
+  for (f = 0; f < 3; ++f) {
+#else
+  for (f = 0; f < 2; ++f) {
+#endif
+    snprintf (filename, BUFSIZ, P4EST_STRING "_vtk_format_%d", f);
+    cont = p4est_vtk_context_new (p4est, filename);
+    p4est_vtk_context_set_geom (cont, geom);
+    p4est_vtk_context_set_format (cont, formats[f]);
+    cont = p4est_vtk_write_header (cont);
+    SC_CHECK_ABORT (cont != NULL, "VTK header");
+    cont = p4est_vtk_write_cell_dataf (cont, 1, 1, 1, 0, 1, 0,
+                                       "cells", cells, cont);
+    SC_CHECK_ABORT (cont != NULL, "VTK cell data");
+    cont = p4est_vtk_write_point_dataf (cont, 1, 0, "points", points, cont);
+    SC_CHECK_ABORT (cont != NULL, "VTK point data");
+    retval = p4est_vtk_write_footer (cont);
+    SC_CHECK_ABORT (!retval, "VTK footer");
+
+    if (formats[f] != P4EST_VTK_FORMAT_ASCII) {
+      snprintf (vtufilename, BUFSIZ, "%s_%04d.vtu", filename, p4est->mpirank);
+      test_vtk_decode (vtufilename, "cells", formats[f],
+                       (const char *) expected,
+                       sizeof (test_vtk_float_t) * cells->elem_count);
+      test_vtk_remove (filename, p4est->mpirank, p4est->mpirank == 0);
+    }
+  }
+  P4EST_FREE (expected);
+  sc_array_destroy (cells);
+  sc_array_destroy (points);
+}
+
+/* write a point vector field that spans more than one batch of blocks on a
+ * forest of each process alone and decode it again; the uniform forest
+ * yields a whole number of blocks and the refined one a partial block */
+static void
+test_vtk_roundtrip (int mpirank)
+{
+  int                 f, refine, retval;
+  char                filename[BUFSIZ], vtufilename[BUFSIZ];
+  const p4est_vtk_format_t formats[2] = {
+    P4EST_VTK_FORMAT_BINARY, P4EST_VTK_FORMAT_COMPRESSED
+  };
+  size_t              zz, bytes;
+  sc_array_t         *vectors;
+  test_vtk_float_t   *expected;
+  p4est_connectivity_t *conn;
+  p4est_t            *p4est;
+  p4est_vtk_context_t *cont;
+
+#ifndef P4_TO_P8
+  conn = p4est_connectivity_new_unitsquare ();
+#else
+  conn = p8est_connectivity_new_unitcube ();
+#endif
+  for (refine = 0; refine < 2; ++refine) {
+    p4est = p4est_new_ext (sc_MPI_COMM_SELF, conn, 0, TEST_VTK_LEVEL, 1, 0,
+                           NULL, NULL);
+    if (refine) {
+      p4est_refine (p4est, 0, test_vtk_refine_origin, NULL);
+    }
+
+    /* the vertex scaling writes one point for every quadrant corner */
+    vectors = sc_array_new_count (sizeof (double), 3 * P4EST_CHILDREN *
+                                  (size_t) p4est->local_num_quadrants);
+    expected = P4EST_ALLOC (test_vtk_float_t, vectors->elem_count);
+    for (zz = 0; zz < vectors->elem_count; ++zz) {
+      *(double *) sc_array_index (vectors, zz) = (double) (zz % 1000);
+      expected[zz] = (test_vtk_float_t) (zz % 1000);
+    }
+    bytes = sizeof (test_vtk_float_t) * vectors->elem_count;
+    SC_CHECK_ABORT (bytes > P4EST_VTK_BATCH_BLOCKS * P4EST_VTK_BLOCK_SIZE &&
+                    (refine || bytes % P4EST_VTK_BLOCK_SIZE == 0) &&
+                    (!refine || bytes % P4EST_VTK_BLOCK_SIZE != 0),
+                    "VTK round trip sizes");
+
+#ifdef P4EST_HAVE_ZLIB
+    for (f = 0; f < 2; ++f) {
+#else
+    for (f = 0; f < 1; ++f) {
+#endif
+      snprintf (filename, BUFSIZ, P4EST_STRING "_vtk_roundtrip_%d_%d_%d",
+                mpirank, refine, f);
+      cont = p4est_vtk_context_new (p4est, filename);
+      p4est_vtk_context_set_scale (cont, .95);
+      p4est_vtk_context_set_format (cont, formats[f]);
+      cont = p4est_vtk_write_header (cont);
+      SC_CHECK_ABORT (cont != NULL, "VTK header");
+      cont = p4est_vtk_write_point_dataf (cont, 0, 1, "vectors", vectors,
+                                          cont);
+      SC_CHECK_ABORT (cont != NULL, "VTK point data");
+      retval = p4est_vtk_write_footer (cont);
+      SC_CHECK_ABORT (!retval, "VTK footer");
+
+      /* the forest lives on a single process */
+      snprintf (vtufilename, BUFSIZ, "%s_%04d.vtu", filename, 0);
+      test_vtk_decode (vtufilename, "vectors", formats[f],
+                       (const char *) expected, bytes);
+      test_vtk_remove (filename, 0, 1);
+    }
+
+    P4EST_FREE (expected);
+    sc_array_destroy (vectors);
+    p4est_destroy (p4est);
+  }
+  p4est_connectivity_destroy (conn);
+}
+
+
+static int
+test_vtk_refine (p4est_t * p4est, p4est_topidx_t which_tree,
+                 p4est_quadrant_t * quadrant)
+{
+  return (int) quadrant->level < 4 - (int) (which_tree % 3);
+}
+
+int
+main (int argc, char **argv)
+{
+  int                 mpiret;
+  sc_MPI_Comm         mpicomm;
+  p4est_t            *p4est;
+  p4est_connectivity_t *connectivity;
+  p4est_geometry_t   *geom;
+
+  mpiret = sc_MPI_Init (&argc, &argv);
+  SC_CHECK_MPI (mpiret);
+  mpicomm = sc_MPI_COMM_WORLD;
+
+  sc_init (mpicomm, 1, 1, NULL, SC_LP_DEFAULT);
+  p4est_init (NULL, SC_LP_DEFAULT);
+
+  /* a nonuniform forest in all formats */
+#ifndef P4_TO_P8
+  connectivity = p4est_connectivity_new_star ();
+  geom = p4est_geometry_new_connectivity (connectivity);
+#else
+  connectivity = p8est_connectivity_new_rotcubes ();
+  geom = NULL;
+#endif
+  p4est = p4est_new_ext (mpicomm, connectivity, 0, 1, 1, 0, NULL, NULL);
+  p4est_refine (p4est, 1, test_vtk_refine, NULL);
+  p4est_partition (p4est, 0, NULL);
+  test_vtk_formats (p4est, geom);
+
+  /* large arrays on a forest of each process alone */
+  test_vtk_roundtrip (p4est->mpirank);
+
+  p4est_destroy (p4est);
+  if (geom != NULL) {
+    p4est_geometry_destroy (geom);
+  }
+  p4est_connectivity_destroy (connectivity);
+  sc_finalize ();
+
+  mpiret = sc_MPI_Finalize ();
+  SC_CHECK_MPI (mpiret);
+
+  return 0;
+}